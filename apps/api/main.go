@@ -1,14 +1,20 @@
 package main
 
 import (
+	"context"
+	"errors"
 	"log"
 	"net/http"
 	"os"
+	"os/signal"
+	"syscall"
+	"time"
 
 	"github.com/gin-gonic/gin"
 	"github.com/penguintechinc/project-template/shared/licensing"
 	"github.com/prometheus/client_golang/prometheus"
 	"github.com/prometheus/client_golang/prometheus/promhttp"
+	"github.com/redis/go-redis/v9"
 )
 
 var (
@@ -62,6 +68,23 @@ func main() {
 		}
 	}
 
+	ctx, stop := signal.NotifyContext(context.Background(), os.Interrupt, syscall.SIGTERM)
+	defer stop()
+
+	// Feature gate, revalidated when the license server announces a change
+	fg := licensing.NewFeatureGate(licenseClient)
+	defer fg.Close()
+
+	if url := os.Getenv("REDIS_URL"); url != "" {
+		rdb, err := newRedis(url)
+		if err != nil {
+			log.Printf("License updates not watched: %v", err)
+		} else {
+			defer rdb.Close()
+			fg.WatchLicenseUpdates(ctx, licenseSubscriber{rdb})
+		}
+	}
+
 	// Set up Gin router
 	if os.Getenv("GIN_MODE") == "release" {
 		gin.SetMode(gin.ReleaseMode)
@@ -104,8 +127,6 @@ func main() {
 		v1.GET("/features", getFeatures)
 
 		// Feature-gated endpoints
-		fg := licensing.NewFeatureGate(licenseClient)
-
 		advanced := v1.Group("/advanced")
 		advanced.Use(fg.RequireFeature("advanced_analytics"))
 		{
@@ -125,10 +146,53 @@ func main() {
 		port = "8080"
 	}
 
-	log.Printf("Starting server on port %s", port)
-	if err := r.Run(":" + port); err != nil {
-		log.Fatal("Failed to start server:", err)
+	srv := &http.Server{Addr: ":" + port, Handler: r}
+	errc := make(chan error, 1)
+	go func() {
+		log.Printf("Starting server on port %s", port)
+		errc <- srv.ListenAndServe()
+	}()
+
+	select {
+	case err := <-errc:
+		if !errors.Is(err, http.ErrServerClosed) {
+			log.Printf("Failed to start server: %v", err)
+		}
+	case <-ctx.Done():
+		log.Printf("Shutting down")
+		shutdownCtx, cancel := context.WithTimeout(context.Background(), 10*time.Second)
+		defer cancel()
+		if err := srv.Shutdown(shutdownCtx); err != nil {
+			log.Printf("Server shutdown: %v", err)
+		}
+	}
+}
+
+// newRedis connects to the Redis server at url.
+func newRedis(url string) (*redis.Client, error) {
+	opts, err := redis.ParseURL(url)
+	if err != nil {
+		return nil, err
+	}
+	client := redis.NewClient(opts)
+
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+	if err := client.Ping(ctx).Err(); err != nil {
+		client.Close()
+		return nil, err
 	}
+	return client, nil
+}
+
+// licenseSubscriber subscribes to the channel that
+// database.RedisClient.PublishLicenseUpdate announces license changes on.
+type licenseSubscriber struct {
+	*redis.Client
+}
+
+func (s licenseSubscriber) SubscribeLicenseUpdates(ctx context.Context, licenseKey string) *redis.PubSub {
+	return s.Subscribe(ctx, "license_updates:"+licenseKey)
 }
 
 func getStatus(c *gin.Context) {
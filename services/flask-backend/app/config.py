@@ -31,6 +31,12 @@ class Config:
     DB_PASS = get_secret("DB_PASS", "app_pass")
     DB_POOL_SIZE = int(os.getenv("DB_POOL_SIZE", "10"))
 
+    # Principal cache - auth_required's user lookups (see principal.py)
+    REDIS_URL = os.getenv("REDIS_URL", "")
+    PRINCIPAL_CACHE_TTL = int(os.getenv("PRINCIPAL_CACHE_TTL", "5"))
+    PRINCIPAL_CACHE_LOCAL_TTL = int(os.getenv("PRINCIPAL_CACHE_LOCAL_TTL", "2"))
+    PRINCIPAL_CACHE_SIZE = int(os.getenv("PRINCIPAL_CACHE_SIZE", "10000"))
+
     # OpenSearch - Logs and Analytics
     OPENSEARCH_HOST = os.getenv("OPENSEARCH_HOST", "localhost")
     OPENSEARCH_PORT = int(os.getenv("OPENSEARCH_PORT", "9200"))
@@ -86,5 +92,6 @@ class TestingConfig(Config):
     """Testing configuration."""
 
     TESTING = True
+    PRINCIPAL_CACHE_TTL = 0
     DB_TYPE = "sqlite"
     DB_NAME = ":memory:"
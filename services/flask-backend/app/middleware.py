@@ -7,6 +7,7 @@ import jwt
 from flask import current_app, g, jsonify, request
 
 from .models import get_user_by_id
+from .principal import load_principal
 
 
 def get_token_from_header() -> Optional[str]:
@@ -54,12 +55,12 @@ def auth_required(f: Callable) -> Callable:
         if payload.get("type") != "access":
             return jsonify({"error": "Invalid token type"}), 401
 
-        # Get user from database
+        # Get user from the principal cache, or the database on a miss
         user_id = payload.get("sub")
         if not user_id:
             return jsonify({"error": "Invalid token payload"}), 401
 
-        user = get_user_by_id(int(user_id))
+        user = load_principal(int(user_id), get_user_by_id)
         if not user:
             return jsonify({"error": "User not found"}), 401
 
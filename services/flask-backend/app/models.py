@@ -1,5 +1,7 @@
 """PyDAL Database Models."""
 
+import logging
+import time
 from datetime import datetime
 from typing import Optional
 
@@ -11,6 +13,9 @@ from pydal.validators import (
 )
 
 from .config import Config
+from .principal import invalidate_principal
+
+logger = logging.getLogger(__name__)
 
 # Valid roles for the application
 VALID_ROLES = ["admin", "maintainer", "viewer"]
@@ -323,6 +328,9 @@ def init_db(app: Flask) -> DAL:
         Field("details", "text"),
     )
 
+    # User listings page on (created_at, id); see list_users_after
+    create_index(db, "users_created_at_id", "users", "created_at", "id")
+
     # Commit table definitions
     db.commit()
 
@@ -332,6 +340,21 @@ def init_db(app: Flask) -> DAL:
     return db
 
 
+def create_index(db: DAL, name: str, table: str, *columns: str) -> None:
+    """Create an index if the database does not have it yet."""
+    columns_sql = ", ".join(columns)
+    if db._dbname == "mysql":
+        # MySQL has no IF NOT EXISTS for indexes; it fails once the index exists
+        sql = f"CREATE INDEX {name} ON {table} ({columns_sql})"
+    else:
+        sql = f"CREATE INDEX IF NOT EXISTS {name} ON {table} ({columns_sql})"
+    try:
+        db.executesql(sql)
+    except Exception as e:
+        db.rollback()
+        logger.debug("Index %s not created: %s", name, e)
+
+
 def get_db() -> DAL:
     """Get database connection for current request context."""
     from flask import current_app
@@ -367,6 +390,7 @@ def create_user(email: str, password_hash: str, full_name: str = "",
         is_active=True,
     )
     db.commit()
+    _count_cache.pop("users", None)
     return get_user_by_id(user_id)
 
 
@@ -383,6 +407,7 @@ def update_user(user_id: int, **kwargs) -> Optional[dict]:
 
     db(db.users.id == user_id).update(**update_data)
     db.commit()
+    invalidate_principal(user_id)
     return get_user_by_id(user_id)
 
 
@@ -391,21 +416,71 @@ def delete_user(user_id: int) -> bool:
     db = get_db()
     deleted = db(db.users.id == user_id).delete()
     db.commit()
+    invalidate_principal(user_id)
+    _count_cache.pop("users", None)
     return deleted > 0
 
 
 def list_users(page: int = 1, per_page: int = 20) -> tuple[list[dict], int]:
-    """List users with pagination."""
+    """List users with offset pagination.
+
+    Deep pages cost in proportion to the offset; list_users_after does not.
+    """
     db = get_db()
     offset = (page - 1) * per_page
 
     users = db(db.users).select(
-        orderby=db.users.created_at,
+        orderby=db.users.created_at | db.users.id,
         limitby=(offset, offset + per_page),
     )
-    total = db(db.users).count()
 
-    return [u.as_dict() for u in users], total
+    return [u.as_dict() for u in users], count_users()
+
+
+def list_users_after(cursor: Optional[tuple[datetime, int]] = None,
+                     limit: int = 20) -> tuple[list[dict], Optional[tuple[datetime, int]]]:
+    """List users in (created_at, id) order after cursor (keyset pagination).
+
+    Returns the page and the cursor of its last row, or None on the last page.
+    Each page is one range scan of the (created_at, id) index, however deep.
+    """
+    db = get_db()
+    query = db.users.id > 0
+    if cursor is not None:
+        created_at, user_id = cursor
+        query = (db.users.created_at > created_at) | (
+            (db.users.created_at == created_at) & (db.users.id > user_id)
+        )
+
+    # One extra row tells whether another page follows
+    rows = db(query).select(
+        orderby=db.users.created_at | db.users.id,
+        limitby=(0, limit + 1),
+    )
+    users = [u.as_dict() for u in rows[:limit]]
+
+    next_cursor = None
+    if len(rows) > limit:
+        last = users[-1]
+        next_cursor = (last["created_at"], last["id"])
+    return users, next_cursor
+
+
+# Table counts are cached for COUNT_CACHE_SECONDS; a COUNT(*) scans the table
+COUNT_CACHE_SECONDS = 30
+_count_cache: dict[str, tuple[float, int]] = {}
+
+
+def count_users() -> int:
+    """Return the number of users, cached for COUNT_CACHE_SECONDS."""
+    cached = _count_cache.get("users")
+    now = time.monotonic()
+    if cached and cached[0] > now:
+        return cached[1]
+    db = get_db()
+    total = db(db.users).count()
+    _count_cache["users"] = (now + COUNT_CACHE_SECONDS, total)
+    return total
 
 
 def store_refresh_token(user_id: int, token_hash: str, expires_at: datetime) -> int:
@@ -444,4 +519,5 @@ def revoke_all_user_tokens(user_id: int) -> int:
     db = get_db()
     updated = db(db.refresh_tokens.user_id == user_id).update(revoked=True)
     db.commit()
+    invalidate_principal(user_id)
     return updated
@@ -0,0 +1,198 @@
+"""Short-lived cache of authenticated principals.
+
+auth_required resolves the user behind every access token. Rather than
+query the database each time, it keeps what requests use of that user
+(id, email, name, role and active flag) in two layers:
+
+* an in-process LRU, fresh for PRINCIPAL_CACHE_LOCAL_TTL seconds;
+* Redis, when REDIS_URL is set, fresh for PRINCIPAL_CACHE_TTL seconds and
+  shared by every worker.
+
+Anything that changes a user's role or active flag, or ends their sessions,
+must call invalidate_principal(). That clears both layers at once in this
+worker; other workers may serve their local copy until it goes stale, so
+a change reaches every worker within PRINCIPAL_CACHE_LOCAL_TTL seconds.
+
+A worker that read the row before a change must not put it back in Redis
+after the invalidation. Invalidating stamps a new version on the user, and
+a fill only writes to Redis if the version is the one it saw before
+reading the row.
+"""
+
+import json
+import logging
+import secrets
+import threading
+import time
+from collections import OrderedDict
+from datetime import datetime
+from typing import Callable, Optional
+
+from flask import current_app
+
+try:
+    import redis
+except ImportError:  # pragma: no cover - Redis layer is optional
+    redis = None
+
+logger = logging.getLogger(__name__)
+
+# Fields of the user row a principal keeps
+PRINCIPAL_FIELDS = ("id", "email", "full_name", "role", "is_active", "created_at")
+
+REDIS_KEY_PREFIX = "principal:"
+
+# Caches a principal unless the user was invalidated since the fill began.
+# KEYS: principal, version; ARGV: version seen ("" if none), principal, TTL
+_FILL_SCRIPT = """
+if (redis.call('GET', KEYS[2]) or '') ~= ARGV[1] then
+    return 0
+end
+redis.call('SET', KEYS[1], ARGV[2], 'EX', ARGV[3])
+return 1
+"""
+
+
+class _LocalCache:
+    """Thread-safe LRU of principals with a fixed time to live."""
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._entries: OrderedDict[int, tuple[float, dict]] = OrderedDict()
+
+    def get(self, user_id: int) -> Optional[dict]:
+        now = time.monotonic()
+        with self._lock:
+            entry = self._entries.get(user_id)
+            if entry is None:
+                return None
+            expires, principal = entry
+            if expires <= now:
+                del self._entries[user_id]
+                return None
+            self._entries.move_to_end(user_id)
+            return principal
+
+    def put(self, user_id: int, principal: dict, ttl: float, max_size: int) -> None:
+        with self._lock:
+            self._entries[user_id] = (time.monotonic() + ttl, principal)
+            self._entries.move_to_end(user_id)
+            while len(self._entries) > max_size:
+                self._entries.popitem(last=False)
+
+    def pop(self, user_id: int) -> None:
+        with self._lock:
+            self._entries.pop(user_id, None)
+
+
+_local = _LocalCache()
+_redis_lock = threading.Lock()
+_redis_clients: dict[str, "redis.Redis"] = {}
+
+
+def _redis_client() -> Optional["redis.Redis"]:
+    """Return this process's Redis client, or None without REDIS_URL."""
+    url = current_app.config.get("REDIS_URL", "")
+    if not url or redis is None:
+        return None
+    client = _redis_clients.get(url)
+    if client is None:
+        with _redis_lock:
+            client = _redis_clients.get(url)
+            if client is None:
+                client = redis.Redis.from_url(
+                    url,
+                    socket_timeout=0.05,
+                    socket_connect_timeout=0.1,
+                )
+                _redis_clients[url] = client
+    return client
+
+
+def _to_principal(user: dict) -> dict:
+    return {k: user.get(k) for k in PRINCIPAL_FIELDS}
+
+
+def _encode(principal: dict) -> str:
+    data = dict(principal)
+    if isinstance(data.get("created_at"), datetime):
+        data["created_at"] = data["created_at"].isoformat()
+    return json.dumps(data)
+
+
+def _keys(user_id: int) -> tuple[str, str]:
+    """Return the Redis keys of user_id's principal and its version."""
+    key = f"{REDIS_KEY_PREFIX}{user_id}"
+    return key, f"{key}:version"
+
+
+def _decode(raw: bytes) -> dict:
+    data = json.loads(raw)
+    if data.get("created_at"):
+        data["created_at"] = datetime.fromisoformat(data["created_at"])
+    return data
+
+
+def load_principal(user_id: int, loader: Callable[[int], Optional[dict]]) -> Optional[dict]:
+    """Return the principal of user_id, calling loader on a miss in both layers.
+
+    Returns None if the user does not exist; that is not cached.
+    """
+    config = current_app.config
+    ttl = config.get("PRINCIPAL_CACHE_TTL", 0)
+    if ttl <= 0:
+        user = loader(user_id)
+        return _to_principal(user) if user else None
+
+    local_ttl = min(config.get("PRINCIPAL_CACHE_LOCAL_TTL", ttl), ttl)
+    max_size = config.get("PRINCIPAL_CACHE_SIZE", 10000)
+
+    principal = _local.get(user_id)
+    if principal is not None:
+        return dict(principal)
+
+    client = _redis_client()
+    key, version_key = _keys(user_id)
+    version = b""
+    if client is not None:
+        try:
+            raw, seen = client.mget(key, version_key)
+            version = seen or b""
+            if raw is not None:
+                principal = _decode(raw)
+                _local.put(user_id, principal, local_ttl, max_size)
+                return dict(principal)
+        except (redis.RedisError, ValueError) as e:
+            logger.warning("Principal cache read failed: %s", e)
+
+    user = loader(user_id)
+    if not user:
+        return None
+    principal = _to_principal(user)
+    _local.put(user_id, principal, local_ttl, max_size)
+    if client is not None:
+        try:
+            client.eval(_FILL_SCRIPT, 2, key, version_key, version, _encode(principal), int(ttl))
+        except redis.RedisError as e:
+            logger.warning("Principal cache write failed: %s", e)
+    return dict(principal)
+
+
+def invalidate_principal(user_id: int) -> None:
+    """Drop the cached principal of user_id from both layers."""
+    _local.pop(user_id)
+    client = _redis_client()
+    if client is None:
+        return
+    key, version_key = _keys(user_id)
+    # The version outlives any fill that began before it was stamped
+    ttl = max(int(current_app.config.get("PRINCIPAL_CACHE_TTL", 0)), 1)
+    try:
+        pipe = client.pipeline()
+        pipe.set(version_key, secrets.token_hex(8), ex=ttl)
+        pipe.delete(key)
+        pipe.execute()
+    except redis.RedisError as e:
+        # The Redis copy expires on its own within PRINCIPAL_CACHE_TTL
+        logger.warning("Principal cache invalidation failed: %s", e)
+
@@ -1,6 +1,11 @@
 """User Management Endpoints (Admin Only)."""
 
+import base64
+import binascii
+import json
 import logging
+from datetime import datetime
+from typing import Optional
 
 from flask import Blueprint, jsonify, request
 
@@ -18,24 +23,71 @@ from .models import (
     delete_user,
     get_user_by_email,
     get_user_by_id,
+    count_users,
     list_users,
+    list_users_after,
     update_user,
 )
 
 users_bp = Blueprint("users", __name__)
 
 
+def encode_cursor(cursor: Optional[tuple[datetime, int]]) -> Optional[str]:
+    """Encode a (created_at, id) keyset cursor as an opaque URL-safe token."""
+    if cursor is None:
+        return None
+    created_at, user_id = cursor
+    raw = json.dumps([created_at.isoformat(), user_id], separators=(",", ":"))
+    return base64.urlsafe_b64encode(raw.encode()).decode().rstrip("=")
+
+
+def decode_cursor(token: str) -> tuple[datetime, int]:
+    """Decode a cursor from encode_cursor. Raises ValueError if malformed."""
+    try:
+        raw = base64.urlsafe_b64decode(token + "=" * (-len(token) % 4))
+        created_at, user_id = json.loads(raw)
+        return datetime.fromisoformat(created_at), int(user_id)
+    except (binascii.Error, TypeError, UnicodeDecodeError) as e:
+        raise ValueError("malformed cursor") from e
+
+
 @users_bp.route("", methods=["GET"])
 @auth_required
 @admin_required
 def get_users():
-    """List all users with pagination (Admin only)."""
-    page = request.args.get("page", 1, type=int)
+    """List all users with pagination (Admin only).
+
+    With ?cursor= (empty for the first page) pages are keyset pages: each
+    costs the same however deep, and pagination.next_cursor is passed back
+    for the next one. ?page= keeps offset pagination for older clients.
+    The total is cached for a few seconds, so it may briefly lag.
+    """
     per_page = request.args.get("per_page", 20, type=int)
 
     # Limit per_page to reasonable bounds
     per_page = min(max(per_page, 1), 100)
 
+    if "cursor" in request.args:
+        token = request.args.get("cursor", "")
+        try:
+            cursor = decode_cursor(token) if token else None
+        except ValueError:
+            return jsonify({"error": "Invalid cursor"}), 400
+
+        users, next_cursor = list_users_after(cursor=cursor, limit=per_page)
+        for user in users:
+            user.pop("password_hash", None)
+
+        return jsonify({
+            "users": users,
+            "pagination": {
+                "per_page": per_page,
+                "total": count_users(),
+                "next_cursor": encode_cursor(next_cursor),
+            },
+        }), 200
+
+    page = max(request.args.get("page", 1, type=int), 1)
     users, total = list_users(page=page, per_page=per_page)
 
     # Remove password hashes from response
@@ -0,0 +1,320 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Cerberus XDP fast-path filter.
+//
+// Runs L3/L4 allow/deny in the driver before an skb is allocated. Packets
+// of flows the Go conntrack table has offloaded to ct_flows are passed
+// straight away. Otherwise source addresses are matched against LPM tries,
+// then the (protocol, destination port) pair against a hash map. Each rule
+// resolves to an action:
+//
+//   ACL_ALLOW   - XDP_PASS to the kernel stack
+//   ACL_DENY    - XDP_DROP
+//   ACL_INSPECT - redirect to the AF_XDP socket bound to the RX queue
+//
+// Packets that match no rule get the default action from cfg_map.
+// All maps are managed from Go (internal/xdp/xdp.go).
+//
+// Build: clang -O2 -g -target bpf -c xdp_filter.c -o xdp_filter.o
+
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/in.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_endian.h>
+
+#define ACL_NONE    0
+#define ACL_ALLOW   1
+#define ACL_DENY    2
+#define ACL_INSPECT 3
+
+#define MAX_QUEUES      64
+#define MAX_CIDR_RULES  1048576
+#define MAX_PORT_RULES  65536
+#define MAX_CT_ENTRIES  2097152 // Two per flow; resized from Go at load time
+
+#ifndef ETH_P_8021AD
+#define ETH_P_8021AD 0x88A8
+#endif
+
+struct lpm_v4_key {
+	__u32 prefixlen;
+	__u8  addr[4];
+};
+
+struct lpm_v6_key {
+	__u32 prefixlen;
+	__u8  addr[16];
+};
+
+struct port_key {
+	__u8  proto;
+	__u8  pad;
+	__u16 port; // Host byte order
+};
+
+// Conntrack fast-path entry, one per direction. Addresses are IPv6 or
+// IPv4-mapped IPv6; ports are in host byte order.
+struct ct_key {
+	__u8  src[16];
+	__u8  dst[16];
+	__u16 sport;
+	__u16 dport;
+	__u8  proto;
+	__u8  pad[3];
+};
+
+// Refreshed on every hit so the Go timer wheel can see activity on flows
+// whose packets no longer reach user space.
+struct ct_value {
+	__u64 last_seen; // bpf_ktime_get_ns()
+	__u64 packets;
+	__u64 bytes;
+};
+
+struct action_stat {
+	__u64 packets;
+	__u64 bytes;
+};
+
+// Stats slots, indexed by XDP action (XDP_ABORTED..XDP_REDIRECT)
+#define STATS_SLOTS 5
+
+// cfg_map slots
+#define CFG_DEFAULT_ACTION 0
+#define CFG_SLOTS          1
+
+struct {
+	__uint(type, BPF_MAP_TYPE_LPM_TRIE);
+	__type(key, struct lpm_v4_key);
+	__type(value, __u32);
+	__uint(max_entries, MAX_CIDR_RULES);
+	__uint(map_flags, BPF_F_NO_PREALLOC);
+} acl_src_v4 SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_LPM_TRIE);
+	__type(key, struct lpm_v6_key);
+	__type(value, __u32);
+	__uint(max_entries, MAX_CIDR_RULES);
+	__uint(map_flags, BPF_F_NO_PREALLOC);
+} acl_src_v6 SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__type(key, struct port_key);
+	__type(value, __u32);
+	__uint(max_entries, MAX_PORT_RULES);
+} acl_ports SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__type(key, struct ct_key);
+	__type(value, struct ct_value);
+	__uint(max_entries, MAX_CT_ENTRIES);
+} ct_flows SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_XSKMAP);
+	__type(key, __u32);
+	__type(value, __u32);
+	__uint(max_entries, MAX_QUEUES);
+} xsks_map SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__type(key, __u32);
+	__type(value, __u32);
+	__uint(max_entries, CFG_SLOTS);
+} cfg_map SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, __u32);
+	__type(value, struct action_stat);
+	__uint(max_entries, STATS_SLOTS);
+} action_stats SEC(".maps");
+
+struct vlan_hdr {
+	__be16 tci;
+	__be16 proto;
+};
+
+static __always_inline int count(struct xdp_md *ctx, int action)
+{
+	__u32 key = action;
+	struct action_stat *st = bpf_map_lookup_elem(&action_stats, &key);
+
+	if (st) {
+		st->packets++;
+		st->bytes += ctx->data_end - ctx->data;
+	}
+	return action;
+}
+
+static __always_inline int verdict(struct xdp_md *ctx, __u32 acl)
+{
+	switch (acl) {
+	case ACL_ALLOW:
+		return count(ctx, XDP_PASS);
+	case ACL_DENY:
+		return count(ctx, XDP_DROP);
+	case ACL_INSPECT:
+		// Falls back to XDP_PASS when no socket is bound to this queue
+		return count(ctx, bpf_redirect_map(&xsks_map, ctx->rx_queue_index, XDP_PASS));
+	default:
+		return count(ctx, XDP_PASS);
+	}
+}
+
+static __always_inline __u32 port_lookup(__u8 proto, __u16 port)
+{
+	struct port_key key = { .proto = proto, .port = port };
+	__u32 *acl = bpf_map_lookup_elem(&acl_ports, &key);
+
+	return acl ? *acl : ACL_NONE;
+}
+
+// parse_l4 fills in the ports of key in host byte order. Returns -1 if the
+// header is truncated and 1 if the packet changes TCP state (SYN, FIN or
+// RST) and must be seen by user space.
+static __always_inline int parse_l4(void *l4, void *data_end, struct ct_key *key)
+{
+	if (key->proto == IPPROTO_TCP) {
+		struct tcphdr *tcp = l4;
+		if ((void *)(tcp + 1) > data_end)
+			return -1;
+		key->sport = bpf_ntohs(tcp->source);
+		key->dport = bpf_ntohs(tcp->dest);
+		return (tcp->syn || tcp->fin || tcp->rst) ? 1 : 0;
+	}
+	if (key->proto == IPPROTO_UDP) {
+		struct udphdr *udp = l4;
+		if ((void *)(udp + 1) > data_end)
+			return -1;
+		key->sport = bpf_ntohs(udp->source);
+		key->dport = bpf_ntohs(udp->dest);
+	}
+	return 0;
+}
+
+SEC("xdp")
+int xdp_cerberus(struct xdp_md *ctx)
+{
+	void *data = (void *)(long)ctx->data;
+	void *data_end = (void *)(long)ctx->data_end;
+	struct ethhdr *eth = data;
+	struct ct_key key;
+	struct ct_value *ct;
+	void *l3;
+	void *l4 = NULL;
+	__u16 proto;
+	__u32 *acl;
+	__u32 cfg_key = CFG_DEFAULT_ACTION;
+	__u32 *dflt;
+	int tcp_ctl = 0;
+	int i;
+
+	__builtin_memset(&key, 0, sizeof(key));
+
+	if ((void *)(eth + 1) > data_end)
+		return count(ctx, XDP_DROP);
+
+	proto = eth->h_proto;
+	l3 = eth + 1;
+
+	// Up to two VLAN tags (802.1Q / QinQ)
+#pragma unroll
+	for (i = 0; i < 2; i++) {
+		struct vlan_hdr *vh = l3;
+
+		if (proto != bpf_htons(ETH_P_8021Q) && proto != bpf_htons(ETH_P_8021AD))
+			break;
+		if ((void *)(vh + 1) > data_end)
+			return count(ctx, XDP_DROP);
+		proto = vh->proto;
+		l3 = vh + 1;
+	}
+
+	if (proto == bpf_htons(ETH_P_IP)) {
+		struct iphdr *ip = l3;
+
+		if ((void *)(ip + 1) > data_end)
+			return count(ctx, XDP_DROP);
+		// A header shorter than 20 bytes would put l4 inside it
+		if (ip->ihl < 5)
+			return count(ctx, XDP_DROP);
+
+		key.src[10] = key.src[11] = 0xff;
+		key.dst[10] = key.dst[11] = 0xff;
+		__builtin_memcpy(&key.src[12], &ip->saddr, 4);
+		__builtin_memcpy(&key.dst[12], &ip->daddr, 4);
+		key.proto = ip->protocol;
+
+		// Only the first fragment carries the L4 header
+		if (!(ip->frag_off & bpf_htons(0x1FFF)))
+			l4 = (void *)ip + ip->ihl * 4;
+	} else if (proto == bpf_htons(ETH_P_IPV6)) {
+		struct ipv6hdr *ip6 = l3;
+
+		if ((void *)(ip6 + 1) > data_end)
+			return count(ctx, XDP_DROP);
+
+		__builtin_memcpy(key.src, &ip6->saddr, 16);
+		__builtin_memcpy(key.dst, &ip6->daddr, 16);
+
+		// Extension headers are left to user space; only direct L4 matches here
+		key.proto = ip6->nexthdr;
+		l4 = ip6 + 1;
+	} else {
+		return count(ctx, XDP_PASS);
+	}
+
+	if (l4) {
+		tcp_ctl = parse_l4(l4, data_end, &key);
+		if (tcp_ctl < 0)
+			return count(ctx, XDP_DROP);
+	}
+
+	// Established flows bypass the ACLs; TCP control packets go the slow
+	// way so conntrack sees every state change
+	if (!tcp_ctl) {
+		ct = bpf_map_lookup_elem(&ct_flows, &key);
+		if (ct) {
+			ct->last_seen = bpf_ktime_get_ns();
+			__sync_fetch_and_add(&ct->packets, 1);
+			__sync_fetch_and_add(&ct->bytes, ctx->data_end - ctx->data);
+			return count(ctx, XDP_PASS);
+		}
+	}
+
+	if (proto == bpf_htons(ETH_P_IP)) {
+		struct lpm_v4_key lpm = { .prefixlen = 32 };
+
+		__builtin_memcpy(lpm.addr, &key.src[12], 4);
+		acl = bpf_map_lookup_elem(&acl_src_v4, &lpm);
+	} else {
+		struct lpm_v6_key lpm = { .prefixlen = 128 };
+
+		__builtin_memcpy(lpm.addr, key.src, 16);
+		acl = bpf_map_lookup_elem(&acl_src_v6, &lpm);
+	}
+	if (acl && *acl != ACL_NONE)
+		return verdict(ctx, *acl);
+
+	if (key.dport) {
+		__u32 port_acl = port_lookup(key.proto, key.dport);
+
+		if (port_acl != ACL_NONE)
+			return verdict(ctx, port_acl);
+	}
+
+	dflt = bpf_map_lookup_elem(&cfg_map, &cfg_key);
+	return verdict(ctx, dflt ? *dflt : ACL_ALLOW);
+}
+
+char _license[] SEC("license") = "GPL";
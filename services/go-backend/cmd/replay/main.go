@@ -0,0 +1,368 @@
+// Package main replays a pcap file through the AF_XDP datapath and reports
+// throughput, per-packet cost and allocations.
+//
+// Frames are injected with an AF_PACKET socket on one end of a veth pair
+// (-peer) and received by the engine on the other (-iface), through the same
+// XDP filter program and pipeline stages as cmd/server. Results are printed
+// as a Go benchmark line, so runs can be compared with benchstat:
+//
+//	ip link add xdp0 type veth peer name xdp1   # or pass -setup
+//	replay -pcap trace.pcap -iface xdp0 -peer xdp1 -count 5 > new.txt
+//	benchstat old.txt new.txt
+//
+// Requires root (or CAP_NET_ADMIN, CAP_NET_RAW, CAP_BPF and CAP_SYS_ADMIN).
+package main
+
+import (
+	"errors"
+	"flag"
+	"fmt"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"runtime"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"golang.org/x/sys/unix"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/conntrack"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+type options struct {
+	pcap       string
+	iface      string
+	peer       string
+	setup      bool
+	queues     int
+	mode       string
+	zeroCopy   bool
+	batch      int
+	program    string
+	conntrack  bool
+	senders    int
+	warmup     time.Duration
+	duration   time.Duration
+	count      int
+	maxPackets int
+}
+
+// sample is one measurement window.
+type sample struct {
+	at        time.Time
+	elapsed   time.Duration // Set by sub
+	sent      uint64
+	received  uint64
+	dropped   uint64 // Dropped by the kernel before reaching the workers
+	stageNs   uint64 // Pipeline time summed over stages
+	mallocs   uint64
+	sendFails uint64
+}
+
+func main() {
+	var opt options
+	flag.StringVar(&opt.pcap, "pcap", "", "Classic pcap file of Ethernet frames to replay (required)")
+	flag.StringVar(&opt.iface, "iface", "xdp0", "Interface the engine receives on")
+	flag.StringVar(&opt.peer, "peer", "xdp1", "veth peer of -iface that frames are injected on")
+	flag.BoolVar(&opt.setup, "setup", false, "Create the veth pair and delete it on exit")
+	flag.IntVar(&opt.queues, "queues", 1, "RX queues (AF_XDP workers); also sets the veth queue count with -setup")
+	flag.StringVar(&opt.mode, "mode", "native", "XDP attach mode: native or skb")
+	flag.BoolVar(&opt.zeroCopy, "zerocopy", false, "Bind the AF_XDP sockets in zero-copy mode (driver support required)")
+	flag.IntVar(&opt.batch, "batch", 64, "Descriptors per ring operation")
+	flag.StringVar(&opt.program, "program", "bpf/xdp_filter.o", "Compiled XDP filter program")
+	flag.BoolVar(&opt.conntrack, "conntrack", true, "Run the conntrack stage after decode, as cmd/server does")
+	flag.IntVar(&opt.senders, "senders", 1, "Injecting goroutines")
+	flag.DurationVar(&opt.warmup, "warmup", time.Second, "Traffic sent before measuring")
+	flag.DurationVar(&opt.duration, "duration", 5*time.Second, "Length of each measurement")
+	flag.IntVar(&opt.count, "count", 1, "Measurements to print, as go test -count")
+	flag.IntVar(&opt.maxPackets, "max-packets", 1<<20, "Frames loaded from the pcap (0 loads all)")
+	flag.Parse()
+
+	if opt.pcap == "" {
+		flag.Usage()
+		os.Exit(2)
+	}
+	if err := run(opt); err != nil {
+		fmt.Fprintln(os.Stderr, "replay:", err)
+		os.Exit(1)
+	}
+}
+
+func run(opt options) error {
+	sockCfg := xdp.DefaultSocketConfig(opt.iface)
+	frames, skipped, err := readPcap(opt.pcap, opt.maxPackets, sockCfg.FrameSize-sockCfg.FrameHeadroom)
+	if err != nil {
+		return err
+	}
+	if len(frames) == 0 {
+		return errors.New("no replayable frames in pcap")
+	}
+	fmt.Fprintf(os.Stderr, "loaded %d frames from %s (%d skipped)\n", len(frames), opt.pcap, skipped)
+
+	if opt.setup {
+		if err := setupVeth(opt.iface, opt.peer, opt.queues); err != nil {
+			return err
+		}
+		defer teardownVeth(opt.iface)
+	}
+
+	if err := xdp.SetRLimitMemlock(); err != nil {
+		return fmt.Errorf("memlock rlimit: %w", err)
+	}
+
+	prog, err := xdp.LoadXDPProgram(xdp.XDPConfig{
+		InterfaceName: opt.iface,
+		Mode:          xdp.ParseXDPMode(opt.mode),
+		ProgramPath:   opt.program,
+	})
+	if err != nil {
+		return err
+	}
+	defer prog.Detach()
+	// Every frame goes to the AF_XDP workers
+	if err := prog.SetDefaultAction(xdp.ACLInspect); err != nil {
+		return err
+	}
+
+	// Flows are not mirrored into the fast path, which would stop them
+	// reaching the workers being measured
+	var ct *conntrack.Table
+	if opt.conntrack {
+		ctCfg := conntrack.DefaultConfig()
+		ctCfg.NUMANodeID = max(xdp.InterfaceNUMANode(opt.iface), 0)
+		ct, err = conntrack.New(ctCfg)
+		if err != nil {
+			return err
+		}
+		ct.Start()
+		defer ct.Stop()
+	}
+
+	engineCfg := xdp.DefaultEngineConfig(opt.iface)
+	engineCfg.NumQueues = opt.queues
+	engineCfg.BatchSize = opt.batch
+	engineCfg.Socket.ZeroCopy = opt.zeroCopy
+	engine, err := xdp.NewEngine(engineCfg, func(queueID int) *xdp.Pipeline {
+		stages := []xdp.Stage{xdp.NewDecodeStage()}
+		if ct != nil {
+			stages = append(stages, conntrack.NewStage(ct, nil, true))
+		}
+		return xdp.NewPipeline(xdp.XDPPass, stages...)
+	})
+	if err != nil {
+		return err
+	}
+	defer engine.Stop()
+	for _, w := range engine.Workers() {
+		if err := prog.RegisterSocket(w.QueueID(), w.Socket()); err != nil {
+			return fmt.Errorf("queue %d: %w", w.QueueID(), err)
+		}
+	}
+	engine.Start()
+
+	inj, err := newInjector(opt.peer, frames, opt.senders)
+	if err != nil {
+		return err
+	}
+	inj.start()
+	defer inj.stop()
+
+	time.Sleep(opt.warmup)
+
+	name := benchName(opt)
+	for i := 0; i < opt.count; i++ {
+		before := measure(engine, inj)
+		time.Sleep(opt.duration)
+		after := measure(engine, inj)
+		report(name, after.sub(before))
+	}
+	return nil
+}
+
+// benchName names the run after the capture and datapath configuration, in
+// the form benchstat groups by.
+func benchName(opt options) string {
+	base := strings.TrimSuffix(filepath.Base(opt.pcap), filepath.Ext(opt.pcap))
+	bind := "copy"
+	if opt.zeroCopy {
+		bind = "zerocopy"
+	}
+	return fmt.Sprintf("BenchmarkReplay/pcap=%s/mode=%s/bind=%s/queues=%d/conntrack=%t-%d",
+		base, opt.mode, bind, opt.queues, opt.conntrack, runtime.GOMAXPROCS(0))
+}
+
+// measure snapshots the counters a window is computed from.
+func measure(engine *xdp.Engine, inj *injector) sample {
+	var ms runtime.MemStats
+	runtime.ReadMemStats(&ms)
+
+	s := sample{
+		at:        time.Now(),
+		sent:      inj.sent.Load(),
+		sendFails: inj.fails.Load(),
+		mallocs:   ms.Mallocs,
+	}
+	for _, w := range engine.Workers() {
+		ws := w.Stats()
+		s.received += ws.RxPackets
+		for _, st := range ws.Stages {
+			s.stageNs += st.Nanoseconds
+		}
+		if sock, err := w.Socket().Stats(); err == nil {
+			s.dropped += sock.RxDropped + sock.RxRingFull
+		}
+	}
+	return s
+}
+
+func (s sample) sub(o sample) sample {
+	return sample{
+		at:        s.at,
+		elapsed:   s.at.Sub(o.at),
+		sent:      s.sent - o.sent,
+		received:  s.received - o.received,
+		dropped:   s.dropped - o.dropped,
+		stageNs:   s.stageNs - o.stageNs,
+		mallocs:   s.mallocs - o.mallocs,
+		sendFails: s.sendFails - o.sendFails,
+	}
+}
+
+// report prints a window as a benchmark line on stdout, with ns/op being
+// wall time per received packet, and a summary on stderr. Allocations
+// include the injector's, which allocates nothing once started.
+func report(name string, s sample) {
+	if s.received == 0 {
+		fmt.Fprintf(os.Stderr, "%s: no packets received (%d sent, %d send errors)\n", name, s.sent, s.sendFails)
+		return
+	}
+	pkts := float64(s.received)
+	secs := s.elapsed.Seconds()
+
+	fmt.Printf("%s\t%d\t%.2f ns/op\t%.4f Mpps\t%.2f pipeline-ns/pkt\t%.4f allocs/op\n",
+		name, s.received, float64(s.elapsed.Nanoseconds())/pkts, pkts/secs/1e6,
+		float64(s.stageNs)/pkts, float64(s.mallocs)/pkts)
+	fmt.Fprintf(os.Stderr, "sent %d, received %d, kernel drops %d, send errors %d over %v\n",
+		s.sent, s.received, s.dropped, s.sendFails, s.elapsed.Round(time.Millisecond))
+}
+
+// injector writes the capture in a loop from AF_PACKET sockets bound to the
+// peer interface, bypassing its qdisc.
+type injector struct {
+	frames [][]byte
+	fds    []int
+
+	sent    atomic.Uint64
+	fails   atomic.Uint64
+	stopped atomic.Bool
+	wg      sync.WaitGroup
+}
+
+func newInjector(ifaceName string, frames [][]byte, senders int) (*injector, error) {
+	ifaceIdx, err := xdp.GetInterfaceIndex(ifaceName)
+	if err != nil {
+		return nil, err
+	}
+
+	inj := &injector{frames: frames}
+	proto := htons(unix.ETH_P_ALL)
+	for i := 0; i < max(senders, 1); i++ {
+		fd, err := unix.Socket(unix.AF_PACKET, unix.SOCK_RAW|unix.SOCK_CLOEXEC, int(proto))
+		if err != nil {
+			inj.close()
+			return nil, fmt.Errorf("packet socket: %w", err)
+		}
+		inj.fds = append(inj.fds, fd)
+		if err := unix.Bind(fd, &unix.SockaddrLinklayer{Protocol: proto, Ifindex: ifaceIdx}); err != nil {
+			inj.close()
+			return nil, fmt.Errorf("bind %s: %w", ifaceName, err)
+		}
+		_ = unix.SetsockoptInt(fd, unix.SOL_PACKET, unix.PACKET_QDISC_BYPASS, 1)
+	}
+	return inj, nil
+}
+
+func (inj *injector) start() {
+	for i, fd := range inj.fds {
+		inj.wg.Add(1)
+		go inj.send(fd, i)
+	}
+}
+
+// send writes frames starting at a per-sender offset, so senders do not
+// replay the same flow in lockstep. Counters are added every 1024 frames.
+func (inj *injector) send(fd, offset int) {
+	defer inj.wg.Done()
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	var sent, fails uint64
+	i := offset * len(inj.frames) / len(inj.fds)
+	for !inj.stopped.Load() {
+		for n := 0; n < 1024; n++ {
+			if _, err := unix.Write(fd, inj.frames[i]); err != nil {
+				fails++ // ENOBUFS when the peer cannot keep up
+			} else {
+				sent++
+			}
+			if i++; i == len(inj.frames) {
+				i = 0
+			}
+		}
+		inj.sent.Add(sent)
+		inj.fails.Add(fails)
+		sent, fails = 0, 0
+	}
+}
+
+func (inj *injector) stop() {
+	inj.stopped.Store(true)
+	inj.wg.Wait()
+	inj.close()
+}
+
+func (inj *injector) close() {
+	for _, fd := range inj.fds {
+		unix.Close(fd)
+	}
+	inj.fds = nil
+}
+
+func htons(v uint16) uint16 {
+	return v<<8 | v>>8
+}
+
+// setupVeth creates and raises a veth pair with queues RX/TX queues per end.
+// Native XDP on veth needs the peer up, and GRO off so frames are not
+// coalesced before the program sees them.
+func setupVeth(iface, peer string, queues int) error {
+	q := strconv.Itoa(max(queues, 1))
+	cmds := [][]string{
+		{"ip", "link", "add", iface, "numrxqueues", q, "numtxqueues", q, "type", "veth",
+			"peer", "name", peer, "numrxqueues", q, "numtxqueues", q},
+		{"ip", "link", "set", iface, "up"},
+		{"ip", "link", "set", peer, "up"},
+		{"ethtool", "-K", iface, "gro", "off"},
+	}
+	for i, args := range cmds {
+		if out, err := exec.Command(args[0], args[1:]...).CombinedOutput(); err != nil {
+			if args[0] == "ethtool" {
+				continue // Optional
+			}
+			if i > 0 {
+				teardownVeth(iface)
+			}
+			return fmt.Errorf("%s: %v: %s", strings.Join(args, " "), err, strings.TrimSpace(string(out)))
+		}
+	}
+	return nil
+}
+
+// teardownVeth deletes the pair; removing one end removes both.
+func teardownVeth(iface string) {
+	_ = exec.Command("ip", "link", "del", iface).Run()
+}
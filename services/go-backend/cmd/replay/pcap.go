@@ -0,0 +1,94 @@
+// Package main provides a minimal reader for classic libpcap capture files.
+package main
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+)
+
+const (
+	pcapMagicMicros = 0xa1b2c3d4
+	pcapMagicNanos  = 0xa1b23c4d
+
+	pcapGlobalHeaderSize = 24
+	pcapRecordHeaderSize = 16
+
+	// linkTypeEthernet is LINKTYPE_ETHERNET, the only link type the
+	// datapath can replay.
+	linkTypeEthernet = 1
+)
+
+// Pcap errors
+var (
+	ErrPcapFormat   = errors.New("not a classic pcap file")
+	ErrPcapLinkType = errors.New("pcap link type is not Ethernet")
+)
+
+// readPcap loads up to maxPackets Ethernet frames from a classic pcap file
+// (microsecond or nanosecond timestamps, either byte order). Frames longer
+// than maxLen or truncated by the capture snaplen are skipped; the second
+// return value counts them. pcapng files are not supported; convert them
+// with `editcap -F pcap`.
+func readPcap(path string, maxPackets, maxLen int) ([][]byte, int, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, 0, err
+	}
+	defer f.Close()
+
+	r := bufio.NewReaderSize(f, 1<<20)
+
+	var hdr [pcapGlobalHeaderSize]byte
+	if _, err := io.ReadFull(r, hdr[:]); err != nil {
+		return nil, 0, fmt.Errorf("%w: %v", ErrPcapFormat, err)
+	}
+
+	var order binary.ByteOrder
+	switch binary.LittleEndian.Uint32(hdr[0:]) {
+	case pcapMagicMicros, pcapMagicNanos:
+		order = binary.LittleEndian
+	default:
+		switch binary.BigEndian.Uint32(hdr[0:]) {
+		case pcapMagicMicros, pcapMagicNanos:
+			order = binary.BigEndian
+		default:
+			return nil, 0, ErrPcapFormat
+		}
+	}
+	if linkType := order.Uint32(hdr[20:]) & 0xffff; linkType != linkTypeEthernet {
+		return nil, 0, fmt.Errorf("%w: %d", ErrPcapLinkType, linkType)
+	}
+
+	var frames [][]byte
+	skipped := 0
+	var rec [pcapRecordHeaderSize]byte
+	for maxPackets <= 0 || len(frames) < maxPackets {
+		if _, err := io.ReadFull(r, rec[:]); err != nil {
+			if err == io.EOF {
+				break
+			}
+			return nil, 0, fmt.Errorf("%w: record header: %v", ErrPcapFormat, err)
+		}
+		inclLen := int(order.Uint32(rec[8:]))
+		origLen := int(order.Uint32(rec[12:]))
+		if inclLen > 256*1024 {
+			return nil, 0, fmt.Errorf("%w: record of %d bytes", ErrPcapFormat, inclLen)
+		}
+
+		data := make([]byte, inclLen)
+		if _, err := io.ReadFull(r, data); err != nil {
+			return nil, 0, fmt.Errorf("%w: record data: %v", ErrPcapFormat, err)
+		}
+		if inclLen < origLen || inclLen > maxLen || inclLen < 14 {
+			skipped++
+			continue
+		}
+		frames = append(frames, data)
+	}
+
+	return frames, skipped, nil
+}
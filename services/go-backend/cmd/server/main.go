@@ -11,10 +11,17 @@ import (
 	"time"
 
 	gocommon "github.com/penguintechinc/penguin-libs/packages/go-common"
+	"github.com/prometheus/client_golang/prometheus"
 
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/capture"
 	"github.com/penguintechinc/cerberus/services/go-backend/internal/config"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/conntrack"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/ingest"
 	"github.com/penguintechinc/cerberus/services/go-backend/internal/memory"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/metrics"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/policy"
 	"github.com/penguintechinc/cerberus/services/go-backend/internal/server"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/telemetry"
 	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
 )
 
@@ -41,7 +48,7 @@ func main() {
 
 	// Initialize NUMA if enabled
 	if cfg.NUMAEnabled {
-		initNUMA()
+		initNUMA(cfg)
 	}
 
 	// Set memlock rlimit for BPF if XDP is enabled
@@ -57,6 +64,37 @@ func main() {
 		logger.Fatal("Failed to create server", "error", err)
 	}
 
+	// Attach the fast-path filter and start the AF_XDP datapath if enabled
+	var prog *xdp.XDPProgram
+	var ct *conntrack.Table
+	var engine *xdp.Engine
+	var taps *capture.Hub
+	if cfg.XDPEnabled {
+		prog = loadXDPProgram(cfg)
+		taps = newCaptureHub(cfg)
+		if cfg.ConntrackEnabled {
+			ct = startConntrack(cfg, prog)
+		}
+	}
+	rules := loadPolicy(cfg, prog, ct)
+	if rules != nil {
+		srv.SetPolicy(rules)
+	}
+	if cfg.XDPEnabled {
+		engine = startXDPEngine(cfg, prog, ct, rules, taps)
+		if engine != nil {
+			srv.SetEngine(engine)
+			if taps != nil {
+				srv.SetCapture(taps)
+			}
+		}
+
+		// Datapath counters are read on scrape, not pushed per packet
+		prometheus.MustRegister(metrics.NewDatapathCollector("go_backend", cfg.XDPInterface, engine, prog))
+	}
+	srv.SetIngest(ingestPipelines(rules))
+	srv.SetTelemetry(telemetry.Sources{Engine: engine, Conntrack: ct, Policy: rules})
+
 	// Start server in a goroutine
 	go func() {
 		logger.Info("Server listening", "host", cfg.Host, "port", cfg.Port)
@@ -76,15 +114,217 @@ func main() {
 	ctx, cancel := context.WithTimeout(context.Background(), 30*time.Second)
 	defer cancel()
 
+	// Handlers and the telemetry hub read the datapath, so they stop first
 	if err := srv.Shutdown(ctx); err != nil {
 		logger.Error("Server forced to shutdown", "error", err)
 	}
 
+	if engine != nil {
+		engine.Stop()
+	}
+	if ct != nil {
+		ct.Close()
+	}
+	if taps != nil {
+		taps.Close()
+	}
+	if prog != nil {
+		if err := prog.Detach(); err != nil {
+			logger.Warn("Failed to detach XDP program", "error", err)
+		}
+	}
+
 	logger.Info("Server stopped")
 }
 
-// initNUMA initializes NUMA-aware settings.
-func initNUMA() {
+// loadXDPProgram attaches the fast-path filter to the interface.
+// Failure is logged; the AF_XDP sockets then only see traffic if another
+// program redirects to them.
+func loadXDPProgram(cfg *config.Config) *xdp.XDPProgram {
+	prog, err := xdp.LoadXDPProgram(xdp.XDPConfig{
+		InterfaceName: cfg.XDPInterface,
+		Mode:          xdp.ParseXDPMode(cfg.XDPMode),
+		ProgramPath:   cfg.XDPProgramPath,
+		FlowEntries:   uint32(cfg.ConntrackMaxFlows * 2),
+	})
+	if err != nil {
+		logger.Warn("Failed to load XDP program", "interface", cfg.XDPInterface, "error", err)
+		return nil
+	}
+
+	action, err := xdp.ParseACLAction(cfg.XDPDefaultAction)
+	if err != nil {
+		logger.Warn("Invalid XDP default action, using allow", "error", err)
+		action = xdp.ACLAllow
+	}
+	if err := prog.SetDefaultAction(action); err != nil {
+		logger.Warn("Failed to set XDP default action", "error", err)
+	}
+
+	logger.Info("XDP program attached", "interface", cfg.XDPInterface, "mode", cfg.XDPMode, "default_action", action.String())
+	return prog
+}
+
+// newCaptureHub creates the capture hub, with shared rings for an IPS
+// engine if CAPTURE_SHM_DIR is set. Failure is logged and leaves the
+// datapath without capture.
+func newCaptureHub(cfg *config.Config) *capture.Hub {
+	capCfg := capture.DefaultConfig()
+	capCfg.ShmDir = cfg.CaptureShmDir
+	capCfg.RingSize = cfg.CaptureRingSize
+	capCfg.Filter = cfg.CaptureFilter
+	capCfg.Sample = cfg.CaptureSample
+	capCfg.Snaplen = cfg.CaptureSnaplen
+
+	hub, err := capture.NewHub(capCfg)
+	if err != nil {
+		logger.Warn("Failed to create capture hub", "error", err)
+		return nil
+	}
+	return hub
+}
+
+// loadPolicy creates the firewall policy store, loading the saved policy.
+// ACL rules are mirrored into the filter program's maps if it is loaded,
+// and updates evict the tracked flows they drop.
+// Failure is logged and leaves the datapath without a policy stage.
+func loadPolicy(cfg *config.Config, prog *xdp.XDPProgram, ct *conntrack.Table) *policy.Store {
+	storeCfg := policy.StoreConfig{Path: cfg.PolicyPath}
+	if prog != nil {
+		storeCfg.Mirror = prog
+	}
+	if ct != nil {
+		storeCfg.Flows = ct
+	}
+
+	store, err := policy.NewStore(storeCfg)
+	if err != nil {
+		logger.Warn("Failed to load firewall policy", "path", cfg.PolicyPath, "error", err)
+		return nil
+	}
+
+	logger.Info("Firewall policy loaded", "path", cfg.PolicyPath, "rules", store.Current().Len(), "fast_path", prog != nil)
+	return store
+}
+
+// startConntrack creates the flow table and its expiry goroutine. Established
+// flows are mirrored into the filter program's fast path if it is loaded.
+func startConntrack(cfg *config.Config, prog *xdp.XDPProgram) *conntrack.Table {
+	ctCfg := conntrack.DefaultConfig()
+	ctCfg.MaxFlows = cfg.ConntrackMaxFlows
+	// The table is read by the workers, so place it on the NIC's node
+	ctCfg.NUMANodeID = cfg.NUMANodeID
+	if node := xdp.InterfaceNUMANode(cfg.XDPInterface); node >= 0 {
+		ctCfg.NUMANodeID = node
+	}
+	ctCfg.UseHugepages = cfg.HugepagesEnabled
+	ctCfg.HugepageSize = memory.ParseHugepageSize(cfg.HugepageSize)
+	if prog != nil {
+		ctCfg.Mirror = prog
+	}
+
+	ct, err := conntrack.New(ctCfg)
+	if err != nil {
+		logger.Warn("Failed to create conntrack table", "error", err)
+		return nil
+	}
+	ct.Start()
+
+	stats := ct.Stats()
+	logger.Info("Conntrack enabled", "max_flows", stats.MaxFlows, "slots", stats.Capacity, "fast_path", prog != nil)
+	return ct
+}
+
+// startXDPEngine opens one AF_XDP socket per RX queue, registers each with
+// the filter program (if loaded) and starts the workers.
+// Failure is logged and leaves the HTTP API running without a datapath.
+func startXDPEngine(cfg *config.Config, prog *xdp.XDPProgram, ct *conntrack.Table, rules *policy.Store, taps *capture.Hub) *xdp.Engine {
+	engineCfg := xdp.DefaultEngineConfig(cfg.XDPInterface)
+	engineCfg.NumQueues = cfg.XDPQueues
+	engineCfg.BatchSize = cfg.XDPBatchSize
+	engineCfg.LatencySample = cfg.XDPLatencySample
+	engineCfg.Socket.ZeroCopy = cfg.XDPZeroCopy
+	engineCfg.UseHugepages = cfg.HugepagesEnabled
+	engineCfg.HugepageSize = memory.ParseHugepageSize(cfg.HugepageSize)
+	engineCfg.OnError = func(queueID int, err error) {
+		logger.Error("XDP worker poll failed", "queue", queueID, "error", err)
+	}
+
+	engine, err := xdp.NewEngine(engineCfg, func(queueID int) *xdp.Pipeline {
+		stages := []xdp.Stage{xdp.NewDecodeStage()}
+		// Capture before conntrack, so the IPS sees established flows
+		if taps != nil {
+			if st, err := taps.NewStage(queueID); err == nil {
+				stages = append(stages, st)
+			} else {
+				logger.Warn("Failed to create capture stage", "queue", queueID, "error", err)
+			}
+		}
+		// The policy classifies every frame not of an established flow;
+		// conntrack only tracks the frames it accepts, and the undecided
+		// ones the pipeline passes
+		var classifier xdp.Stage
+		if rules != nil {
+			classifier = rules.NewStage()
+		}
+		switch {
+		case ct != nil:
+			stages = append(stages, conntrack.NewStage(ct, classifier, true))
+		case classifier != nil:
+			stages = append(stages, classifier)
+		}
+		return xdp.NewPipeline(xdp.XDPPass, stages...)
+	})
+	if err != nil {
+		logger.Warn("Failed to start XDP engine", "interface", cfg.XDPInterface, "error", err)
+		return nil
+	}
+
+	for _, w := range engine.Workers() {
+		if prog != nil {
+			if err := prog.RegisterSocket(w.QueueID(), w.Socket()); err != nil {
+				logger.Warn("Failed to register AF_XDP socket", "queue", w.QueueID(), "error", err)
+			}
+		}
+	}
+	if taps != nil {
+		for _, path := range taps.SharedRings() {
+			logger.Info("Capture ring", "path", path, "filter", cfg.CaptureFilter, "sample", cfg.CaptureSample)
+		}
+	}
+	for _, w := range engine.Stats() {
+		logger.Info("XDP worker starting", "interface", cfg.XDPInterface, "queue", w.QueueID, "cpu", w.CPU, "node", w.Node)
+	}
+	engine.Start()
+
+	return engine
+}
+
+// ingestPipelines returns the pipeline factory of the bulk ingest endpoint:
+// the datapath's policy without capture or conntrack. Ingested frames come
+// from API clients, so they must not create flows in the live table, whose
+// entries are offloaded to the fast path ahead of the ACLs, nor count as
+// rule hits.
+func ingestPipelines(rules *policy.Store) ingest.PipelineFactory {
+	return func() (*xdp.Pipeline, func()) {
+		stages := []xdp.Stage{xdp.NewDecodeStage()}
+		var ps *policy.Stage
+		if rules != nil {
+			ps = rules.NewUncountedStage()
+			stages = append(stages, ps)
+		}
+		return xdp.NewPipeline(xdp.XDPPass, stages...), func() {
+			if ps != nil {
+				ps.Close()
+			}
+		}
+	}
+}
+
+// initNUMA logs the NUMA topology. The process is not bound to a node:
+// the server keeps a memory pool per node, and XDP workers are pinned to
+// the node of their NIC when the engine starts.
+func initNUMA(cfg *config.Config) {
 	info := memory.GetNUMAInfo()
 
 	if !info.Available {
@@ -104,10 +344,7 @@ func initNUMA() {
 		logger.Info("NUMA node CPUs", "node", node, "cpus", cpus)
 	}
 
-	// Optionally bind to a specific node (node 0 by default)
-	if err := memory.BindToNUMANode(0); err != nil {
-		logger.Warn("Failed to bind to NUMA node 0", "error", err)
-	} else {
-		logger.Info("Successfully bound to NUMA node 0")
+	if cfg.XDPEnabled {
+		logger.Info("NUMA node of XDP interface", "interface", cfg.XDPInterface, "node", xdp.InterfaceNUMANode(cfg.XDPInterface))
 	}
 }
@@ -0,0 +1,310 @@
+package capture
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"net/netip"
+	"path/filepath"
+	"testing"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+func view(src, dst string, proto uint8, sport, dport uint16) xdp.PacketView {
+	v := xdp.PacketView{Protocol: proto, Layers: xdp.LayerL3}
+	s, d := netip.MustParseAddr(src), netip.MustParseAddr(dst)
+	if s.Is4() {
+		v.IPVersion, v.SrcIP4, v.DstIP4 = 4, s.As4(), d.As4()
+	} else {
+		v.IPVersion, v.SrcIP6, v.DstIP6 = 6, s.As16(), d.As16()
+	}
+	if proto == xdp.IPProtoTCP || proto == xdp.IPProtoUDP {
+		v.Layers |= xdp.LayerL4
+		v.SrcPort, v.DstPort = sport, dport
+	}
+	return v
+}
+
+// TestFilter checks primitives, qualifiers and operator precedence.
+func TestFilter(t *testing.T) {
+	web := view("10.0.0.1", "192.0.2.10", xdp.IPProtoTCP, 40000, 443)
+	dns := view("2001:db8::1", "2001:db8::53", xdp.IPProtoUDP, 5353, 53)
+	ping := view("10.0.0.1", "10.0.0.2", xdp.IPProtoICMP, 0, 0)
+	tagged := web
+	tagged.NumVLANs, tagged.VLANs[0] = 1, 0x2000|42
+
+	tests := []struct {
+		expr string
+		want [4]bool // web, dns, ping, tagged
+	}{
+		{"", [4]bool{true, true, true, true}},
+		{"tcp", [4]bool{true, false, false, true}},
+		{"tcp port 443", [4]bool{true, false, false, true}},
+		{"dst port 443", [4]bool{true, false, false, true}},
+		{"src port 443", [4]bool{false, false, false, false}},
+		{"portrange 50-60", [4]bool{false, true, false, false}},
+		{"host 10.0.0.1", [4]bool{true, false, true, true}},
+		{"dst host 10.0.0.1", [4]bool{false, false, false, false}},
+		{"net 10.0.0.0/8 and not icmp", [4]bool{true, false, false, true}},
+		{"ip6 or icmp", [4]bool{false, true, true, false}},
+		{"src net 2001:db8::/32 && udp", [4]bool{false, true, false, false}},
+		{"!(tcp || udp)", [4]bool{false, false, true, false}},
+		{"icmp or tcp and port 53", [4]bool{false, false, true, false}},
+		{"vlan", [4]bool{false, false, false, true}},
+		{"vlan 42 and ip proto tcp", [4]bool{false, false, false, true}},
+		{"vlan 7", [4]bool{false, false, false, false}},
+		{"proto 17", [4]bool{false, true, false, false}},
+	}
+	for _, tt := range tests {
+		f, err := CompileFilter(tt.expr)
+		if err != nil {
+			t.Fatalf("%q: %v", tt.expr, err)
+		}
+		for i, v := range []*xdp.PacketView{&web, &dns, &ping, &tagged} {
+			if got := f.Match(v); got != tt.want[i] {
+				t.Errorf("%q on packet %d: expected %v, got %v", tt.expr, i, tt.want[i], got)
+			}
+		}
+	}
+
+	for _, expr := range []string{"port", "host 10.0.0.300", "tcp and", "(tcp", "portrange 9-1", "port 1-2", "foo", "tcp tcp"} {
+		if _, err := CompileFilter(expr); !errors.Is(err, ErrInvalidFilter) {
+			t.Errorf("%q: expected ErrInvalidFilter, got %v", expr, err)
+		}
+	}
+}
+
+// TestRing checks wrap-around, drops when full and snaplen.
+func TestRing(t *testing.T) {
+	r, err := NewRing(4096)
+	if err != nil {
+		t.Fatal(err)
+	}
+	frame := make([]byte, 1000)
+	for i := range frame {
+		frame[i] = byte(i)
+	}
+
+	// Four 1024-byte records fill the ring; the fifth is dropped
+	for i := 0; i < 5; i++ {
+		ok := r.Write(1, int64(i), frame, 0)
+		if ok != (i < 4) {
+			t.Fatalf("write %d: expected fit %v", i, i < 4)
+		}
+	}
+	if r.Drops() != 1 {
+		t.Errorf("expected 1 drop, got %d", r.Drops())
+	}
+
+	// Consume some, then write across the end of the buffer
+	seen := 0
+	if n, err := r.Read(3, func(rec *Record) {
+		if rec.Timestamp != int64(seen) || rec.OrigLen != 1000 || !bytes.Equal(rec.Data, frame) {
+			t.Errorf("record %d corrupted", seen)
+		}
+		seen++
+	}); n != 3 || err != nil {
+		t.Fatalf("expected 3 records, got %d (%v)", n, err)
+	}
+	for i := 0; i < 2; i++ {
+		if !r.Write(2, 10, frame, 100) {
+			t.Fatalf("write after read %d failed", i)
+		}
+	}
+	var lens []int
+	if _, err := r.Read(0, func(rec *Record) { lens = append(lens, len(rec.Data)) }); err != nil {
+		t.Fatal(err)
+	}
+	if len(lens) != 3 || lens[0] != 1000 || lens[1] != 100 || lens[2] != 100 {
+		t.Errorf("expected 1000, 100, 100 byte records, got %v", lens)
+	}
+	if r.Len() != 0 {
+		t.Errorf("expected an empty ring, got %d bytes", r.Len())
+	}
+}
+
+// TestShm checks that a second mapping of a shared ring reads the frames,
+// across pad records at the end of the buffer.
+func TestShm(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "capture-q0.ring")
+	w, err := CreateShm(path, 4096)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer w.Close()
+	r, err := OpenShm(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer r.Close()
+
+	for i := 0; i < 200; i++ {
+		frame := make([]byte, 20) // 48-byte records leave a pad at the end
+		frame[0] = byte(i)
+		if !w.Write(0, int64(i), frame, 0) {
+			t.Fatalf("write %d failed", i)
+		}
+		if i%50 == 49 {
+			n, err := r.Read(0, func(rec *Record) {
+				if rec.Data[0] != byte(rec.Timestamp) {
+					t.Errorf("record %d corrupted", rec.Timestamp)
+				}
+			})
+			if n != 50 || err != nil {
+				t.Fatalf("expected 50 records, got %d (%v)", n, err)
+			}
+		}
+	}
+
+	if _, err := OpenShm(filepath.Join(t.TempDir(), "missing")); err == nil {
+		t.Error("expected an error for a missing ring")
+	}
+}
+
+func testBatch() *xdp.Batch {
+	b := &xdp.Batch{N: 4, Active: 0xF}
+	for i := 0; i < 4; i++ {
+		b.Frames[i] = bytes.Repeat([]byte{byte(i)}, 64+i)
+		b.Views[i] = view("10.0.0.1", "192.0.2.10", xdp.IPProtoTCP, 40000, uint16(80+i))
+	}
+	return b
+}
+
+// TestStage checks the shared ring filter and sampling and a live session.
+func TestStage(t *testing.T) {
+	cfg := DefaultConfig()
+	cfg.ShmDir = t.TempDir()
+	cfg.RingSize = 1 << 16
+	cfg.Filter = "not port 83"
+	cfg.Sample = 2
+	hub, err := NewHub(cfg)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer hub.Close()
+	st, err := hub.NewStage(3)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if paths := hub.SharedRings(); len(paths) != 1 || filepath.Base(paths[0]) != "capture-q3.ring" {
+		t.Fatalf("unexpected shared rings %v", paths)
+	}
+
+	sess, err := hub.Subscribe(SessionConfig{Filter: "port 80 or port 81", Snaplen: 32})
+	if err != nil {
+		t.Fatal(err)
+	}
+	b := testBatch()
+	var v xdp.Verdicts
+	st.Process(b, &v)
+	if v != (xdp.Verdicts{}) {
+		t.Errorf("expected no verdicts, got %+v", v)
+	}
+
+	// Frames 0-2 match the shared filter; 1 in 2 keeps frame 1
+	shared, err := OpenShm(hub.SharedRings()[0])
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer shared.Close()
+	var got []byte
+	shared.Read(0, func(rec *Record) { got = append(got, rec.Data[0]) })
+	if !bytes.Equal(got, []byte{1}) {
+		t.Errorf("expected frame 1 in the shared ring, got %v", got)
+	}
+
+	got = got[:0]
+	sess.Read(0, func(rec *Record) {
+		if rec.Queue != 3 || len(rec.Data) != 32 || rec.OrigLen != 64+int(rec.Data[0]) {
+			t.Errorf("unexpected record %+v", rec)
+		}
+		got = append(got, rec.Data[0])
+	})
+	if !bytes.Equal(got, []byte{0, 1}) {
+		t.Errorf("expected frames 0 and 1 in the session, got %v", got)
+	}
+
+	sess.Close()
+	for i := 0; i < cfg.MaxSessions; i++ {
+		if _, err := hub.Subscribe(SessionConfig{}); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if _, err := hub.Subscribe(SessionConfig{}); !errors.Is(err, ErrTooManySessions) {
+		t.Errorf("expected ErrTooManySessions, got %v", err)
+	}
+}
+
+// TestPcapng checks the block structure of a written stream.
+func TestPcapng(t *testing.T) {
+	var buf bytes.Buffer
+	w, err := NewPcapngWriter(&buf, "eth0", []int{0, 1})
+	if err != nil {
+		t.Fatal(err)
+	}
+	w.WritePacket(&Record{Queue: 1, Timestamp: 1 << 40, OrigLen: 60, Data: make([]byte, 13)})
+	w.WriteStats(1<<40, 1, 0)
+
+	var types []uint32
+	data := buf.Bytes()
+	for len(data) > 0 {
+		n := binary.LittleEndian.Uint32(data[4:])
+		if n%4 != 0 || int(n) > len(data) || binary.LittleEndian.Uint32(data[n-4:]) != n {
+			t.Fatalf("bad block length %d", n)
+		}
+		types = append(types, binary.LittleEndian.Uint32(data))
+		if binary.LittleEndian.Uint32(data) == pcapngEPB {
+			if id := binary.LittleEndian.Uint32(data[8:]); id != 1 {
+				t.Errorf("expected interface 1, got %d", id)
+			}
+			if capLen := binary.LittleEndian.Uint32(data[20:]); capLen != 13 {
+				t.Errorf("expected 13 captured bytes, got %d", capLen)
+			}
+		}
+		data = data[n:]
+	}
+	want := []uint32{pcapngSHB, pcapngIDB, pcapngIDB, pcapngEPB, pcapngISB}
+	if len(types) != len(want) {
+		t.Fatalf("expected blocks %x, got %x", want, types)
+	}
+	for i := range want {
+		if types[i] != want[i] {
+			t.Errorf("block %d: expected %x, got %x", i, want[i], types[i])
+		}
+	}
+}
+
+// TestStageAllocs checks that capturing does not allocate.
+func TestStageAllocs(t *testing.T) {
+	hub, err := NewHub(DefaultConfig())
+	if err != nil {
+		t.Fatal(err)
+	}
+	st, _ := hub.NewStage(0)
+	sess, err := hub.Subscribe(SessionConfig{Filter: "tcp and net 10.0.0.0/8"})
+	if err != nil {
+		t.Fatal(err)
+	}
+	b := testBatch()
+	var v xdp.Verdicts
+	if n := testing.AllocsPerRun(100, func() {
+		st.Process(b, &v)
+		sess.Read(0, func(*Record) {})
+	}); n != 0 {
+		t.Errorf("expected no allocations, got %v", n)
+	}
+}
+
+// BenchmarkFilter measures a compound filter on one packet.
+func BenchmarkFilter(b *testing.B) {
+	f, err := CompileFilter("(tcp port 443 or udp port 53) and not net 192.168.0.0/16")
+	if err != nil {
+		b.Fatal(err)
+	}
+	v := view("10.0.0.1", "192.0.2.10", xdp.IPProtoTCP, 40000, 443)
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		f.Match(&v)
+	}
+}
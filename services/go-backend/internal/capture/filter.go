@@ -0,0 +1,395 @@
+// Package capture copies datapath frames out of the AF_XDP pipeline, for an
+// IPS engine reading a shared-memory ring and for live pcapng streams.
+//
+// A Hub owns the capture configuration; each pipeline gets a Stage from it,
+// placed right after decode so it sees every frame the filter program
+// redirected, established flows included. A stage never decides a verdict.
+package capture
+
+import (
+	"errors"
+	"fmt"
+	"net/netip"
+	"strconv"
+	"strings"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+var (
+	// ErrInvalidFilter is returned for a filter expression that does not parse.
+	ErrInvalidFilter = errors.New("invalid capture filter")
+)
+
+// Filter is a compiled capture filter. Filters use a subset of the
+// pcap-filter(7) syntax, applied to the decoded packet:
+//
+//	[src|dst] host ADDR    [src|dst] net PREFIX
+//	[src|dst] port N       [src|dst] portrange LO-HI
+//	ip  ip6  tcp  udp  icmp  icmp6  proto N|NAME  vlan [ID]
+//
+// combined with and (&&), or (||), not (!) and parentheses. A protocol
+// followed by a port primitive implies and: "tcp port 443". Like BPF, a
+// filter compiles to a flat program run on a fixed stack, so matching
+// never allocates. The empty filter matches everything.
+type Filter struct {
+	expr string
+	prog []insn
+}
+
+type opcode uint8
+
+const (
+	opAddr  opcode = iota // Address within prefix
+	opPort                // TCP or UDP port within lo-hi
+	opProto               // IP protocol
+	opIPVer               // IP version
+	opVLAN                // Any VLAN tag, or outermost VLAN ID
+	opAnd
+	opOr
+	opNot
+)
+
+type direction uint8
+
+const (
+	dirEither direction = iota
+	dirSrc
+	dirDst
+)
+
+type insn struct {
+	op     opcode
+	dir    direction
+	prefix netip.Prefix
+	lo, hi uint16 // Port range; protocol, IP version or VLAN ID in lo (hi 1 if a VLAN ID is set)
+}
+
+// maxFilterDepth bounds the evaluation stack.
+const maxFilterDepth = 32
+
+// CompileFilter compiles a filter expression.
+func CompileFilter(expr string) (*Filter, error) {
+	p := &filterParser{tokens: tokenize(expr)}
+	f := &Filter{expr: strings.TrimSpace(expr)}
+	if len(p.tokens) == 0 {
+		return f, nil
+	}
+	if err := p.parseOr(); err != nil {
+		return nil, fmt.Errorf("%w: %v", ErrInvalidFilter, err)
+	}
+	if p.pos < len(p.tokens) {
+		return nil, fmt.Errorf("%w: unexpected %q", ErrInvalidFilter, p.tokens[p.pos])
+	}
+
+	depth, maxDepth := 0, 0
+	for _, in := range p.prog {
+		switch in.op {
+		case opAnd, opOr:
+			depth--
+		case opNot:
+		default:
+			depth++
+		}
+		maxDepth = max(maxDepth, depth)
+	}
+	if maxDepth > maxFilterDepth {
+		return nil, fmt.Errorf("%w: nested too deeply", ErrInvalidFilter)
+	}
+	f.prog = p.prog
+	return f, nil
+}
+
+// String returns the filter expression.
+func (f *Filter) String() string {
+	return f.expr
+}
+
+// Match reports whether decoded packet v passes the filter.
+func (f *Filter) Match(v *xdp.PacketView) bool {
+	if len(f.prog) == 0 {
+		return true
+	}
+	var stack [maxFilterDepth]bool
+	sp := 0
+	for i := range f.prog {
+		in := &f.prog[i]
+		switch in.op {
+		case opAnd:
+			sp--
+			stack[sp-1] = stack[sp-1] && stack[sp]
+		case opOr:
+			sp--
+			stack[sp-1] = stack[sp-1] || stack[sp]
+		case opNot:
+			stack[sp-1] = !stack[sp-1]
+		default:
+			stack[sp] = in.eval(v)
+			sp++
+		}
+	}
+	return stack[0]
+}
+
+func (in *insn) eval(v *xdp.PacketView) bool {
+	switch in.op {
+	case opAddr:
+		return in.dir != dirDst && addrIn(in.prefix, v, true) ||
+			in.dir != dirSrc && addrIn(in.prefix, v, false)
+	case opPort:
+		if !v.Has(xdp.LayerL4) || (v.Protocol != xdp.IPProtoTCP && v.Protocol != xdp.IPProtoUDP) {
+			return false
+		}
+		return in.dir != dirDst && v.SrcPort >= in.lo && v.SrcPort <= in.hi ||
+			in.dir != dirSrc && v.DstPort >= in.lo && v.DstPort <= in.hi
+	case opProto:
+		return v.IPVersion != 0 && uint16(v.Protocol) == in.lo
+	case opIPVer:
+		return uint16(v.IPVersion) == in.lo
+	case opVLAN:
+		return v.NumVLANs > 0 && (in.hi == 0 || v.VLANs[0]&0x0FFF == in.lo)
+	}
+	return false
+}
+
+func addrIn(p netip.Prefix, v *xdp.PacketView, src bool) bool {
+	switch {
+	case v.IPVersion == 4 && p.Addr().Is4():
+		a := v.DstIP4
+		if src {
+			a = v.SrcIP4
+		}
+		return p.Contains(netip.AddrFrom4(a))
+	case v.IPVersion == 6 && p.Addr().Is6():
+		a := v.DstIP6
+		if src {
+			a = v.SrcIP6
+		}
+		return p.Contains(netip.AddrFrom16(a))
+	}
+	return false
+}
+
+func tokenize(s string) []string {
+	var out []string
+	for _, f := range strings.Fields(s) {
+		for f != "" {
+			switch {
+			case f[0] == '(' || f[0] == ')':
+				out, f = append(out, f[:1]), f[1:]
+			case f[0] == '!':
+				out, f = append(out, "not"), f[1:]
+			default:
+				i := strings.IndexAny(f, "()")
+				if i < 0 {
+					i = len(f)
+				}
+				out, f = append(out, f[:i]), f[i:]
+			}
+		}
+	}
+	return out
+}
+
+// filterParser compiles tokens to postfix by recursive descent.
+type filterParser struct {
+	tokens []string
+	pos    int
+	prog   []insn
+}
+
+func (p *filterParser) peek() string {
+	if p.pos < len(p.tokens) {
+		return strings.ToLower(p.tokens[p.pos])
+	}
+	return ""
+}
+
+func (p *filterParser) next() (string, error) {
+	if p.pos >= len(p.tokens) {
+		return "", errors.New("unexpected end of filter")
+	}
+	p.pos++
+	return p.tokens[p.pos-1], nil
+}
+
+func (p *filterParser) parseOr() error {
+	if err := p.parseAnd(); err != nil {
+		return err
+	}
+	for t := p.peek(); t == "or" || t == "||"; t = p.peek() {
+		p.pos++
+		if err := p.parseAnd(); err != nil {
+			return err
+		}
+		p.prog = append(p.prog, insn{op: opOr})
+	}
+	return nil
+}
+
+func (p *filterParser) parseAnd() error {
+	if err := p.parseNot(); err != nil {
+		return err
+	}
+	for t := p.peek(); t == "and" || t == "&&"; t = p.peek() {
+		p.pos++
+		if err := p.parseNot(); err != nil {
+			return err
+		}
+		p.prog = append(p.prog, insn{op: opAnd})
+	}
+	return nil
+}
+
+func (p *filterParser) parseNot() error {
+	switch p.peek() {
+	case "not":
+		p.pos++
+		if err := p.parseNot(); err != nil {
+			return err
+		}
+		p.prog = append(p.prog, insn{op: opNot})
+		return nil
+	case "(":
+		p.pos++
+		if err := p.parseOr(); err != nil {
+			return err
+		}
+		if p.peek() != ")" {
+			return errors.New("missing )")
+		}
+		p.pos++
+		return nil
+	}
+	return p.parsePrimitive()
+}
+
+var protoNames = map[string]uint8{
+	"tcp":   xdp.IPProtoTCP,
+	"udp":   xdp.IPProtoUDP,
+	"icmp":  xdp.IPProtoICMP,
+	"icmp6": 58,
+	"esp":   50,
+	"ah":    51,
+	"gre":   47,
+	"sctp":  132,
+}
+
+func (p *filterParser) parsePrimitive() error {
+	tok, err := p.next()
+	if err != nil {
+		return err
+	}
+	tok = strings.ToLower(tok)
+
+	switch tok {
+	case "ip":
+		p.prog = append(p.prog, insn{op: opIPVer, lo: 4})
+		if p.peek() == "proto" {
+			return p.and(p.parsePrimitive())
+		}
+		return nil
+	case "ip6":
+		p.prog = append(p.prog, insn{op: opIPVer, lo: 6})
+		return nil
+	case "vlan":
+		in := insn{op: opVLAN}
+		if n, err := strconv.ParseUint(p.peek(), 10, 12); err == nil {
+			p.pos++
+			in.lo, in.hi = uint16(n), 1
+		}
+		p.prog = append(p.prog, in)
+		return nil
+	case "proto":
+		t, err := p.next()
+		if err != nil {
+			return err
+		}
+		proto, ok := protoNames[strings.ToLower(t)]
+		if !ok {
+			n, err := strconv.ParseUint(t, 10, 8)
+			if err != nil {
+				return fmt.Errorf("unknown protocol %q", t)
+			}
+			proto = uint8(n)
+		}
+		p.prog = append(p.prog, insn{op: opProto, lo: uint16(proto)})
+		return nil
+	}
+	if proto, ok := protoNames[tok]; ok {
+		p.prog = append(p.prog, insn{op: opProto, lo: uint16(proto)})
+		// "tcp port 80" is "tcp and port 80"
+		switch p.peek() {
+		case "port", "portrange", "src", "dst":
+			return p.and(p.parsePrimitive())
+		}
+		return nil
+	}
+
+	dir := dirEither
+	switch tok {
+	case "src", "dst":
+		dir = dirSrc
+		if tok == "dst" {
+			dir = dirDst
+		}
+		if tok, err = p.next(); err != nil {
+			return err
+		}
+		tok = strings.ToLower(tok)
+	}
+
+	switch tok {
+	case "host", "net":
+		t, err := p.next()
+		if err != nil {
+			return err
+		}
+		var prefix netip.Prefix
+		if tok == "net" || strings.Contains(t, "/") {
+			prefix, err = netip.ParsePrefix(t)
+			prefix = prefix.Masked()
+		} else {
+			var a netip.Addr
+			a, err = netip.ParseAddr(t)
+			prefix = netip.PrefixFrom(a, a.BitLen())
+		}
+		if err != nil {
+			return fmt.Errorf("invalid %s %q", tok, t)
+		}
+		if a := prefix.Addr(); a.Is4In6() && prefix.Bits() >= 96 {
+			prefix = netip.PrefixFrom(a.Unmap(), prefix.Bits()-96)
+		}
+		p.prog = append(p.prog, insn{op: opAddr, dir: dir, prefix: prefix})
+		return nil
+	case "port", "portrange":
+		t, err := p.next()
+		if err != nil {
+			return err
+		}
+		loStr, hiStr, isRange := strings.Cut(t, "-")
+		if isRange != (tok == "portrange") {
+			return fmt.Errorf("invalid %s %q", tok, t)
+		}
+		lo, err := strconv.ParseUint(loStr, 10, 16)
+		hi := lo
+		if err == nil && isRange {
+			hi, err = strconv.ParseUint(hiStr, 10, 16)
+		}
+		if err != nil || hi < lo {
+			return fmt.Errorf("invalid %s %q", tok, t)
+		}
+		p.prog = append(p.prog, insn{op: opPort, dir: dir, lo: uint16(lo), hi: uint16(hi)})
+		return nil
+	}
+	return fmt.Errorf("unknown primitive %q", tok)
+}
+
+// and appends an and of the two primitives before it, after err is checked.
+func (p *filterParser) and(err error) error {
+	if err != nil {
+		return err
+	}
+	p.prog = append(p.prog, insn{op: opAnd})
+	return nil
+}
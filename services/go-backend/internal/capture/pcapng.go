@@ -0,0 +1,127 @@
+package capture
+
+import (
+	"encoding/binary"
+	"io"
+	"strconv"
+)
+
+// pcapng block types and options (draft-ietf-opsawg-pcapng).
+const (
+	pcapngSHB = 0x0A0D0D0A
+	pcapngIDB = 0x00000001
+	pcapngEPB = 0x00000006
+	pcapngISB = 0x00000005
+
+	pcapngByteOrderMagic = 0x1A2B3C4D
+
+	optEnd        = 0
+	optIfName     = 2
+	optIfTsresol  = 9
+	optISBIfRecv  = 4
+	optISBIfDrop  = 5
+	optShbUserApp = 4
+
+	// linkTypeEthernet is LINKTYPE_ETHERNET.
+	linkTypeEthernet = 1
+)
+
+// PcapngWriter writes a pcapng stream with nanosecond timestamps, one
+// interface block per datapath queue. Blocks are little-endian.
+type PcapngWriter struct {
+	w   io.Writer
+	buf []byte
+	ifs map[int]uint32 // Queue to interface ID
+}
+
+// NewPcapngWriter writes the section header and an interface block per
+// queue, named iface/q<N>.
+func NewPcapngWriter(w io.Writer, iface string, queues []int) (*PcapngWriter, error) {
+	p := &PcapngWriter{w: w, ifs: make(map[int]uint32, len(queues))}
+
+	b := p.begin(pcapngSHB)
+	b = binary.LittleEndian.AppendUint32(b, pcapngByteOrderMagic)
+	b = binary.LittleEndian.AppendUint16(b, 1) // Version 1.0
+	b = binary.LittleEndian.AppendUint16(b, 0)
+	b = binary.LittleEndian.AppendUint64(b, ^uint64(0)) // Section length unknown
+	b = appendOption(b, optShbUserApp, []byte("cerberus-xdp"))
+	b = appendOption(b, optEnd, nil)
+	p.buf = b
+	if err := p.end(); err != nil {
+		return nil, err
+	}
+
+	for i, q := range queues {
+		b := p.begin(pcapngIDB)
+		b = binary.LittleEndian.AppendUint16(b, linkTypeEthernet)
+		b = binary.LittleEndian.AppendUint16(b, 0)
+		b = binary.LittleEndian.AppendUint32(b, 0) // No snaplen limit
+		b = appendOption(b, optIfName, []byte(iface+"/q"+strconv.Itoa(q)))
+		b = appendOption(b, optIfTsresol, []byte{9}) // Nanoseconds
+		b = appendOption(b, optEnd, nil)
+		p.buf = b
+		if err := p.end(); err != nil {
+			return nil, err
+		}
+		p.ifs[q] = uint32(i)
+	}
+	return p, nil
+}
+
+// WritePacket writes a captured frame as an enhanced packet block.
+func (p *PcapngWriter) WritePacket(rec *Record) error {
+	b := p.begin(pcapngEPB)
+	b = binary.LittleEndian.AppendUint32(b, p.ifs[rec.Queue])
+	b = binary.LittleEndian.AppendUint32(b, uint32(uint64(rec.Timestamp)>>32))
+	b = binary.LittleEndian.AppendUint32(b, uint32(rec.Timestamp))
+	b = binary.LittleEndian.AppendUint32(b, uint32(len(rec.Data)))
+	b = binary.LittleEndian.AppendUint32(b, uint32(rec.OrigLen))
+	b = append(b, rec.Data...)
+	p.buf = appendPad(b)
+	return p.end()
+}
+
+// WriteStats writes an interface statistics block for the first queue's
+// interface with the frames received and dropped over the whole capture.
+func (p *PcapngWriter) WriteStats(ts int64, received, dropped uint64) error {
+	b := p.begin(pcapngISB)
+	b = binary.LittleEndian.AppendUint32(b, 0)
+	b = binary.LittleEndian.AppendUint32(b, uint32(uint64(ts)>>32))
+	b = binary.LittleEndian.AppendUint32(b, uint32(ts))
+	b = appendOption(b, optISBIfRecv, binary.LittleEndian.AppendUint64(nil, received))
+	b = appendOption(b, optISBIfDrop, binary.LittleEndian.AppendUint64(nil, dropped))
+	b = appendOption(b, optEnd, nil)
+	p.buf = b
+	return p.end()
+}
+
+// begin starts a block in p.buf, leaving its total length to end.
+func (p *PcapngWriter) begin(blockType uint32) []byte {
+	b := binary.LittleEndian.AppendUint32(p.buf[:0], blockType)
+	return binary.LittleEndian.AppendUint32(b, 0)
+}
+
+// end fills in the block length, appends the trailing copy and writes it.
+func (p *PcapngWriter) end() error {
+	n := uint32(len(p.buf) + 4)
+	binary.LittleEndian.PutUint32(p.buf[4:], n)
+	p.buf = binary.LittleEndian.AppendUint32(p.buf, n)
+	_, err := p.w.Write(p.buf)
+	return err
+}
+
+func appendOption(b []byte, code uint16, value []byte) []byte {
+	b = binary.LittleEndian.AppendUint16(b, code)
+	b = binary.LittleEndian.AppendUint16(b, uint16(len(value)))
+	b = append(b, value...)
+	return appendPad(b)
+}
+
+// appendPad pads b to 32 bits; blocks start aligned, so offsets within b
+// match offsets within the block.
+func appendPad(b []byte) []byte {
+	for len(b)%4 != 0 {
+		b = append(b, 0)
+	}
+	return b
+}
@@ -0,0 +1,290 @@
+package capture
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"os"
+	"sync/atomic"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+var (
+	// ErrRingFormat is returned when a shared ring's header is not valid.
+	ErrRingFormat = errors.New("invalid capture ring")
+)
+
+// A Ring is a single-producer, single-consumer queue of captured frames in
+// one contiguous buffer, either private or a shared memory mapping another
+// process reads. The producer copies each frame in once; the consumer reads
+// records in place. The producer never waits: a frame that does not fit is
+// counted as a drop.
+//
+// Layout (native byte order, all offsets 8-byte aligned):
+//
+//	0    magic "CBRRING\0"
+//	8    version uint32, 12 reserved
+//	16   data size uint64 (a power of two), 24 data offset uint64
+//	64   head uint64: bytes written, stored by the producer after a record
+//	128  tail uint64: bytes consumed, stored by the consumer
+//	192  drops uint64: frames the producer could not fit
+//	256  data
+//
+// Each record starts with a 24-byte header: length uint32 (header, data
+// and padding to 8 bytes), kind uint16, queue uint16, timestamp int64
+// (Unix nanoseconds), original length uint32 and captured length uint32,
+// followed by the captured bytes. A record never wraps; where one would,
+// the producer writes a pad record (kind 2, length only) to the end of the
+// buffer first. Positions grow without bound and are taken modulo the size.
+type Ring struct {
+	mem   []byte // Whole ring, header included
+	data  []byte
+	mask  uint64
+	head  *atomic.Uint64
+	tail  *atomic.Uint64
+	drops *atomic.Uint64
+	shm   bool
+
+	// Producer-local copy of the consumer position
+	cachedTail uint64
+	// Consumer's record, reused so Read does not allocate
+	rec Record
+}
+
+const (
+	ringVersion    = 1
+	ringHeaderSize = 256
+	recHeaderSize  = 24
+
+	recPacket = 1
+	recPad    = 2
+
+	minRingSize = 1 << 12
+	maxRingSize = 1 << 30
+)
+
+var ringMagic = [8]byte{'C', 'B', 'R', 'R', 'I', 'N', 'G', 0}
+
+// Record is one captured frame. Data aliases the ring and is valid only
+// until the consumer callback returns.
+type Record struct {
+	Queue     int
+	Timestamp int64 // Unix nanoseconds
+	OrigLen   int
+	Data      []byte
+}
+
+// ringSize rounds size up to a supported power of two.
+func ringSize(size int) (int, error) {
+	if size <= 0 || size > maxRingSize {
+		return 0, fmt.Errorf("ring size %d out of range", size)
+	}
+	n := minRingSize
+	for n < size {
+		n <<= 1
+	}
+	return n, nil
+}
+
+// NewRing creates a private ring of at least size data bytes.
+func NewRing(size int) (*Ring, error) {
+	n, err := ringSize(size)
+	if err != nil {
+		return nil, err
+	}
+	// Allocated as words so the counters are aligned
+	words := make([]uint64, (ringHeaderSize+n)/8)
+	mem := unsafe.Slice((*byte)(unsafe.Pointer(&words[0])), len(words)*8)
+	initRing(mem, n)
+	return attachRing(mem, false)
+}
+
+// CreateShm creates a ring of at least size data bytes in a shared memory
+// file at path (typically under /dev/shm), replacing any existing file.
+func CreateShm(path string, size int) (*Ring, error) {
+	n, err := ringSize(size)
+	if err != nil {
+		return nil, err
+	}
+	f, err := os.OpenFile(path, os.O_RDWR|os.O_CREATE|os.O_TRUNC, 0o600)
+	if err != nil {
+		return nil, fmt.Errorf("failed to create capture ring: %w", err)
+	}
+	defer f.Close()
+	if err := f.Truncate(int64(ringHeaderSize + n)); err != nil {
+		return nil, fmt.Errorf("failed to size capture ring: %w", err)
+	}
+
+	mem, err := unix.Mmap(int(f.Fd()), 0, ringHeaderSize+n, unix.PROT_READ|unix.PROT_WRITE, unix.MAP_SHARED)
+	if err != nil {
+		return nil, fmt.Errorf("failed to map capture ring: %w", err)
+	}
+	initRing(mem, n)
+	return attachRing(mem, true)
+}
+
+// OpenShm maps an existing shared ring, for a consumer.
+func OpenShm(path string) (*Ring, error) {
+	f, err := os.OpenFile(path, os.O_RDWR, 0)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	st, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	if st.Size() < ringHeaderSize+minRingSize || st.Size() > ringHeaderSize+maxRingSize {
+		return nil, ErrRingFormat
+	}
+
+	mem, err := unix.Mmap(int(f.Fd()), 0, int(st.Size()), unix.PROT_READ|unix.PROT_WRITE, unix.MAP_SHARED)
+	if err != nil {
+		return nil, fmt.Errorf("failed to map capture ring: %w", err)
+	}
+	r, err := attachRing(mem, true)
+	if err != nil {
+		unix.Munmap(mem)
+		return nil, err
+	}
+	return r, nil
+}
+
+func initRing(mem []byte, size int) {
+	copy(mem[0:8], ringMagic[:])
+	binary.NativeEndian.PutUint32(mem[8:], ringVersion)
+	binary.NativeEndian.PutUint64(mem[16:], uint64(size))
+	binary.NativeEndian.PutUint64(mem[24:], ringHeaderSize)
+}
+
+func attachRing(mem []byte, shm bool) (*Ring, error) {
+	size := binary.NativeEndian.Uint64(mem[16:])
+	if [8]byte(mem[0:8]) != ringMagic ||
+		binary.NativeEndian.Uint32(mem[8:]) != ringVersion ||
+		binary.NativeEndian.Uint64(mem[24:]) != ringHeaderSize ||
+		size&(size-1) != 0 || size < minRingSize || uint64(len(mem)) != ringHeaderSize+size {
+		return nil, ErrRingFormat
+	}
+	r := &Ring{
+		mem:   mem,
+		data:  mem[ringHeaderSize:],
+		mask:  size - 1,
+		head:  (*atomic.Uint64)(unsafe.Pointer(&mem[64])),
+		tail:  (*atomic.Uint64)(unsafe.Pointer(&mem[128])),
+		drops: (*atomic.Uint64)(unsafe.Pointer(&mem[192])),
+		shm:   shm,
+	}
+	r.cachedTail = r.tail.Load()
+	return r, nil
+}
+
+// Size returns the data capacity in bytes.
+func (r *Ring) Size() int {
+	return len(r.data)
+}
+
+// Drops returns the frames dropped because the ring was full.
+func (r *Ring) Drops() uint64 {
+	return r.drops.Load()
+}
+
+// Len returns the bytes written and not yet consumed.
+func (r *Ring) Len() int {
+	return int(r.head.Load() - r.tail.Load())
+}
+
+// Write appends a frame, truncated to snaplen if that is positive, and
+// reports whether it fit. Only one goroutine may write.
+func (r *Ring) Write(queue int, ts int64, frame []byte, snaplen int) bool {
+	capLen := len(frame)
+	if snaplen > 0 && capLen > snaplen {
+		capLen = snaplen
+	}
+	need := uint64(recHeaderSize+capLen+7) &^ 7
+	size := uint64(len(r.data))
+	if need > size/2 {
+		r.drops.Add(1)
+		return false
+	}
+
+	head := r.head.Load()
+	pos := head & r.mask
+	pad := uint64(0)
+	if size-pos < need {
+		pad = size - pos
+	}
+	if head+pad+need-r.cachedTail > size {
+		r.cachedTail = r.tail.Load()
+		if head+pad+need-r.cachedTail > size {
+			r.drops.Add(1)
+			return false
+		}
+	}
+
+	if pad > 0 {
+		binary.NativeEndian.PutUint32(r.data[pos:], uint32(pad))
+		binary.NativeEndian.PutUint16(r.data[pos+4:], recPad)
+		head += pad
+		pos = 0
+	}
+	rec := r.data[pos : pos+need]
+	binary.NativeEndian.PutUint32(rec[0:], uint32(need))
+	binary.NativeEndian.PutUint16(rec[4:], recPacket)
+	binary.NativeEndian.PutUint16(rec[6:], uint16(queue))
+	binary.NativeEndian.PutUint64(rec[8:], uint64(ts))
+	binary.NativeEndian.PutUint32(rec[16:], uint32(len(frame)))
+	binary.NativeEndian.PutUint32(rec[20:], uint32(capLen))
+	copy(rec[recHeaderSize:], frame[:capLen])
+
+	r.head.Store(head + need)
+	return true
+}
+
+// Read passes up to max records (all if max <= 0) to fn, returning how
+// many it passed, and frees them once fn has seen the last. Only one
+// goroutine may read.
+func (r *Ring) Read(max int, fn func(rec *Record)) (int, error) {
+	head := r.head.Load()
+	tail := r.tail.Load()
+	n := 0
+	rec := &r.rec
+	for tail != head && (max <= 0 || n < max) {
+		pos := tail & r.mask
+		length := uint64(binary.NativeEndian.Uint32(r.data[pos:]))
+		if length < 8 || length&7 != 0 || pos+length > uint64(len(r.data)) || length > head-tail {
+			r.tail.Store(tail)
+			return n, fmt.Errorf("%w: bad record at %d", ErrRingFormat, tail)
+		}
+		if binary.NativeEndian.Uint16(r.data[pos+4:]) == recPacket {
+			hdr := r.data[pos : pos+recHeaderSize]
+			capLen := uint64(binary.NativeEndian.Uint32(hdr[20:]))
+			if recHeaderSize+capLen > length {
+				r.tail.Store(tail)
+				return n, fmt.Errorf("%w: bad record at %d", ErrRingFormat, tail)
+			}
+			*rec = Record{
+				Queue:     int(binary.NativeEndian.Uint16(hdr[6:])),
+				Timestamp: int64(binary.NativeEndian.Uint64(hdr[8:])),
+				OrigLen:   int(binary.NativeEndian.Uint32(hdr[16:])),
+				Data:      r.data[pos+recHeaderSize : pos+recHeaderSize+capLen],
+			}
+			fn(rec)
+			n++
+		}
+		tail += length
+	}
+	r.tail.Store(tail)
+	return n, nil
+}
+
+// Close unmaps a shared ring; the file stays for consumers until removed.
+func (r *Ring) Close() error {
+	if !r.shm || r.mem == nil {
+		return nil
+	}
+	err := unix.Munmap(r.mem)
+	r.mem, r.data = nil, nil
+	return err
+}
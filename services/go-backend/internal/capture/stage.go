@@ -0,0 +1,296 @@
+package capture
+
+import (
+	"errors"
+	"fmt"
+	"math/bits"
+	"os"
+	"path/filepath"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+var (
+	// ErrTooManySessions is returned when MaxSessions live captures run.
+	ErrTooManySessions = errors.New("too many capture sessions")
+)
+
+// Config configures a Hub.
+type Config struct {
+	// ShmDir holds one shared ring per queue, capture-q<N>.ring, for an
+	// external consumer such as an IPS engine; empty disables them
+	ShmDir   string
+	RingSize int    // Bytes per shared ring
+	Filter   string // Frames the shared rings get; empty for all
+	Sample   int    // Shared rings get 1 in Sample matching frames
+	Snaplen  int    // Bytes kept per frame; 0 keeps whole frames
+
+	MaxSessions     int // Live captures at once
+	SessionRingSize int // Bytes per queue per live capture
+}
+
+// DefaultConfig returns a configuration without shared rings.
+func DefaultConfig() Config {
+	return Config{
+		RingSize:        4 << 20,
+		Sample:          1,
+		MaxSessions:     4,
+		SessionRingSize: 1 << 20,
+	}
+}
+
+// SessionConfig configures a live capture.
+type SessionConfig struct {
+	Filter  string
+	Sample  int // 1 in Sample matching frames; 0 or 1 for all
+	Snaplen int
+}
+
+// Hub connects the capture stages of every pipeline to the shared rings
+// and the live capture sessions.
+type Hub struct {
+	config Config
+	filter *Filter
+
+	mu       sync.Mutex // Guards stages and session changes
+	stages   []*Stage
+	sessions atomic.Pointer[[]*Session] // Copy on write; nil when none
+}
+
+// NewHub creates a hub.
+func NewHub(config Config) (*Hub, error) {
+	filter, err := CompileFilter(config.Filter)
+	if err != nil {
+		return nil, err
+	}
+	if config.Sample < 1 {
+		config.Sample = 1
+	}
+	if config.ShmDir != "" {
+		if err := os.MkdirAll(config.ShmDir, 0o755); err != nil {
+			return nil, fmt.Errorf("failed to create capture directory: %w", err)
+		}
+	}
+	return &Hub{config: config, filter: filter}, nil
+}
+
+// NewStage creates the capture stage of the pipeline serving queueID,
+// with its shared ring if configured.
+func (h *Hub) NewStage(queueID int) (*Stage, error) {
+	s := &Stage{hub: h, queue: queueID, filter: h.filter, sample: uint32(h.config.Sample)}
+	if h.config.ShmDir != "" {
+		path := filepath.Join(h.config.ShmDir, fmt.Sprintf("capture-q%d.ring", queueID))
+		r, err := CreateShm(path, h.config.RingSize)
+		if err != nil {
+			return nil, err
+		}
+		s.ring, s.ringPath = r, path
+	}
+
+	h.mu.Lock()
+	s.index = len(h.stages)
+	h.stages = append(h.stages, s)
+	h.mu.Unlock()
+	return s, nil
+}
+
+// SharedRings returns the paths of the shared rings.
+func (h *Hub) SharedRings() []string {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	var out []string
+	for _, s := range h.stages {
+		if s.ring != nil {
+			out = append(out, s.ringPath)
+		}
+	}
+	return out
+}
+
+// Close unmaps and removes the shared rings. The datapath must be stopped.
+func (h *Hub) Close() {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	for _, s := range h.stages {
+		if s.ring != nil {
+			s.ring.Close()
+			os.Remove(s.ringPath)
+			s.ring = nil
+		}
+	}
+}
+
+// Subscribe starts a live capture. Frames reach it from the next batch on;
+// Close the session to stop it.
+func (h *Hub) Subscribe(config SessionConfig) (*Session, error) {
+	filter, err := CompileFilter(config.Filter)
+	if err != nil {
+		return nil, err
+	}
+
+	h.mu.Lock()
+	defer h.mu.Unlock()
+
+	var cur []*Session
+	if p := h.sessions.Load(); p != nil {
+		cur = *p
+	}
+	if len(cur) >= h.config.MaxSessions {
+		return nil, ErrTooManySessions
+	}
+
+	sess := &Session{hub: h, config: config, filter: filter, taps: make([]tap, len(h.stages))}
+	if sess.config.Sample < 1 {
+		sess.config.Sample = 1
+	}
+	for i, s := range h.stages {
+		r, err := NewRing(h.config.SessionRingSize)
+		if err != nil {
+			return nil, err
+		}
+		sess.taps[i] = tap{ring: r, queue: s.queue}
+	}
+
+	next := append(append([]*Session(nil), cur...), sess)
+	h.sessions.Store(&next)
+	return sess, nil
+}
+
+func (h *Hub) unsubscribe(sess *Session) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	p := h.sessions.Load()
+	if p == nil {
+		return
+	}
+	var next []*Session
+	for _, s := range *p {
+		if s != sess {
+			next = append(next, s)
+		}
+	}
+	if len(next) == 0 {
+		h.sessions.Store(nil)
+	} else {
+		h.sessions.Store(&next)
+	}
+}
+
+// Session is a live capture with a private ring per queue.
+type Session struct {
+	hub    *Hub
+	config SessionConfig
+	filter *Filter
+	taps   []tap // By stage index
+}
+
+// tap is a session's ring on one queue. n is written by that queue's
+// worker only.
+type tap struct {
+	ring  *Ring
+	queue int
+	n     uint32
+}
+
+// Queues returns the queue of each of the session's rings.
+func (s *Session) Queues() []int {
+	out := make([]int, len(s.taps))
+	for i := range s.taps {
+		out[i] = s.taps[i].queue
+	}
+	return out
+}
+
+// Read passes up to max captured frames (all if max <= 0), visiting the
+// queues in turn, and returns how many it passed. Only one goroutine may
+// read a session.
+func (s *Session) Read(max int, fn func(rec *Record)) int {
+	n := 0
+	for i := range s.taps {
+		if max > 0 && n >= max {
+			break
+		}
+		limit := 0
+		if max > 0 {
+			limit = max - n
+		}
+		// Private rings are only written by this package, so they parse
+		k, _ := s.taps[i].ring.Read(limit, fn)
+		n += k
+	}
+	return n
+}
+
+// Drops returns the frames dropped because the session's rings were full.
+func (s *Session) Drops() uint64 {
+	var n uint64
+	for i := range s.taps {
+		n += s.taps[i].ring.Drops()
+	}
+	return n
+}
+
+// Close stops the capture.
+func (s *Session) Close() {
+	s.hub.unsubscribe(s)
+}
+
+// Stage copies matching frames into the shared ring and live sessions. It
+// must run after xdp.DecodeStage and never decides a verdict.
+type Stage struct {
+	hub      *Hub
+	queue    int
+	index    int
+	filter   *Filter
+	sample   uint32
+	n        uint32 // Matching frames since the last sampled one
+	ring     *Ring
+	ringPath string
+}
+
+// Name returns the stage name.
+func (s *Stage) Name() string { return "capture" }
+
+// Process captures the active frames.
+func (s *Stage) Process(b *xdp.Batch, v *xdp.Verdicts) {
+	sessions := s.hub.sessions.Load()
+	if s.ring == nil && sessions == nil {
+		return
+	}
+
+	var ts int64
+	for m := b.Active; m != 0; m &= m - 1 {
+		i := bits.TrailingZeros64(m)
+		view := &b.Views[i]
+
+		if s.ring != nil && s.filter.Match(view) {
+			if s.n++; s.n >= s.sample {
+				s.n = 0
+				if ts == 0 {
+					ts = time.Now().UnixNano()
+				}
+				s.ring.Write(s.queue, ts, b.Frames[i], s.hub.config.Snaplen)
+			}
+		}
+
+		if sessions == nil {
+			continue
+		}
+		for _, sess := range *sessions {
+			if s.index >= len(sess.taps) || !sess.filter.Match(view) {
+				continue
+			}
+			t := &sess.taps[s.index]
+			if t.n++; t.n >= uint32(sess.config.Sample) {
+				t.n = 0
+				if ts == 0 {
+					ts = time.Now().UnixNano()
+				}
+				t.ring.Write(s.queue, ts, b.Frames[i], sess.config.Snaplen)
+			}
+		}
+	}
+}
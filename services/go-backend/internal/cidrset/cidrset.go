@@ -0,0 +1,332 @@
+// Package cidrset provides compiled IPv4/IPv6 prefix sets for matching
+// packets against large reputation and blocklist feeds.
+//
+// A Set maps prefixes to a caller-defined uint32 value (a list ID, a bitmask
+// of feeds, an ACL action) and answers longest-prefix-match lookups on the
+// fixed-size addresses of xdp.PacketView without allocating. Sets are
+// immutable: a Builder collects prefixes from feeds and compiles them, and a
+// compiled Set can be saved as a snapshot and memory-mapped at startup
+// instead of being rebuilt.
+package cidrset
+
+import (
+	"bufio"
+	"bytes"
+	"cmp"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"net/netip"
+	"slices"
+
+	"golang.org/x/sys/unix"
+)
+
+var (
+	// ErrInvalidPrefix is returned for a prefix or feed line that does not parse.
+	ErrInvalidPrefix = errors.New("invalid prefix")
+	// ErrSnapshotFormat is returned when a snapshot is truncated, corrupt or
+	// was written by an incompatible version or host.
+	ErrSnapshotFormat = errors.New("invalid cidrset snapshot")
+)
+
+func errCorrupt(format string, args ...any) error {
+	return fmt.Errorf("%w: %s", ErrSnapshotFormat, fmt.Sprintf(format, args...))
+}
+
+// prefix4 and prefix6 are the sorted source prefixes of a set, kept for
+// export and iteration. Their layout is part of the snapshot format.
+type prefix4 struct {
+	Addr  [4]byte
+	Bits  uint8
+	_     [3]byte
+	Value uint32
+}
+
+type prefix6 struct {
+	Addr  [16]byte
+	Bits  uint8
+	_     [3]byte
+	Value uint32
+}
+
+// Set is an immutable prefix set. It is safe for concurrent use.
+type Set struct {
+	v4, v6  trie
+	values  []uint32 // Distinct values, indexed by leaf-1
+	prefix4 []prefix4
+	prefix6 []prefix6
+	mapping []byte // Snapshot mapping, for sets opened with Open
+}
+
+// Lookup4 returns the value of the longest prefix containing a.
+func (s *Set) Lookup4(a [4]byte) (uint32, bool) {
+	leaf := s.v4.lookup(uint64(binary.BigEndian.Uint32(a[:]))<<32, 0)
+	if leaf == 0 {
+		return 0, false
+	}
+	return s.values[leaf-1], true
+}
+
+// Lookup6 returns the value of the longest prefix containing a. IPv4-mapped
+// addresses are matched as IPv6; use Lookup to match them as IPv4.
+func (s *Set) Lookup6(a [16]byte) (uint32, bool) {
+	leaf := s.v6.lookup(binary.BigEndian.Uint64(a[:8]), binary.BigEndian.Uint64(a[8:]))
+	if leaf == 0 {
+		return 0, false
+	}
+	return s.values[leaf-1], true
+}
+
+// Lookup returns the value of the longest prefix containing addr, matching
+// IPv4-mapped IPv6 addresses as IPv4.
+func (s *Set) Lookup(addr netip.Addr) (uint32, bool) {
+	addr = addr.Unmap()
+	switch {
+	case addr.Is4():
+		return s.Lookup4(addr.As4())
+	case addr.Is6():
+		return s.Lookup6(addr.As16())
+	default:
+		return 0, false
+	}
+}
+
+// Contains4 reports whether any prefix contains a.
+func (s *Set) Contains4(a [4]byte) bool {
+	return s.v4.lookup(uint64(binary.BigEndian.Uint32(a[:]))<<32, 0) != 0
+}
+
+// Contains6 reports whether any prefix contains a.
+func (s *Set) Contains6(a [16]byte) bool {
+	return s.v6.lookup(binary.BigEndian.Uint64(a[:8]), binary.BigEndian.Uint64(a[8:])) != 0
+}
+
+// Contains reports whether any prefix contains addr.
+func (s *Set) Contains(addr netip.Addr) bool {
+	_, ok := s.Lookup(addr)
+	return ok
+}
+
+// Len returns the number of prefixes in the set.
+func (s *Set) Len() int {
+	return len(s.prefix4) + len(s.prefix6)
+}
+
+// Range calls fn for each prefix in address order, IPv4 first, until fn
+// returns false.
+func (s *Set) Range(fn func(prefix netip.Prefix, value uint32) bool) {
+	for i := range s.prefix4 {
+		if !fn(s.prefix4[i].prefix(), s.prefix4[i].Value) {
+			return
+		}
+	}
+	for i := range s.prefix6 {
+		if !fn(s.prefix6[i].prefix(), s.prefix6[i].Value) {
+			return
+		}
+	}
+}
+
+func (p *prefix4) prefix() netip.Prefix {
+	return netip.PrefixFrom(netip.AddrFrom4(p.Addr), int(p.Bits))
+}
+
+func (p *prefix6) prefix() netip.Prefix {
+	return netip.PrefixFrom(netip.AddrFrom16(p.Addr), int(p.Bits))
+}
+
+// Stats describes the size of a compiled set.
+type Stats struct {
+	Prefixes4 int
+	Prefixes6 int
+	Nodes     int // Trie nodes, both families
+	Leaves    int // Compressed trie leaves, both families
+	Values    int // Distinct values
+	Bytes     int // Memory held by the set
+	Mapped    bool
+}
+
+// Stats returns the size of the set.
+func (s *Set) Stats() Stats {
+	return Stats{
+		Prefixes4: len(s.prefix4),
+		Prefixes6: len(s.prefix6),
+		Nodes:     len(s.v4.nodes) + len(s.v6.nodes),
+		Leaves:    len(s.v4.leaves) + len(s.v6.leaves),
+		Values:    len(s.values),
+		Bytes:     s.snapshotSize(),
+		Mapped:    s.mapping != nil,
+	}
+}
+
+// Close unmaps a set opened with Open. The set must not be used afterwards.
+// Close is a no-op for sets built in memory.
+func (s *Set) Close() error {
+	if s.mapping == nil {
+		return nil
+	}
+	err := unix.Munmap(s.mapping)
+	*s = Set{}
+	return err
+}
+
+// Builder collects prefixes for a Set. Adding a prefix that is already
+// present replaces its value. A Builder is not safe for concurrent use.
+type Builder struct {
+	v4, v6 []entry
+	seq    uint32
+}
+
+// NewBuilder creates a builder with room for sizeHint prefixes.
+func NewBuilder(sizeHint int) *Builder {
+	return &Builder{v4: make([]entry, 0, sizeHint)}
+}
+
+// Add adds prefix with value. The prefix is masked; an IPv4-mapped IPv6
+// prefix of at least 96 bits is added as IPv4.
+func (b *Builder) Add(prefix netip.Prefix, value uint32) error {
+	if !prefix.IsValid() {
+		return fmt.Errorf("%w: %s", ErrInvalidPrefix, prefix)
+	}
+	prefix = prefix.Masked()
+	addr, bits := prefix.Addr(), prefix.Bits()
+	if addr.Is4In6() && bits >= 96 {
+		addr, bits = addr.Unmap(), bits-96
+	}
+
+	e := entry{bits: uint8(bits), value: value, seq: b.seq}
+	b.seq++
+	if addr.Is4() {
+		a := addr.As4()
+		e.hi = uint64(binary.BigEndian.Uint32(a[:])) << 32
+		b.v4 = append(b.v4, e)
+		return nil
+	}
+	a := addr.As16()
+	e.hi, e.lo = binary.BigEndian.Uint64(a[:8]), binary.BigEndian.Uint64(a[8:])
+	b.v6 = append(b.v6, e)
+	return nil
+}
+
+// AddBatch adds every prefix with the same value, as for one feed.
+func (b *Builder) AddBatch(prefixes []netip.Prefix, value uint32) error {
+	for _, p := range prefixes {
+		if err := b.Add(p, value); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// ReadFeed adds the prefixes of a plain-text feed with value and returns how
+// many it read. Each line holds an address or prefix as its first field,
+// separated by whitespace or a comma; blank lines and lines starting with
+// '#' or ';' are skipped.
+func (b *Builder) ReadFeed(r io.Reader, value uint32) (int, error) {
+	sc := bufio.NewScanner(r)
+	n := 0
+	for line := 1; sc.Scan(); line++ {
+		field := bytes.TrimSpace(sc.Bytes())
+		if len(field) == 0 || field[0] == '#' || field[0] == ';' {
+			continue
+		}
+		if i := bytes.IndexAny(field, " \t,"); i >= 0 {
+			field = field[:i]
+		}
+
+		var prefix netip.Prefix
+		var err error
+		if bytes.IndexByte(field, '/') >= 0 {
+			prefix, err = netip.ParsePrefix(string(field))
+		} else {
+			var addr netip.Addr
+			if addr, err = netip.ParseAddr(string(field)); err == nil {
+				prefix = netip.PrefixFrom(addr, addr.BitLen())
+			}
+		}
+		if err != nil {
+			return n, fmt.Errorf("%w: line %d: %q", ErrInvalidPrefix, line, field)
+		}
+		if err := b.Add(prefix, value); err != nil {
+			return n, err
+		}
+		n++
+	}
+	return n, sc.Err()
+}
+
+// Len returns the number of prefixes added, counting duplicates.
+func (b *Builder) Len() int {
+	return len(b.v4) + len(b.v6)
+}
+
+// Build compiles the prefixes added so far into a Set. The builder may be
+// reused afterwards.
+func (b *Builder) Build() *Set {
+	s := &Set{}
+	index := make(map[uint32]uint32)
+	v4 := s.intern(dedupe(b.v4), index)
+	v6 := s.intern(dedupe(b.v6), index)
+
+	s.v4 = buildTrie(v4)
+	s.v6 = buildTrie(v6)
+
+	s.prefix4 = make([]prefix4, len(v4))
+	for i, e := range v4 {
+		p := &s.prefix4[i]
+		binary.BigEndian.PutUint32(p.Addr[:], uint32(e.hi>>32))
+		p.Bits, p.Value = e.bits, s.values[e.value-1]
+	}
+	s.prefix6 = make([]prefix6, len(v6))
+	for i, e := range v6 {
+		p := &s.prefix6[i]
+		binary.BigEndian.PutUint64(p.Addr[:8], e.hi)
+		binary.BigEndian.PutUint64(p.Addr[8:], e.lo)
+		p.Bits, p.Value = e.bits, s.values[e.value-1]
+	}
+	return s
+}
+
+// dedupe returns entries sorted by address then length, keeping the last
+// added of each prefix. The builder's slice is left untouched.
+func dedupe(entries []entry) []entry {
+	sorted := slices.Clone(entries)
+	slices.SortFunc(sorted, func(a, b entry) int {
+		if c := cmp.Compare(a.hi, b.hi); c != 0 {
+			return c
+		}
+		if c := cmp.Compare(a.lo, b.lo); c != 0 {
+			return c
+		}
+		if c := cmp.Compare(a.bits, b.bits); c != 0 {
+			return c
+		}
+		return cmp.Compare(a.seq, b.seq)
+	})
+
+	out := sorted[:0]
+	for i, e := range sorted {
+		if i+1 < len(sorted) && sorted[i+1].hi == e.hi && sorted[i+1].lo == e.lo && sorted[i+1].bits == e.bits {
+			continue
+		}
+		out = append(out, e)
+	}
+	return out
+}
+
+// intern replaces each entry's value with its index+1 in s.values.
+func (s *Set) intern(entries []entry, index map[uint32]uint32) []entry {
+	for i := range entries {
+		v := entries[i].value
+		idx, ok := index[v]
+		if !ok {
+			s.values = append(s.values, v)
+			idx = uint32(len(s.values))
+			index[v] = idx
+		}
+		entries[i].value = idx
+	}
+	return entries
+}
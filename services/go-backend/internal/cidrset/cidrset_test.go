@@ -0,0 +1,303 @@
+package cidrset
+
+import (
+	"errors"
+	"math/rand"
+	"net/netip"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// randomPrefixes returns n random prefixes of one family, clustered so they
+// nest, with lengths biased towards those feeds carry.
+func randomPrefixes(rng *rand.Rand, n int, v6 bool) []netip.Prefix {
+	out := make([]netip.Prefix, n)
+	for i := range out {
+		var addr netip.Addr
+		var bits int
+		if v6 {
+			var a [16]byte
+			rng.Read(a[:])
+			a[0] = 0x20 // Cluster in 2000::/8 so prefixes overlap
+			addr, bits = netip.AddrFrom16(a), []int{16, 32, 48, 56, 64, 127, 128}[rng.Intn(7)]-rng.Intn(8)
+		} else {
+			var a [4]byte
+			rng.Read(a[:])
+			a[0] &= 0x0F // Cluster in 0.0.0.0/4 so prefixes overlap
+			addr, bits = netip.AddrFrom4(a), []int{8, 12, 16, 20, 24, 28, 32}[rng.Intn(7)]-rng.Intn(4)
+		}
+		out[i] = netip.PrefixFrom(addr, bits).Masked()
+	}
+	return out
+}
+
+// linearLookup is the reference longest-prefix match.
+func linearLookup(prefixes []netip.Prefix, values []uint32, addr netip.Addr) (uint32, bool) {
+	best := -1
+	var value uint32
+	for i, p := range prefixes {
+		if p.Contains(addr) && p.Bits() >= best {
+			best, value = p.Bits(), values[i]
+		}
+	}
+	return value, best >= 0
+}
+
+// TestLookupMatchesLinearScan checks the trie against a linear scan for both
+// families, probing prefix boundaries and random addresses.
+func TestLookupMatchesLinearScan(t *testing.T) {
+	rng := rand.New(rand.NewSource(1))
+	for _, v6 := range []bool{false, true} {
+		prefixes := randomPrefixes(rng, 2000, v6)
+		values := make([]uint32, len(prefixes))
+		b := NewBuilder(len(prefixes))
+		for i, p := range prefixes {
+			values[i] = uint32(rng.Intn(16))
+			if err := b.Add(p, values[i]); err != nil {
+				t.Fatal(err)
+			}
+		}
+		// Later duplicates win, in the reference as in the set
+		s := b.Build()
+
+		probes := make([]netip.Addr, 0, 3*len(prefixes))
+		for _, p := range randomPrefixes(rng, len(prefixes), v6) {
+			probes = append(probes, p.Addr())
+		}
+		for _, p := range prefixes {
+			probes = append(probes, p.Addr(), lastAddr(p))
+		}
+
+		for _, addr := range probes {
+			want, wantOK := linearLookup(prefixes, values, addr)
+			got, ok := s.Lookup(addr)
+			if ok != wantOK || got != want {
+				t.Fatalf("%s: expected %d/%v, got %d/%v", addr, want, wantOK, got, ok)
+			}
+		}
+	}
+}
+
+func lastAddr(p netip.Prefix) netip.Addr {
+	a := p.Addr().As16()
+	off := 0
+	if p.Addr().Is4() {
+		off = 96
+	}
+	for bit := off + p.Bits(); bit < 128; bit++ {
+		a[bit/8] |= 0x80 >> (bit % 8)
+	}
+	if p.Addr().Is4() {
+		return netip.AddrFrom16(a).Unmap()
+	}
+	return netip.AddrFrom16(a)
+}
+
+// TestBuilder checks duplicates, mapped prefixes, the default route and feeds.
+func TestBuilder(t *testing.T) {
+	b := NewBuilder(0)
+	b.Add(netip.MustParsePrefix("10.1.2.3/8"), 1)
+	b.Add(netip.MustParsePrefix("10.0.0.0/8"), 2)
+	b.Add(netip.MustParsePrefix("::ffff:192.168.0.0/112"), 3)
+	b.Add(netip.MustParsePrefix("::/0"), 4)
+	if err := b.Add(netip.Prefix{}, 5); !errors.Is(err, ErrInvalidPrefix) {
+		t.Errorf("expected ErrInvalidPrefix, got %v", err)
+	}
+
+	feed := "# threat feed\n\n198.51.100.0/24,botnet\n203.0.113.7 scanner\n;comment\n2001:db8::/32\n"
+	if n, err := b.ReadFeed(strings.NewReader(feed), 6); err != nil || n != 3 {
+		t.Fatalf("expected 3 feed prefixes, got %d (%v)", n, err)
+	}
+	if _, err := NewBuilder(0).ReadFeed(strings.NewReader("10.0.0.0/8\nnot-an-ip\n"), 6); !errors.Is(err, ErrInvalidPrefix) {
+		t.Errorf("expected ErrInvalidPrefix for a bad feed line, got %v", err)
+	}
+
+	s := b.Build()
+	for addr, want := range map[string]uint32{
+		"10.200.0.1":         2, // Duplicate replaced
+		"192.168.5.5":        3, // Mapped prefix stored as IPv4
+		"::ffff:192.168.5.5": 3,
+		"198.51.100.9":       6,
+		"203.0.113.7":        6,
+		"2001:db8::1":        6,
+		"2606:4700::1":       4,
+	} {
+		if got, ok := s.Lookup(netip.MustParseAddr(addr)); !ok || got != want {
+			t.Errorf("%s: expected %d, got %d/%v", addr, want, got, ok)
+		}
+	}
+	if s.Contains4([4]byte{203, 0, 113, 8}) {
+		t.Error("expected 203.0.113.8 to miss")
+	}
+	if s.Len() != 6 {
+		t.Errorf("expected 6 prefixes, got %d", s.Len())
+	}
+}
+
+// TestSnapshot checks that an opened snapshot matches the built set and that
+// corruption is rejected.
+func TestSnapshot(t *testing.T) {
+	rng := rand.New(rand.NewSource(2))
+	b := NewBuilder(0)
+	b.AddBatch(randomPrefixes(rng, 5000, false), 1)
+	b.AddBatch(randomPrefixes(rng, 5000, true), 2)
+	s := b.Build()
+
+	path := filepath.Join(t.TempDir(), "feeds.cidrset")
+	if err := s.Save(path); err != nil {
+		t.Fatal(err)
+	}
+	m, err := Open(path)
+	if err != nil {
+		t.Fatalf("open: %v", err)
+	}
+	defer m.Close()
+
+	if st := m.Stats(); !st.Mapped || st.Nodes != s.Stats().Nodes || m.Len() != s.Len() {
+		t.Fatalf("expected mapped copy of %+v, got %+v", s.Stats(), st)
+	}
+	for _, p := range append(randomPrefixes(rng, 2000, false), randomPrefixes(rng, 2000, true)...) {
+		want, wantOK := s.Lookup(p.Addr())
+		if got, ok := m.Lookup(p.Addr()); got != want || ok != wantOK {
+			t.Fatalf("%s: expected %d/%v, got %d/%v", p.Addr(), want, wantOK, got, ok)
+		}
+	}
+
+	data, err := os.ReadFile(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	data[len(data)/2] ^= 0xFF
+	if err := os.WriteFile(path, data, 0o644); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := Open(path); !errors.Is(err, ErrSnapshotFormat) {
+		t.Errorf("expected ErrSnapshotFormat for a corrupt snapshot, got %v", err)
+	}
+}
+
+// TestLookupAllocs checks that lookups on parser addresses do not allocate.
+func TestLookupAllocs(t *testing.T) {
+	b := NewBuilder(0)
+	b.AddBatch(randomPrefixes(rand.New(rand.NewSource(3)), 1000, false), 1)
+	s := b.Build()
+
+	var v xdp.PacketView
+	v.SrcIP4 = [4]byte{1, 2, 3, 4}
+	if n := testing.AllocsPerRun(100, func() { s.Lookup4(v.SrcIP4); s.Contains6(v.SrcIP6) }); n != 0 {
+		t.Errorf("expected no allocations, got %v", n)
+	}
+}
+
+// fakeACL records exported rules.
+type fakeACL struct {
+	rules map[netip.Prefix]xdp.ACLAction
+}
+
+func (f *fakeACL) SetCIDRActions(prefixes []netip.Prefix, actions []xdp.ACLAction) error {
+	for i, p := range prefixes {
+		f.rules[p] = actions[i]
+	}
+	return nil
+}
+
+func (f *fakeACL) RemoveCIDRs(prefixes []netip.Prefix) error {
+	for _, p := range prefixes {
+		delete(f.rules, p)
+	}
+	return nil
+}
+
+// TestExportACL checks that a reload writes only the difference.
+func TestExportACL(t *testing.T) {
+	// Value 1 is a blocklist, 2 is monitored, 3 is not exported
+	action := func(v uint32) (xdp.ACLAction, bool) {
+		switch v {
+		case 1:
+			return xdp.ACLDeny, true
+		case 2:
+			return xdp.ACLInspect, true
+		}
+		return xdp.ACLNone, false
+	}
+	build := func(rules map[string]uint32) *Set {
+		b := NewBuilder(0)
+		for p, v := range rules {
+			b.Add(netip.MustParsePrefix(p), v)
+		}
+		return b.Build()
+	}
+
+	acl := &fakeACL{rules: make(map[netip.Prefix]xdp.ACLAction)}
+	prev := build(map[string]uint32{"10.0.0.0/8": 1, "10.1.0.0/16": 2, "192.0.2.0/24": 1, "2001:db8::/32": 1})
+	if st, err := ExportACL(acl, nil, prev, action); err != nil || st.Written != 4 || st.Removed != 0 {
+		t.Fatalf("expected 4 written, got %+v (%v)", st, err)
+	}
+
+	next := build(map[string]uint32{"10.0.0.0/8": 1, "10.1.0.0/16": 1, "192.0.2.0/24": 3, "2001:db8:1::/48": 2})
+	st, err := ExportACL(acl, prev, next, action)
+	if err != nil || st.Written != 2 || st.Removed != 2 {
+		t.Fatalf("expected 2 written and 2 removed, got %+v (%v)", st, err)
+	}
+
+	want := map[string]xdp.ACLAction{"10.0.0.0/8": xdp.ACLDeny, "10.1.0.0/16": xdp.ACLDeny, "2001:db8:1::/48": xdp.ACLInspect}
+	if len(acl.rules) != len(want) {
+		t.Errorf("expected %d rules, got %v", len(want), acl.rules)
+	}
+	for p, a := range want {
+		if got := acl.rules[netip.MustParsePrefix(p)]; got != a {
+			t.Errorf("%s: expected %v, got %v", p, a, got)
+		}
+	}
+}
+
+// BenchmarkBuild measures compiling a million-prefix IPv4 feed.
+func BenchmarkBuild(b *testing.B) {
+	prefixes := make([]netip.Prefix, 1_000_000)
+	rng := rand.New(rand.NewSource(4))
+	for i := range prefixes {
+		var a [4]byte
+		rng.Read(a[:])
+		prefixes[i] = netip.PrefixFrom(netip.AddrFrom4(a), 24+rng.Intn(9)).Masked()
+	}
+
+	b.ReportAllocs()
+	var s *Set
+	for i := 0; i < b.N; i++ {
+		builder := NewBuilder(len(prefixes))
+		builder.AddBatch(prefixes, 1)
+		s = builder.Build()
+	}
+	b.ReportMetric(float64(s.Stats().Bytes)/(1<<20), "MB")
+}
+
+// BenchmarkLookup4 measures a lookup against a million-prefix set.
+func BenchmarkLookup4(b *testing.B) {
+	rng := rand.New(rand.NewSource(5))
+	builder := NewBuilder(1_000_000)
+	for i := 0; i < 1_000_000; i++ {
+		var a [4]byte
+		rng.Read(a[:])
+		builder.Add(netip.PrefixFrom(netip.AddrFrom4(a), 24+rng.Intn(9)), 1)
+	}
+	s := builder.Build()
+
+	addrs := make([][4]byte, 4096)
+	for i := range addrs {
+		rng.Read(addrs[i][:])
+	}
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	hits := 0
+	for i := 0; i < b.N; i++ {
+		if s.Contains4(addrs[i&(len(addrs)-1)]) {
+			hits++
+		}
+	}
+	_ = hits
+}
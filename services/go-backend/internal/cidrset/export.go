@@ -0,0 +1,166 @@
+package cidrset
+
+import (
+	"net/netip"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// exportBatch is the number of prefixes written to the fast path per call.
+const exportBatch = 4096
+
+// ACLWriter is the fast-path ACL a set is exported into. *xdp.XDPProgram
+// implements it with the acl_src LPM-trie maps.
+type ACLWriter interface {
+	SetCIDRActions(prefixes []netip.Prefix, actions []xdp.ACLAction) error
+	RemoveCIDRs(prefixes []netip.Prefix) error
+}
+
+// ActionFunc maps a prefix's value to its fast-path action. Returning false
+// leaves the prefix out of the map; returning xdp.ACLNone installs it as a
+// pass-through entry that shadows shorter prefixes and defers to port rules.
+type ActionFunc func(value uint32) (xdp.ACLAction, bool)
+
+// ExportStats counts the changes an export made.
+type ExportStats struct {
+	Written int // Prefixes added or given a new action
+	Removed int // Prefixes of the previous set no longer exported
+}
+
+// ExportACL installs next's prefixes in w, replacing prev's. prev is the set
+// last exported with the same action func, or nil if w holds none; prefixes
+// whose action is unchanged are not rewritten and prefixes next no longer
+// has are removed, so reloading a feed costs only its difference.
+func ExportACL(w ACLWriter, prev, next *Set, action ActionFunc) (ExportStats, error) {
+	if prev == nil {
+		prev = &Set{}
+	}
+	e := exporter{w: w, action: action}
+
+	err := e.family(len(prev.prefix4), len(next.prefix4),
+		func(i, j int) int { return comparePrefix4(&prev.prefix4[i], &next.prefix4[j]) },
+		func(i int) (netip.Prefix, uint32) { return prev.prefix4[i].prefix(), prev.prefix4[i].Value },
+		func(j int) (netip.Prefix, uint32) { return next.prefix4[j].prefix(), next.prefix4[j].Value })
+	if err != nil {
+		return e.stats, err
+	}
+	err = e.family(len(prev.prefix6), len(next.prefix6),
+		func(i, j int) int { return comparePrefix6(&prev.prefix6[i], &next.prefix6[j]) },
+		func(i int) (netip.Prefix, uint32) { return prev.prefix6[i].prefix(), prev.prefix6[i].Value },
+		func(j int) (netip.Prefix, uint32) { return next.prefix6[j].prefix(), next.prefix6[j].Value })
+	if err != nil {
+		return e.stats, err
+	}
+	return e.stats, e.flush()
+}
+
+// exporter batches the writes and removals of an export.
+type exporter struct {
+	w       ACLWriter
+	action  ActionFunc
+	put     []netip.Prefix
+	actions []xdp.ACLAction
+	del     []netip.Prefix
+	stats   ExportStats
+}
+
+// family merges one address family's sorted prefixes of the previous and
+// next sets, queueing the changes between them.
+func (e *exporter) family(prevLen, nextLen int, compare func(i, j int) int,
+	prevAt, nextAt func(int) (netip.Prefix, uint32)) error {
+	i, j := 0, 0
+	for i < prevLen || j < nextLen {
+		var c int
+		switch {
+		case i == prevLen:
+			c = 1
+		case j == nextLen:
+			c = -1
+		default:
+			c = compare(i, j)
+		}
+
+		var p netip.Prefix
+		var oldAction, newAction xdp.ACLAction
+		var wasExported, exported bool
+		if c <= 0 {
+			var v uint32
+			p, v = prevAt(i)
+			oldAction, wasExported = e.action(v)
+			i++
+		}
+		if c >= 0 {
+			var v uint32
+			p, v = nextAt(j)
+			newAction, exported = e.action(v)
+			j++
+		}
+
+		var err error
+		switch {
+		case exported && (!wasExported || newAction != oldAction):
+			err = e.write(p, newAction)
+		case !exported && wasExported:
+			err = e.remove(p)
+		}
+		if err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+func (e *exporter) write(p netip.Prefix, a xdp.ACLAction) error {
+	e.put = append(e.put, p)
+	e.actions = append(e.actions, a)
+	if len(e.put) == exportBatch {
+		return e.flush()
+	}
+	return nil
+}
+
+func (e *exporter) remove(p netip.Prefix) error {
+	e.del = append(e.del, p)
+	if len(e.del) == exportBatch {
+		return e.flush()
+	}
+	return nil
+}
+
+// flush writes pending changes, additions first so that traffic never falls
+// through to a shorter prefix while a more specific one is being replaced.
+func (e *exporter) flush() error {
+	if len(e.put) > 0 {
+		if err := e.w.SetCIDRActions(e.put, e.actions); err != nil {
+			return err
+		}
+		e.stats.Written += len(e.put)
+		e.put, e.actions = e.put[:0], e.actions[:0]
+	}
+	if len(e.del) > 0 {
+		if err := e.w.RemoveCIDRs(e.del); err != nil {
+			return err
+		}
+		e.stats.Removed += len(e.del)
+		e.del = e.del[:0]
+	}
+	return nil
+}
+
+func comparePrefix4(a, b *prefix4) int {
+	for k := range a.Addr {
+		if a.Addr[k] != b.Addr[k] {
+			return int(a.Addr[k]) - int(b.Addr[k])
+		}
+	}
+	return int(a.Bits) - int(b.Bits)
+}
+
+func comparePrefix6(a, b *prefix6) int {
+	for k := range a.Addr {
+		if a.Addr[k] != b.Addr[k] {
+			return int(a.Addr[k]) - int(b.Addr[k])
+		}
+	}
+	return int(a.Bits) - int(b.Bits)
+}
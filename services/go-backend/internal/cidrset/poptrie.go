@@ -0,0 +1,165 @@
+package cidrset
+
+import "math/bits"
+
+// stride is the number of address bits each trie node consumes; 6 bits make
+// a node's 64 slots fit one popcount word.
+const stride = 6
+
+// node is a poptrie node (Asai and Ohara, SIGCOMM 2015). Of its 64 slots,
+// those with a bit in vector have a child node; the rest are leaves, stored
+// run-length compressed: a bit in leafvec marks a slot whose leaf differs
+// from the previous leaf slot. Children and leaves of a node are contiguous,
+// so a slot's entry is found by counting the bits below it.
+type node struct {
+	vector  uint64 // Slots with a child node
+	leafvec uint64 // Leaf slots that start a new run
+	base0   uint32 // Index of the node's first leaf
+	base1   uint32 // Index of the node's first child
+}
+
+// trie is a compiled poptrie. Leaves are pushed down, so every leaf holds
+// the index+1 into the set's values of the longest prefix covering it, or 0
+// where none does. nodes[0] is the root and is always present; children are
+// always stored after their parent.
+type trie struct {
+	nodes  []node
+	leaves []uint32
+}
+
+// chunk returns the stride bits of the 128-bit address hi:lo at bit off,
+// counting from the most significant bit. Bits past the end read as zero.
+func chunk(hi, lo uint64, off uint) uint64 {
+	const mask = 1<<stride - 1
+	switch {
+	case off <= 64-stride:
+		return hi >> (64 - stride - off) & mask
+	case off < 64:
+		return (hi<<(off-(64-stride)) | lo>>(128-stride-off)) & mask
+	case off <= 128-stride:
+		return lo >> (128 - stride - off) & mask
+	default:
+		return lo << (off - (128 - stride)) & mask
+	}
+}
+
+// lookup returns the leaf of the longest prefix matching hi:lo.
+func (t *trie) lookup(hi, lo uint64) uint32 {
+	n := &t.nodes[0]
+	for off := uint(0); ; off += stride {
+		bit := uint64(1) << chunk(hi, lo, off)
+		if n.vector&bit == 0 {
+			return t.leaves[n.base0+uint32(bits.OnesCount64(n.leafvec&(bit<<1-1)))-1]
+		}
+		n = &t.nodes[n.base1+uint32(bits.OnesCount64(n.vector&(bit-1)))]
+	}
+}
+
+// entry is a prefix being compiled.
+type entry struct {
+	hi, lo uint64 // Masked address
+	bits   uint8
+	value  uint32 // Index+1 into the set's values
+	seq    uint32 // Insertion order, so the last duplicate wins
+}
+
+// buildTrie compiles entries, which must be sorted by address then length
+// and free of duplicates. In that order a prefix precedes every prefix it
+// covers, so painting slots in order leaves the longest match in each.
+func buildTrie(entries []entry) trie {
+	var t trie
+	t.nodes = make([]node, 1, 1+len(entries)/4)
+	t.leaves = make([]uint32, 0, 1+len(entries))
+	t.compile(0, entries, 0, 0)
+	return t
+}
+
+// compile fills node n, covering bits [off, off+stride), from entries: the
+// prefixes under it longer than off. inherited is the leaf of the longest
+// prefix ending above the node.
+func (t *trie) compile(n int, entries []entry, off uint, inherited uint32) {
+	var (
+		slots      [1 << stride]uint32
+		start, end [1 << stride]int32 // Entries of each child
+		vector     uint64
+	)
+	for i := range slots {
+		slots[i] = inherited
+	}
+
+	for i := range entries {
+		e := &entries[i]
+		s := chunk(e.hi, e.lo, off)
+		if uint(e.bits) > off+stride {
+			// Entries of one child are contiguous: any prefix sorting
+			// between two of them covers the whole slot, so sorts first
+			if vector&(1<<s) == 0 {
+				vector |= 1 << s
+				start[s] = int32(i)
+			}
+			end[s] = int32(i + 1)
+			continue
+		}
+		span := uint64(1) << (off + stride - uint(e.bits))
+		for j := s; j < s+span; j++ {
+			slots[j] = e.value
+		}
+	}
+
+	nd := node{vector: vector, base0: uint32(len(t.leaves))}
+	first := true
+	for i := range slots {
+		if vector&(1<<i) != 0 {
+			continue
+		}
+		if first || slots[i] != t.leaves[len(t.leaves)-1] {
+			nd.leafvec |= 1 << i
+			t.leaves = append(t.leaves, slots[i])
+			first = false
+		}
+	}
+
+	// Reserve the children together before filling any of them
+	nd.base1 = uint32(len(t.nodes))
+	for c := bits.OnesCount64(vector); c > 0; c-- {
+		t.nodes = append(t.nodes, node{})
+	}
+	t.nodes[n] = nd
+
+	child := int(nd.base1)
+	for m := vector; m != 0; m &= m - 1 {
+		s := bits.TrailingZeros64(m)
+		t.compile(child, entries[start[s]:end[s]], off+stride, slots[s])
+		child++
+	}
+}
+
+// validate checks that every lookup in t stays in bounds and terminates,
+// for tries loaded from a snapshot.
+func (t *trie) validate(values int) error {
+	if len(t.nodes) == 0 {
+		return errCorrupt("trie has no root")
+	}
+	for i := range t.nodes {
+		n := &t.nodes[i]
+		if n.leafvec&n.vector != 0 {
+			return errCorrupt("node %d: slot is both leaf and child", i)
+		}
+		if leafSlots := ^n.vector; leafSlots != 0 && n.leafvec&(leafSlots&-leafSlots) == 0 {
+			return errCorrupt("node %d: first leaf slot starts no run", i)
+		}
+		if uint64(n.base0)+uint64(bits.OnesCount64(n.leafvec)) > uint64(len(t.leaves)) {
+			return errCorrupt("node %d: leaves out of range", i)
+		}
+		if n.vector != 0 && (n.base1 <= uint32(i) ||
+			uint64(n.base1)+uint64(bits.OnesCount64(n.vector)) > uint64(len(t.nodes))) {
+			return errCorrupt("node %d: children out of range", i)
+		}
+	}
+	for i, l := range t.leaves {
+		if l > uint32(values) {
+			return errCorrupt("leaf %d: value out of range", i)
+		}
+	}
+	return nil
+}
@@ -0,0 +1,273 @@
+package cidrset
+
+import (
+	"bufio"
+	"hash/crc32"
+	"io"
+	"os"
+	"path/filepath"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+// Snapshot layout: a fixed header followed by the set's arrays, each 8-byte
+// aligned and in host byte order, so a mapped file is used in place. The
+// header's byte-order mark rejects files from a host of the other order.
+const (
+	snapshotVersion   = 1
+	snapshotByteOrder = 0x01020304
+	snapshotAlign     = 8
+)
+
+var snapshotMagic = [8]byte{'C', 'I', 'D', 'R', 'S', 'E', 'T', 0}
+
+// Snapshot sections, in file order.
+const (
+	secNodes4 = iota
+	secLeaves4
+	secNodes6
+	secLeaves6
+	secValues
+	secPrefix4
+	secPrefix6
+	numSections
+)
+
+type snapshotSection struct {
+	Off uint64 // Byte offset from the start of the file
+	Len uint64 // Number of elements
+}
+
+type snapshotHeader struct {
+	Magic     [8]byte
+	Version   uint32
+	ByteOrder uint32
+	Sections  [numSections]snapshotSection
+	CRC       uint32 // CRC-32C of everything after the header
+	_         uint32
+}
+
+const headerSize = int(unsafe.Sizeof(snapshotHeader{}))
+
+var castagnoli = crc32.MakeTable(crc32.Castagnoli)
+
+// asBytes returns the memory of s.
+func asBytes[T any](s []T) []byte {
+	if len(s) == 0 {
+		return nil
+	}
+	var zero T
+	return unsafe.Slice((*byte)(unsafe.Pointer(unsafe.SliceData(s))), len(s)*int(unsafe.Sizeof(zero)))
+}
+
+// sections returns the set's arrays in file order.
+func (s *Set) sections() [numSections][]byte {
+	return [numSections][]byte{
+		secNodes4:  asBytes(s.v4.nodes),
+		secLeaves4: asBytes(s.v4.leaves),
+		secNodes6:  asBytes(s.v6.nodes),
+		secLeaves6: asBytes(s.v6.leaves),
+		secValues:  asBytes(s.values),
+		secPrefix4: asBytes(s.prefix4),
+		secPrefix6: asBytes(s.prefix6),
+	}
+}
+
+func align(n int) int {
+	return (n + snapshotAlign - 1) &^ (snapshotAlign - 1)
+}
+
+// snapshotSize returns the size of the set's snapshot, which is also the
+// memory the set holds.
+func (s *Set) snapshotSize() int {
+	n := headerSize
+	for _, sec := range s.sections() {
+		n = align(n) + len(sec)
+	}
+	return n
+}
+
+// WriteTo writes the set as a snapshot.
+func (s *Set) WriteTo(w io.Writer) (int64, error) {
+	secs := s.sections()
+	hdr := snapshotHeader{Magic: snapshotMagic, Version: snapshotVersion, ByteOrder: snapshotByteOrder}
+	lens := [numSections]int{
+		len(s.v4.nodes), len(s.v4.leaves), len(s.v6.nodes), len(s.v6.leaves),
+		len(s.values), len(s.prefix4), len(s.prefix6),
+	}
+
+	var pad [snapshotAlign]byte
+	crc := uint32(0)
+	off := headerSize
+	for i, sec := range secs {
+		if a := align(off); a != off {
+			crc = crc32.Update(crc, castagnoli, pad[:a-off])
+			off = a
+		}
+		hdr.Sections[i] = snapshotSection{Off: uint64(off), Len: uint64(lens[i])}
+		crc = crc32.Update(crc, castagnoli, sec)
+		off += len(sec)
+	}
+	hdr.CRC = crc
+
+	var n int64
+	write := func(b []byte) error {
+		m, err := w.Write(b)
+		n += int64(m)
+		return err
+	}
+	if err := write(unsafe.Slice((*byte)(unsafe.Pointer(&hdr)), headerSize)); err != nil {
+		return n, err
+	}
+	for i, sec := range secs {
+		if gap := int(hdr.Sections[i].Off) - int(n); gap > 0 {
+			if err := write(pad[:gap]); err != nil {
+				return n, err
+			}
+		}
+		if err := write(sec); err != nil {
+			return n, err
+		}
+	}
+	return n, nil
+}
+
+// Save writes the set's snapshot to path atomically, so a process that has
+// the previous snapshot mapped keeps a consistent view.
+func (s *Set) Save(path string) error {
+	f, err := os.CreateTemp(filepath.Dir(path), filepath.Base(path)+".tmp*")
+	if err != nil {
+		return err
+	}
+	defer os.Remove(f.Name())
+
+	w := bufio.NewWriterSize(f, 1<<20)
+	if _, err := s.WriteTo(w); err != nil {
+		f.Close()
+		return err
+	}
+	if err := w.Flush(); err != nil {
+		f.Close()
+		return err
+	}
+	if err := f.Sync(); err != nil {
+		f.Close()
+		return err
+	}
+	if err := f.Close(); err != nil {
+		return err
+	}
+	return os.Rename(f.Name(), path)
+}
+
+// Open memory-maps the snapshot at path. The set uses the file's pages in
+// place, so opening costs one checksum pass rather than a rebuild, and
+// processes opening the same snapshot share its memory. Close the set to
+// unmap it. Replace snapshots with Save, never by rewriting them in place.
+func Open(path string) (*Set, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	fi, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	if fi.Size() < int64(headerSize) || fi.Size() != int64(int(fi.Size())) {
+		return nil, errCorrupt("file size %d", fi.Size())
+	}
+
+	data, err := unix.Mmap(int(f.Fd()), 0, int(fi.Size()), unix.PROT_READ, unix.MAP_SHARED)
+	if err != nil {
+		return nil, err
+	}
+	s, err := loadSnapshot(data)
+	if err != nil {
+		unix.Munmap(data)
+		return nil, err
+	}
+	s.mapping = data
+	return s, nil
+}
+
+// loadSnapshot returns a set backed by data, which must be 8-byte aligned.
+// Every offset and trie link is checked so that no lookup on a corrupt
+// snapshot can go out of bounds.
+func loadSnapshot(data []byte) (*Set, error) {
+	if len(data) < headerSize || uintptr(unsafe.Pointer(&data[0]))%snapshotAlign != 0 {
+		return nil, errCorrupt("short or misaligned header")
+	}
+	hdr := (*snapshotHeader)(unsafe.Pointer(&data[0]))
+	if hdr.Magic != snapshotMagic {
+		return nil, errCorrupt("bad magic")
+	}
+	if hdr.ByteOrder != snapshotByteOrder {
+		return nil, errCorrupt("written on a host of another byte order")
+	}
+	if hdr.Version != snapshotVersion {
+		return nil, errCorrupt("version %d, expected %d", hdr.Version, snapshotVersion)
+	}
+	if crc := crc32.Checksum(data[headerSize:], castagnoli); crc != hdr.CRC {
+		return nil, errCorrupt("checksum mismatch")
+	}
+
+	s := &Set{}
+	var err error
+	if s.v4.nodes, err = section[node](data, hdr, secNodes4); err != nil {
+		return nil, err
+	}
+	if s.v4.leaves, err = section[uint32](data, hdr, secLeaves4); err != nil {
+		return nil, err
+	}
+	if s.v6.nodes, err = section[node](data, hdr, secNodes6); err != nil {
+		return nil, err
+	}
+	if s.v6.leaves, err = section[uint32](data, hdr, secLeaves6); err != nil {
+		return nil, err
+	}
+	if s.values, err = section[uint32](data, hdr, secValues); err != nil {
+		return nil, err
+	}
+	if s.prefix4, err = section[prefix4](data, hdr, secPrefix4); err != nil {
+		return nil, err
+	}
+	if s.prefix6, err = section[prefix6](data, hdr, secPrefix6); err != nil {
+		return nil, err
+	}
+
+	if err := s.v4.validate(len(s.values)); err != nil {
+		return nil, err
+	}
+	if err := s.v6.validate(len(s.values)); err != nil {
+		return nil, err
+	}
+	for i := range s.prefix4 {
+		if s.prefix4[i].Bits > 32 {
+			return nil, errCorrupt("IPv4 prefix %d: length %d", i, s.prefix4[i].Bits)
+		}
+	}
+	for i := range s.prefix6 {
+		if s.prefix6[i].Bits > 128 {
+			return nil, errCorrupt("IPv6 prefix %d: length %d", i, s.prefix6[i].Bits)
+		}
+	}
+	return s, nil
+}
+
+// section returns section i of data as a slice of T.
+func section[T any](data []byte, hdr *snapshotHeader, i int) ([]T, error) {
+	var zero T
+	size := uint64(unsafe.Sizeof(zero))
+	sec := hdr.Sections[i]
+	if sec.Off%snapshotAlign != 0 || sec.Off < uint64(headerSize) || sec.Off > uint64(len(data)) ||
+		sec.Len > (uint64(len(data))-sec.Off)/size {
+		return nil, errCorrupt("section %d out of range", i)
+	}
+	if sec.Len == 0 {
+		return nil, nil
+	}
+	return unsafe.Slice((*T)(unsafe.Pointer(&data[sec.Off])), sec.Len), nil
+}
@@ -20,20 +20,57 @@ type Config struct {
 	XDPEnabled   bool
 	XDPMode      string // "native", "skb", or "offload"
 	XDPInterface string
+	XDPQueues    int // 0 uses every RX queue of the interface
+	XDPZeroCopy  bool
+	XDPBatchSize int
+	// XDPLatencySample times one pipeline batch in this many
+	XDPLatencySample int
+	// XDPProgramPath is the compiled bpf/xdp_filter.c object
+	XDPProgramPath string
+	// XDPDefaultAction applies to packets no fast-path ACL rule matched
+	XDPDefaultAction string // "allow", "deny", or "inspect"
 
 	// NUMA settings
 	NUMAEnabled      bool
 	NUMANodeID       int
 	HugepagesEnabled bool
+	HugepageSize     string // "2M" or "1G"
+
+	// Connection tracking settings
+	ConntrackEnabled  bool
+	ConntrackMaxFlows int
+
+	// Packet capture
+	// CaptureShmDir holds a shared capture ring per queue; empty disables them
+	CaptureShmDir   string
+	CaptureRingSize int
+	CaptureFilter   string
+	CaptureSample   int
+	CaptureSnaplen  int // Bytes kept per frame, headers only by default; 0 keeps whole frames
+
+	// Firewall policy
+	// PolicyPath persists the policy set through the API; empty keeps it in memory
+	PolicyPath string
 
 	// Memory pool settings
 	MemoryPoolSlots    int
 	MemoryPoolSlotSize int
 	MemoryPreallocate  bool
+	MemoryScrub        string // "full", "written" or "none"
+
+	// Authentication
+	// JWTSecretKey verifies the Flask backend's access tokens; empty
+	// refuses every request that needs an admin
+	JWTSecretKey string
 
 	// Metrics
 	MetricsEnabled bool
 	MetricsPort    int
+	// TelemetryInterval is the tick of /api/v1/telemetry/stream
+	TelemetryInterval   time.Duration
+	TelemetryTopTalkers int
+	// AccessLogSample logs one request in this many, and every 5xx; 0 disables
+	AccessLogSample int
 
 	// Timeouts
 	ReadTimeout  time.Duration
@@ -52,24 +89,53 @@ func Load() *Config {
 		Version:     getEnv("VERSION", "1.0.0"),
 
 		// XDP
-		XDPEnabled:   getEnvBool("XDP_ENABLED", false),
-		XDPMode:      getEnv("XDP_MODE", "skb"), // skb is safest default
-		XDPInterface: getEnv("XDP_INTERFACE", "eth0"),
+		XDPEnabled:       getEnvBool("XDP_ENABLED", false),
+		XDPMode:          getEnv("XDP_MODE", "skb"), // skb is safest default
+		XDPInterface:     getEnv("XDP_INTERFACE", "eth0"),
+		XDPQueues:        getEnvInt("XDP_QUEUES", 0),
+		XDPZeroCopy:      getEnvBool("XDP_ZEROCOPY", false),
+		XDPBatchSize:     getEnvInt("XDP_BATCH_SIZE", 64),
+		XDPLatencySample: getEnvInt("XDP_LATENCY_SAMPLE", 16),
+		XDPProgramPath:   getEnv("XDP_PROGRAM_PATH", "/app/bpf/xdp_filter.o"),
+		XDPDefaultAction: getEnv("XDP_DEFAULT_ACTION", "allow"),
+
+		// Connection tracking
+		ConntrackEnabled:  getEnvBool("CONNTRACK_ENABLED", true),
+		ConntrackMaxFlows: getEnvInt("CONNTRACK_MAX_FLOWS", 262144),
+
+		// Packet capture
+		CaptureShmDir:   getEnv("CAPTURE_SHM_DIR", ""),
+		CaptureRingSize: getEnvInt("CAPTURE_RING_SIZE", 4<<20),
+		CaptureFilter:   getEnv("CAPTURE_FILTER", ""),
+		CaptureSample:   getEnvInt("CAPTURE_SAMPLE", 1),
+		CaptureSnaplen:  getEnvInt("CAPTURE_SNAPLEN", 128),
+
+		// Firewall policy
+		PolicyPath: getEnv("POLICY_PATH", ""),
 
 		// NUMA
 		NUMAEnabled:      getEnvBool("NUMA_ENABLED", false),
 		NUMANodeID:       getEnvInt("NUMA_NODE_ID", 0),
 		HugepagesEnabled: getEnvBool("HUGEPAGES_ENABLED", false),
+		HugepageSize:     getEnv("HUGEPAGE_SIZE", "2M"),
 
 		// Memory pool
 		MemoryPoolSlots:    getEnvInt("MEMORY_POOL_SLOTS", 1024),
 		MemoryPoolSlotSize: getEnvInt("MEMORY_POOL_SLOT_SIZE", 2048),
 		MemoryPreallocate:  getEnvBool("MEMORY_PREALLOCATE", true),
+		MemoryScrub:        getEnv("MEMORY_SCRUB", "full"),
+
+		// Authentication
+		JWTSecretKey: getEnv("JWT_SECRET_KEY", getEnv("SECRET_KEY", "")),
 
 		// Metrics
 		MetricsEnabled: getEnvBool("METRICS_ENABLED", true),
 		MetricsPort:    getEnvInt("METRICS_PORT", 9090),
 
+		TelemetryInterval:   getEnvDuration("TELEMETRY_INTERVAL", time.Second),
+		TelemetryTopTalkers: getEnvInt("TELEMETRY_TOP_TALKERS", 10),
+		AccessLogSample:     getEnvInt("ACCESS_LOG_SAMPLE", 1),
+
 		// Timeouts
 		ReadTimeout:  getEnvDuration("READ_TIMEOUT", 30*time.Second),
 		WriteTimeout: getEnvDuration("WRITE_TIMEOUT", 30*time.Second),
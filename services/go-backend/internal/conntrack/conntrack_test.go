@@ -0,0 +1,396 @@
+package conntrack
+
+import (
+	"math/bits"
+	"net/netip"
+	"testing"
+	"time"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+func testTable(t *testing.T, mirror Mirror) *Table {
+	config := DefaultConfig()
+	config.MaxFlows = 1024
+	config.Shards = 4
+	config.UseHugepages = false
+	config.Mirror = mirror
+
+	table, err := New(config)
+	if err != nil {
+		t.Fatalf("failed to create table: %v", err)
+	}
+	t.Cleanup(func() { table.Close() })
+	return table
+}
+
+func tcpKey() FlowKey {
+	k := FlowKey{SrcPort: 40000, DstPort: 443, Proto: xdp.IPProtoTCP}
+	k.Src[10], k.Src[11], k.Src[12], k.Src[15] = 0xFF, 0xFF, 10, 1
+	k.Dst[10], k.Dst[11], k.Dst[12], k.Dst[15] = 0xFF, 0xFF, 192, 10
+	return k
+}
+
+// fakeMirror records offloaded tuples.
+type fakeMirror struct {
+	flows    map[xdp.FlowTuple]int64
+	counters map[xdp.FlowTuple][2]uint64 // Fast-path packets and bytes
+}
+
+func (m *fakeMirror) OffloadFlow(t xdp.FlowTuple) error { m.flows[t] = 0; return nil }
+func (m *fakeMirror) RemoveFlow(t xdp.FlowTuple) error  { delete(m.flows, t); return nil }
+func (m *fakeMirror) FlowLastSeen(t xdp.FlowTuple) (int64, error) {
+	return m.flows[t], nil
+}
+func (m *fakeMirror) FlowCounters(t xdp.FlowTuple) (uint64, uint64, error) {
+	c := m.counters[t]
+	return c[0], c[1], nil
+}
+
+// TestTCPHandshake verifies both directions share an entry and the state
+// machine reaches ESTABLISHED after the three-way handshake.
+func TestTCPHandshake(t *testing.T) {
+	table := testTable(t, nil)
+	key := tcpKey()
+	now := Now()
+
+	steps := []struct {
+		key   FlowKey
+		flags uint8
+		state TCPState
+		dir   Direction
+	}{
+		{key, xdp.TCPFlagSYN, TCPSynSent, DirOriginal},
+		{key.Reverse(), xdp.TCPFlagSYN | xdp.TCPFlagACK, TCPSynRecv, DirReply},
+		{key, xdp.TCPFlagACK, TCPEstablished, DirOriginal},
+	}
+	for i, step := range steps {
+		res, err := table.track(&step.key, step.flags, 64, now)
+		if err != nil {
+			t.Fatalf("step %d: unexpected error %v", i, err)
+		}
+		if res.State != step.state || res.Dir != step.dir {
+			t.Errorf("step %d: expected %v/%d, got %v/%d", i, step.state, step.dir, res.State, res.Dir)
+		}
+	}
+
+	flow, ok := table.Lookup(key.Reverse())
+	if !ok || flow.Key != key || !flow.Established {
+		t.Fatalf("expected established flow keyed in original direction, got %+v", flow)
+	}
+	if flow.Packets[DirOriginal] != 2 || flow.Packets[DirReply] != 1 {
+		t.Errorf("expected 2/1 packets, got %v", flow.Packets)
+	}
+	if stats := table.Stats(); stats.Entries != 1 || stats.Inserts != 1 {
+		t.Errorf("expected 1 entry/1 insert, got %d/%d", stats.Entries, stats.Inserts)
+	}
+
+	rst := key
+	rst.SrcPort++
+	if _, err := table.track(&rst, xdp.TCPFlagRST, 64, now); err != ErrInvalidFlow {
+		t.Errorf("expected ErrInvalidFlow for a lone RST, got %v", err)
+	}
+}
+
+// TestExpiryAndOffload verifies established flows are mirrored, kept alive
+// by fast-path activity and removed once idle.
+func TestExpiryAndOffload(t *testing.T) {
+	mirror := &fakeMirror{flows: make(map[xdp.FlowTuple]int64)}
+	table := testTable(t, mirror)
+
+	key := tcpKey()
+	key.Proto = xdp.IPProtoUDP
+	now := Now()
+
+	table.track(&key, 0, 64, now)
+	reverse := key.Reverse()
+	res, _ := table.track(&reverse, 0, 64, now)
+	if !res.Established {
+		t.Fatalf("expected UDP flow established after a reply")
+	}
+
+	table.applyOffload(<-table.offload)
+	if len(mirror.flows) != 2 {
+		t.Fatalf("expected 2 offloaded tuples, got %d", len(mirror.flows))
+	}
+
+	// Fast-path activity extends the flow past its own deadline
+	timeout := int64(table.config.Timeouts.UDPStream)
+	later := now + timeout + int64(time.Second)
+	mirror.flows[key.Tuple()] = later
+	if n := table.Advance(later + int64(time.Second)); n != 0 {
+		t.Errorf("expected no expiry while fast path active, got %d", n)
+	}
+
+	if n := table.Advance(later + timeout + 2*int64(time.Second)); n != 1 {
+		t.Errorf("expected 1 expired flow, got %d", n)
+	}
+	if len(mirror.flows) != 0 {
+		t.Errorf("expected fast path cleared, got %d tuples", len(mirror.flows))
+	}
+	if _, ok := table.Lookup(key); ok {
+		t.Errorf("expected flow removed")
+	}
+
+	// The slot is reusable after expiry
+	if res, err := table.track(&key, 0, 64, later); err != nil || !res.New {
+		t.Errorf("expected new flow after expiry, got %+v %v", res, err)
+	}
+}
+
+// TestTopFlows verifies flows come back largest first, limited to n.
+func TestTopFlows(t *testing.T) {
+	table := testTable(t, nil)
+	now := Now()
+	key := tcpKey()
+	key.Proto = xdp.IPProtoUDP
+	for i := 0; i < 20; i++ {
+		k := key
+		k.SrcPort = uint16(1000 + i)
+		for j := 0; j <= i%7; j++ {
+			table.track(&k, 0, 100+i, now)
+		}
+	}
+
+	top := table.TopFlows(5)
+	if len(top) != 5 {
+		t.Fatalf("expected 5 flows, got %d", len(top))
+	}
+	want := []uint16{1013, 1006, 1019, 1012, 1005} // 791, 742, 714, 672 and 630 bytes
+	for i, f := range top {
+		if f.Key.SrcPort != want[i] {
+			t.Errorf("flow %d: expected source port %d, got %d (%d bytes)", i, want[i], f.Key.SrcPort, flowBytes(&f))
+		}
+	}
+	if n := len(table.TopFlows(100)); n != 20 {
+		t.Errorf("expected all 20 flows, got %d", n)
+	}
+}
+
+// TestTopFlowsOffloaded verifies an offloaded flow counts its fast-path
+// traffic; it ranks first once that outgrows the other flow.
+func TestTopFlowsOffloaded(t *testing.T) {
+	mirror := &fakeMirror{
+		flows:    make(map[xdp.FlowTuple]int64),
+		counters: make(map[xdp.FlowTuple][2]uint64),
+	}
+	table := testTable(t, mirror)
+	now := Now()
+
+	key := tcpKey()
+	key.Proto = xdp.IPProtoUDP
+	reverse := key.Reverse()
+	table.track(&key, 0, 64, now)
+	table.track(&reverse, 0, 64, now)
+	table.applyOffload(<-table.offload)
+
+	other := key
+	other.SrcPort++
+	table.track(&other, 0, 1000, now)
+
+	mirror.counters[key.Tuple()] = [2]uint64{10, 5000}
+	mirror.counters[reverse.Tuple()] = [2]uint64{2, 500}
+
+	top := table.TopFlows(1)
+	if len(top) != 1 || top[0].Key != key || !top[0].Offloaded {
+		t.Fatalf("expected the offloaded flow first, got %+v", top)
+	}
+	if top[0].Packets != [2]uint64{11, 3} || top[0].Bytes != [2]uint64{5064, 564} {
+		t.Errorf("expected fast-path counters added, got %v packets %v bytes", top[0].Packets, top[0].Bytes)
+	}
+}
+
+// TestTopFlowsCandidates verifies calls between scans re-rank the flows the
+// last scan kept, and new flows are found by the next scan.
+func TestTopFlowsCandidates(t *testing.T) {
+	table := testTable(t, nil)
+	now := Now()
+	key := tcpKey()
+	key.Proto = xdp.IPProtoUDP
+	keys := make([]FlowKey, 10)
+	for i := range keys {
+		keys[i] = key
+		keys[i].SrcPort = uint16(1000 + i)
+		table.track(&keys[i], 0, 100+i, now)
+	}
+
+	// One flow asked for keeps the topFlowsSpare largest
+	if top := table.TopFlows(1); len(top) != 1 || top[0].Key != keys[9] {
+		t.Fatalf("expected port 1009 first, got %+v", top)
+	}
+	table.track(&keys[6], 0, 100, now) // A candidate overtakes
+	table.track(&keys[0], 0, 200, now) // Not a candidate, found at the next scan
+	if top := table.TopFlows(1); top[0].Key != keys[6] {
+		t.Errorf("expected port 1006 first between scans, got port %d", top[0].Key.SrcPort)
+	}
+
+	table.top.scanned -= int64(topFlowsScan)
+	if top := table.TopFlows(1); top[0].Key != keys[0] {
+		t.Errorf("expected port 1000 first after a scan, got port %d", top[0].Key.SrcPort)
+	}
+}
+
+func udpView(src, dst byte, sport, dport uint16) xdp.PacketView {
+	v := xdp.PacketView{Layers: xdp.LayerL3 | xdp.LayerL4, IPVersion: 4, Protocol: xdp.IPProtoUDP}
+	v.SrcIP4, v.DstIP4 = [4]byte{10, 0, 0, src}, [4]byte{10, 0, 0, dst}
+	v.SrcPort, v.DstPort = sport, dport
+	return v
+}
+
+// TestStageDeniedNeverOffloaded checks that a flow the classifier denies is
+// neither tracked nor offloaded, even when both directions are seen, while
+// an accepted flow is established and offloaded.
+func TestStageDeniedNeverOffloaded(t *testing.T) {
+	mirror := &fakeMirror{flows: make(map[xdp.FlowTuple]int64)}
+	table := testTable(t, mirror)
+
+	// Deny anything to or from port 53
+	deny := xdp.StageFunc{StageName: "policy", Fn: func(b *xdp.Batch, v *xdp.Verdicts) {
+		for m := b.Active; m != 0; m &= m - 1 {
+			i := bits.TrailingZeros64(m)
+			if b.Views[i].SrcPort == 53 || b.Views[i].DstPort == 53 {
+				v.Drop |= uint64(1) << uint(i)
+			}
+		}
+	}}
+	stage := NewStage(table, deny, true)
+
+	var b xdp.Batch
+	for round := 0; round < 3; round++ {
+		b.N, b.Active = 4, 0xF
+		b.Views[0] = udpView(1, 2, 40000, 53) // Spoofed exchange, both ways
+		b.Views[1] = udpView(2, 1, 53, 40000)
+		b.Views[2] = udpView(1, 2, 40001, 123) // Accepted flow and its reply
+		b.Views[3] = udpView(2, 1, 123, 40001)
+		var v xdp.Verdicts
+		stage.Process(&b, &v)
+		if v.Drop != 0x3 {
+			t.Fatalf("round %d: expected the port 53 frames dropped, got %+v", round, v)
+		}
+		if round > 0 && v.Pass != 0xC {
+			t.Fatalf("round %d: expected the established flow passed, got %+v", round, v)
+		}
+	}
+	for len(table.offload) > 0 {
+		table.applyOffload(<-table.offload)
+	}
+
+	denied := FlowKey{SrcPort: 40000, DstPort: 53, Proto: xdp.IPProtoUDP}
+	denied.Src = netip.AddrFrom4([4]byte{10, 0, 0, 1}).As16()
+	denied.Dst = netip.AddrFrom4([4]byte{10, 0, 0, 2}).As16()
+	if _, ok := table.Lookup(denied); ok {
+		t.Error("expected no entry for the denied flow")
+	}
+	if _, ok := mirror.flows[denied.Tuple()]; ok {
+		t.Error("expected the denied flow never offloaded")
+	}
+	if _, ok := mirror.flows[denied.Reverse().Tuple()]; ok {
+		t.Error("expected the denied reply never offloaded")
+	}
+	if len(mirror.flows) != 2 {
+		t.Errorf("expected the accepted flow's 2 tuples offloaded, got %d", len(mirror.flows))
+	}
+	if stats := table.Stats(); stats.Entries != 1 {
+		t.Errorf("expected 1 entry, got %d", stats.Entries)
+	}
+}
+
+// TestStageReplyNotClassified checks that a reply to a tracked flow is
+// passed without reaching the classifier, and a frame the classifier drops
+// changes no flow.
+func TestStageReplyNotClassified(t *testing.T) {
+	table := testTable(t, &fakeMirror{flows: make(map[xdp.FlowTuple]int64)})
+	var classified int
+	drop := xdp.StageFunc{StageName: "policy", Fn: func(b *xdp.Batch, v *xdp.Verdicts) {
+		classified += bits.OnesCount64(b.Active)
+		v.Drop |= b.Active
+	}}
+	stage := NewStage(table, drop, true)
+
+	orig := udpView(1, 2, 40000, 80)
+	table.Track(&orig, Now())
+	var b xdp.Batch
+	b.N, b.Active = 2, 0x3
+	b.Views[0] = udpView(2, 1, 80, 40000) // Reply
+	b.Views[1] = udpView(1, 2, 40001, 80) // New flow
+	var v xdp.Verdicts
+	stage.Process(&b, &v)
+	if v.Pass != 0x1 || v.Drop != 0x2 || classified != 1 {
+		t.Fatalf("expected the reply passed unclassified, got %+v after %d classified", v, classified)
+	}
+	if _, ok := table.Lookup(KeyFromView(&b.Views[1])); ok {
+		t.Error("expected no entry for the dropped frame")
+	}
+}
+
+// TestEvict checks that an evicted flow leaves the fast path at once, is no
+// longer followed without a verdict and expires, while other flows stay.
+func TestEvict(t *testing.T) {
+	mirror := &fakeMirror{flows: make(map[xdp.FlowTuple]int64)}
+	table := testTable(t, mirror)
+	now := Now()
+
+	for _, port := range []uint16{80, 81} {
+		orig, reply := udpView(1, 2, 40000, port), udpView(2, 1, port, 40000)
+		table.Track(&orig, now)
+		if res, _ := table.Track(&reply, now); !res.Established {
+			t.Fatalf("expected the flow to port %d established", port)
+		}
+	}
+	for len(table.offload) > 0 {
+		table.applyOffload(<-table.offload)
+	}
+	if len(mirror.flows) != 4 {
+		t.Fatalf("expected 4 offloaded tuples, got %d", len(mirror.flows))
+	}
+
+	n := table.Evict(func(ft xdp.FlowTuple) bool { return ft.DstPort == 80 })
+	if n != 1 {
+		t.Fatalf("expected 1 flow evicted, got %d", n)
+	}
+	orig := udpView(1, 2, 40000, 80)
+	if _, ok := mirror.flows[KeyFromView(&orig).Tuple()]; ok || len(mirror.flows) != 2 {
+		t.Errorf("expected only the evicted flow out of the fast path, got %d tuples", len(mirror.flows))
+	}
+	for _, v := range []xdp.PacketView{udpView(1, 2, 40000, 80), udpView(2, 1, 80, 40000)} {
+		if _, ok := table.Follow(&v, now); ok {
+			t.Errorf("expected %d->%d not followed after eviction", v.SrcPort, v.DstPort)
+		}
+	}
+	other := udpView(2, 1, 81, 40000)
+	if _, ok := table.Follow(&other, now); !ok {
+		t.Error("expected the other flow still followed")
+	}
+	if n := table.Evict(func(xdp.FlowTuple) bool { return true }); n != 1 {
+		t.Errorf("expected only the other flow evicted the second time, got %d", n)
+	}
+
+	table.Advance(now + int64(table.config.Timeouts.UDPStream) + 2*int64(time.Second))
+	if stats := table.Stats(); stats.Entries != 0 || stats.Offloaded != 0 {
+		t.Errorf("expected both flows expired and unaccounted, got %+v", stats)
+	}
+}
+
+// BenchmarkTrackEstablished measures the lock-free path for known flows.
+func BenchmarkTrackEstablished(b *testing.B) {
+	config := DefaultConfig()
+	config.UseHugepages = false
+	table, err := New(config)
+	if err != nil {
+		b.Fatal(err)
+	}
+	defer table.Close()
+
+	key := tcpKey()
+	reverse := key.Reverse()
+	now := Now()
+	table.track(&key, xdp.TCPFlagSYN, 64, now)
+	table.track(&reverse, xdp.TCPFlagSYN|xdp.TCPFlagACK, 64, now)
+	table.track(&key, xdp.TCPFlagACK, 64, now)
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		table.track(&key, xdp.TCPFlagACK, 64, now)
+	}
+}
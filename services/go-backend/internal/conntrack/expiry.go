@@ -0,0 +1,275 @@
+// Package conntrack provides timer-wheel expiry and fast-path offload.
+package conntrack
+
+import (
+	"time"
+
+	"golang.org/x/sys/unix"
+)
+
+const (
+	// tickNanos is the timer wheel resolution.
+	tickNanos = int64(time.Second)
+	// wheelSlots is the number of buckets per shard. Deadlines further
+	// out than one rotation are re-checked and rescheduled when their
+	// bucket comes round.
+	wheelSlots = 4096
+	// offloadQueueSize bounds pending fast-path updates.
+	offloadQueueSize = 4096
+)
+
+// offloadOp is a pending change to the BPF fast path.
+type offloadOp uint8
+
+const (
+	opNone offloadOp = iota
+	opAdd
+	opRemove
+)
+
+type offloadReq struct {
+	shard int
+	idx   uint32
+	gen   uint32
+	op    offloadOp
+}
+
+// schedule links slot i into the bucket of deadline; the caller holds the
+// shard lock.
+//
+// Entries are scheduled lazily: the datapath only moves an entry's
+// deadline, and the wheel re-checks it when the bucket fires, so an active
+// flow costs one reschedule per timeout instead of a list move per packet.
+func (s *shard) schedule(i uint32, deadline int64) {
+	tick := (deadline + tickNanos - 1) / tickNanos
+	if tick <= s.tick {
+		tick = s.tick + 1
+	}
+	b := tick & (wheelSlots - 1)
+	s.entries[i].next = s.wheel[b]
+	s.wheel[b] = i + 1
+}
+
+// Advance runs the timer wheels up to now, expiring idle flows.
+// Returns the number of flows expired. Called once per tick by the
+// goroutine started with Start; exported for callers that drive expiry
+// themselves.
+func (t *Table) Advance(now int64) int {
+	expired := 0
+	for i := range t.shards {
+		s := &t.shards[i]
+		s.mu.Lock()
+		expired += t.advanceShard(s, now)
+		s.mu.Unlock()
+	}
+	return expired
+}
+
+func (t *Table) advanceShard(s *shard, now int64) int {
+	target := now / tickNanos
+	if target-s.tick > wheelSlots {
+		s.tick = target - wheelSlots // Every bucket is visited once
+	}
+
+	expired := 0
+	for s.tick < target {
+		s.tick++
+		b := s.tick & (wheelSlots - 1)
+		head := s.wheel[b]
+		s.wheel[b] = 0
+
+		for head != 0 {
+			i := head - 1
+			head = s.entries[i].next
+			s.entries[i].next = 0
+			if t.expire(s, i, now) {
+				expired++
+			}
+		}
+	}
+	return expired
+}
+
+// expire removes slot i if it has been idle past its deadline, otherwise
+// reschedules it. Offloaded flows are idle only if the fast path has not
+// seen them either.
+func (t *Table) expire(s *shard, i uint32, now int64) bool {
+	e := &s.entries[i]
+	st := e.state.Load()
+	if st&slotMask != slotLive {
+		return false
+	}
+
+	mirror := t.config.Mirror
+	if st&flagDead == 0 {
+		deadline := e.deadline.Load()
+		if deadline > now {
+			s.schedule(i, deadline)
+			return false
+		}
+
+		if st&flagOffloaded != 0 && mirror != nil {
+			key := origKey(e.loadKey(), st)
+			last := lastSeen(mirror, key)
+			if extended := last + t.config.Timeouts.timeout(key.Proto, st); extended > now {
+				e.deadline.CompareAndSwap(deadline, extended)
+				s.schedule(i, e.deadline.Load())
+				return false
+			}
+		}
+	}
+
+	if st&flagOffloaded != 0 && mirror != nil {
+		key := origKey(e.loadKey(), st)
+		mirror.RemoveFlow(key.Tuple())
+		mirror.RemoveFlow(key.Reverse().Tuple())
+		t.offloaded.Add(-1)
+	}
+
+	s.remove(i)
+	s.expired.Add(1)
+	return true
+}
+
+// lastSeen returns the latest fast-path activity of either direction.
+func lastSeen(m Mirror, key FlowKey) int64 {
+	last, _ := m.FlowLastSeen(key.Tuple())
+	if reply, _ := m.FlowLastSeen(key.Reverse().Tuple()); reply > last {
+		last = reply
+	}
+	return last
+}
+
+// origKey returns the original-direction key of a packed key.
+func origKey(p packedKey, st uint32) FlowKey {
+	k := p.unpack()
+	if st&flagOrigLow == 0 {
+		k = k.Reverse()
+	}
+	return k
+}
+
+// queueOffload hands a fast-path change to the background goroutine. If
+// the queue is full the pending flag is cleared so a later packet retries.
+func (t *Table) queueOffload(si int, i, st uint32, op offloadOp) {
+	select {
+	case t.offload <- offloadReq{shard: si, idx: i, gen: st >> genShift, op: op}:
+	default:
+		t.offloadErrors.Add(1)
+		t.clearPending(&t.shards[si].entries[i], st>>genShift, 0, 0)
+	}
+}
+
+// clearPending clears flagOffloadPending and applies set/unset to the
+// state of e, unless the slot has been reused.
+func (t *Table) clearPending(e *entry, gen, set, unset uint32) bool {
+	for {
+		st := e.state.Load()
+		if st&slotMask != slotLive || st>>genShift != gen {
+			return false
+		}
+		if e.state.CompareAndSwap(st, (st&^(flagOffloadPending|unset))|set) {
+			return true
+		}
+	}
+}
+
+// applyOffload performs a queued fast-path change under the shard lock,
+// so the entry cannot expire or be reused meanwhile.
+func (t *Table) applyOffload(req offloadReq) {
+	mirror := t.config.Mirror
+	if mirror == nil {
+		return
+	}
+
+	s := &t.shards[req.shard]
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	e := &s.entries[req.idx]
+	st := e.state.Load()
+	if st&slotMask != slotLive || st>>genShift != req.gen {
+		return
+	}
+
+	key := origKey(e.loadKey(), st)
+	fwd, rev := key.Tuple(), key.Reverse().Tuple()
+
+	switch req.op {
+	case opAdd:
+		if st&flagDead != 0 {
+			t.clearPending(e, req.gen, 0, 0) // Evicted since it was queued
+			return
+		}
+		err := mirror.OffloadFlow(fwd)
+		if err == nil {
+			if err = mirror.OffloadFlow(rev); err != nil {
+				mirror.RemoveFlow(fwd)
+			}
+		}
+		if err != nil {
+			t.offloadErrors.Add(1)
+			t.clearPending(e, req.gen, 0, 0)
+			return
+		}
+		if t.clearPending(e, req.gen, flagOffloaded, 0) {
+			t.offloaded.Add(1)
+		}
+
+	case opRemove:
+		mirror.RemoveFlow(fwd)
+		mirror.RemoveFlow(rev)
+		if t.clearPending(e, req.gen, 0, flagOffloaded) {
+			t.offloaded.Add(-1)
+		}
+	}
+}
+
+// Start launches the background goroutine that advances the timer wheels
+// and applies fast-path offloads.
+func (t *Table) Start() {
+	if t.stop != nil {
+		return
+	}
+	stop := make(chan struct{})
+	t.stop = stop
+
+	t.wg.Add(1)
+	go func() {
+		defer t.wg.Done()
+
+		ticker := time.NewTicker(time.Duration(tickNanos))
+		defer ticker.Stop()
+
+		for {
+			select {
+			case <-stop:
+				return
+			case <-ticker.C:
+				t.Advance(Now())
+			case req := <-t.offload:
+				t.applyOffload(req)
+			}
+		}
+	}()
+}
+
+// Stop stops the background goroutine.
+func (t *Table) Stop() {
+	if t.stop == nil {
+		return
+	}
+	close(t.stop)
+	t.wg.Wait()
+	t.stop = nil
+}
+
+// monotonicNanos reads CLOCK_MONOTONIC with a system call; Now uses it
+// once to anchor the runtime clock.
+func monotonicNanos() int64 {
+	var ts unix.Timespec
+	if err := unix.ClockGettime(unix.CLOCK_MONOTONIC, &ts); err != nil {
+		return 0
+	}
+	return ts.Nano()
+}
@@ -0,0 +1,106 @@
+// Package conntrack provides the pipeline stage for connection tracking.
+package conntrack
+
+import (
+	"math/bits"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// Stage tracks the decoded frames of a batch and passes frames of
+// established flows, so they skip the policy. It must run after
+// xdp.DecodeStage.
+//
+// Only a frame the classifier (normally the policy stage) accepts may
+// create a flow or advance one in its original direction; otherwise two
+// spoofed packets, one each way, would establish a denied flow and offload
+// it to the fast path ahead of the ACLs. Frames of established flows and
+// replies to a tracked flow follow it and are passed without a verdict, so
+// a frame the classifier drops has changed no flow. The classifier sees
+// every other frame, and its verdicts are the stage's.
+type Stage struct {
+	table      *Table
+	classifier xdp.Stage
+	section    Section // The classifier's, if it has one
+	// trackUndecided also tracks frames the classifier left undecided,
+	// for pipelines whose default action passes them
+	trackUndecided bool
+	scratch        xdp.Verdicts
+}
+
+// Section is implemented by classifiers whose rules are replaced under the
+// datapath, such as the policy stage: it holds the rules loaded by the next
+// Process call until ExitSection. The stage holds it until the frames the
+// classifier accepted are tracked, so an update that waits out the section
+// and then evicts the flows its new rules deny sees every flow the old rules
+// admitted.
+type Section interface {
+	EnterSection()
+	ExitSection()
+}
+
+// NewStage creates a conntrack stage over table. classifier may be nil, in
+// which case every frame is accepted. trackUndecided must be true only if
+// the pipeline passes undecided frames.
+func NewStage(table *Table, classifier xdp.Stage, trackUndecided bool) *Stage {
+	s := &Stage{table: table, classifier: classifier, trackUndecided: trackUndecided}
+	s.section, _ = classifier.(Section)
+	return s
+}
+
+// Name returns the stage name.
+func (s *Stage) Name() string { return "conntrack" }
+
+// Process passes the frames that follow established flows and replies,
+// classifies the other frames and tracks those accepted.
+func (s *Stage) Process(b *xdp.Batch, v *xdp.Verdicts) {
+	now := Now()
+	var check uint64
+	for m := b.Active; m != 0; m &= m - 1 {
+		i := bits.TrailingZeros64(m)
+		bit := uint64(1) << uint(i)
+		if _, ok := s.table.Follow(&b.Views[i], now); ok {
+			v.Pass |= bit
+		} else {
+			check |= bit
+		}
+	}
+	if check == 0 {
+		return
+	}
+
+	accepted := check
+	if s.section != nil {
+		s.section.EnterSection()
+	}
+	if s.classifier != nil {
+		active := b.Active
+		b.Active = check
+		cv := &s.scratch
+		*cv = xdp.Verdicts{}
+		s.classifier.Process(b, cv)
+		b.Active = active
+
+		cv.Drop &= check
+		cv.Pass &= check &^ cv.Drop
+		cv.TX &= check &^ (cv.Drop | cv.Pass)
+		cv.Redirect &= check &^ (cv.Drop | cv.Pass | cv.TX)
+		v.Drop |= cv.Drop
+		v.Pass |= cv.Pass
+		v.TX |= cv.TX
+		v.Redirect |= cv.Redirect
+
+		accepted = cv.Pass
+		if s.trackUndecided {
+			accepted |= check &^ cv.Decided()
+		}
+	}
+
+	for m := accepted; m != 0; m &= m - 1 {
+		i := bits.TrailingZeros64(m)
+		s.table.Track(&b.Views[i], now)
+	}
+	if s.section != nil {
+		s.section.ExitSection()
+	}
+}
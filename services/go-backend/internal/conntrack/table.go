@@ -0,0 +1,952 @@
+// Package conntrack provides a connection tracking table for the XDP datapath.
+package conntrack
+
+import (
+	"cmp"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"slices"
+	"sync"
+	"sync/atomic"
+	"time"
+	"unsafe"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/memory"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+var (
+	// ErrTableFull is returned when a flow cannot be inserted.
+	ErrTableFull = errors.New("conntrack table full")
+	// ErrInvalidFlow is returned for packets that cannot open a flow, such
+	// as a TCP RST with no matching entry.
+	ErrInvalidFlow = errors.New("packet does not belong to a valid flow")
+	// ErrNotTracked is returned for packets without an IP header, or whose
+	// entry expired while the packet was being tracked.
+	ErrNotTracked = errors.New("packet not tracked")
+)
+
+const (
+	// entrySize is the size of one table slot (two cache lines).
+	entrySize = 128
+	// hugePageSize is the allocation granularity of the table memory.
+	hugePageSize = 2 << 20
+	// maxProbe bounds the linear probe sequence of lookups and inserts.
+	maxProbe = 64
+)
+
+// State word layout of an entry, updated with CAS by the datapath
+const (
+	slotEmpty uint32 = 0
+	slotLive  uint32 = 1
+	slotTomb  uint32 = 2
+	slotMask  uint32 = 0x3
+
+	tcpShift = 8
+	tcpMask  = uint32(0xFF) << tcpShift
+
+	flagOrigLow        uint32 = 1 << 16 // Originator is the low endpoint of the packed key
+	flagReplySeen      uint32 = 1 << 17
+	flagOffloaded      uint32 = 1 << 18 // Mirrored into the BPF fast path
+	flagOffloadPending uint32 = 1 << 19 // Offload or removal queued
+	flagFinOrig        uint32 = 1 << 20
+	flagFinReply       uint32 = 1 << 21
+	flagDead           uint32 = 1 << 22 // Deleted; expires on the next tick
+
+	// genShift holds a slot generation that changes on every reuse, so a
+	// CAS prepared against a previous occupant fails.
+	genShift = 24
+	genMask  = uint32(0xFF) << genShift
+)
+
+func tcpStateOf(st uint32) TCPState {
+	return TCPState((st & tcpMask) >> tcpShift)
+}
+
+func withTCPState(st uint32, s TCPState) uint32 {
+	return st&^tcpMask | uint32(s)<<tcpShift
+}
+
+// FlowKey is the 5-tuple of one direction of a flow. IPv4 addresses are
+// stored IPv4-mapped.
+type FlowKey struct {
+	Src     [16]byte
+	Dst     [16]byte
+	SrcPort uint16
+	DstPort uint16
+	Proto   uint8
+}
+
+// KeyFromView builds the key of a decoded packet. Ports are zero for
+// protocols without them.
+func KeyFromView(v *xdp.PacketView) FlowKey {
+	k := FlowKey{
+		SrcPort: v.SrcPort,
+		DstPort: v.DstPort,
+		Proto:   v.Protocol,
+	}
+	if v.IPVersion == 4 {
+		k.Src[10], k.Src[11] = 0xFF, 0xFF
+		k.Dst[10], k.Dst[11] = 0xFF, 0xFF
+		copy(k.Src[12:], v.SrcIP4[:])
+		copy(k.Dst[12:], v.DstIP4[:])
+	} else {
+		k.Src = v.SrcIP6
+		k.Dst = v.DstIP6
+	}
+	return k
+}
+
+// Reverse returns the key of the opposite direction.
+func (k FlowKey) Reverse() FlowKey {
+	return FlowKey{Src: k.Dst, Dst: k.Src, SrcPort: k.DstPort, DstPort: k.SrcPort, Proto: k.Proto}
+}
+
+// Tuple converts the key to the BPF ct_flows key.
+func (k FlowKey) Tuple() xdp.FlowTuple {
+	return xdp.FlowTuple{Src: k.Src, Dst: k.Dst, SrcPort: k.SrcPort, DstPort: k.DstPort, Proto: k.Proto}
+}
+
+// packedKey is a direction-independent key: the lower endpoint first, so
+// both directions of a flow share one entry.
+type packedKey [5]uint64
+
+// pack returns the packed key and whether the endpoints were swapped.
+func (k *FlowKey) pack() (packedKey, bool) {
+	s0 := binary.LittleEndian.Uint64(k.Src[0:8])
+	s1 := binary.LittleEndian.Uint64(k.Src[8:16])
+	d0 := binary.LittleEndian.Uint64(k.Dst[0:8])
+	d1 := binary.LittleEndian.Uint64(k.Dst[8:16])
+	sp, dp := k.SrcPort, k.DstPort
+
+	swapped := s0 > d0 || (s0 == d0 && (s1 > d1 || (s1 == d1 && sp > dp)))
+	if swapped {
+		s0, s1, d0, d1, sp, dp = d0, d1, s0, s1, dp, sp
+	}
+
+	return packedKey{s0, s1, d0, d1, uint64(sp)<<48 | uint64(dp)<<32 | uint64(k.Proto)}, swapped
+}
+
+// unpack returns the key from the low endpoint to the high endpoint.
+func (p *packedKey) unpack() FlowKey {
+	var k FlowKey
+	binary.LittleEndian.PutUint64(k.Src[0:8], p[0])
+	binary.LittleEndian.PutUint64(k.Src[8:16], p[1])
+	binary.LittleEndian.PutUint64(k.Dst[0:8], p[2])
+	binary.LittleEndian.PutUint64(k.Dst[8:16], p[3])
+	k.SrcPort = uint16(p[4] >> 48)
+	k.DstPort = uint16(p[4] >> 32)
+	k.Proto = uint8(p[4])
+	return k
+}
+
+func (p *packedKey) proto() uint8 {
+	return uint8(p[4])
+}
+
+// hash mixes the packed key (splitmix64 finalizer per word).
+func (p *packedKey) hash() uint32 {
+	h := uint64(0x9E3779B97F4A7C15)
+	for _, w := range p {
+		h = (h ^ w) * 0xBF58476D1CE4E5B9
+		h ^= h >> 31
+	}
+	return uint32(h>>32) ^ uint32(h)
+}
+
+// entry is one table slot. It lives in mmapped memory and holds no Go
+// pointers. Readers never lock: they validate the key against version,
+// which writers make odd while the key is being rewritten (a seqlock), and
+// update state, counters and deadline with atomics.
+type entry struct {
+	version  atomic.Uint32
+	state    atomic.Uint32
+	hash     atomic.Uint32
+	next     uint32 // Timer wheel link (index+1), owned by the shard lock
+	key      [5]atomic.Uint64
+	deadline atomic.Int64 // Monotonic nanoseconds
+	created  atomic.Int64
+	packets  [2]atomic.Uint64 // Indexed by Direction
+	bytes    [2]atomic.Uint64
+	_        [24]byte
+}
+
+// Compile-time check that entry is exactly entrySize bytes
+var (
+	_ [entrySize - unsafe.Sizeof(entry{})]byte
+	_ [unsafe.Sizeof(entry{}) - entrySize]byte
+)
+
+// match reports whether the entry holds key p.
+func (e *entry) match(p *packedKey) bool {
+	for {
+		v := e.version.Load()
+		if v&1 != 0 {
+			continue // Being rewritten
+		}
+		eq := e.key[0].Load() == p[0] && e.key[1].Load() == p[1] &&
+			e.key[2].Load() == p[2] && e.key[3].Load() == p[3] &&
+			e.key[4].Load() == p[4]
+		if e.version.Load() == v {
+			return eq
+		}
+	}
+}
+
+// loadKey copies the key; the caller holds the shard lock.
+func (e *entry) loadKey() packedKey {
+	var p packedKey
+	for i := range p {
+		p[i] = e.key[i].Load()
+	}
+	return p
+}
+
+// shard is one independently locked open-addressing table. The lock
+// serializes inserts, expiry and the timer wheel; lookups never take it.
+type shard struct {
+	mu      sync.Mutex
+	entries []entry
+	mask    uint32
+	limit   int64 // Maximum live entries, keeps the load factor at 3/4
+
+	live       atomic.Int64
+	tombstones int
+
+	wheel []uint32 // Bucket heads (index+1)
+	tick  int64    // Last processed tick
+
+	inserts  atomic.Uint64
+	expired  atomic.Uint64
+	failures atomic.Uint64
+
+	_ [64]byte
+}
+
+// find probes for key p without locking.
+// Returns the slot index and its state word.
+func (s *shard) find(p *packedKey, h uint32) (uint32, uint32, bool) {
+	i := h & s.mask
+	for n := 0; n < maxProbe; n++ {
+		e := &s.entries[i]
+		st := e.state.Load()
+		switch st & slotMask {
+		case slotEmpty:
+			return 0, 0, false
+		case slotLive:
+			if e.hash.Load() == h && e.match(p) {
+				if st = e.state.Load(); st&slotMask == slotLive {
+					return i, st, true
+				}
+			}
+		}
+		i = (i + 1) & s.mask
+	}
+	return 0, 0, false
+}
+
+// Config holds connection tracking configuration.
+type Config struct {
+	MaxFlows     int
+	Shards       int // Rounded up to a power of two
+	NUMANodeID   int
+	UseHugepages bool
+	HugepageSize memory.HugepageSize
+	Timeouts     Timeouts
+	// Loose picks up TCP flows mid-stream instead of requiring a SYN.
+	Loose bool
+	// Mirror, if set, receives established flows for the XDP fast path.
+	Mirror Mirror
+}
+
+// DefaultConfig returns a default conntrack configuration.
+func DefaultConfig() Config {
+	return Config{
+		MaxFlows:     262144,
+		Shards:       64,
+		UseHugepages: true,
+		Timeouts:     DefaultTimeouts(),
+		Loose:        true,
+	}
+}
+
+// Mirror is the BPF fast path established flows are offloaded to.
+// *xdp.XDPProgram implements it.
+type Mirror interface {
+	OffloadFlow(t xdp.FlowTuple) error
+	RemoveFlow(t xdp.FlowTuple) error
+	FlowLastSeen(t xdp.FlowTuple) (int64, error)
+	FlowCounters(t xdp.FlowTuple) (packets, bytes uint64, err error)
+}
+
+// Table is a sharded connection tracking table.
+//
+// The datapath calls Track for every packet; existing flows are found and
+// updated without locks. A background goroutine (Start) expires idle flows
+// with a per-shard timer wheel and keeps the Mirror in sync.
+type Table struct {
+	config     Config
+	allocator  *memory.NUMAAllocator
+	mem        []byte
+	shards     []shard
+	shardShift uint32
+	capacity   int
+
+	offload       chan offloadReq
+	offloaded     atomic.Int64
+	offloadErrors atomic.Uint64
+
+	top topFlows
+
+	stop chan struct{}
+	wg   sync.WaitGroup
+}
+
+// Result describes the flow a packet was tracked to.
+type Result struct {
+	State       TCPState
+	Dir         Direction
+	New         bool // The packet created the flow
+	Established bool // Both directions seen and, for TCP, established
+	Offloaded   bool // The flow is in the BPF fast path
+}
+
+// Flow is a snapshot of a table entry.
+type Flow struct {
+	Key         FlowKey // Original direction
+	State       TCPState
+	Packets     [2]uint64 // Indexed by Direction
+	Bytes       [2]uint64
+	Created     int64 // Monotonic nanoseconds, see Now
+	Deadline    int64
+	Established bool
+	Offloaded   bool
+}
+
+// Stats holds conntrack statistics.
+type Stats struct {
+	Capacity      int    `json:"capacity"`
+	MaxFlows      int    `json:"max_flows"`
+	Entries       int64  `json:"entries"`
+	Offloaded     int64  `json:"offloaded"`
+	Inserts       uint64 `json:"inserts"`
+	Expired       uint64 `json:"expired"`
+	InsertFailed  uint64 `json:"insert_failed"`
+	OffloadErrors uint64 `json:"offload_errors"`
+}
+
+// New creates a table sized for config.MaxFlows, with its slots allocated
+// from NUMA-local (huge)pages.
+func New(config Config) (*Table, error) {
+	if config.MaxFlows <= 0 {
+		return nil, fmt.Errorf("conntrack: invalid max flows %d", config.MaxFlows)
+	}
+
+	shards := nextPow2(max(config.Shards, 1))
+	perShard := nextPow2((config.MaxFlows*4/3 + shards - 1) / shards)
+	if perShard < 2 {
+		perShard = 2
+	}
+	capacity := shards * perShard
+
+	allocator, err := memory.NewHugepageAllocator(config.NUMANodeID, config.UseHugepages, config.HugepageSize)
+	if err != nil {
+		return nil, err
+	}
+
+	size := (capacity*entrySize + hugePageSize - 1) / hugePageSize * hugePageSize
+	mem, err := allocator.AllocateAligned(size)
+	if err != nil {
+		return nil, fmt.Errorf("conntrack: allocate %d bytes: %w", size, err)
+	}
+
+	t := &Table{
+		config:    config,
+		allocator: allocator,
+		mem:       mem,
+		shards:    make([]shard, shards),
+		capacity:  capacity,
+		offload:   make(chan offloadReq, offloadQueueSize),
+	}
+	if shards > 1 {
+		t.shardShift = uint32(32 - log2(shards))
+	} else {
+		t.shardShift = 32
+	}
+
+	all := unsafe.Slice((*entry)(unsafe.Pointer(&mem[0])), capacity)
+	limit := int64((config.MaxFlows + shards - 1) / shards)
+	now := Now()
+	for i := range t.shards {
+		s := &t.shards[i]
+		s.entries = all[i*perShard : (i+1)*perShard : (i+1)*perShard]
+		s.mask = uint32(perShard - 1)
+		s.limit = limit
+		s.wheel = make([]uint32, wheelSlots)
+		s.tick = now / tickNanos
+	}
+
+	return t, nil
+}
+
+func (t *Table) shardFor(h uint32) (*shard, int) {
+	if t.shardShift == 32 {
+		return &t.shards[0], 0
+	}
+	i := int(h >> t.shardShift)
+	return &t.shards[i], i
+}
+
+// Track records a decoded packet and returns the state of its flow.
+// now is the monotonic time in nanoseconds (see Now), read once per batch.
+func (t *Table) Track(v *xdp.PacketView, now int64) (Result, error) {
+	if !v.Has(xdp.LayerL3) {
+		return Result{}, ErrNotTracked
+	}
+	key := KeyFromView(v)
+	return t.track(&key, v.TCPFlags, len(v.Data()), now)
+}
+
+// Follow applies a decoded packet to its flow if the flow already admits
+// it: any packet of an established flow, and replies. It returns false,
+// changing nothing, for a packet with no flow, for one of a deleted flow
+// and for one in the original direction of a flow not yet established;
+// such packets need a policy verdict before Track.
+func (t *Table) Follow(v *xdp.PacketView, now int64) (Result, bool) {
+	if !v.Has(xdp.LayerL3) {
+		return Result{}, false
+	}
+	key := KeyFromView(v)
+	p, swapped := key.pack()
+	h := p.hash()
+	s, si := t.shardFor(h)
+
+	i, st, ok := s.find(&p, h)
+	if !ok {
+		return Result{}, false
+	}
+	orig := swapped != (st&flagOrigLow != 0)
+	if st&flagDead != 0 || orig && !established(st) {
+		return Result{}, false
+	}
+	res, err := t.update(s, si, i, st, swapped, v.TCPFlags, len(v.Data()), now)
+	return res, err == nil
+}
+
+func (t *Table) track(key *FlowKey, flags uint8, size int, now int64) (Result, error) {
+	p, swapped := key.pack()
+	h := p.hash()
+	s, si := t.shardFor(h)
+
+	if i, st, ok := s.find(&p, h); ok {
+		return t.update(s, si, i, st, swapped, flags, size, now)
+	}
+
+	st := uint32(0)
+	if p.proto() == xdp.IPProtoTCP {
+		state, ok := initialTCPState(flags, t.config.Loose)
+		if !ok {
+			return Result{}, ErrInvalidFlow
+		}
+		st = withTCPState(st, state)
+	}
+	if !swapped {
+		st |= flagOrigLow
+	}
+
+	i, cur, inserted, err := s.insert(&p, h, st, now, now+t.config.Timeouts.timeout(p.proto(), st))
+	if err != nil {
+		return Result{}, err
+	}
+	if !inserted {
+		// Raced with another worker inserting the same flow
+		return t.update(s, si, i, cur, swapped, flags, size, now)
+	}
+
+	e := &s.entries[i]
+	e.packets[DirOriginal].Add(1)
+	e.bytes[DirOriginal].Add(uint64(size))
+
+	return Result{State: tcpStateOf(st), Dir: DirOriginal, New: true}, nil
+}
+
+// update applies a packet to an existing entry without locking.
+func (t *Table) update(s *shard, si int, i, st uint32, swapped bool, flags uint8, size int, now int64) (Result, error) {
+	e := &s.entries[i]
+	proto := uint8(e.key[4].Load())
+
+	dir := DirReply
+	if swapped != (st&flagOrigLow != 0) {
+		dir = DirOriginal
+	}
+
+	var req offloadOp
+	for {
+		next := st
+		if dir == DirReply {
+			next |= flagReplySeen
+		}
+		if proto == xdp.IPProtoTCP {
+			next = tcpTransition(next, flags, dir)
+		}
+
+		req = opNone
+		if t.config.Mirror != nil && next&flagOffloadPending == 0 {
+			switch {
+			case established(next) && next&flagOffloaded == 0:
+				req = opAdd
+			case !established(next) && next&flagOffloaded != 0:
+				req = opRemove
+			}
+			if req != opNone {
+				next |= flagOffloadPending
+			}
+		}
+
+		if next == st || e.state.CompareAndSwap(st, next) {
+			st = next
+			break
+		}
+		if st = e.state.Load(); st&slotMask != slotLive {
+			return Result{}, ErrNotTracked // Expired under us
+		}
+	}
+
+	e.packets[dir].Add(1)
+	e.bytes[dir].Add(uint64(size))
+	e.deadline.Store(now + t.config.Timeouts.timeout(proto, st))
+
+	if req != opNone {
+		t.queueOffload(si, i, st, req)
+	}
+
+	return Result{
+		State:       tcpStateOf(st),
+		Dir:         dir,
+		Established: established(st),
+		Offloaded:   st&flagOffloaded != 0,
+	}, nil
+}
+
+// insert adds key p under the shard lock. If another writer inserted it
+// first, returns the existing slot with inserted false.
+func (s *shard) insert(p *packedKey, h, st uint32, now, deadline int64) (idx, cur uint32, inserted bool, err error) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	slot := -1
+	i := h & s.mask
+probe:
+	for n := 0; n < maxProbe; n++ {
+		e := &s.entries[i]
+		old := e.state.Load()
+		switch old & slotMask {
+		case slotEmpty:
+			if slot < 0 {
+				slot = int(i)
+			}
+			break probe // End of the probe sequence
+		case slotTomb:
+			if slot < 0 {
+				slot = int(i)
+			}
+		case slotLive:
+			if e.hash.Load() == h && e.match(p) {
+				return i, old, false, nil
+			}
+		}
+		i = (i + 1) & s.mask
+	}
+
+	if slot < 0 || s.live.Load() >= s.limit {
+		s.failures.Add(1)
+		return 0, 0, false, ErrTableFull
+	}
+
+	e := &s.entries[slot]
+	old := e.state.Load()
+	if old&slotMask == slotTomb {
+		s.tombstones--
+	}
+	gen := (old>>genShift + 1) << genShift
+	st |= slotLive | gen
+
+	e.version.Add(1)
+	for w := range p {
+		e.key[w].Store(p[w])
+	}
+	e.hash.Store(h)
+	e.created.Store(now)
+	e.deadline.Store(deadline)
+	for d := range e.packets {
+		e.packets[d].Store(0)
+		e.bytes[d].Store(0)
+	}
+	e.state.Store(st)
+	e.version.Add(1)
+
+	s.live.Add(1)
+	s.inserts.Add(1)
+	s.schedule(uint32(slot), deadline)
+
+	return uint32(slot), st, true, nil
+}
+
+// remove turns a live slot into a tombstone; the caller holds the lock.
+// Tombstones directly before an empty slot end no probe sequence and are
+// cleared back to empty.
+func (s *shard) remove(i uint32) {
+	e := &s.entries[i]
+
+	e.version.Add(1)
+	for {
+		st := e.state.Load()
+		if e.state.CompareAndSwap(st, st&genMask|slotTomb) {
+			break
+		}
+	}
+	e.version.Add(1)
+
+	s.live.Add(-1)
+	s.tombstones++
+
+	if s.entries[(i+1)&s.mask].state.Load()&slotMask != slotEmpty {
+		return
+	}
+	for n := uint32(0); n <= s.mask; n++ {
+		e := &s.entries[i]
+		st := e.state.Load()
+		if st&slotMask != slotTomb {
+			break
+		}
+		e.state.Store(st &^ slotMask) // Empty, keeping the generation
+		s.tombstones--
+		i = (i - 1) & s.mask
+	}
+}
+
+// Lookup returns a snapshot of the flow a key belongs to, in either direction.
+func (t *Table) Lookup(key FlowKey) (Flow, bool) {
+	p, _ := key.pack()
+	h := p.hash()
+	s, _ := t.shardFor(h)
+
+	i, st, ok := s.find(&p, h)
+	if !ok {
+		return Flow{}, false
+	}
+
+	e := &s.entries[i]
+	orig := p.unpack()
+	if st&flagOrigLow == 0 {
+		orig = orig.Reverse()
+	}
+
+	return Flow{
+		Key:         orig,
+		State:       tcpStateOf(st),
+		Packets:     [2]uint64{e.packets[0].Load(), e.packets[1].Load()},
+		Bytes:       [2]uint64{e.bytes[0].Load(), e.bytes[1].Load()},
+		Created:     e.created.Load(),
+		Deadline:    e.deadline.Load(),
+		Established: established(st),
+		Offloaded:   st&flagOffloaded != 0,
+	}, true
+}
+
+// TopFlows returns up to n live flows with the most bytes in both
+// directions, largest first. An offloaded flow counts its fast-path
+// traffic too.
+//
+// Scanning every slot costs time in proportion to the capacity, plus two
+// map lookups per offloaded flow, so the table is scanned at most every
+// topFlowsScan (or when more flows are asked for than last time). Calls in
+// between re-rank the topFlowsSpare*n largest flows of the last scan, with
+// their current counters; a flow that was small then shows up at the next
+// scan.
+func (t *Table) TopFlows(n int) []Flow {
+	if n <= 0 {
+		return nil
+	}
+	c := &t.top
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	var top []rankedFlow
+	if now := Now(); n > c.n || now-c.scanned >= int64(topFlowsScan) {
+		top = t.scanFlows(n * topFlowsSpare)
+		c.n, c.scanned = n, now
+		c.slots = c.slots[:0]
+		for i := range top {
+			c.slots = append(c.slots, top[i].slot)
+		}
+	} else {
+		top = make([]rankedFlow, 0, len(c.slots))
+		for _, slot := range c.slots {
+			if f, ok := t.flowAt(slot, true, 0); ok {
+				top = append(top, f)
+			}
+		}
+	}
+
+	slices.SortFunc(top, func(a, b rankedFlow) int {
+		return cmp.Compare(flowBytes(&b.Flow), flowBytes(&a.Flow))
+	})
+	flows := make([]Flow, min(n, len(top)))
+	for i := range flows {
+		flows[i] = top[i].Flow
+	}
+	return flows
+}
+
+const (
+	// topFlowsScan is the longest TopFlows goes without a full scan.
+	topFlowsScan = 10 * time.Second
+	// topFlowsSpare is how many candidates per flow asked for TopFlows
+	// keeps between scans.
+	topFlowsSpare = 4
+)
+
+// topFlows is the TopFlows candidate set.
+type topFlows struct {
+	mu      sync.Mutex
+	slots   []flowSlot
+	n       int   // Flows asked for at the last scan
+	scanned int64 // Monotonic nanoseconds of the last scan
+}
+
+// flowSlot names a flow by its slot and the slot's generation.
+type flowSlot struct {
+	shard, idx, gen uint32
+}
+
+// rankedFlow is a flow with the slot it was read from.
+type rankedFlow struct {
+	Flow
+	slot flowSlot
+}
+
+// scanFlows returns up to n live flows with the most bytes, unordered.
+func (t *Table) scanFlows(n int) []rankedFlow {
+	top := make([]rankedFlow, 0, n) // Min-heap on total bytes
+	for si := range t.shards {
+		for i := range t.shards[si].entries {
+			var floor uint64
+			if len(top) == n {
+				floor = flowBytes(&top[0].Flow)
+			}
+			f, ok := t.flowAt(flowSlot{shard: uint32(si), idx: uint32(i)}, false, floor)
+			if !ok {
+				continue
+			}
+
+			if len(top) < n {
+				top = append(top, f)
+				for c := len(top) - 1; c > 0; {
+					parent := (c - 1) / 2
+					if flowBytes(&top[parent].Flow) <= flowBytes(&top[c].Flow) {
+						break
+					}
+					top[parent], top[c] = top[c], top[parent]
+					c = parent
+				}
+				continue
+			}
+			top[0] = f
+			siftDownFlows(top)
+		}
+	}
+	return top
+}
+
+// flowAt reads the live flow in slot without locking, if it has more than
+// floor bytes. With sameGen, the slot must not have been reused since
+// slot was taken; the flow read carries the generation found.
+func (t *Table) flowAt(slot flowSlot, sameGen bool, floor uint64) (rankedFlow, bool) {
+	e := &t.shards[slot.shard].entries[slot.idx]
+	st := e.state.Load()
+	if st&slotMask != slotLive || sameGen && st>>genShift != slot.gen {
+		return rankedFlow{}, false
+	}
+	slot.gen = st >> genShift
+
+	offloaded := st&flagOffloaded != 0
+	mirror := t.config.Mirror
+	bytes := [2]uint64{e.bytes[0].Load(), e.bytes[1].Load()}
+	if (!offloaded || mirror == nil) && floor > 0 && bytes[0]+bytes[1] <= floor {
+		return rankedFlow{}, false
+	}
+
+	v := e.version.Load()
+	if v&1 != 0 {
+		return rankedFlow{}, false // Being rewritten
+	}
+	p := e.loadKey()
+	if e.version.Load() != v {
+		return rankedFlow{}, false
+	}
+	f := rankedFlow{
+		Flow: Flow{
+			Key:         origKey(p, st),
+			State:       tcpStateOf(st),
+			Packets:     [2]uint64{e.packets[0].Load(), e.packets[1].Load()},
+			Bytes:       bytes,
+			Created:     e.created.Load(),
+			Deadline:    e.deadline.Load(),
+			Established: established(st),
+			Offloaded:   offloaded,
+		},
+		slot: slot,
+	}
+
+	if offloaded && mirror != nil {
+		for dir, tuple := range [2]xdp.FlowTuple{f.Key.Tuple(), f.Key.Reverse().Tuple()} {
+			if packets, bytes, err := mirror.FlowCounters(tuple); err == nil {
+				f.Packets[dir] += packets
+				f.Bytes[dir] += bytes
+			}
+		}
+		if floor > 0 && flowBytes(&f.Flow) <= floor {
+			return rankedFlow{}, false
+		}
+	}
+	return f, true
+}
+
+func flowBytes(f *Flow) uint64 {
+	return f.Bytes[0] + f.Bytes[1]
+}
+
+// siftDownFlows restores the min-heap after its root was replaced.
+func siftDownFlows(h []rankedFlow) {
+	for i := 0; ; {
+		least := i
+		for _, c := range [2]int{2*i + 1, 2*i + 2} {
+			if c < len(h) && flowBytes(&h[c].Flow) < flowBytes(&h[least].Flow) {
+				least = c
+			}
+		}
+		if least == i {
+			return
+		}
+		h[i], h[least] = h[least], h[i]
+		i = least
+	}
+}
+
+// Delete marks the flow of key for removal on the next expiry tick, even
+// if it is still active in the fast path.
+func (t *Table) Delete(key FlowKey) bool {
+	p, _ := key.pack()
+	h := p.hash()
+	s, _ := t.shardFor(h)
+
+	i, st, ok := s.find(&p, h)
+	if !ok {
+		return false
+	}
+
+	e := &s.entries[i]
+	for !e.state.CompareAndSwap(st, st|flagDead) {
+		if st = e.state.Load(); st&slotMask != slotLive {
+			return false
+		}
+	}
+	e.deadline.Store(0)
+	return true
+}
+
+// Evict deletes the flows whose original-direction tuple drop reports true,
+// as Delete does, and takes them out of the BPF fast path at once, so their
+// next packets meet the policy again. It holds each shard's lock in turn.
+// Returns the number of flows evicted.
+func (t *Table) Evict(drop func(xdp.FlowTuple) bool) int {
+	mirror := t.config.Mirror
+	evicted := 0
+	for si := range t.shards {
+		s := &t.shards[si]
+		s.mu.Lock()
+		for i := range s.entries {
+			e := &s.entries[i]
+			st := e.state.Load()
+			if st&slotMask != slotLive || st&flagDead != 0 {
+				continue
+			}
+			key := origKey(e.loadKey(), st)
+			if !drop(key.Tuple()) {
+				continue
+			}
+			for !e.state.CompareAndSwap(st, st|flagDead) {
+				st = e.state.Load()
+			}
+			e.deadline.Store(0)
+			// The entry keeps flagOffloaded until it expires, which
+			// accounts for it; the fast path must stop passing it now
+			if st&flagOffloaded != 0 && mirror != nil {
+				mirror.RemoveFlow(key.Tuple())
+				mirror.RemoveFlow(key.Reverse().Tuple())
+			}
+			evicted++
+		}
+		s.mu.Unlock()
+	}
+	return evicted
+}
+
+// Stats returns table statistics.
+func (t *Table) Stats() Stats {
+	stats := Stats{
+		Capacity:      t.capacity,
+		MaxFlows:      t.config.MaxFlows,
+		Offloaded:     t.offloaded.Load(),
+		OffloadErrors: t.offloadErrors.Load(),
+	}
+	for i := range t.shards {
+		s := &t.shards[i]
+		stats.Entries += s.live.Load()
+		stats.Inserts += s.inserts.Load()
+		stats.Expired += s.expired.Load()
+		stats.InsertFailed += s.failures.Load()
+	}
+	return stats
+}
+
+// Close stops the background goroutine and releases the table memory.
+// The table must not be used afterwards.
+func (t *Table) Close() error {
+	t.Stop()
+	t.shards = nil
+	mem := t.mem
+	t.mem = nil
+	return t.allocator.Free(mem)
+}
+
+// monoBase and wallBase anchor Now to CLOCK_MONOTONIC, the clock of
+// bpf_ktime_get_ns, while reading it through the runtime's vDSO clock.
+var (
+	monoBase = monotonicNanos()
+	wallBase = time.Now()
+)
+
+// Now returns the current CLOCK_MONOTONIC time in nanoseconds.
+func Now() int64 {
+	return monoBase + int64(time.Since(wallBase))
+}
+
+func nextPow2(n int) int {
+	p := 1
+	for p < n {
+		p <<= 1
+	}
+	return p
+}
+
+func log2(n int) int {
+	b := 0
+	for n > 1 {
+		n >>= 1
+		b++
+	}
+	return b
+}
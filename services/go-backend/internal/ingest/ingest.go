@@ -0,0 +1,158 @@
+// Package ingest runs frames from a byte stream through a batch pipeline,
+// for test and replay injectors that need packets per second rather than
+// requests per second.
+//
+// The request stream is a sequence of frames, each a big-endian uint16
+// length followed by that many bytes of Ethernet frame. The response
+// stream carries one byte per frame, its xdp.XDPAction, in request order.
+// Responses are written a batch at a time and flushed whenever the
+// request stream has no more buffered frames, so a client may send and
+// receive on one long-lived connection.
+package ingest
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/memory"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// Content types of the request and response streams.
+const (
+	ContentType        = "application/vnd.cerberus.frames"
+	VerdictContentType = "application/vnd.cerberus.verdicts"
+)
+
+// Ingest errors
+var (
+	ErrFrameSize = errors.New("invalid ingest frame length")
+	ErrTruncated = errors.New("ingest stream ends inside a frame")
+)
+
+// PipelineFactory returns a pipeline for one stream and a function that
+// releases it when the stream ends.
+type PipelineFactory func() (pipeline *xdp.Pipeline, release func())
+
+// Config configures a stream.
+type Config struct {
+	Cache     *memory.PoolCache // Frames are read straight into its slots
+	SlotSize  int               // Size of the cache's slots
+	Pipeline  *xdp.Pipeline
+	BatchSize int // Frames per pipeline run, at most xdp.MaxBatchSize
+}
+
+// Stats counts a stream's frames.
+type Stats struct {
+	Frames  uint64
+	Bytes   uint64
+	Batches uint64
+	Actions [xdp.XDPRedirect + 1]uint64 // Frames by verdict
+}
+
+// readBufferSize is the stream read buffer; it bounds the frames a batch
+// can take without waiting for the network.
+const readBufferSize = 256 << 10
+
+// Serve runs the frames of r through the pipeline, writing verdicts to w
+// and calling flush when it would otherwise wait for input. It returns
+// at the end of r, or at the first error with the frames before it
+// answered.
+func Serve(r io.Reader, w io.Writer, flush func() error, cfg Config) (Stats, error) {
+	var st Stats
+	batchSize := cfg.BatchSize
+	if batchSize <= 0 || batchSize > xdp.MaxBatchSize {
+		batchSize = xdp.MaxBatchSize
+	}
+	maxFrame := min(cfg.SlotSize, 0xFFFF)
+
+	br := bufio.NewReaderSize(r, readBufferSize)
+	var b xdp.Batch
+	var slots [xdp.MaxBatchSize]int
+	var out [xdp.MaxBatchSize]byte
+
+	for {
+		b.Reset()
+		var readErr error
+		for b.N < batchSize {
+			// Answer what is in hand rather than wait for more
+			if b.N > 0 && br.Buffered() == 0 {
+				break
+			}
+			// Take the slot first so that, with the pool exhausted, the
+			// frames in hand are answered and release theirs
+			idx, buf, err := cfg.Cache.Acquire()
+			if err != nil {
+				if !errors.Is(err, memory.ErrPoolExhausted) || b.N == 0 {
+					readErr = err
+				}
+				break
+			}
+			n, err := readFrame(br, buf[:maxFrame])
+			if err != nil {
+				cfg.Cache.Release(idx)
+				readErr = err
+				break
+			}
+			b.Frames[b.N] = buf[:n]
+			slots[b.N] = idx
+			b.N++
+			st.Bytes += uint64(n)
+		}
+
+		if b.N > 0 {
+			n := b.N
+			v := cfg.Pipeline.Run(&b)
+			for i := 0; i < n; i++ {
+				a := v.Action(i)
+				out[i] = byte(a)
+				st.Actions[a]++
+				cfg.Cache.ReleaseWritten(slots[i], len(b.Frames[i]))
+			}
+			st.Frames += uint64(n)
+			st.Batches++
+			if _, err := w.Write(out[:n]); err != nil {
+				return st, err
+			}
+		}
+
+		if readErr != nil || br.Buffered() == 0 {
+			if err := flush(); err != nil {
+				return st, err
+			}
+		}
+		if readErr == io.EOF {
+			return st, nil
+		}
+		if readErr != nil {
+			return st, readErr
+		}
+	}
+}
+
+// readFrame reads one frame into buf, returning io.EOF only at a frame
+// boundary.
+func readFrame(br *bufio.Reader, buf []byte) (int, error) {
+	hdr, err := br.Peek(2)
+	if err != nil {
+		if err == io.EOF && len(hdr) > 0 {
+			err = ErrTruncated
+		}
+		return 0, err
+	}
+	n := int(binary.BigEndian.Uint16(hdr))
+	br.Discard(2)
+	if n == 0 || n > len(buf) {
+		return 0, fmt.Errorf("%w: %d (limit %d)", ErrFrameSize, n, len(buf))
+	}
+	if _, err := io.ReadFull(br, buf[:n]); err != nil {
+		if errors.Is(err, io.EOF) || errors.Is(err, io.ErrUnexpectedEOF) {
+			err = ErrTruncated
+		}
+		return 0, err
+	}
+	return n, nil
+}
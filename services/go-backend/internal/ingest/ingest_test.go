@@ -0,0 +1,154 @@
+package ingest
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"io"
+	"math/bits"
+	"testing"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/memory"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// oddDrop drops frames whose first byte is odd and leaves the rest to the
+// default action.
+type oddDrop struct{}
+
+func (oddDrop) Name() string { return "odd-drop" }
+
+func (oddDrop) Process(b *xdp.Batch, v *xdp.Verdicts) {
+	for m := b.Active; m != 0; m &= m - 1 {
+		i := bits.TrailingZeros64(m)
+		if b.Frames[i][0]&1 == 1 {
+			v.Set(i, xdp.XDPDrop)
+		}
+	}
+}
+
+func testConfig(t testing.TB, slots int) Config {
+	pc := memory.DefaultPoolConfig()
+	pc.NumSlots = slots
+	pc.CacheSize = 8
+	pool, err := memory.NewMemoryPool(pc)
+	if err != nil {
+		t.Fatal(err)
+	}
+	return Config{
+		Cache:    pool.NewCache(),
+		SlotSize: pool.SlotSize(),
+		Pipeline: xdp.NewPipeline(xdp.XDPPass, oddDrop{}),
+	}
+}
+
+func appendFrame(dst []byte, frame []byte) []byte {
+	dst = binary.BigEndian.AppendUint16(dst, uint16(len(frame)))
+	return append(dst, frame...)
+}
+
+func stream(n int) []byte {
+	var s []byte
+	for i := 0; i < n; i++ {
+		s = appendFrame(s, bytes.Repeat([]byte{byte(i)}, 60+i%40))
+	}
+	return s
+}
+
+// TestServe checks that verdicts come back one per frame, in order, across
+// batches and flushes.
+func TestServe(t *testing.T) {
+	cfg := testConfig(t, 64)
+	var out bytes.Buffer
+	flushes := 0
+	// A one-byte reader makes every frame arrive on its own
+	for _, r := range []io.Reader{bytes.NewReader(stream(200)), &oneByte{bytes.NewReader(stream(200))}} {
+		out.Reset()
+		st, err := Serve(r, &out, func() error { flushes++; return nil }, cfg)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if st.Frames != 200 || out.Len() != 200 {
+			t.Fatalf("expected 200 verdicts, got %d (%d frames)", out.Len(), st.Frames)
+		}
+		for i, a := range out.Bytes() {
+			want := xdp.XDPPass
+			if i&1 == 1 {
+				want = xdp.XDPDrop
+			}
+			if xdp.XDPAction(a) != want {
+				t.Fatalf("frame %d: expected %v, got %v", i, want, xdp.XDPAction(a))
+			}
+		}
+		if st.Actions[xdp.XDPDrop] != 100 || st.Actions[xdp.XDPPass] != 100 {
+			t.Errorf("unexpected action counts %v", st.Actions)
+		}
+	}
+	if flushes < 2 {
+		t.Errorf("expected a flush per stream at least, got %d", flushes)
+	}
+}
+
+type oneByte struct{ r io.Reader }
+
+func (o *oneByte) Read(p []byte) (int, error) {
+	return o.r.Read(p[:1])
+}
+
+// TestServeErrors checks that bad frames end the stream after the frames
+// before them are answered.
+func TestServeErrors(t *testing.T) {
+	cfg := testConfig(t, 64)
+	good := stream(3)
+	tests := []struct {
+		name string
+		in   []byte
+		want error
+	}{
+		{"empty frame", append(append([]byte{}, good...), 0, 0), ErrFrameSize},
+		{"oversize frame", append(append([]byte{}, good...), 0xFF, 0xFF), ErrFrameSize},
+		{"short header", append(append([]byte{}, good...), 0), ErrTruncated},
+		{"short frame", append(append([]byte{}, good...), 0, 10, 1), ErrTruncated},
+	}
+	for _, tt := range tests {
+		var out bytes.Buffer
+		st, err := Serve(bytes.NewReader(tt.in), &out, func() error { return nil }, cfg)
+		if !errors.Is(err, tt.want) {
+			t.Errorf("%s: expected %v, got %v", tt.name, tt.want, err)
+		}
+		if st.Frames != 3 || out.Len() != 3 {
+			t.Errorf("%s: expected 3 verdicts, got %d", tt.name, out.Len())
+		}
+	}
+}
+
+// TestServeExhausted checks that a stream larger than the pool completes
+// by answering batches early to free their slots.
+func TestServeExhausted(t *testing.T) {
+	cfg := testConfig(t, 16)
+	var out bytes.Buffer
+	st, err := Serve(bytes.NewReader(stream(100)), &out, func() error { return nil }, cfg)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if st.Frames != 100 || st.Batches < 100/16 {
+		t.Errorf("expected 100 frames in at least 6 batches, got %d in %d", st.Frames, st.Batches)
+	}
+}
+
+// BenchmarkServe measures frames per second through a one-stage pipeline.
+func BenchmarkServe(b *testing.B) {
+	cfg := testConfig(b, 256)
+	in := stream(4096)
+	r := bytes.NewReader(in)
+	b.SetBytes(int64(len(in)))
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		r.Reset(in)
+		if _, err := Serve(r, io.Discard, func() error { return nil }, cfg); err != nil {
+			b.Fatal(err)
+		}
+	}
+	b.ReportMetric(float64(b.N)*4096/b.Elapsed().Seconds(), "frames/s")
+}
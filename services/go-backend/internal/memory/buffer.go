@@ -3,15 +3,30 @@ package memory
 
 import (
 	"encoding/binary"
+	"errors"
 	"sync"
 )
 
+// ErrNoHeadroom is returned when a buffer cannot grow at the front.
+var ErrNoHeadroom = errors.New("insufficient buffer headroom")
+
 // Buffer provides a wrapper around a memory pool slot with helper methods.
+//
+// The data starts offset bytes into the slot. The bytes in front of it are
+// headroom, which lets headers be pushed without moving the payload, and
+// lets a Buffer describe an AF_XDP frame the kernel wrote after its own
+// UMEM headroom. When the pool is registered as a UMEM, Addr is the frame
+// address used in ring descriptors.
 type Buffer struct {
 	pool    *MemoryPool
 	slotIdx int
-	data    []byte
-	length  int // Actual data length (may be less than slot size)
+	data    []byte // The whole slot
+	offset  int    // Start of data within the slot
+	length  int    // Actual data length (may be less than slot size)
+	// written is the high-water mark of the slot bytes used, which the
+	// ScrubWritten policy clears: data shrunk by Reset or SetLength must
+	// not be left behind for the slot's next user
+	written int
 }
 
 // BufferPool manages a set of reusable buffers.
@@ -43,18 +58,77 @@ func (bp *BufferPool) Get() (*Buffer, error) {
 	buf.pool = bp.memPool
 	buf.slotIdx = idx
 	buf.data = data
+	buf.offset = 0
 	buf.length = 0
+	buf.written = 0
+
+	return buf, nil
+}
+
+// GetWithHeadroom acquires a buffer whose data starts headroom bytes into
+// the slot, leaving room for Prepend.
+func (bp *BufferPool) GetWithHeadroom(headroom int) (*Buffer, error) {
+	if headroom < 0 || headroom > bp.memPool.slotSize {
+		return nil, ErrNoHeadroom
+	}
+	buf, err := bp.Get()
+	if err != nil {
+		return nil, err
+	}
+	buf.offset = headroom
+	return buf, nil
+}
+
+// Wrap takes ownership of an acquired slot without copying, for example a
+// received AF_XDP frame. addr is an offset within the pool's Region, such
+// as a UMEM descriptor address, and length the bytes of data from there.
+// The slot is returned to the pool by Put.
+func (bp *BufferPool) Wrap(addr uint64, length int) (*Buffer, error) {
+	idx, offset := bp.memPool.SlotAt(addr)
+	data, err := bp.memPool.GetSlot(idx)
+	if err != nil {
+		return nil, err
+	}
+	if length < 0 || offset+length > len(data) {
+		return nil, ErrInvalidSlot
+	}
+
+	buf := bp.buffers.Get().(*Buffer)
+	buf.pool = bp.memPool
+	buf.slotIdx = idx
+	buf.data = data
+	buf.offset = offset
+	buf.length = length
+	buf.written = offset + length
 
 	return buf, nil
 }
 
+// Detach releases the Buffer wrapper but keeps the slot acquired, handing
+// it to the caller. It returns the data address and length, for example to
+// queue the frame on an AF_XDP TX ring, which gives the slot back once the
+// send completes.
+func (bp *BufferPool) Detach(buf *Buffer) (uint64, int) {
+	addr, length := buf.Addr(), buf.length
+
+	buf.pool = nil
+	buf.data = nil
+	buf.offset = 0
+	buf.length = 0
+	buf.written = 0
+
+	bp.buffers.Put(buf)
+	return addr, length
+}
+
 // Put returns a buffer to the pool.
 func (bp *BufferPool) Put(buf *Buffer) error {
 	if buf == nil {
 		return nil
 	}
 
-	err := bp.memPool.Release(buf.slotIdx)
+	// The pool's ScrubWritten policy only clears the bytes we wrote
+	err := bp.memPool.ReleaseWritten(buf.slotIdx, max(buf.written, buf.offset+buf.length))
 	if err != nil {
 		return err
 	}
@@ -62,19 +136,30 @@ func (bp *BufferPool) Put(buf *Buffer) error {
 	// Clear buffer metadata
 	buf.pool = nil
 	buf.data = nil
+	buf.offset = 0
 	buf.length = 0
+	buf.written = 0
 
 	bp.buffers.Put(buf)
 	return nil
 }
 
+// Pool returns the memory pool the buffers are taken from.
+func (bp *BufferPool) Pool() *MemoryPool {
+	return bp.memPool
+}
+
 // Data returns the underlying byte slice up to the current length.
 func (b *Buffer) Data() []byte {
-	return b.data[:b.length]
+	end := b.offset + b.length
+	return b.data[b.offset:end:end]
 }
 
-// RawData returns the full underlying byte slice (slot size).
+// RawData returns the full underlying byte slice (slot size), headroom
+// included. The caller may write anywhere in it, so the whole slot is
+// scrubbed on release.
 func (b *Buffer) RawData() []byte {
+	b.written = len(b.data)
 	return b.data
 }
 
@@ -83,17 +168,58 @@ func (b *Buffer) Length() int {
 	return b.length
 }
 
-// Capacity returns the maximum capacity (slot size).
+// Capacity returns the maximum data length after the headroom.
 func (b *Buffer) Capacity() int {
-	return len(b.data)
+	return len(b.data) - b.offset
 }
 
 // SetLength sets the current data length.
 func (b *Buffer) SetLength(n int) {
-	if n > len(b.data) {
-		n = len(b.data)
+	if n > len(b.data)-b.offset {
+		n = len(b.data) - b.offset
 	}
 	b.length = n
+	b.mark()
+}
+
+// mark raises the high-water mark to the end of the data.
+func (b *Buffer) mark() {
+	if end := b.offset + b.length; end > b.written {
+		b.written = end
+	}
+}
+
+// Headroom returns the number of free bytes in front of the data.
+func (b *Buffer) Headroom() int {
+	return b.offset
+}
+
+// Addr returns the offset of the data within the pool's Region. For a pool
+// registered as a UMEM it is the AF_XDP descriptor address.
+func (b *Buffer) Addr() uint64 {
+	return b.pool.SlotAddr(b.slotIdx) + uint64(b.offset)
+}
+
+// Prepend grows the data by n bytes at the front, taken from the headroom,
+// and returns the new leading bytes for the caller to fill in (for example
+// an encapsulation header).
+func (b *Buffer) Prepend(n int) ([]byte, error) {
+	if n < 0 || n > b.offset {
+		return nil, ErrNoHeadroom
+	}
+	b.offset -= n
+	b.length += n
+	return b.data[b.offset : b.offset+n : b.offset+n], nil
+}
+
+// Pull removes n bytes from the front of the data (for example a stripped
+// tunnel header), returning them to the headroom.
+func (b *Buffer) Pull(n int) {
+	if n > b.length {
+		n = b.length
+	}
+	b.offset += n
+	b.length -= n
 }
 
 // Reset clears the buffer.
@@ -103,13 +229,15 @@ func (b *Buffer) Reset() {
 
 // Write appends data to the buffer.
 func (b *Buffer) Write(p []byte) (n int, err error) {
-	available := len(b.data) - b.length
+	end := b.offset + b.length
+	available := len(b.data) - end
 	if len(p) > available {
 		p = p[:available]
 	}
 
-	copy(b.data[b.length:], p)
+	copy(b.data[end:], p)
 	b.length += len(p)
+	b.mark()
 	return len(p), nil
 }
 
@@ -119,44 +247,48 @@ func (b *Buffer) Read(p []byte) (n int, err error) {
 		return 0, nil
 	}
 
-	n = copy(p, b.data[:b.length])
+	n = copy(p, b.Data())
 	return n, nil
 }
 
 // WriteUint16 writes a uint16 in network byte order.
 func (b *Buffer) WriteUint16(v uint16) error {
-	if b.length+2 > len(b.data) {
+	end := b.offset + b.length
+	if end+2 > len(b.data) {
 		return ErrPoolExhausted
 	}
-	binary.BigEndian.PutUint16(b.data[b.length:], v)
+	binary.BigEndian.PutUint16(b.data[end:], v)
 	b.length += 2
+	b.mark()
 	return nil
 }
 
 // WriteUint32 writes a uint32 in network byte order.
 func (b *Buffer) WriteUint32(v uint32) error {
-	if b.length+4 > len(b.data) {
+	end := b.offset + b.length
+	if end+4 > len(b.data) {
 		return ErrPoolExhausted
 	}
-	binary.BigEndian.PutUint32(b.data[b.length:], v)
+	binary.BigEndian.PutUint32(b.data[end:], v)
 	b.length += 4
+	b.mark()
 	return nil
 }
 
 // ReadUint16At reads a uint16 at the specified offset.
 func (b *Buffer) ReadUint16At(offset int) uint16 {
-	if offset+2 > b.length {
+	if offset < 0 || offset+2 > b.length {
 		return 0
 	}
-	return binary.BigEndian.Uint16(b.data[offset:])
+	return binary.BigEndian.Uint16(b.data[b.offset+offset:])
 }
 
 // ReadUint32At reads a uint32 at the specified offset.
 func (b *Buffer) ReadUint32At(offset int) uint32 {
-	if offset+4 > b.length {
+	if offset < 0 || offset+4 > b.length {
 		return 0
 	}
-	return binary.BigEndian.Uint32(b.data[offset:])
+	return binary.BigEndian.Uint32(b.data[b.offset+offset:])
 }
 
 // SlotIndex returns the underlying memory pool slot index.
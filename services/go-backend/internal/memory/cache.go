@@ -0,0 +1,115 @@
+// Package memory provides per-worker magazine caches for memory pool slots.
+package memory
+
+import "sync/atomic"
+
+// cacheLinePad separates hot per-worker fields from their neighbours.
+type cacheLinePad [64]byte
+
+// PoolCache is a per-worker magazine of free slots in front of a
+// MemoryPool's global free list.
+//
+// Acquire and Release only touch the cache's own memory until the magazine
+// runs empty or full, at which point half a magazine is moved from or to
+// the global lock-free stack with a single CAS. Statistics are counted in
+// the cache and summed by MemoryPool.Stats, so the hot path never writes a
+// cache line shared with another worker.
+//
+// A PoolCache is not safe for concurrent use; create one per worker
+// goroutine with MemoryPool.NewCache and Flush it when the worker exits.
+type PoolCache struct {
+	_ cacheLinePad
+
+	pool  *MemoryPool
+	slots []int32 // Magazine of free slot indices, used as a stack
+	n     int
+
+	allocs atomic.Uint64
+	frees  atomic.Uint64
+
+	_ cacheLinePad
+}
+
+// NewCache creates a per-worker cache registered with the pool.
+func (p *MemoryPool) NewCache() *PoolCache {
+	c := &PoolCache{
+		pool:  p,
+		slots: make([]int32, p.cacheSize),
+	}
+
+	p.mu.Lock()
+	p.caches = append(p.caches, c)
+	p.mu.Unlock()
+
+	return c
+}
+
+// Acquire gets a free memory slot, refilling the magazine from the global
+// free list when it is empty.
+// Returns the slot index and a byte slice for the slot.
+func (c *PoolCache) Acquire() (int, []byte, error) {
+	if c.n == 0 {
+		c.n = c.pool.free.popN(c.slots[:len(c.slots)/2])
+		if c.n == 0 {
+			return 0, nil, ErrPoolExhausted
+		}
+	}
+
+	c.n--
+	idx := int(c.slots[c.n])
+	c.pool.inUse[idx].Store(true)
+	c.allocs.Add(1)
+
+	return idx, c.pool.slot(idx), nil
+}
+
+// Release returns a slot to the magazine, spilling half of it to the
+// global free list when it is full.
+func (c *PoolCache) Release(idx int) error {
+	return c.ReleaseWritten(idx, -1)
+}
+
+// ReleaseWritten is Release with the number of bytes written to the slot,
+// used by the ScrubWritten policy. A negative length means unknown.
+func (c *PoolCache) ReleaseWritten(idx, written int) error {
+	p := c.pool
+	if idx < 0 || idx >= p.numSlots {
+		return ErrInvalidSlot
+	}
+
+	// Another cache may release the same index concurrently; only the one
+	// that clears the flag may cache the slot
+	if !p.inUse[idx].CompareAndSwap(true, false) {
+		return ErrSlotNotInUse
+	}
+
+	p.scrubSlot(idx, written)
+
+	if c.n == len(c.slots) {
+		c.spill(len(c.slots) / 2)
+	}
+	c.slots[c.n] = int32(idx)
+	c.n++
+	c.frees.Add(1)
+
+	return nil
+}
+
+// Flush returns every cached slot to the global free list.
+func (c *PoolCache) Flush() {
+	c.spill(c.n)
+}
+
+// spill moves the top k cached slots to the global free list in one push.
+func (c *PoolCache) spill(k int) {
+	if k == 0 {
+		return
+	}
+
+	chain := c.slots[c.n-k : c.n]
+	for i := 0; i < k-1; i++ {
+		c.pool.free.link(chain[i], chain[i+1])
+	}
+	c.pool.free.pushChain(chain[0], chain[k-1])
+	c.n -= k
+}
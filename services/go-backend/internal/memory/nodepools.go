@@ -0,0 +1,140 @@
+// Package memory provides per-NUMA-node memory pools.
+package memory
+
+import (
+	"fmt"
+	"sort"
+)
+
+// NodePools holds one MemoryPool per NUMA node, so each worker allocates
+// from memory attached to its own socket.
+type NodePools struct {
+	pools []*MemoryPool // Indexed by node ID; nil for nodes without a pool
+	nodes []int         // Node IDs with a pool, ascending
+}
+
+// NewNodePools creates a pool with config on each of nodes; the NUMANodeID
+// of config is ignored. A nil nodes creates one pool on every NUMA node
+// that has memory, or a single pool on node 0 if NUMA is unavailable.
+func NewNodePools(config PoolConfig, nodes []int) (*NodePools, error) {
+	if nodes == nil {
+		nodes = poolNodes(GetNUMAInfo())
+	}
+	if len(nodes) == 0 {
+		return nil, fmt.Errorf("no NUMA nodes for memory pools")
+	}
+
+	nodes = append([]int(nil), nodes...)
+	sort.Ints(nodes)
+
+	np := &NodePools{
+		pools: make([]*MemoryPool, nodes[len(nodes)-1]+1),
+	}
+	for _, node := range nodes {
+		if node < 0 {
+			np.Close()
+			return nil, fmt.Errorf("invalid NUMA node %d", node)
+		}
+		if np.pools[node] != nil {
+			continue
+		}
+
+		nodeConfig := config
+		nodeConfig.NUMANodeID = node
+		pool, err := NewMemoryPool(nodeConfig)
+		if err != nil {
+			np.Close()
+			return nil, fmt.Errorf("node %d: %w", node, err)
+		}
+		np.pools[node] = pool
+		np.nodes = append(np.nodes, node)
+	}
+
+	return np, nil
+}
+
+// poolNodes returns the nodes that should get a pool: every node with
+// memory (CPU-only nodes cannot back allocations), or node 0.
+func poolNodes(info NUMAInfo) []int {
+	if !info.Available {
+		return []int{0}
+	}
+
+	var nodes []int
+	for node := range info.CPUsPerNode {
+		if mem, ok := info.MemoryMB[node]; ok && mem == 0 {
+			continue
+		}
+		nodes = append(nodes, node)
+	}
+	for node, mem := range info.MemoryMB {
+		if _, ok := info.CPUsPerNode[node]; !ok && mem > 0 {
+			nodes = append(nodes, node)
+		}
+	}
+	if len(nodes) == 0 {
+		return []int{0}
+	}
+	return nodes
+}
+
+// Pool returns the pool on node, or the pool of the lowest node if node has
+// none.
+func (np *NodePools) Pool(node int) *MemoryPool {
+	if node >= 0 && node < len(np.pools) && np.pools[node] != nil {
+		return np.pools[node]
+	}
+	return np.pools[np.nodes[0]]
+}
+
+// Local returns the pool on the NUMA node the calling thread runs on.
+// Workers pinned to a node's CPUs always get that node's pool; unpinned
+// goroutines get the pool of wherever they are scheduled at the time.
+func (np *NodePools) Local() *MemoryPool {
+	if len(np.nodes) == 1 {
+		return np.pools[np.nodes[0]]
+	}
+	return np.Pool(CurrentNUMANode())
+}
+
+// Nodes returns the node IDs that have a pool, in ascending order.
+func (np *NodePools) Nodes() []int {
+	return np.nodes
+}
+
+// Stats returns the statistics of all pools combined.
+func (np *NodePools) Stats() PoolStats {
+	var total PoolStats
+	for _, node := range np.nodes {
+		stats := np.pools[node].Stats()
+		total.TotalSlots += stats.TotalSlots
+		total.FreeSlots += stats.FreeSlots
+		total.UsedSlots += stats.UsedSlots
+		total.TotalAllocs += stats.TotalAllocs
+		total.TotalFrees += stats.TotalFrees
+		total.PeakUsage += stats.PeakUsage
+		total.SlotSize = stats.SlotSize
+		total.TotalMemory += stats.TotalMemory
+	}
+	return total
+}
+
+// NodeStats returns the statistics of each pool by node ID.
+func (np *NodePools) NodeStats() map[int]PoolStats {
+	stats := make(map[int]PoolStats, len(np.nodes))
+	for _, node := range np.nodes {
+		stats[node] = np.pools[node].Stats()
+	}
+	return stats
+}
+
+// Close releases the memory of every pool.
+func (np *NodePools) Close() error {
+	var firstErr error
+	for _, node := range np.nodes {
+		if err := np.pools[node].Close(); err != nil && firstErr == nil {
+			firstErr = err
+		}
+	}
+	return firstErr
+}
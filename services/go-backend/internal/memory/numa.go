@@ -8,6 +8,7 @@ import (
 	"runtime"
 	"strconv"
 	"strings"
+	"sync"
 	"syscall"
 	"unsafe"
 
@@ -16,25 +17,87 @@ import (
 
 // NUMAInfo holds NUMA topology information.
 type NUMAInfo struct {
-	NodeCount    int
-	CurrentNode  int
-	CPUsPerNode  map[int][]int
-	MemoryMB     map[int]int64
-	Available    bool
+	NodeCount   int
+	CurrentNode int
+	CPUsPerNode map[int][]int
+	MemoryMB    map[int]int64
+	Available   bool
+
+	// Placement lists where the pages of live allocations actually are.
+	// Only GetNUMAInfoWithPlacement fills it in.
+	Placement []RegionPlacement
+}
+
+// HugepageSize selects the page size of hugepage allocations.
+type HugepageSize int
+
+const (
+	// Hugepage2M uses 2 MiB pages. It is the zero value and the default.
+	Hugepage2M HugepageSize = iota
+	// Hugepage1G uses 1 GiB pages, which must be reserved at boot.
+	Hugepage1G
+)
+
+// ParseHugepageSize parses "2M"/"2MB" or "1G"/"1GB" (case-insensitive),
+// defaulting to 2 MiB.
+func ParseHugepageSize(size string) HugepageSize {
+	switch strings.ToUpper(strings.TrimSpace(size)) {
+	case "1G", "1GB", "1GIB":
+		return Hugepage1G
+	default:
+		return Hugepage2M
+	}
+}
+
+// String returns the string representation of a HugepageSize.
+func (h HugepageSize) String() string {
+	if h == Hugepage1G {
+		return "1G"
+	}
+	return "2M"
+}
+
+// Bytes returns the page size in bytes.
+func (h HugepageSize) Bytes() int {
+	if h == Hugepage1G {
+		return 1 << 30
+	}
+	return 2 << 20
+}
+
+// mmapFlag returns the MAP_HUGE_* flag requesting this page size.
+func (h HugepageSize) mmapFlag() int {
+	if h == Hugepage1G {
+		return 30 << unix.MAP_HUGE_SHIFT
+	}
+	return 21 << unix.MAP_HUGE_SHIFT
 }
 
 // NUMAAllocator provides NUMA-aware memory allocation.
+//
+// Allocations are bound to the allocator's node with mbind(MPOL_BIND)
+// before their pages are faulted in, so placement does not depend on which
+// CPU first touches them.
 type NUMAAllocator struct {
 	nodeID       int
 	hugepages    bool
+	hugepageSize HugepageSize
 	initialized  bool
 }
 
-// NewNUMAAllocator creates a new NUMA-aware allocator.
+// NewNUMAAllocator creates a new NUMA-aware allocator. Hugepage
+// allocations use 2 MiB pages.
 func NewNUMAAllocator(nodeID int, useHugepages bool) (*NUMAAllocator, error) {
+	return NewHugepageAllocator(nodeID, useHugepages, Hugepage2M)
+}
+
+// NewHugepageAllocator creates a NUMA-aware allocator with an explicit
+// hugepage size.
+func NewHugepageAllocator(nodeID int, useHugepages bool, size HugepageSize) (*NUMAAllocator, error) {
 	allocator := &NUMAAllocator{
-		nodeID:    nodeID,
-		hugepages: useHugepages,
+		nodeID:       nodeID,
+		hugepages:    useHugepages,
+		hugepageSize: size,
 	}
 
 	// Verify NUMA is available
@@ -76,50 +139,99 @@ func (a *NUMAAllocator) BindToNode() error {
 }
 
 // AllocateAligned allocates page-aligned memory, optionally using hugepages.
+// The size is rounded up to a whole number of pages of the size used.
 func (a *NUMAAllocator) AllocateAligned(size int) ([]byte, error) {
 	pageSize := os.Getpagesize()
-
-	// Round up to page size
-	alignedSize := ((size + pageSize - 1) / pageSize) * pageSize
-
 	flags := syscall.MAP_PRIVATE | syscall.MAP_ANONYMOUS
 
+	var data []byte
 	if a.hugepages {
-		flags |= syscall.MAP_HUGETLB
-	}
-
-	// Use mmap for page-aligned allocation
-	data, err := unix.Mmap(-1, 0, alignedSize, syscall.PROT_READ|syscall.PROT_WRITE, flags)
-	if err != nil {
-		// Fallback to regular allocation if hugepages fail
-		if a.hugepages {
-			flags &^= syscall.MAP_HUGETLB
-			data, err = unix.Mmap(-1, 0, alignedSize, syscall.PROT_READ|syscall.PROT_WRITE, flags)
+		hugeSize := a.hugepageSize.Bytes()
+		huge, err := unix.Mmap(-1, 0, roundUp(size, hugeSize), syscall.PROT_READ|syscall.PROT_WRITE,
+			flags|syscall.MAP_HUGETLB|a.hugepageSize.mmapFlag())
+		// Fallback to regular allocation if no hugepages are reserved
+		if err == nil {
+			data, pageSize = huge, hugeSize
 		}
+	}
+	if data == nil {
+		var err error
+		data, err = unix.Mmap(-1, 0, roundUp(size, pageSize), syscall.PROT_READ|syscall.PROT_WRITE, flags)
 		if err != nil {
 			return nil, fmt.Errorf("mmap failed: %w", err)
 		}
 	}
 
+	// Bind before anything faults the pages in, mlock included. Non-fatal:
+	// seccomp profiles commonly block mbind, and placement then falls back
+	// to first touch, which VerifyPlacement reports.
+	bound := false
+	if a.initialized {
+		bound = mbindNode(data, a.nodeID) == nil
+	}
+
 	// Lock memory to prevent swapping (requires CAP_IPC_LOCK)
 	if err := unix.Mlock(data); err != nil {
 		// Non-fatal: memory will still work, just might be swapped
 		// Log warning in production
 	}
 
+	trackRegion(data, a.nodeID, pageSize, bound)
 	return data, nil
 }
 
+// roundUp rounds size up to a multiple of align.
+func roundUp(size, align int) int {
+	return (size + align - 1) / align * align
+}
+
 // Free releases memory allocated with AllocateAligned.
 func (a *NUMAAllocator) Free(data []byte) error {
 	if len(data) == 0 {
 		return nil
 	}
+	untrackRegion(data)
 	return unix.Munmap(data)
 }
 
+var (
+	numaOnce     sync.Once
+	numaTopology NUMAInfo
+)
+
 // GetNUMAInfo returns information about NUMA topology.
+//
+// The topology is read from sysfs once and cached; only CurrentNode is
+// determined per call. The returned maps are shared and must not be
+// modified.
 func GetNUMAInfo() NUMAInfo {
+	numaOnce.Do(func() {
+		numaTopology = readNUMAInfo()
+	})
+
+	info := numaTopology
+	if info.Available {
+		info.CurrentNode = getCurrentNUMANode()
+	}
+	return info
+}
+
+// GetNUMAInfoWithPlacement returns GetNUMAInfo with Placement filled in by
+// VerifyPlacement.
+func GetNUMAInfoWithPlacement() NUMAInfo {
+	info := GetNUMAInfo()
+	info.Placement = VerifyPlacement()
+	return info
+}
+
+// CurrentNUMANode returns the NUMA node of the CPU the calling thread runs
+// on, or 0 if NUMA is unavailable.
+func CurrentNUMANode() int {
+	return GetNUMAInfo().CurrentNode
+}
+
+// readNUMAInfo reads the NUMA topology from sysfs.
+func readNUMAInfo() NUMAInfo {
 	info := NUMAInfo{
 		CPUsPerNode: make(map[int][]int),
 		MemoryMB:    make(map[int]int64),
@@ -167,11 +279,6 @@ func GetNUMAInfo() NUMAInfo {
 
 	info.Available = info.NodeCount > 0
 
-	// Get current node (approximate based on current CPU)
-	if info.Available {
-		info.CurrentNode = getCurrentNUMANode(info)
-	}
-
 	return info
 }
 
@@ -233,23 +340,12 @@ func BindToNUMANode(nodeID int) error {
 }
 
 // getCurrentNUMANode determines which NUMA node the current thread is on.
-func getCurrentNUMANode(info NUMAInfo) int {
-	// Get current CPU using getcpu syscall
+// getcpu(2) reports the node directly, so no CPU-to-node search is needed.
+func getCurrentNUMANode() int {
 	var cpu, node uint32
-	// SYS_GETCPU syscall number for x86_64 is 309
-	_, _, err := syscall.Syscall(309, uintptr(unsafe.Pointer(&cpu)), uintptr(unsafe.Pointer(&node)), 0)
-	if err != 0 {
+	_, _, errno := unix.RawSyscall(unix.SYS_GETCPU, uintptr(unsafe.Pointer(&cpu)), uintptr(unsafe.Pointer(&node)), 0)
+	if errno != 0 {
 		return 0
 	}
-
-	// Find which node this CPU belongs to
-	for nodeID, cpus := range info.CPUsPerNode {
-		for _, c := range cpus {
-			if c == int(cpu) {
-				return nodeID
-			}
-		}
-	}
-
-	return 0
+	return int(node)
 }
@@ -0,0 +1,146 @@
+// Package memory provides NUMA memory policy and page-placement checks.
+package memory
+
+import (
+	"sort"
+	"sync"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+const (
+	// mpolBind is MPOL_BIND from linux/mempolicy.h.
+	mpolBind = 2
+	// mpolMFMove is MPOL_MF_MOVE: migrate pages already faulted in.
+	mpolMFMove = 1 << 1
+
+	// maxPlacementSamples bounds the pages move_pages inspects per region.
+	maxPlacementSamples = 1024
+)
+
+// mbindNode binds data to node with MPOL_BIND, so its pages can only be
+// allocated there.
+func mbindNode(data []byte, node int) error {
+	if node < 0 || len(data) == 0 {
+		return unix.EINVAL
+	}
+	mask := make([]uint64, node/64+1)
+	mask[node/64] = 1 << (node % 64)
+
+	// maxnode counts one more than the mask bits (see mbind(2) NOTES)
+	_, _, errno := unix.Syscall6(unix.SYS_MBIND,
+		uintptr(unsafe.Pointer(&data[0])), uintptr(len(data)), mpolBind,
+		uintptr(unsafe.Pointer(&mask[0])), uintptr(len(mask)*64+1), mpolMFMove)
+	if errno != 0 {
+		return errno
+	}
+	return nil
+}
+
+// RegionPlacement reports where the pages of one allocation landed.
+type RegionPlacement struct {
+	Node        int         // Requested node
+	Bytes       int         // Size of the region
+	PageSize    int         // Page size backing the region
+	Bound       bool        // mbind(MPOL_BIND) succeeded
+	Sampled     int         // Pages inspected with move_pages
+	NotPresent  int         // Sampled pages not yet faulted in
+	PagesByNode map[int]int // Sampled pages per node they reside on
+	LocalRatio  float64     // Fraction of present sampled pages on Node
+}
+
+// region is a live allocation registered by AllocateAligned.
+type region struct {
+	data     []byte
+	node     int
+	pageSize int
+	bound    bool
+}
+
+var (
+	regionsMu sync.Mutex
+	regions   = make(map[uintptr]region)
+)
+
+// trackRegion registers an allocation for VerifyPlacement.
+func trackRegion(data []byte, node, pageSize int, bound bool) {
+	regionsMu.Lock()
+	regions[uintptr(unsafe.Pointer(&data[0]))] = region{data: data, node: node, pageSize: pageSize, bound: bound}
+	regionsMu.Unlock()
+}
+
+// untrackRegion removes an allocation before it is unmapped.
+func untrackRegion(data []byte) {
+	regionsMu.Lock()
+	delete(regions, uintptr(unsafe.Pointer(&data[0])))
+	regionsMu.Unlock()
+}
+
+// VerifyPlacement queries move_pages(2) for the node of a sample of pages of
+// every live allocation made by a NUMAAllocator, largest first. At most
+// maxPlacementSamples pages, spread evenly, are inspected per region.
+func VerifyPlacement() []RegionPlacement {
+	regionsMu.Lock()
+	defer regionsMu.Unlock() // Keeps regions mapped while they are inspected
+
+	placements := make([]RegionPlacement, 0, len(regions))
+	for _, r := range regions {
+		placements = append(placements, r.verify())
+	}
+	sort.Slice(placements, func(i, j int) bool {
+		return placements[i].Bytes > placements[j].Bytes
+	})
+	return placements
+}
+
+// verify samples the region's pages with move_pages.
+func (r region) verify() RegionPlacement {
+	p := RegionPlacement{
+		Node:        r.node,
+		Bytes:       len(r.data),
+		PageSize:    r.pageSize,
+		Bound:       r.bound,
+		PagesByNode: make(map[int]int),
+	}
+
+	pages := len(r.data) / r.pageSize
+	stride := 1
+	if pages > maxPlacementSamples {
+		stride = (pages + maxPlacementSamples - 1) / maxPlacementSamples
+	}
+
+	addrs := make([]uintptr, 0, pages/stride+1)
+	base := uintptr(unsafe.Pointer(&r.data[0]))
+	for i := 0; i < pages; i += stride {
+		addrs = append(addrs, base+uintptr(i*r.pageSize))
+	}
+	if len(addrs) == 0 {
+		return p
+	}
+	status := make([]int32, len(addrs))
+
+	// With a nil node list move_pages only reports each page's node
+	_, _, errno := unix.Syscall6(unix.SYS_MOVE_PAGES, 0, uintptr(len(addrs)),
+		uintptr(unsafe.Pointer(&addrs[0])), 0, uintptr(unsafe.Pointer(&status[0])), 0)
+	if errno != 0 {
+		return p
+	}
+
+	p.Sampled = len(addrs)
+	local := 0
+	for _, st := range status {
+		if st < 0 {
+			p.NotPresent++ // -ENOENT and friends
+			continue
+		}
+		p.PagesByNode[int(st)]++
+		if int(st) == r.node {
+			local++
+		}
+	}
+	if present := p.Sampled - p.NotPresent; present > 0 {
+		p.LocalRatio = float64(local) / float64(present)
+	}
+	return p
+}
@@ -17,21 +17,28 @@ var (
 )
 
 // MemoryPool provides pre-allocated memory slots for zero-copy operations.
+//
+// Free slots are kept on a lock-free stack. Datapath workers should go
+// through a PoolCache (see NewCache), which batches stack operations and
+// keeps statistics per worker; Acquire and Release on the pool itself hit
+// the shared stack and counters on every call and suit low-rate callers.
 type MemoryPool struct {
 	allocator *NUMAAllocator
 	data      []byte        // Contiguous memory region
 	slotSize  int           // Size of each slot
 	numSlots  int           // Total number of slots
-	freeList  chan int      // Channel of free slot indices
+	cacheSize int           // Magazine size of per-worker caches
+	scrub     ScrubPolicy   // How slot data is cleared on release
+	free      *slotStack    // Lock-free stack of free slot indices
 	inUse     []atomic.Bool // Track which slots are in use
 
-	// Statistics
-	totalAllocs   atomic.Uint64
-	totalFrees    atomic.Uint64
-	peakUsage     atomic.Int32
-	currentUsage  atomic.Int32
+	// Statistics for uncached Acquire/Release; caches keep their own
+	totalAllocs atomic.Uint64
+	totalFrees  atomic.Uint64
+	peakUsage   atomic.Int32
 
-	mu sync.RWMutex
+	caches []*PoolCache // Registered per-worker caches, guarded by mu
+	mu     sync.RWMutex
 }
 
 // PoolConfig holds configuration for memory pool.
@@ -40,9 +47,54 @@ type PoolConfig struct {
 	SlotSize     int
 	NUMANodeID   int
 	UseHugepages bool
+	HugepageSize HugepageSize // Page size when UseHugepages is set
 	Preallocate  bool
+	CacheSize    int         // Slots per worker magazine (0 uses the default)
+	Scrub        ScrubPolicy // How slot data is cleared on release
 }
 
+// ScrubPolicy controls how a slot's contents are cleared when it is released.
+type ScrubPolicy int
+
+const (
+	// ScrubFull zeroes the whole slot. It is the zero value so pools keep
+	// clearing data unless configured otherwise.
+	ScrubFull ScrubPolicy = iota
+	// ScrubWritten zeroes only the bytes written to the slot, as reported to
+	// ReleaseWritten (e.g. from Buffer.Length), and the whole slot when the
+	// written length is unknown.
+	ScrubWritten
+	// ScrubNone leaves slot contents as they are.
+	ScrubNone
+)
+
+// ParseScrubPolicy parses a string policy to ScrubPolicy.
+func ParseScrubPolicy(policy string) ScrubPolicy {
+	switch policy {
+	case "none", "off":
+		return ScrubNone
+	case "written", "headroom":
+		return ScrubWritten
+	default:
+		return ScrubFull
+	}
+}
+
+// String returns the string representation of a ScrubPolicy.
+func (s ScrubPolicy) String() string {
+	switch s {
+	case ScrubNone:
+		return "none"
+	case ScrubWritten:
+		return "written"
+	default:
+		return "full"
+	}
+}
+
+// DefaultCacheSize is the default number of slots per worker magazine.
+const DefaultCacheSize = 64
+
 // DefaultPoolConfig returns sensible defaults for a memory pool.
 func DefaultPoolConfig() PoolConfig {
 	return PoolConfig{
@@ -51,12 +103,14 @@ func DefaultPoolConfig() PoolConfig {
 		NUMANodeID:   0,
 		UseHugepages: false,
 		Preallocate:  true,
+		CacheSize:    DefaultCacheSize,
+		Scrub:        ScrubFull,
 	}
 }
 
 // NewMemoryPool creates a new pre-allocated memory pool.
 func NewMemoryPool(config PoolConfig) (*MemoryPool, error) {
-	allocator, err := NewNUMAAllocator(config.NUMANodeID, config.UseHugepages)
+	allocator, err := NewHugepageAllocator(config.NUMANodeID, config.UseHugepages, config.HugepageSize)
 	if err != nil {
 		return nil, err
 	}
@@ -77,58 +131,51 @@ func NewMemoryPool(config PoolConfig) (*MemoryPool, error) {
 		}
 	}
 
+	cacheSize := config.CacheSize
+	if cacheSize <= 0 {
+		cacheSize = DefaultCacheSize
+	}
+	if cacheSize < 2 {
+		cacheSize = 2 // Refill and spill move half a magazine
+	}
+
 	pool := &MemoryPool{
 		allocator: allocator,
 		data:      data,
 		slotSize:  config.SlotSize,
 		numSlots:  config.NumSlots,
-		freeList:  make(chan int, config.NumSlots),
+		cacheSize: cacheSize,
+		scrub:     config.Scrub,
+		free:      newSlotStack(config.NumSlots),
 		inUse:     make([]atomic.Bool, config.NumSlots),
 	}
 
-	// Initialize free list with all slot indices
-	for i := 0; i < config.NumSlots; i++ {
-		pool.freeList <- i
-	}
-
 	return pool, nil
 }
 
 // Acquire gets a free memory slot from the pool.
 // Returns the slot index and a byte slice for the slot.
 func (p *MemoryPool) Acquire() (int, []byte, error) {
-	select {
-	case idx := <-p.freeList:
-		// Mark slot as in use
-		if !p.inUse[idx].CompareAndSwap(false, true) {
-			// Slot was already in use (shouldn't happen)
-			return 0, nil, ErrInvalidSlot
-		}
-
-		// Update statistics
-		p.totalAllocs.Add(1)
-		current := p.currentUsage.Add(1)
-
-		// Update peak usage
-		for {
-			peak := p.peakUsage.Load()
-			if current <= peak || p.peakUsage.CompareAndSwap(peak, current) {
-				break
-			}
-		}
-
-		// Return slice pointing to slot in contiguous memory
-		start := idx * p.slotSize
-		end := start + p.slotSize
-		return idx, p.data[start:end], nil
-
-	default:
+	slot, ok := p.free.pop()
+	if !ok {
 		return 0, nil, ErrPoolExhausted
 	}
+
+	idx := int(slot)
+	p.inUse[idx].Store(true)
+	p.totalAllocs.Add(1)
+
+	return idx, p.slot(idx), nil
 }
 
 // Release returns a slot to the pool.
 func (p *MemoryPool) Release(idx int) error {
+	return p.ReleaseWritten(idx, -1)
+}
+
+// ReleaseWritten returns a slot to the pool, telling the ScrubWritten policy
+// that only the first written bytes were used. A negative length means unknown.
+func (p *MemoryPool) ReleaseWritten(idx, written int) error {
 	if idx < 0 || idx >= p.numSlots {
 		return ErrInvalidSlot
 	}
@@ -138,23 +185,39 @@ func (p *MemoryPool) Release(idx int) error {
 		return ErrSlotNotInUse
 	}
 
-	// Clear slot data (optional, for security)
-	start := idx * p.slotSize
-	end := start + p.slotSize
-	for i := start; i < end; i++ {
-		p.data[i] = 0
-	}
+	p.scrubSlot(idx, written)
 
 	// Return to free list
-	p.freeList <- idx
-
-	// Update statistics
+	p.free.push(int32(idx))
 	p.totalFrees.Add(1)
-	p.currentUsage.Add(-1)
 
 	return nil
 }
 
+// slot returns the byte slice for a slot in contiguous memory.
+func (p *MemoryPool) slot(idx int) []byte {
+	start := idx * p.slotSize
+	end := start + p.slotSize
+	return p.data[start:end:end]
+}
+
+// scrubSlot clears slot data before it is reused (for security).
+// clear compiles to the runtime's vectorized memclr rather than a byte loop.
+func (p *MemoryPool) scrubSlot(idx, written int) {
+	n := p.slotSize
+	switch p.scrub {
+	case ScrubNone:
+		return
+	case ScrubWritten:
+		if written >= 0 && written < n {
+			n = written
+		}
+	}
+
+	start := idx * p.slotSize
+	clear(p.data[start : start+n])
+}
+
 // GetSlot returns a byte slice for a slot without acquiring it.
 // Used for reading data from a slot that's already acquired.
 func (p *MemoryPool) GetSlot(idx int) ([]byte, error) {
@@ -166,32 +229,82 @@ func (p *MemoryPool) GetSlot(idx int) ([]byte, error) {
 		return nil, ErrSlotNotInUse
 	}
 
-	start := idx * p.slotSize
-	end := start + p.slotSize
-	return p.data[start:end], nil
+	return p.slot(idx), nil
+}
+
+// Region returns the pool's contiguous memory, slot i starting at byte
+// i*SlotSize. It is nil if the pool was not preallocated. The region is
+// page aligned, so it can be registered with the kernel as an AF_XDP UMEM.
+func (p *MemoryPool) Region() []byte {
+	return p.data
+}
+
+// SlotSize returns the size of each slot in bytes.
+func (p *MemoryPool) SlotSize() int {
+	return p.slotSize
+}
+
+// NumSlots returns the number of slots in the pool.
+func (p *MemoryPool) NumSlots() int {
+	return p.numSlots
+}
+
+// SlotAddr returns the offset of slot idx within Region.
+func (p *MemoryPool) SlotAddr(idx int) uint64 {
+	return uint64(idx) * uint64(p.slotSize)
+}
+
+// SlotAt splits an offset within Region into its slot index and the offset
+// within that slot.
+func (p *MemoryPool) SlotAt(addr uint64) (int, int) {
+	size := uint64(p.slotSize)
+	return int(addr / size), int(addr % size)
 }
 
 // Stats returns current pool statistics.
 type PoolStats struct {
-	TotalSlots   int
-	FreeSlots    int
-	UsedSlots    int
-	TotalAllocs  uint64
-	TotalFrees   uint64
-	PeakUsage    int32
-	SlotSize     int
-	TotalMemory  int
+	TotalSlots  int
+	FreeSlots   int
+	UsedSlots   int
+	TotalAllocs uint64
+	TotalFrees  uint64
+	PeakUsage   int32
+	SlotSize    int
+	TotalMemory int
 }
 
 // Stats returns current pool statistics.
+// Per-worker cache counters are summed here rather than on the hot path.
+// PeakUsage is the highest usage observed by Stats calls.
 func (p *MemoryPool) Stats() PoolStats {
-	freeCount := len(p.freeList)
+	allocs := p.totalAllocs.Load()
+	frees := p.totalFrees.Load()
+
+	p.mu.RLock()
+	for _, c := range p.caches {
+		// Read frees first so a concurrent release never makes used negative
+		frees += c.frees.Load()
+		allocs += c.allocs.Load()
+	}
+	p.mu.RUnlock()
+
+	used := int32(0)
+	if allocs > frees {
+		used = int32(allocs - frees)
+	}
+	for {
+		peak := p.peakUsage.Load()
+		if used <= peak || p.peakUsage.CompareAndSwap(peak, used) {
+			break
+		}
+	}
+
 	return PoolStats{
 		TotalSlots:  p.numSlots,
-		FreeSlots:   freeCount,
-		UsedSlots:   p.numSlots - freeCount,
-		TotalAllocs: p.totalAllocs.Load(),
-		TotalFrees:  p.totalFrees.Load(),
+		FreeSlots:   p.numSlots - int(used),
+		UsedSlots:   int(used),
+		TotalAllocs: allocs,
+		TotalFrees:  frees,
 		PeakUsage:   p.peakUsage.Load(),
 		SlotSize:    p.slotSize,
 		TotalMemory: p.numSlots * p.slotSize,
@@ -210,6 +323,5 @@ func (p *MemoryPool) Close() error {
 		p.data = nil
 	}
 
-	close(p.freeList)
 	return nil
 }
@@ -0,0 +1,288 @@
+package memory
+
+import (
+	"bytes"
+	"errors"
+	"fmt"
+	"runtime"
+	"sync"
+	"testing"
+)
+
+func newTestPool(t *testing.T, slots, cacheSize int) *MemoryPool {
+	t.Helper()
+	config := DefaultPoolConfig()
+	config.NumSlots = slots
+	config.SlotSize = 256
+	config.CacheSize = cacheSize
+	pool, err := NewMemoryPool(config)
+	if err != nil {
+		t.Fatal(err)
+	}
+	t.Cleanup(func() { pool.Close() })
+	return pool
+}
+
+// TestCacheDoubleRelease checks that a slot is cached once however often,
+// and by however many goroutines, it is released.
+func TestCacheDoubleRelease(t *testing.T) {
+	pool := newTestPool(t, 64, 8)
+	c := pool.NewCache()
+
+	idx, _, err := c.Acquire()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := c.Release(idx); err != nil {
+		t.Fatal(err)
+	}
+	if err := c.Release(idx); !errors.Is(err, ErrSlotNotInUse) {
+		t.Fatalf("expected ErrSlotNotInUse, got %v", err)
+	}
+	if err := c.Release(64); !errors.Is(err, ErrInvalidSlot) {
+		t.Errorf("expected ErrInvalidSlot, got %v", err)
+	}
+
+	// Racing releases through separate caches: exactly one wins
+	idx, _, _ = c.Acquire()
+	var wg sync.WaitGroup
+	errs := make([]error, 8)
+	for i := range errs {
+		wg.Add(1)
+		go func(i int, rc *PoolCache) {
+			defer wg.Done()
+			errs[i] = rc.Release(idx)
+			rc.Flush()
+		}(i, pool.NewCache())
+	}
+	wg.Wait()
+	ok := 0
+	for _, err := range errs {
+		if err == nil {
+			ok++
+		} else if !errors.Is(err, ErrSlotNotInUse) {
+			t.Errorf("unexpected error %v", err)
+		}
+	}
+	if ok != 1 {
+		t.Fatalf("expected 1 successful release, got %d", ok)
+	}
+
+	c.Flush()
+	seen := make(map[int]bool)
+	for i := 0; i < 64; i++ {
+		idx, _, err := c.Acquire()
+		if err != nil {
+			t.Fatalf("acquire %d: %v", i, err)
+		}
+		if seen[idx] {
+			t.Fatalf("slot %d handed out twice", idx)
+		}
+		seen[idx] = true
+	}
+}
+
+// TestCacheCrossRelease checks that a slot may be released through any
+// cache of its pool, and through no other pool.
+func TestCacheCrossRelease(t *testing.T) {
+	pool := newTestPool(t, 64, 8)
+	a, b := pool.NewCache(), pool.NewCache()
+	other := newTestPool(t, 64, 8).NewCache()
+
+	idx, _, err := a.Acquire()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := other.Release(idx); !errors.Is(err, ErrSlotNotInUse) {
+		t.Fatalf("expected another pool to refuse the slot, got %v", err)
+	}
+	if err := b.Release(idx); err != nil {
+		t.Fatalf("expected another cache to release the slot, got %v", err)
+	}
+	if err := a.Release(idx); !errors.Is(err, ErrSlotNotInUse) {
+		t.Errorf("expected ErrSlotNotInUse, got %v", err)
+	}
+	if err := pool.Release(idx); !errors.Is(err, ErrSlotNotInUse) {
+		t.Errorf("expected the pool to refuse a cached slot, got %v", err)
+	}
+
+	// The slot comes back from the cache that holds it
+	if got, _, _ := b.Acquire(); got != idx {
+		t.Errorf("expected slot %d from b, got %d", idx, got)
+	}
+	if s := pool.Stats(); s.UsedSlots != 1 || s.TotalAllocs != 2 || s.TotalFrees != 1 {
+		t.Errorf("unexpected stats %+v", s)
+	}
+}
+
+// TestCacheRefill checks that a cache refills from and spills to the
+// shared free list half a magazine at a time, and that every slot of the
+// pool can be acquired through caches.
+func TestCacheRefill(t *testing.T) {
+	pool := newTestPool(t, 32, 8)
+	a, b := pool.NewCache(), pool.NewCache()
+
+	var held []int
+	for {
+		idx, _, err := a.Acquire()
+		if errors.Is(err, ErrPoolExhausted) {
+			break
+		}
+		if err != nil {
+			t.Fatal(err)
+		}
+		held = append(held, idx)
+	}
+	if len(held) != 32 || a.n != 0 {
+		t.Fatalf("expected all 32 slots through refills, got %d with %d cached", len(held), a.n)
+	}
+	if _, _, err := b.Acquire(); !errors.Is(err, ErrPoolExhausted) {
+		t.Fatalf("expected ErrPoolExhausted, got %v", err)
+	}
+
+	// Releasing more than a magazine spills half of it
+	for _, idx := range held[:9] {
+		if err := a.Release(idx); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if a.n != 5 {
+		t.Errorf("expected 5 cached after a spill, got %d", a.n)
+	}
+	for i := 0; i < 4; i++ {
+		if _, _, err := b.Acquire(); err != nil {
+			t.Fatalf("expected b to refill from the spilled slots: %v", err)
+		}
+	}
+	if _, _, err := b.Acquire(); !errors.Is(err, ErrPoolExhausted) {
+		t.Errorf("expected the spilled slots used up, got %v", err)
+	}
+	if s := pool.Stats(); s.UsedSlots != 27 {
+		t.Errorf("expected 27 used slots, got %d", s.UsedSlots)
+	}
+}
+
+// TestBufferScrubsWritten checks that ScrubWritten clears every byte a
+// buffer wrote, including data it later cut off, and no more.
+func TestBufferScrubsWritten(t *testing.T) {
+	config := DefaultPoolConfig()
+	config.NumSlots = 1
+	config.SlotSize = 256
+	config.Scrub = ScrubWritten
+	pool, err := NewMemoryPool(config)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer pool.Close()
+	bp := NewBufferPool(pool)
+
+	buf, err := bp.GetWithHeadroom(16)
+	if err != nil {
+		t.Fatal(err)
+	}
+	slot := buf.data
+	slot[255] = 0xEE // Past anything written, stays
+	buf.Write(bytes.Repeat([]byte{0xAA}, 100))
+	buf.SetLength(10)
+	buf.Reset()
+	if err := bp.Put(buf); err != nil {
+		t.Fatal(err)
+	}
+	if i := bytes.IndexByte(slot, 0xAA); i >= 0 {
+		t.Errorf("expected the written bytes scrubbed, found one at %d", i)
+	}
+	if slot[255] != 0xEE {
+		t.Error("expected bytes past the high-water mark left alone")
+	}
+
+	// RawData may have been written anywhere
+	buf, _ = bp.Get()
+	buf.RawData()[200] = 0xBB
+	bp.Put(buf)
+	if slot[200] != 0 || slot[255] != 0 {
+		t.Error("expected the whole slot scrubbed after RawData")
+	}
+}
+
+// newBenchPool creates a pool with room for every goroutine's magazine.
+// Slots are small: the benchmarks never touch slot data.
+func newBenchPool(b *testing.B, goroutines int) *MemoryPool {
+	b.Helper()
+	config := DefaultPoolConfig()
+	config.NumSlots = max(4096, 2*goroutines*DefaultCacheSize)
+	config.SlotSize = 256
+	config.Scrub = ScrubNone
+	pool, err := NewMemoryPool(config)
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.Cleanup(func() { pool.Close() })
+	return pool
+}
+
+// BenchmarkPoolAcquireRelease measures an Acquire/Release pair on the
+// shared free list and through per-goroutine caches, with 1 to 16
+// goroutines per GOMAXPROCS contending.
+func BenchmarkPoolAcquireRelease(b *testing.B) {
+	for _, par := range []int{1, 4, 16} {
+		goroutines := par * runtime.GOMAXPROCS(0)
+
+		b.Run(fmt.Sprintf("Pool/goroutines=%d", goroutines), func(b *testing.B) {
+			pool := newBenchPool(b, goroutines)
+			b.SetParallelism(par)
+			b.ReportAllocs()
+			b.RunParallel(func(pb *testing.PB) {
+				for pb.Next() {
+					idx, _, err := pool.Acquire()
+					if err != nil {
+						b.Error(err)
+						return
+					}
+					pool.Release(idx)
+				}
+			})
+		})
+
+		b.Run(fmt.Sprintf("Cache/goroutines=%d", goroutines), func(b *testing.B) {
+			pool := newBenchPool(b, goroutines)
+			b.SetParallelism(par)
+			b.ReportAllocs()
+			b.RunParallel(func(pb *testing.PB) {
+				cache := pool.NewCache()
+				defer cache.Flush()
+				for pb.Next() {
+					idx, _, err := cache.Acquire()
+					if err != nil {
+						b.Error(err)
+						return
+					}
+					cache.Release(idx)
+				}
+			})
+		})
+	}
+}
+
+// BenchmarkCacheBurst measures a cache moving a full batch of slots at a
+// time, as a datapath worker does, so every iteration crosses the magazine
+// and touches the shared free list.
+func BenchmarkCacheBurst(b *testing.B) {
+	pool := newBenchPool(b, 1)
+	cache := pool.NewCache()
+	defer cache.Flush()
+	idx := make([]int, 2*DefaultCacheSize)
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		for j := range idx {
+			var err error
+			if idx[j], _, err = cache.Acquire(); err != nil {
+				b.Fatal(err)
+			}
+		}
+		for _, j := range idx {
+			cache.Release(j)
+		}
+	}
+	b.ReportMetric(float64(b.Elapsed().Nanoseconds())/float64(b.N*len(idx)), "ns/slot")
+}
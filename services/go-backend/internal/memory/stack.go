@@ -0,0 +1,95 @@
+// Package memory provides a lock-free free list for memory pool slots.
+package memory
+
+import "sync/atomic"
+
+// slotStack is a lock-free LIFO of slot indices (a Treiber stack).
+//
+// Links live in a flat array indexed by slot, so pushing and popping never
+// allocate. The head packs a generation tag in its upper 32 bits and the
+// top slot (index+1, 0 meaning empty) in its lower 32 bits. Every
+// successful CAS bumps the tag, so a pop that read a stale head fails even
+// if the same slot was popped and pushed back in the meantime (ABA).
+//
+// Chains of slots are pushed and popped with a single CAS, which lets
+// per-worker caches refill and spill in bulk.
+type slotStack struct {
+	head atomic.Uint64
+	next []atomic.Uint32 // next[i] holds the index+1 of the slot below i
+}
+
+// newSlotStack creates a stack for n slots holding every slot index.
+func newSlotStack(n int) *slotStack {
+	s := &slotStack{
+		next: make([]atomic.Uint32, n),
+	}
+
+	// Link 0 -> 1 -> ... -> n-1 so the lowest slots are handed out first
+	for i := 0; i < n-1; i++ {
+		s.next[i].Store(uint32(i + 2))
+	}
+	if n > 0 {
+		s.head.Store(1)
+	}
+
+	return s
+}
+
+// link records that slot below follows slot idx in a chain being built by
+// the caller, who must own both slots.
+func (s *slotStack) link(idx, below int32) {
+	s.next[idx].Store(uint32(below + 1))
+}
+
+// pushChain pushes a chain of owned slots, first..last, linked with link.
+func (s *slotStack) pushChain(first, last int32) {
+	for {
+		old := s.head.Load()
+		s.next[last].Store(uint32(old))
+		tag := uint32(old>>32) + 1
+		if s.head.CompareAndSwap(old, uint64(tag)<<32|uint64(first+1)) {
+			return
+		}
+	}
+}
+
+// push pushes a single owned slot.
+func (s *slotStack) push(idx int32) {
+	s.pushChain(idx, idx)
+}
+
+// popN pops up to len(out) slots into out. Returns the number popped.
+func (s *slotStack) popN(out []int32) int {
+	for {
+		old := s.head.Load()
+		top := uint32(old)
+		if top == 0 {
+			return 0
+		}
+
+		// Walk the chain from the observed head. The links may change under
+		// us if another thread wins the race, but then the tag differs and
+		// the CAS below fails, discarding whatever was read.
+		cur := top
+		n := 0
+		for n < len(out) && cur != 0 {
+			out[n] = int32(cur - 1)
+			n++
+			cur = s.next[cur-1].Load()
+		}
+
+		tag := uint32(old>>32) + 1
+		if s.head.CompareAndSwap(old, uint64(tag)<<32|uint64(cur)) {
+			return n
+		}
+	}
+}
+
+// pop pops a single slot. Returns false if the stack is empty.
+func (s *slotStack) pop() (int32, bool) {
+	var out [1]int32
+	if s.popN(out[:]) == 0 {
+		return 0, false
+	}
+	return out[0], true
+}
@@ -0,0 +1,167 @@
+// Package metrics provides the scrape-time collector for datapath counters.
+package metrics
+
+import (
+	"strconv"
+
+	"github.com/prometheus/client_golang/prometheus"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// latencyQuantiles are exported for each stage latency summary.
+var latencyQuantiles = []float64{0.5, 0.9, 0.99, 0.999}
+
+// DatapathCollector exports AF_XDP and XDP counters. Nothing is recorded on
+// the packet path: each worker keeps its own counters, and Collect reads
+// them, the sockets' XDP_STATISTICS, the filter program's per-CPU
+// action_stats map and the interface counters when Prometheus scrapes.
+type DatapathCollector struct {
+	engine *xdp.Engine     // May be nil
+	prog   *xdp.XDPProgram // May be nil
+	iface  string
+
+	rxPackets       *prometheus.Desc
+	rxBytes         *prometheus.Desc
+	txPackets       *prometheus.Desc
+	txBytes         *prometheus.Desc
+	dropped         *prometheus.Desc
+	passed          *prometheus.Desc
+	pollErrors      *prometheus.Desc
+	stagePackets    *prometheus.Desc
+	stageDrops      *prometheus.Desc
+	stageSeconds    *prometheus.Desc
+	stageLatency    *prometheus.Desc
+	sockRxDropped   *prometheus.Desc
+	sockRxInvalid   *prometheus.Desc
+	sockTxInvalid   *prometheus.Desc
+	sockRxRingFull  *prometheus.Desc
+	sockFillEmpty   *prometheus.Desc
+	sockTxRingEmpty *prometheus.Desc
+	actionPackets   *prometheus.Desc
+	actionBytes     *prometheus.Desc
+	ifPackets       *prometheus.Desc
+	ifBytes         *prometheus.Desc
+	ifDrops         *prometheus.Desc
+	ifErrors        *prometheus.Desc
+}
+
+// NewDatapathCollector creates a collector for an engine, its filter
+// program and their interface. Register it with prometheus.MustRegister.
+func NewDatapathCollector(namespace, iface string, engine *xdp.Engine, prog *xdp.XDPProgram) *DatapathCollector {
+	if namespace == "" {
+		namespace = "go_backend"
+	}
+	desc := func(name, help string, labels ...string) *prometheus.Desc {
+		return prometheus.NewDesc(prometheus.BuildFQName(namespace, "xdp", name), help, labels,
+			prometheus.Labels{"interface": iface})
+	}
+
+	return &DatapathCollector{
+		engine: engine,
+		prog:   prog,
+		iface:  iface,
+
+		rxPackets:       desc("packets_received_total", "Packets received by the AF_XDP workers", "queue"),
+		rxBytes:         desc("bytes_received_total", "Bytes received by the AF_XDP workers", "queue"),
+		txPackets:       desc("packets_sent_total", "Packets transmitted by the AF_XDP workers", "queue"),
+		txBytes:         desc("bytes_sent_total", "Bytes transmitted by the AF_XDP workers", "queue"),
+		dropped:         desc("packets_dropped_total", "Frames the pipeline dropped or the TX ring had no room for", "queue"),
+		passed:          desc("packets_passed_total", "Frames the pipeline passed or redirected, which AF_XDP cannot deliver", "queue"),
+		pollErrors:      desc("poll_errors_total", "Failed polls of the AF_XDP sockets", "queue"),
+		stagePackets:    desc("stage_packets_total", "Packets seen by a pipeline stage", "queue", "stage"),
+		stageDrops:      desc("stage_drops_total", "Packets dropped by a pipeline stage", "queue", "stage"),
+		stageSeconds:    desc("stage_seconds_total", "Time spent in a pipeline stage", "queue", "stage"),
+		stageLatency:    desc("stage_latency_seconds", "Sampled per-packet latency of a pipeline stage across all queues", "stage"),
+		sockRxDropped:   desc("socket_rx_dropped_total", "Packets the kernel dropped before the RX ring", "queue"),
+		sockRxInvalid:   desc("socket_rx_invalid_descs_total", "Packets dropped due to invalid fill ring descriptors", "queue"),
+		sockTxInvalid:   desc("socket_tx_invalid_descs_total", "Invalid descriptors on the TX ring", "queue"),
+		sockRxRingFull:  desc("socket_rx_ring_full_total", "Packets dropped because the RX ring was full", "queue"),
+		sockFillEmpty:   desc("socket_fill_ring_empty_total", "Receives that found the fill ring empty", "queue"),
+		sockTxRingEmpty: desc("socket_tx_ring_empty_total", "TX wakeups that found the TX ring empty", "queue"),
+		actionPackets:   desc("program_action_packets_total", "Packets by XDP filter program verdict", "action"),
+		actionBytes:     desc("program_action_bytes_total", "Bytes by XDP filter program verdict", "action"),
+		ifPackets:       desc("interface_packets_total", "Interface packet counters", "direction"),
+		ifBytes:         desc("interface_bytes_total", "Interface byte counters", "direction"),
+		ifDrops:         desc("interface_rx_dropped_total", "Packets dropped by the interface on receive"),
+		ifErrors:        desc("interface_rx_errors_total", "Receive errors reported by the interface"),
+	}
+}
+
+// Describe implements prometheus.Collector.
+func (c *DatapathCollector) Describe(ch chan<- *prometheus.Desc) {
+	for _, d := range []*prometheus.Desc{
+		c.rxPackets, c.rxBytes, c.txPackets, c.txBytes, c.dropped, c.passed, c.pollErrors,
+		c.stagePackets, c.stageDrops, c.stageSeconds, c.stageLatency,
+		c.sockRxDropped, c.sockRxInvalid, c.sockTxInvalid, c.sockRxRingFull, c.sockFillEmpty, c.sockTxRingEmpty,
+		c.actionPackets, c.actionBytes,
+		c.ifPackets, c.ifBytes, c.ifDrops, c.ifErrors,
+	} {
+		ch <- d
+	}
+}
+
+// Collect implements prometheus.Collector.
+func (c *DatapathCollector) Collect(ch chan<- prometheus.Metric) {
+	counter := func(d *prometheus.Desc, v uint64, labels ...string) {
+		ch <- prometheus.MustNewConstMetric(d, prometheus.CounterValue, float64(v), labels...)
+	}
+
+	if c.engine != nil {
+		for _, w := range c.engine.Workers() {
+			s := w.Stats()
+			q := strconv.Itoa(s.QueueID)
+			counter(c.rxPackets, s.RxPackets, q)
+			counter(c.rxBytes, s.RxBytes, q)
+			counter(c.txPackets, s.TxPackets, q)
+			counter(c.txBytes, s.TxBytes, q)
+			counter(c.dropped, s.Dropped, q)
+			counter(c.passed, s.Passed, q)
+			counter(c.pollErrors, s.PollErrors, q)
+			for _, st := range s.Stages {
+				counter(c.stagePackets, st.Packets, q, st.Name)
+				counter(c.stageDrops, st.Drops, q, st.Name)
+				ch <- prometheus.MustNewConstMetric(c.stageSeconds, prometheus.CounterValue,
+					float64(st.Nanoseconds)/1e9, q, st.Name)
+			}
+
+			sock, err := w.Socket().Stats()
+			if err != nil {
+				continue // Closed during shutdown
+			}
+			counter(c.sockRxDropped, sock.RxDropped, q)
+			counter(c.sockRxInvalid, sock.RxInvalid, q)
+			counter(c.sockTxInvalid, sock.TxInvalid, q)
+			counter(c.sockRxRingFull, sock.RxRingFull, q)
+			counter(c.sockFillEmpty, sock.FillRingEmpty, q)
+			counter(c.sockTxRingEmpty, sock.TxRingEmpty, q)
+		}
+
+		for _, st := range c.engine.Latency() {
+			quantiles := make(map[float64]float64, len(latencyQuantiles))
+			for _, q := range latencyQuantiles {
+				quantiles[q] = float64(st.Quantile(q)) / 1e9
+			}
+			ch <- prometheus.MustNewConstSummary(c.stageLatency, st.Count, float64(st.Sum)/1e9, quantiles, st.Name)
+		}
+	}
+
+	if c.prog != nil {
+		if actions, err := c.prog.ActionStats(); err == nil {
+			for action, s := range actions {
+				name := xdp.XDPAction(action).String()
+				counter(c.actionPackets, s.Packets, name)
+				counter(c.actionBytes, s.Bytes, name)
+			}
+		}
+	}
+
+	if stats, err := xdp.GetInterfaceStats(c.iface); err == nil {
+		counter(c.ifPackets, stats.RxPackets, "rx")
+		counter(c.ifPackets, stats.TxPackets, "tx")
+		counter(c.ifBytes, stats.RxBytes, "rx")
+		counter(c.ifBytes, stats.TxBytes, "tx")
+		counter(c.ifDrops, stats.Drops)
+		counter(c.ifErrors, stats.Errors)
+	}
+}
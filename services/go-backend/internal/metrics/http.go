@@ -0,0 +1,193 @@
+package metrics
+
+import (
+	"math/rand"
+	"runtime"
+	"sync/atomic"
+	"time"
+
+	"github.com/prometheus/client_golang/prometheus"
+)
+
+// httpBuckets are the request duration buckets, prometheus.DefBuckets.
+var httpBuckets = [numBuckets]float64{.005, .01, .025, .05, .1, .25, .5, 1, 2.5, 5, 10}
+
+const numBuckets = 11
+
+// statusClasses label the status counters by class.
+var statusClasses = [5]string{"1xx", "2xx", "3xx", "4xx", "5xx"}
+
+// HTTPCollector exports API request counters. Like DatapathCollector it
+// records nothing through client_golang on the request path: routes are
+// registered when the router is built, each keeps its own counters by
+// status class, and Collect sums them when Prometheus scrapes. Counters
+// are sharded so that concurrent requests rarely share a cache line.
+type HTTPCollector struct {
+	routes    map[routeKey]*routeStats // Read-only once serving
+	unmatched *routeStats              // Requests no route matched
+	active    []activeShard
+	mask      uint32
+
+	requests *prometheus.Desc
+	duration *prometheus.Desc
+	inFlight *prometheus.Desc
+}
+
+type routeKey struct{ method, path string }
+
+type routeStats struct {
+	method, path string
+	shards       []routeShard
+}
+
+// routeShard holds one shard of a route's counters. Buckets are not
+// cumulative; the last counts requests over the largest bound.
+type routeShard struct {
+	status   [len(statusClasses)]atomic.Uint64
+	buckets  [numBuckets + 1]atomic.Uint64
+	sumNanos atomic.Uint64
+	_        [64]byte
+}
+
+type activeShard struct {
+	started  atomic.Uint64
+	finished atomic.Uint64
+	_        [48]byte
+}
+
+// bucketNanos are httpBuckets in nanoseconds.
+var bucketNanos = func() [numBuckets]int64 {
+	var out [numBuckets]int64
+	for i, b := range httpBuckets {
+		out[i] = int64(b * 1e9)
+	}
+	return out
+}()
+
+// NewHTTPCollector creates a collector. Register the routes with Register
+// before serving, then register it with prometheus.MustRegister.
+func NewHTTPCollector(namespace string) *HTTPCollector {
+	if namespace == "" {
+		namespace = "go_backend"
+	}
+	n := 1
+	for n < runtime.GOMAXPROCS(0) && n < 64 {
+		n <<= 1
+	}
+	c := &HTTPCollector{
+		routes: make(map[routeKey]*routeStats),
+		active: make([]activeShard, n),
+		mask:   uint32(n - 1),
+		requests: prometheus.NewDesc(prometheus.BuildFQName(namespace, "", "http_requests_total"),
+			"Total number of HTTP requests", []string{"method", "endpoint", "status"}, nil),
+		duration: prometheus.NewDesc(prometheus.BuildFQName(namespace, "", "http_request_duration_seconds"),
+			"HTTP request duration in seconds", []string{"method", "endpoint"}, nil),
+		inFlight: prometheus.NewDesc(prometheus.BuildFQName(namespace, "", "http_active_requests"),
+			"Number of active HTTP requests", nil, nil),
+	}
+	c.unmatched = c.newRoute("", "")
+	return c
+}
+
+func (c *HTTPCollector) newRoute(method, path string) *routeStats {
+	return &routeStats{method: method, path: path, shards: make([]routeShard, len(c.active))}
+}
+
+// Register adds a route by method and path pattern, as gin reports them.
+func (c *HTTPCollector) Register(method, path string) {
+	key := routeKey{method, path}
+	if _, ok := c.routes[key]; !ok {
+		c.routes[key] = c.newRoute(method, path)
+	}
+}
+
+// Begin counts a request as started, returning the shard End takes.
+func (c *HTTPCollector) Begin() uint32 {
+	shard := rand.Uint32() & c.mask
+	c.active[shard].started.Add(1)
+	return shard
+}
+
+// End records a finished request on its route; path is the route pattern,
+// empty when none matched. Requests of other methods count as unmatched.
+func (c *HTTPCollector) End(shard uint32, method, path string, status int, elapsed time.Duration) {
+	c.active[shard].finished.Add(1)
+
+	r := c.routes[routeKey{method, path}]
+	if r == nil {
+		r = c.unmatched
+	}
+	s := &r.shards[shard]
+	class := status/100 - 1
+	if class < 0 || class >= len(statusClasses) {
+		class = len(statusClasses) - 1
+	}
+	s.status[class].Add(1)
+
+	ns := int64(elapsed)
+	b := 0
+	for b < len(bucketNanos) && ns > bucketNanos[b] {
+		b++
+	}
+	s.buckets[b].Add(1)
+	s.sumNanos.Add(uint64(ns))
+}
+
+// Describe implements prometheus.Collector.
+func (c *HTTPCollector) Describe(ch chan<- *prometheus.Desc) {
+	ch <- c.requests
+	ch <- c.duration
+	ch <- c.inFlight
+}
+
+// Collect implements prometheus.Collector.
+func (c *HTTPCollector) Collect(ch chan<- prometheus.Metric) {
+	var started, finished uint64
+	for i := range c.active {
+		started += c.active[i].started.Load()
+		finished += c.active[i].finished.Load()
+	}
+	// Finished may be read ahead of its start
+	ch <- prometheus.MustNewConstMetric(c.inFlight, prometheus.GaugeValue, float64(max(int64(started-finished), 0)))
+
+	c.collectRoute(ch, c.unmatched)
+	for _, r := range c.routes {
+		c.collectRoute(ch, r)
+	}
+}
+
+func (c *HTTPCollector) collectRoute(ch chan<- prometheus.Metric, r *routeStats) {
+	var status [len(statusClasses)]uint64
+	var buckets [numBuckets + 1]uint64
+	var sum uint64
+	for i := range r.shards {
+		s := &r.shards[i]
+		for k := range status {
+			status[k] += s.status[k].Load()
+		}
+		for k := range buckets {
+			buckets[k] += s.buckets[k].Load()
+		}
+		sum += s.sumNanos.Load()
+	}
+
+	var count uint64
+	for k, n := range status {
+		if n > 0 {
+			ch <- prometheus.MustNewConstMetric(c.requests, prometheus.CounterValue, float64(n), r.method, r.path, statusClasses[k])
+		}
+		count += n
+	}
+	if count == 0 {
+		return
+	}
+	cumulative := make(map[float64]uint64, numBuckets)
+	var n uint64
+	for k, bound := range httpBuckets {
+		n += buckets[k]
+		cumulative[bound] = n
+	}
+	// Counted from the buckets, which may have moved since the statuses
+	total := n + buckets[numBuckets]
+	ch <- prometheus.MustNewConstHistogram(c.duration, total, float64(sum)/1e9, cumulative, r.method, r.path)
+}
@@ -0,0 +1,84 @@
+package metrics
+
+import (
+	"testing"
+	"time"
+)
+
+// TestHTTPCollector checks the per-route sums across shards.
+func TestHTTPCollector(t *testing.T) {
+	c := NewHTTPCollector("test")
+	c.Register("GET", "/api/v1/status")
+
+	for i := 0; i < 100; i++ {
+		status := 200
+		if i%10 == 0 {
+			status = 503
+		}
+		c.End(c.Begin(), "GET", "/api/v1/status", status, time.Duration(i)*time.Millisecond)
+	}
+	c.End(c.Begin(), "GET", "", 404, time.Millisecond)
+	c.End(c.Begin(), "POST", "/api/v1/status", 404, time.Millisecond)
+	open := c.Begin()
+
+	var status [len(statusClasses)]uint64
+	var buckets [numBuckets + 1]uint64
+	r := c.routes[routeKey{"GET", "/api/v1/status"}]
+	for i := range r.shards {
+		for k := range status {
+			status[k] += r.shards[i].status[k].Load()
+		}
+		for k := range buckets {
+			buckets[k] += r.shards[i].buckets[k].Load()
+		}
+	}
+	if status[1] != 90 || status[4] != 10 {
+		t.Errorf("expected 90 2xx and 10 5xx, got %v", status)
+	}
+	// 0-5ms, 6-10ms, 11-25ms, 26-50ms and 51-99ms
+	if buckets[0] != 6 || buckets[1] != 5 || buckets[2] != 15 || buckets[3] != 25 || buckets[4] != 49 {
+		t.Errorf("unexpected buckets %v", buckets)
+	}
+
+	var unmatched uint64
+	for i := range c.unmatched.shards {
+		unmatched += c.unmatched.shards[i].status[3].Load()
+	}
+	if unmatched != 2 {
+		t.Errorf("expected 2 unmatched requests, got %d", unmatched)
+	}
+
+	var started, finished uint64
+	for i := range c.active {
+		started += c.active[i].started.Load()
+		finished += c.active[i].finished.Load()
+	}
+	if started-finished != 1 {
+		t.Errorf("expected 1 active request, got %d", started-finished)
+	}
+	c.End(open, "GET", "/api/v1/status", 200, 0)
+}
+
+// TestHTTPCollectorAllocs checks that recording a request does not
+// allocate.
+func TestHTTPCollectorAllocs(t *testing.T) {
+	c := NewHTTPCollector("test")
+	c.Register("GET", "/api/v1/status")
+	if n := testing.AllocsPerRun(1000, func() {
+		c.End(c.Begin(), "GET", "/api/v1/status", 200, time.Millisecond)
+	}); n != 0 {
+		t.Errorf("expected no allocations, got %v", n)
+	}
+}
+
+// BenchmarkHTTPCollector measures recording requests from every core.
+func BenchmarkHTTPCollector(b *testing.B) {
+	c := NewHTTPCollector("test")
+	c.Register("GET", "/api/v1/status")
+	b.ReportAllocs()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			c.End(c.Begin(), "GET", "/api/v1/status", 200, time.Millisecond)
+		}
+	})
+}
@@ -9,36 +9,28 @@ import (
 // Metrics holds all Prometheus metrics for the application.
 type Metrics struct {
 	// HTTP metrics
-	HTTPRequestsTotal    *prometheus.CounterVec
-	HTTPRequestDuration  *prometheus.HistogramVec
-	HTTPActiveRequests   prometheus.Gauge
+	HTTP *HTTPCollector
 
-	// XDP metrics
-	XDPPacketsReceived   prometheus.Counter
-	XDPPacketsSent       prometheus.Counter
-	XDPPacketsDropped    prometheus.Counter
-	XDPBytesReceived     prometheus.Counter
-	XDPBytesSent         prometheus.Counter
-	XDPProcessingTime    prometheus.Histogram
+	// XDP datapath metrics are exported by DatapathCollector at scrape time
 
 	// Memory pool metrics
-	MemoryPoolTotal      prometheus.Gauge
-	MemoryPoolUsed       prometheus.Gauge
-	MemoryPoolFree       prometheus.Gauge
+	MemoryPoolTotal       prometheus.Gauge
+	MemoryPoolUsed        prometheus.Gauge
+	MemoryPoolFree        prometheus.Gauge
 	MemoryPoolAllocations prometheus.Counter
-	MemoryPoolReleases   prometheus.Counter
-	MemoryPoolPeakUsage  prometheus.Gauge
+	MemoryPoolReleases    prometheus.Counter
+	MemoryPoolPeakUsage   prometheus.Gauge
 
 	// NUMA metrics
-	NUMANodeID           prometheus.Gauge
-	NUMAAvailable        prometheus.Gauge
-	NUMAMemoryMB         *prometheus.GaugeVec
+	NUMANodeID    prometheus.Gauge
+	NUMAAvailable prometheus.Gauge
+	NUMAMemoryMB  *prometheus.GaugeVec
 
 	// System metrics
-	GoRoutines           prometheus.Gauge
-	HeapAlloc            prometheus.Gauge
-	HeapSys              prometheus.Gauge
-	GCPauseNS            prometheus.Gauge
+	GoRoutines prometheus.Gauge
+	HeapAlloc  prometheus.Gauge
+	HeapSys    prometheus.Gauge
+	GCPauseNS  prometheus.Gauge
 }
 
 // NewMetrics creates and registers all metrics.
@@ -49,82 +41,7 @@ func NewMetrics(namespace string) *Metrics {
 
 	m := &Metrics{
 		// HTTP metrics
-		HTTPRequestsTotal: promauto.NewCounterVec(
-			prometheus.CounterOpts{
-				Namespace: namespace,
-				Name:      "http_requests_total",
-				Help:      "Total number of HTTP requests",
-			},
-			[]string{"method", "endpoint", "status"},
-		),
-
-		HTTPRequestDuration: promauto.NewHistogramVec(
-			prometheus.HistogramOpts{
-				Namespace: namespace,
-				Name:      "http_request_duration_seconds",
-				Help:      "HTTP request duration in seconds",
-				Buckets:   prometheus.DefBuckets,
-			},
-			[]string{"method", "endpoint"},
-		),
-
-		HTTPActiveRequests: promauto.NewGauge(
-			prometheus.GaugeOpts{
-				Namespace: namespace,
-				Name:      "http_active_requests",
-				Help:      "Number of active HTTP requests",
-			},
-		),
-
-		// XDP metrics
-		XDPPacketsReceived: promauto.NewCounter(
-			prometheus.CounterOpts{
-				Namespace: namespace,
-				Name:      "xdp_packets_received_total",
-				Help:      "Total number of packets received via XDP",
-			},
-		),
-
-		XDPPacketsSent: promauto.NewCounter(
-			prometheus.CounterOpts{
-				Namespace: namespace,
-				Name:      "xdp_packets_sent_total",
-				Help:      "Total number of packets sent via XDP",
-			},
-		),
-
-		XDPPacketsDropped: promauto.NewCounter(
-			prometheus.CounterOpts{
-				Namespace: namespace,
-				Name:      "xdp_packets_dropped_total",
-				Help:      "Total number of packets dropped",
-			},
-		),
-
-		XDPBytesReceived: promauto.NewCounter(
-			prometheus.CounterOpts{
-				Namespace: namespace,
-				Name:      "xdp_bytes_received_total",
-				Help:      "Total bytes received via XDP",
-			},
-		),
-
-		XDPBytesSent: promauto.NewCounter(
-			prometheus.CounterOpts{
-				Namespace: namespace,
-				Name:      "xdp_bytes_sent_total",
-				Help:      "Total bytes sent via XDP",
-			},
-		),
-
-		XDPProcessingTime: promauto.NewHistogram(
-			prometheus.HistogramOpts{
-				Namespace: namespace,
-				Name:      "xdp_processing_time_nanoseconds",
-				Help:      "Packet processing time in nanoseconds",
-				Buckets:   []float64{100, 500, 1000, 5000, 10000, 50000, 100000},
-			},
-		),
+		HTTP: NewHTTPCollector(namespace),
 
 		// Memory pool metrics
 		MemoryPoolTotal: promauto.NewGauge(
@@ -235,13 +152,9 @@ func NewMetrics(namespace string) *Metrics {
 		),
 	}
 
-	return m
-}
+	prometheus.MustRegister(m.HTTP)
 
-// RecordHTTPRequest records metrics for an HTTP request.
-func (m *Metrics) RecordHTTPRequest(method, endpoint, status string, durationSeconds float64) {
-	m.HTTPRequestsTotal.WithLabelValues(method, endpoint, status).Inc()
-	m.HTTPRequestDuration.WithLabelValues(method, endpoint).Observe(durationSeconds)
+	return m
 }
 
 // UpdateMemoryPoolStats updates memory pool metrics.
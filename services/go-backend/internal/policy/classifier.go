@@ -0,0 +1,358 @@
+package policy
+
+import (
+	"encoding/binary"
+	"math/bits"
+	"net/netip"
+	"slices"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/cidrset"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// The classifier is a bitmap-intersection packet classifier (Lakshman and
+// Stiliadis, SIGCOMM 1998). Each field maps a packet's value to a class,
+// and each class to the bitmap of rules that field allows; ANDing the
+// fields' bitmaps leaves the matching rules, in precedence order. Lookup
+// cost grows with the number of rules only by a word per 64, and equal
+// bitmaps are shared, so large rule sets stay small.
+
+// conditions are one rule's constraints; an empty list matches anything.
+type conditions struct {
+	src, dst           []netip.Prefix
+	srcPorts, dstPorts []valueRange
+	vlans              []valueRange
+	protos             []uint8
+}
+
+// bitmapTable holds the distinct rule bitmaps of one field.
+type bitmapTable struct {
+	words int
+	bits  []uint64
+	index map[string]uint32 // Build only
+	key   []byte
+}
+
+func newBitmapTable(words int) bitmapTable {
+	return bitmapTable{words: words, index: make(map[string]uint32)}
+}
+
+// intern returns the class of bitmap bm, adding it if new.
+func (t *bitmapTable) intern(bm []uint64) uint32 {
+	t.key = t.key[:0]
+	for _, w := range bm {
+		t.key = binary.LittleEndian.AppendUint64(t.key, w)
+	}
+	if c, ok := t.index[string(t.key)]; ok {
+		return c
+	}
+	c := uint32(len(t.bits) / max(1, t.words))
+	t.bits = append(t.bits, bm...)
+	t.index[string(t.key)] = c
+	return c
+}
+
+// get returns the bitmap of class c.
+func (t *bitmapTable) get(c uint32) []uint64 {
+	return t.bits[int(c)*t.words : int(c+1)*t.words]
+}
+
+// done drops the build-time index.
+func (t *bitmapTable) done() {
+	t.index, t.key = nil, nil
+}
+
+func setBit(bm []uint64, i int) {
+	bm[i/64] |= 1 << uint(i%64)
+}
+
+func clearBit(bm []uint64, i int) {
+	bm[i/64] &^= 1 << uint(i%64)
+}
+
+// addrField classifies addresses by their longest matching rule prefix: the
+// rules containing an address are exactly those with a prefix containing
+// that longest match, so one LPM lookup finds the class.
+type addrField struct {
+	set *cidrset.Set // Prefix to class
+	any uint32       // Class of addresses no prefix contains
+	bitmapTable
+}
+
+func newAddrField(lists [][]netip.Prefix, words int) addrField {
+	f := addrField{bitmapTable: newBitmapTable(words)}
+
+	type owned struct {
+		p    netip.Prefix
+		rule int
+	}
+	anyBM := make([]uint64, words)
+	var all []owned
+	for i, l := range lists {
+		if len(l) == 0 {
+			setBit(anyBM, i)
+		}
+		for _, p := range l {
+			all = append(all, owned{p, i})
+		}
+	}
+	f.any = f.intern(anyBM)
+
+	// In address-then-length order a prefix follows every prefix that
+	// contains it, so a stack holds the chain of enclosing prefixes
+	slices.SortFunc(all, func(a, b owned) int { return comparePrefix(a.p, b.p) })
+
+	type frame struct {
+		p  netip.Prefix
+		bm []uint64
+	}
+	var stack []frame
+	var free [][]uint64
+	b := cidrset.NewBuilder(len(all))
+	for k := 0; k < len(all); {
+		p := all[k].p
+		for len(stack) > 0 {
+			top := stack[len(stack)-1]
+			if top.p.Bits() <= p.Bits() && top.p.Contains(p.Addr()) {
+				break
+			}
+			free = append(free, top.bm)
+			stack = stack[:len(stack)-1]
+		}
+
+		var bm []uint64
+		if n := len(free); n > 0 {
+			bm, free = free[n-1], free[:n-1]
+		} else {
+			bm = make([]uint64, words)
+		}
+		if len(stack) > 0 {
+			copy(bm, stack[len(stack)-1].bm)
+		} else {
+			copy(bm, anyBM)
+		}
+		for ; k < len(all) && all[k].p == p; k++ {
+			setBit(bm, all[k].rule)
+		}
+
+		stack = append(stack, frame{p, bm})
+		b.Add(p, f.intern(bm))
+	}
+
+	f.set = b.Build()
+	f.done()
+	return f
+}
+
+func (f *addrField) lookup4(a [4]byte) uint32 {
+	if c, ok := f.set.Lookup4(a); ok {
+		return c
+	}
+	return f.any
+}
+
+func (f *addrField) lookup6(a [16]byte) uint32 {
+	if c, ok := f.set.Lookup6(a); ok {
+		return c
+	}
+	return f.any
+}
+
+func comparePrefix(a, b netip.Prefix) int {
+	if c := a.Addr().Compare(b.Addr()); c != 0 {
+		return c
+	}
+	return a.Bits() - b.Bits()
+}
+
+// rangeField classifies ports or VLAN IDs by elementary interval: the rule
+// ranges' bounds split the value space into intervals every value of which
+// matches the same rules.
+type rangeField struct {
+	starts []uint32 // Interval starts, ascending; starts[0] is 0
+	class  []uint32 // Class of each interval
+	none   uint32   // Class of packets without the field
+	bitmapTable
+}
+
+func newRangeField(lists [][]valueRange, words int) rangeField {
+	f := rangeField{bitmapTable: newBitmapTable(words)}
+
+	type event struct {
+		at    uint32
+		rule  int
+		delta int32
+	}
+	active := make([]uint64, words)
+	var events []event
+	for i, l := range lists {
+		if len(l) == 0 {
+			setBit(active, i)
+		}
+		for _, r := range l {
+			events = append(events, event{r.lo, i, 1}, event{r.hi + 1, i, -1})
+		}
+	}
+	f.none = f.intern(active)
+	f.starts, f.class = []uint32{0}, []uint32{f.none}
+
+	// Sweep the bounds, counting each rule's open ranges since one rule's
+	// ranges may overlap
+	slices.SortFunc(events, func(a, b event) int { return int(int64(a.at) - int64(b.at)) })
+	open := make([]int32, len(lists))
+	for k := 0; k < len(events); {
+		at := events[k].at
+		for ; k < len(events) && events[k].at == at; k++ {
+			e := events[k]
+			open[e.rule] += e.delta
+			if open[e.rule] > 0 {
+				setBit(active, e.rule)
+			} else {
+				clearBit(active, e.rule)
+			}
+		}
+
+		c := f.intern(active)
+		last := len(f.starts) - 1
+		switch {
+		case f.starts[last] == at:
+			f.class[last] = c
+		case f.class[last] != c:
+			f.starts = append(f.starts, at)
+			f.class = append(f.class, c)
+		}
+	}
+
+	f.done()
+	return f
+}
+
+func (f *rangeField) lookup(v uint32) uint32 {
+	i, j := 0, len(f.starts)
+	for j-i > 1 {
+		h := int(uint(i+j) >> 1)
+		if f.starts[h] <= v {
+			i = h
+		} else {
+			j = h
+		}
+	}
+	return f.class[i]
+}
+
+// protoField classifies IP protocol numbers directly.
+type protoField struct {
+	class [256]uint32
+	bitmapTable
+}
+
+func newProtoField(lists [][]uint8, words int) protoField {
+	f := protoField{bitmapTable: newBitmapTable(words)}
+	var byProto [256][]uint64
+	anyBM := make([]uint64, words)
+	for i, l := range lists {
+		if len(l) == 0 {
+			setBit(anyBM, i)
+		}
+		for _, p := range l {
+			if byProto[p] == nil {
+				byProto[p] = make([]uint64, words)
+			}
+			setBit(byProto[p], i)
+		}
+	}
+
+	anyClass := f.intern(anyBM)
+	for p := range f.class {
+		f.class[p] = anyClass
+		if bm := byProto[p]; bm != nil {
+			for w := range bm {
+				bm[w] |= anyBM[w]
+			}
+			f.class[p] = f.intern(bm)
+		}
+	}
+
+	f.done()
+	return f
+}
+
+// classifier matches packets against an ordered list of rules.
+type classifier struct {
+	n, words int
+	decisive []uint64 // Rules that end a match; the rest are counted and skipped
+	src, dst addrField
+	srcPort  rangeField
+	dstPort  rangeField
+	vlan     rangeField
+	proto    protoField
+}
+
+// newClassifier compiles rules in precedence order. decisive[i] reports
+// whether rule i ends a match.
+func newClassifier(rules []conditions, decisive []bool) classifier {
+	n := len(rules)
+	words := (n + 63) / 64
+	c := classifier{n: n, words: words, decisive: make([]uint64, words)}
+
+	src := make([][]netip.Prefix, n)
+	dst := make([][]netip.Prefix, n)
+	srcPorts := make([][]valueRange, n)
+	dstPorts := make([][]valueRange, n)
+	vlans := make([][]valueRange, n)
+	protos := make([][]uint8, n)
+	for i := range rules {
+		src[i], dst[i] = rules[i].src, rules[i].dst
+		srcPorts[i], dstPorts[i] = rules[i].srcPorts, rules[i].dstPorts
+		vlans[i], protos[i] = rules[i].vlans, rules[i].protos
+		if decisive[i] {
+			setBit(c.decisive, i)
+		}
+	}
+
+	c.src = newAddrField(src, words)
+	c.dst = newAddrField(dst, words)
+	c.srcPort = newRangeField(srcPorts, words)
+	c.dstPort = newRangeField(dstPorts, words)
+	c.vlan = newRangeField(vlans, words)
+	c.proto = newProtoField(protos, words)
+	return c
+}
+
+// match returns the first decisive rule matching v, or -1. Non-decisive
+// rules matched before it are counted in hits.
+func (c *classifier) match(v *xdp.PacketView, hits []uint64) int {
+	if c.n == 0 {
+		return -1
+	}
+
+	var src, dst uint32
+	if v.IPVersion == 4 {
+		src, dst = c.src.lookup4(v.SrcIP4), c.dst.lookup4(v.DstIP4)
+	} else {
+		src, dst = c.src.lookup6(v.SrcIP6), c.dst.lookup6(v.DstIP6)
+	}
+	sport, dport := c.srcPort.none, c.dstPort.none
+	if v.Has(xdp.LayerL4) && (v.Protocol == xdp.IPProtoTCP || v.Protocol == xdp.IPProtoUDP) {
+		sport, dport = c.srcPort.lookup(uint32(v.SrcPort)), c.dstPort.lookup(uint32(v.DstPort))
+	}
+	vlan := c.vlan.none
+	if v.NumVLANs > 0 {
+		vlan = c.vlan.lookup(uint32(v.VLANs[0] & 0x0FFF)) // Outermost tag
+	}
+
+	b0, b1 := c.src.get(src), c.dst.get(dst)
+	b2, b3 := c.srcPort.get(sport), c.dstPort.get(dport)
+	b4, b5 := c.vlan.get(vlan), c.proto.get(c.proto.class[v.Protocol])
+	for w := 0; w < c.words; w++ {
+		for m := b0[w] & b1[w] & b2[w] & b3[w] & b4[w] & b5[w]; m != 0; m &= m - 1 {
+			bit := bits.TrailingZeros64(m)
+			r := w*64 + bit
+			if c.decisive[w]&(1<<uint(bit)) != 0 {
+				return r
+			}
+			hits[r]++
+		}
+	}
+	return -1
+}
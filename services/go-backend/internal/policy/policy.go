@@ -0,0 +1,202 @@
+// Package policy compiles firewall, ACL and content-filter rules into an
+// immutable ruleset that the datapath swaps in without locks.
+//
+// A Policy is the rule document the WebUI edits; its rule types mirror the
+// firewall_rules, xdp_filter_rules and filter_policies tables of the Flask
+// backend. Store.Update compiles a policy into a Ruleset, publishes it to
+// the pipeline stages through an atomic pointer, waits out a grace period so
+// no worker is still matching against the old rules, and mirrors the ACL
+// rules into the XDP program's maps.
+package policy
+
+import (
+	"errors"
+	"fmt"
+	"net/netip"
+	"strconv"
+	"strings"
+)
+
+var (
+	// ErrInvalidRule is returned for a rule that does not parse.
+	ErrInvalidRule = errors.New("invalid policy rule")
+)
+
+// Firewall actions, as in FIREWALL_ACTIONS. Reject drops in the datapath;
+// log counts the packet and continues with the next rule.
+const (
+	ActionAccept = "accept"
+	ActionDrop   = "drop"
+	ActionReject = "reject"
+	ActionLog    = "log"
+)
+
+// ACL actions, as in XDP_ACTIONS. The inspect and capture actions steer
+// traffic to the AF_XDP datapath, where the firewall rules apply.
+const (
+	ACLActionPass          = "pass"
+	ACLActionDrop          = "drop"
+	ACLActionInspectIPS    = "inspect_ips"
+	ACLActionCaptureArkime = "capture_arkime"
+	ACLActionInspectAll    = "inspect_all"
+)
+
+// ACL match types, as in XDP_MATCH_TYPES.
+const (
+	MatchSrcIP    = "src_ip"
+	MatchDstIP    = "dst_ip"
+	MatchSrcNet   = "src_net"
+	MatchDstNet   = "dst_net"
+	MatchSrcPort  = "src_port"
+	MatchDstPort  = "dst_port"
+	MatchProtocol = "protocol"
+	MatchVLAN     = "vlan"
+)
+
+// Policy is a complete rule document. The zero value accepts everything.
+type Policy struct {
+	// DefaultAction applies to IP packets no rule decided: accept or drop
+	DefaultAction  string          `json:"default_action"`
+	FirewallRules  []FirewallRule  `json:"firewall_rules"`
+	ACLRules       []ACLRule       `json:"acl_rules"`
+	ContentFilters []ContentFilter `json:"content_filters"`
+}
+
+// FirewallRule mirrors a row of firewall_rules. Lists are comma-separated;
+// an empty field matches anything. The lowest priority number wins.
+type FirewallRule struct {
+	ID            int64  `json:"id"`
+	Name          string `json:"name"`
+	Priority      int    `json:"priority"`
+	SourceAddress string `json:"source_address"` // Addresses or prefixes
+	DestAddress   string `json:"dest_address"`
+	SourcePort    string `json:"source_port"` // Ports or lo-hi ranges
+	DestPort      string `json:"dest_port"`
+	Protocol      string `json:"protocol"` // FIREWALL_PROTOCOLS (default: any)
+	Action        string `json:"action"`
+	IsActive      *bool  `json:"is_active,omitempty"` // Default: true
+}
+
+// ACLRule mirrors a row of xdp_filter_rules. Source-address and
+// destination-port rules run in the XDP program itself.
+type ACLRule struct {
+	ID         int64  `json:"id"`
+	Name       string `json:"name"`
+	Priority   int    `json:"priority"`
+	MatchType  string `json:"match_type"`
+	MatchValue string `json:"match_value"`
+	Action     string `json:"action"`
+	IsActive   *bool  `json:"is_active,omitempty"`
+}
+
+// ContentFilter mirrors a row of filter_policies. A domain matches itself
+// and its subdomains; the most specific entry wins, then the filter with
+// the lowest priority number, and an allow beats a block.
+type ContentFilter struct {
+	ID             int64    `json:"id"`
+	Name           string   `json:"name"`
+	Priority       int      `json:"priority"`
+	AllowedDomains []string `json:"allowed_domains"`
+	BlockedDomains []string `json:"blocked_domains"`
+	IsActive       *bool    `json:"is_active,omitempty"`
+}
+
+func active(b *bool) bool {
+	return b == nil || *b
+}
+
+// IP protocol numbers of FIREWALL_PROTOCOLS without an xdp constant.
+const (
+	ipProtoGRE = 47
+)
+
+var protocols = map[string]uint8{
+	"tcp":    6,
+	"udp":    17,
+	"icmp":   1,
+	"icmpv6": 58,
+	"esp":    50,
+	"ah":     51,
+	"gre":    ipProtoGRE,
+}
+
+// parseProtocol returns the protocol number of a name or number; any (or
+// empty) returns ok false.
+func parseProtocol(s string) (proto uint8, ok bool, err error) {
+	s = strings.ToLower(strings.TrimSpace(s))
+	if s == "" || s == "any" {
+		return 0, false, nil
+	}
+	if p, found := protocols[s]; found {
+		return p, true, nil
+	}
+	n, err := strconv.ParseUint(s, 10, 8)
+	if err != nil {
+		return 0, false, fmt.Errorf("unknown protocol %q", s)
+	}
+	return uint8(n), true, nil
+}
+
+// parsePrefixes parses a comma-separated list of addresses and prefixes.
+func parsePrefixes(s string) ([]netip.Prefix, error) {
+	var out []netip.Prefix
+	for _, f := range strings.Split(s, ",") {
+		f = strings.TrimSpace(f)
+		if f == "" || strings.EqualFold(f, "any") {
+			continue
+		}
+		if strings.Contains(f, "/") {
+			p, err := netip.ParsePrefix(f)
+			if err != nil {
+				return nil, fmt.Errorf("invalid prefix %q", f)
+			}
+			out = append(out, canonicalPrefix(p.Masked()))
+			continue
+		}
+		a, err := netip.ParseAddr(f)
+		if err != nil {
+			return nil, fmt.Errorf("invalid address %q", f)
+		}
+		out = append(out, canonicalPrefix(netip.PrefixFrom(a, a.BitLen())))
+	}
+	return out, nil
+}
+
+// valueRange is an inclusive range of port or VLAN numbers.
+type valueRange struct {
+	lo, hi uint32
+}
+
+// parseRanges parses a comma-separated list of numbers and lo-hi ranges no
+// greater than max.
+func parseRanges(s string, max uint32) ([]valueRange, error) {
+	var out []valueRange
+	for _, f := range strings.Split(s, ",") {
+		f = strings.TrimSpace(f)
+		if f == "" || strings.EqualFold(f, "any") {
+			continue
+		}
+		loStr, hiStr, isRange := strings.Cut(f, "-")
+		lo, err := strconv.ParseUint(strings.TrimSpace(loStr), 10, 32)
+		if err != nil || lo > uint64(max) {
+			return nil, fmt.Errorf("invalid value %q", f)
+		}
+		hi := lo
+		if isRange {
+			hi, err = strconv.ParseUint(strings.TrimSpace(hiStr), 10, 32)
+			if err != nil || hi > uint64(max) || hi < lo {
+				return nil, fmt.Errorf("invalid range %q", f)
+			}
+		}
+		out = append(out, valueRange{uint32(lo), uint32(hi)})
+	}
+	return out, nil
+}
+
+// normalizeDomain lowercases a domain and strips a leading "*." or
+// trailing dot.
+func normalizeDomain(d string) string {
+	d = strings.ToLower(strings.TrimSpace(d))
+	d = strings.TrimPrefix(d, "*.")
+	return strings.TrimSuffix(d, ".")
+}
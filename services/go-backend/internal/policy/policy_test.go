@@ -0,0 +1,473 @@
+package policy
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"math/rand"
+	"net/netip"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// view returns a decoded packet; ports are set for TCP and UDP.
+func view(src, dst string, proto uint8, sport, dport uint16) xdp.PacketView {
+	v := xdp.PacketView{Protocol: proto, Layers: xdp.LayerL3}
+	s, d := netip.MustParseAddr(src), netip.MustParseAddr(dst)
+	if s.Is4() {
+		v.IPVersion, v.SrcIP4, v.DstIP4 = 4, s.As4(), d.As4()
+	} else {
+		v.IPVersion, v.SrcIP6, v.DstIP6 = 6, s.As16(), d.As16()
+	}
+	if proto == xdp.IPProtoTCP || proto == xdp.IPProtoUDP {
+		v.Layers |= xdp.LayerL4
+		v.SrcPort, v.DstPort = sport, dport
+	}
+	return v
+}
+
+func testPolicy() Policy {
+	return Policy{
+		DefaultAction: ActionDrop,
+		FirewallRules: []FirewallRule{
+			{ID: 3, Priority: 30, SourceAddress: "10.0.0.0/8", Action: ActionDrop},
+			{ID: 1, Priority: 10, SourceAddress: "10.0.0.0/8", Action: ActionLog},
+			{ID: 2, Priority: 20, DestAddress: "192.0.2.0/24", Protocol: "tcp", DestPort: "80,443", Action: ActionAccept},
+			{ID: 4, Priority: 40, Protocol: "udp", DestPort: "1000-2000", Action: ActionReject},
+			{ID: 5, Priority: 50, SourceAddress: "2001:db8::/32", Action: ActionAccept},
+			{ID: 6, Priority: 5, Action: ActionDrop, IsActive: new(bool)},
+		},
+		ACLRules: []ACLRule{
+			{ID: 10, MatchType: MatchSrcNet, MatchValue: "198.51.100.0/24", Action: ACLActionDrop},
+			{ID: 11, MatchType: MatchSrcIP, MatchValue: "198.51.100.7", Action: ACLActionPass},
+			{ID: 12, MatchType: MatchDstPort, MatchValue: "443", Action: ACLActionInspectIPS},
+			{ID: 13, MatchType: MatchDstPort, MatchValue: "23", Action: ACLActionDrop},
+			{ID: 14, MatchType: MatchVLAN, MatchValue: "100", Action: ACLActionDrop},
+			{ID: 15, MatchType: MatchProtocol, MatchValue: "gre", Action: ACLActionDrop},
+		},
+	}
+}
+
+// TestMatch checks rule precedence across the ACL fast path, the
+// classifier and the default action.
+func TestMatch(t *testing.T) {
+	p := testPolicy()
+	rs, err := Compile(&p, nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if rs.Len() != 11 {
+		t.Fatalf("expected 11 active rules, got %d", rs.Len())
+	}
+
+	tagged := view("2001:db8::1", "2001:db8::2", xdp.IPProtoUDP, 5000, 53)
+	tagged.NumVLANs, tagged.VLANs[0] = 1, 0x2000|100
+
+	tests := []struct {
+		name string
+		v    xdp.PacketView
+		want verdict
+		hits []RuleKey
+	}{
+		{"log then accept", view("10.1.1.1", "192.0.2.5", xdp.IPProtoTCP, 4000, 80), verdictPass,
+			[]RuleKey{{KindFirewall, 1}, {KindFirewall, 2}}},
+		{"priority drop", view("10.1.1.1", "192.0.2.5", xdp.IPProtoTCP, 4000, 8080), verdictDrop,
+			[]RuleKey{{KindFirewall, 1}, {KindFirewall, 3}}},
+		{"port range", view("172.16.0.1", "192.0.2.5", xdp.IPProtoUDP, 4000, 1500), verdictDrop,
+			[]RuleKey{{KindFirewall, 4}}},
+		{"source ACL before port ACL", view("198.51.100.9", "203.0.113.1", xdp.IPProtoTCP, 4000, 23), verdictDrop,
+			[]RuleKey{{KindACL, 10}}},
+		{"longest source prefix", view("198.51.100.7", "203.0.113.1", xdp.IPProtoTCP, 4000, 23), verdictPass,
+			[]RuleKey{{KindACL, 11}}},
+		{"port ACL", view("172.16.0.1", "203.0.113.1", xdp.IPProtoTCP, 4000, 23), verdictDrop,
+			[]RuleKey{{KindACL, 13}}},
+		{"inspect falls through", view("172.16.0.1", "192.0.2.5", xdp.IPProtoTCP, 4000, 443), verdictPass,
+			[]RuleKey{{KindACL, 12}, {KindFirewall, 2}}},
+		{"VLAN ACL before firewall", tagged, verdictDrop, []RuleKey{{KindACL, 14}}},
+		{"IPv6 accept", view("2001:db8::1", "2001:db8::2", xdp.IPProtoUDP, 5000, 53), verdictPass,
+			[]RuleKey{{KindFirewall, 5}}},
+		{"protocol ACL", view("172.16.0.1", "192.0.2.5", ipProtoGRE, 0, 0), verdictDrop,
+			[]RuleKey{{KindACL, 15}}},
+		{"default", view("172.16.0.1", "192.0.2.5", xdp.IPProtoICMP, 0, 0), verdictDrop, nil},
+		{"non-IP", xdp.PacketView{}, verdictNone, nil},
+	}
+	for _, tt := range tests {
+		hits := make([]uint64, rs.Len())
+		if got := rs.match(&tt.v, hits); got != tt.want {
+			t.Errorf("%s: expected verdict %d, got %d", tt.name, tt.want, got)
+		}
+		want := make(map[RuleKey]bool)
+		for _, k := range tt.hits {
+			want[k] = true
+		}
+		for i, n := range hits {
+			if k := rs.rules[i].key; (n == 1) != want[k] || n > 1 {
+				t.Errorf("%s: rule %v hit %d times", tt.name, k, n)
+			}
+		}
+	}
+}
+
+// TestCompileErrors checks that malformed rules are rejected.
+func TestCompileErrors(t *testing.T) {
+	for name, p := range map[string]Policy{
+		"default action": {DefaultAction: "maybe"},
+		"prefix":         {FirewallRules: []FirewallRule{{SourceAddress: "10.0.0.0/33"}}},
+		"action":         {FirewallRules: []FirewallRule{{Action: "allow"}}},
+		"ports on icmp":  {FirewallRules: []FirewallRule{{Protocol: "icmp", DestPort: "80"}}},
+		"port range":     {FirewallRules: []FirewallRule{{DestPort: "90-80"}}},
+		"match type":     {ACLRules: []ACLRule{{MatchType: "mac", MatchValue: "x", Action: ACLActionDrop}}},
+		"empty match":    {ACLRules: []ACLRule{{MatchType: MatchSrcNet, Action: ACLActionDrop}}},
+		"ACL action":     {ACLRules: []ACLRule{{MatchType: MatchVLAN, MatchValue: "1", Action: "accept"}}},
+		"VLAN":           {ACLRules: []ACLRule{{MatchType: MatchVLAN, MatchValue: "4096", Action: ACLActionDrop}}},
+	} {
+		if _, err := Compile(&p, nil); !errors.Is(err, ErrInvalidRule) {
+			t.Errorf("%s: expected ErrInvalidRule, got %v", name, err)
+		}
+	}
+}
+
+// TestFilterDomain checks suffix matching and filter precedence.
+func TestFilterDomain(t *testing.T) {
+	p := Policy{ContentFilters: []ContentFilter{
+		{Priority: 20, BlockedDomains: []string{"example.com", "*.ads.example.net"}},
+		{Priority: 10, AllowedDomains: []string{"good.example.com"}, BlockedDomains: []string{"ads.example.net"}},
+		{Priority: 1, BlockedDomains: []string{"example.org"}, IsActive: new(bool)},
+	}}
+	rs, err := Compile(&p, nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	for name, want := range map[string][2]bool{
+		"example.com":             {true, true},
+		"WWW.Example.COM.":        {true, true},
+		"good.example.com":        {false, true},
+		"x.good.example.com":      {false, true},
+		"tracker.ads.example.net": {true, true},
+		"example.org":             {false, false},
+		"com":                     {false, false},
+	} {
+		if blocked, matched := rs.FilterDomain(name); blocked != want[0] || matched != want[1] {
+			t.Errorf("%s: expected %v/%v, got %v/%v", name, want[0], want[1], blocked, matched)
+		}
+	}
+}
+
+// TestGracePeriod checks that synchronize waits for a reader that entered
+// before it and ignores idle ones.
+func TestGracePeriod(t *testing.T) {
+	g := newGrace()
+	busy := g.register()
+	g.register() // Idle
+
+	g.enter(busy)
+	done := make(chan error, 1)
+	go func() { done <- g.synchronize(context.Background()) }()
+	select {
+	case <-done:
+		t.Fatal("synchronize returned while a reader was active")
+	case <-time.After(20 * time.Millisecond):
+	}
+
+	// A section begun after the advance does not hold the writer
+	g.exit(busy)
+	g.enter(busy)
+	if err := <-done; err != nil {
+		t.Fatal(err)
+	}
+	g.exit(busy)
+
+	g.enter(busy)
+	ctx, cancel := context.WithTimeout(context.Background(), 10*time.Millisecond)
+	defer cancel()
+	if err := g.synchronize(ctx); !errors.Is(err, context.DeadlineExceeded) {
+		t.Errorf("expected deadline exceeded, got %v", err)
+	}
+	g.exit(busy)
+	g.unregister(busy)
+}
+
+// fakeMirror records the mirrored ACL rules.
+type fakeMirror struct {
+	prefixes map[netip.Prefix]xdp.ACLAction
+	ports    map[[2]uint16]xdp.ACLAction
+}
+
+func newFakeMirror() *fakeMirror {
+	return &fakeMirror{prefixes: make(map[netip.Prefix]xdp.ACLAction), ports: make(map[[2]uint16]xdp.ACLAction)}
+}
+
+func (f *fakeMirror) SetCIDRActions(prefixes []netip.Prefix, actions []xdp.ACLAction) error {
+	for i, p := range prefixes {
+		f.prefixes[p] = actions[i]
+	}
+	return nil
+}
+
+func (f *fakeMirror) RemoveCIDRs(prefixes []netip.Prefix) error {
+	for _, p := range prefixes {
+		delete(f.prefixes, p)
+	}
+	return nil
+}
+
+func (f *fakeMirror) SetPortAction(proto uint8, port uint16, action xdp.ACLAction) error {
+	f.ports[[2]uint16{uint16(proto), port}] = action
+	return nil
+}
+
+func (f *fakeMirror) RemovePortAction(proto uint8, port uint16) error {
+	delete(f.ports, [2]uint16{uint16(proto), port})
+	return nil
+}
+
+// TestStoreUpdate checks publishing, mirroring, persistence and hit counts
+// across updates.
+func TestStoreUpdate(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "policy.json")
+	mirror := newFakeMirror()
+	s, err := NewStore(StoreConfig{Path: path, Mirror: mirror})
+	if err != nil {
+		t.Fatal(err)
+	}
+	stage := s.NewStage()
+	defer stage.Close()
+
+	var b xdp.Batch
+	b.N, b.Active = 2, 3
+	b.Views[0] = view("198.51.100.9", "192.0.2.5", xdp.IPProtoTCP, 4000, 80)
+	b.Views[1] = view("10.1.1.1", "192.0.2.5", xdp.IPProtoTCP, 4000, 8080)
+	var v xdp.Verdicts
+	stage.Process(&b, &v)
+	if v.Pass|v.Drop != 0 {
+		t.Fatalf("expected the empty policy to decide nothing, got %+v", v)
+	}
+
+	res, err := s.Update(context.Background(), testPolicy())
+	if err != nil {
+		t.Fatal(err)
+	}
+	if res.Generation != 1 || res.Rules != 11 || res.Written != 6 || res.Removed != 0 {
+		t.Fatalf("unexpected first update %+v", res)
+	}
+	if mirror.prefixes[netip.MustParsePrefix("198.51.100.7/32")] != xdp.ACLAllow ||
+		mirror.ports[[2]uint16{xdp.IPProtoUDP, 443}] != xdp.ACLInspect {
+		t.Errorf("unexpected mirror %+v", mirror)
+	}
+
+	v = xdp.Verdicts{}
+	stage.Process(&b, &v)
+	if v.Drop != 3 {
+		t.Fatalf("expected both frames dropped, got %+v", v)
+	}
+
+	// Drop the port rules and flip the /24; rule 10 keeps its count
+	p := testPolicy()
+	p.ACLRules = p.ACLRules[:2]
+	p.ACLRules[0].Action = ACLActionInspectAll
+	p.FirewallRules = append(p.FirewallRules, FirewallRule{ID: 7, Priority: 1, DestPort: "80", Action: ActionAccept})
+	res, err = s.Update(context.Background(), p)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if res.Generation != 2 || res.Written != 1 || res.Removed != 4 {
+		t.Fatalf("unexpected second update %+v", res)
+	}
+	if len(mirror.ports) != 0 || mirror.prefixes[netip.MustParsePrefix("198.51.100.0/24")] != xdp.ACLInspect {
+		t.Errorf("unexpected mirror %+v", mirror)
+	}
+
+	v = xdp.Verdicts{}
+	stage.Process(&b, &v)
+	if v.Pass != 1 || v.Drop != 2 {
+		t.Fatalf("expected frame 0 passed and 1 dropped, got %+v", v)
+	}
+	stage.flush()
+	hits := make(map[RuleKey]uint64)
+	for _, h := range s.Hits() {
+		hits[RuleKey{h.Kind, h.ID}] = h.Hits
+	}
+	if hits[RuleKey{KindACL, 10}] != 2 || hits[RuleKey{KindFirewall, 7}] != 1 || hits[RuleKey{KindFirewall, 1}] != 2 {
+		t.Errorf("unexpected hits %v", hits)
+	}
+
+	// An uncounted stage decides the same but leaves the counters alone
+	uncounted := s.NewUncountedStage()
+	v = xdp.Verdicts{}
+	uncounted.Process(&b, &v)
+	uncounted.Close()
+	if v.Pass != 1 || v.Drop != 2 {
+		t.Fatalf("expected the uncounted stage to decide alike, got %+v", v)
+	}
+	for _, h := range s.Hits() {
+		if h.Hits != hits[RuleKey{h.Kind, h.ID}] {
+			t.Errorf("expected rule %s:%d to keep %d hits, got %d", h.Kind, h.ID, hits[RuleKey{h.Kind, h.ID}], h.Hits)
+		}
+	}
+
+	if _, err := s.Update(context.Background(), Policy{DefaultAction: "maybe"}); !errors.Is(err, ErrInvalidRule) {
+		t.Errorf("expected ErrInvalidRule, got %v", err)
+	}
+	if _, gen := s.Policy(); gen != 2 {
+		t.Errorf("expected a rejected update to keep generation 2, got %d", gen)
+	}
+
+	// A restarted store loads the saved policy and mirrors it in full
+	reloaded := newFakeMirror()
+	s2, err := NewStore(StoreConfig{Path: path, Mirror: reloaded})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if got, _ := s2.Policy(); len(got.FirewallRules) != len(p.FirewallRules) || s2.Current().Len() != s.Current().Len() {
+		t.Errorf("expected the saved policy, got %+v", got)
+	}
+	if len(reloaded.prefixes) != len(mirror.prefixes) {
+		t.Errorf("expected %d mirrored prefixes, got %d", len(mirror.prefixes), len(reloaded.prefixes))
+	}
+}
+
+// fakeFlows holds the flows of a connection tracking table.
+type fakeFlows struct {
+	flows []xdp.FlowTuple
+}
+
+func (f *fakeFlows) Evict(drop func(xdp.FlowTuple) bool) int {
+	kept := f.flows[:0]
+	for _, t := range f.flows {
+		if !drop(t) {
+			kept = append(kept, t)
+		}
+	}
+	n := len(f.flows) - len(kept)
+	f.flows = kept
+	return n
+}
+
+func tuple(src, dst string, proto uint8, sport, dport uint16) xdp.FlowTuple {
+	return xdp.FlowTuple{
+		Src:     netip.MustParseAddr(src).As16(),
+		Dst:     netip.MustParseAddr(dst).As16(),
+		SrcPort: sport,
+		DstPort: dport,
+		Proto:   proto,
+	}
+}
+
+// TestStoreEvictsFlows checks that an update evicts the tracked flows its
+// rules drop, without counting hits, and completes after its caller is gone.
+func TestStoreEvictsFlows(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "policy.json")
+	flows := &fakeFlows{flows: []xdp.FlowTuple{
+		tuple("10.1.1.1", "192.0.2.5", xdp.IPProtoTCP, 4000, 80),    // Rule 2 accepts
+		tuple("10.1.1.1", "192.0.2.5", xdp.IPProtoTCP, 4000, 8080),  // Rule 3 drops
+		tuple("2001:db8::1", "2001:db8::2", xdp.IPProtoUDP, 53, 53), // Rule 5 accepts
+		tuple("203.0.113.1", "192.0.2.5", xdp.IPProtoUDP, 9, 1500),  // Rule 4 rejects
+	}}
+	s, err := NewStore(StoreConfig{Path: path, Flows: flows})
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// Without rule 14, the VLAN ACL
+	p := testPolicy()
+	p.ACLRules = append(p.ACLRules[:4:4], p.ACLRules[5:]...)
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+	res, err := s.Update(ctx, p)
+	if err != nil {
+		t.Fatalf("expected the update to complete without its caller, got %v", err)
+	}
+	if res.Evicted != 2 || len(flows.flows) != 2 || flows.flows[0].DstPort != 80 || flows.flows[1].DstPort != 53 {
+		t.Fatalf("expected the flows to 8080 and 1500 evicted, got %d: %+v", res.Evicted, flows.flows)
+	}
+	for _, h := range s.Hits() {
+		if h.Hits != 0 {
+			t.Errorf("expected re-checks not counted, got %+v", h)
+		}
+	}
+	if s2, err := NewStore(StoreConfig{Path: path}); err != nil || s2.Current().Len() != res.Rules {
+		t.Errorf("expected the policy saved, got %v", err)
+	}
+
+	// The tuples keep no VLAN tag, so a flow any tag would drop is evicted:
+	// rule 14 drops VLAN 100 ahead of the firewall rules, not ahead of
+	// rule 11, which now passes 10.1.1.1
+	p = testPolicy()
+	p.ACLRules[1].MatchValue = "10.1.1.1"
+	if res, err = s.Update(context.Background(), p); err != nil || res.Evicted != 1 {
+		t.Fatalf("expected the VLAN rule to evict 1 flow, got %d %v", res.Evicted, err)
+	}
+	if len(flows.flows) != 1 || flows.flows[0].Src != netip.MustParseAddr("10.1.1.1").As16() {
+		t.Errorf("expected the flow from 10.1.1.1 kept, got %+v", flows.flows)
+	}
+}
+
+// largePolicy returns n random firewall rules in 10.0.0.0/8.
+func largePolicy(n int) Policy {
+	rng := rand.New(rand.NewSource(1))
+	p := Policy{DefaultAction: ActionAccept}
+	for i := 0; i < n; i++ {
+		r := FirewallRule{
+			ID:            int64(i + 1),
+			Priority:      rng.Intn(1000) + 1,
+			SourceAddress: fmt.Sprintf("10.%d.%d.0/%d", rng.Intn(256), rng.Intn(256), 16+rng.Intn(9)),
+			Action:        []string{ActionAccept, ActionDrop, ActionLog}[rng.Intn(3)],
+		}
+		if rng.Intn(2) == 0 {
+			r.Protocol, r.DestPort = "tcp", fmt.Sprint(rng.Intn(1024))
+		}
+		p.FirewallRules = append(p.FirewallRules, r)
+	}
+	return p
+}
+
+// TestMatchAllocs checks that matching does not allocate.
+func TestMatchAllocs(t *testing.T) {
+	p := largePolicy(500)
+	rs, err := Compile(&p, nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	hits := make([]uint64, rs.Len())
+	v := view("10.1.2.3", "192.0.2.1", xdp.IPProtoTCP, 4000, 80)
+	if n := testing.AllocsPerRun(100, func() { rs.match(&v, hits) }); n != 0 {
+		t.Errorf("expected no allocations, got %v", n)
+	}
+}
+
+// BenchmarkMatch measures matching against 5000 firewall rules.
+func BenchmarkMatch(b *testing.B) {
+	p := largePolicy(5000)
+	rs, err := Compile(&p, nil)
+	if err != nil {
+		b.Fatal(err)
+	}
+	hits := make([]uint64, rs.Len())
+	rng := rand.New(rand.NewSource(2))
+	views := make([]xdp.PacketView, 1024)
+	for i := range views {
+		views[i] = view(fmt.Sprintf("10.%d.%d.%d", rng.Intn(256), rng.Intn(256), rng.Intn(256)), "192.0.2.1",
+			xdp.IPProtoTCP, 4000, uint16(rng.Intn(1024)))
+	}
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		rs.match(&views[i&(len(views)-1)], hits)
+	}
+}
+
+// BenchmarkCompile measures compiling 5000 firewall rules.
+func BenchmarkCompile(b *testing.B) {
+	p := largePolicy(5000)
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		if _, err := Compile(&p, nil); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
@@ -0,0 +1,91 @@
+package policy
+
+import (
+	"context"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// grace implements RCU-style grace periods with epochs. A reader publishes
+// the epoch it started at for the length of a read-side section and clears
+// it afterwards; a writer that has published new data advances the epoch
+// and waits until no reader is still in a section begun before the
+// advance. Readers pay two stores and a load per section and never wait.
+type grace struct {
+	epoch atomic.Uint64
+	mu    sync.Mutex
+	slots []*readerSlot
+}
+
+// graceSpin is how long synchronize sleeps between polls of a reader; a
+// section spans one batch, so the wait is rarely more than a few polls.
+const graceSpin = 20 * time.Microsecond
+
+// readerSlot is one reader's published epoch, 0 when quiescent. The padding
+// keeps readers on separate cache lines.
+type readerSlot struct {
+	epoch atomic.Uint64
+	_     [56]byte
+}
+
+func newGrace() *grace {
+	g := &grace{}
+	g.epoch.Store(1)
+	return g
+}
+
+// register adds a reader.
+func (g *grace) register() *readerSlot {
+	r := &readerSlot{}
+	g.mu.Lock()
+	g.slots = append(g.slots, r)
+	g.mu.Unlock()
+	return r
+}
+
+// unregister removes a reader, which must be quiescent.
+func (g *grace) unregister(r *readerSlot) {
+	g.mu.Lock()
+	defer g.mu.Unlock()
+	for i, s := range g.slots {
+		if s == r {
+			g.slots = append(g.slots[:i], g.slots[i+1:]...)
+			return
+		}
+	}
+}
+
+// enter starts a read-side section; data loaded inside it stays in use
+// until exit.
+func (g *grace) enter(r *readerSlot) {
+	r.epoch.Store(g.epoch.Load())
+}
+
+// exit ends a read-side section.
+func (g *grace) exit(r *readerSlot) {
+	r.epoch.Store(0)
+}
+
+// synchronize waits until every read-side section that began before the
+// call has ended. Idle readers do not delay it.
+func (g *grace) synchronize(ctx context.Context) error {
+	target := g.epoch.Add(1)
+
+	g.mu.Lock()
+	slots := append([]*readerSlot(nil), g.slots...)
+	g.mu.Unlock()
+
+	for _, r := range slots {
+		for {
+			if e := r.epoch.Load(); e == 0 || e >= target {
+				break
+			}
+			if err := ctx.Err(); err != nil {
+				return err
+			}
+			time.Sleep(graceSpin)
+		}
+	}
+	return nil
+}
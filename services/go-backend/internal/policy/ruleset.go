@@ -0,0 +1,455 @@
+package policy
+
+import (
+	"fmt"
+	"net/netip"
+	"slices"
+	"strings"
+	"sync/atomic"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/cidrset"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// verdict is the datapath outcome of a rule.
+type verdict uint8
+
+const (
+	verdictNone verdict = iota // Count and continue matching
+	verdictPass
+	verdictDrop
+)
+
+// RuleKind identifies the table a rule came from.
+type RuleKind string
+
+const (
+	KindFirewall RuleKind = "firewall"
+	KindACL      RuleKind = "acl"
+)
+
+// RuleKey identifies a rule across policy updates, so its hit count
+// survives recompiles.
+type RuleKey struct {
+	Kind RuleKind
+	ID   int64
+}
+
+// compiledRule is one rule of a ruleset.
+type compiledRule struct {
+	key     RuleKey
+	verdict verdict
+	hits    *atomic.Uint64
+}
+
+// maxACLPorts bounds the port entries ACL rules may install, the size of the
+// XDP program's acl_ports map.
+const maxACLPorts = 65536
+
+// aclValue packs an ACL rule index and its fast-path action into a cidrset
+// or port-map value. The action is recoverable without the ruleset, so two
+// rulesets' prefixes can be diffed for export.
+func aclValue(rule int, action xdp.ACLAction) uint32 {
+	return uint32(rule)<<2 | uint32(action)
+}
+
+func aclRule(v uint32) int             { return int(v >> 2) }
+func aclAction(v uint32) xdp.ACLAction { return xdp.ACLAction(v & 3) }
+
+// aclPortKey packs a protocol and port into an aclPorts key.
+func aclPortKey(proto uint8, port uint16) uint32 {
+	return uint32(proto)<<16 | uint32(port)
+}
+
+// domainEntry is a content-filter entry for one domain.
+type domainEntry struct {
+	allow    bool
+	priority int
+}
+
+// Ruleset is a compiled, immutable policy. Matching never allocates or
+// locks, so one ruleset is shared by every datapath worker.
+//
+// Matching follows the XDP program: a source-prefix ACL rule (longest prefix
+// first) decides, else a destination-port ACL rule; inspect actions and
+// misses fall through to the classifier, which holds the remaining ACL rules
+// and then the firewall rules in priority order. IP packets nothing decided
+// get the default action.
+type Ruleset struct {
+	generation  uint64
+	rules       []compiledRule
+	cls         classifier        // rules[:cls.n]
+	aclSrc      *cidrset.Set      // aclValue by source prefix
+	aclPorts    map[uint32]uint32 // aclValue by aclPortKey
+	defaultDrop bool
+	domains     map[string]domainEntry
+}
+
+// Generation returns the update count that produced the ruleset.
+func (rs *Ruleset) Generation() uint64 {
+	return rs.generation
+}
+
+// Len returns the number of active rules.
+func (rs *Ruleset) Len() int {
+	return len(rs.rules)
+}
+
+// match returns the verdict for decoded packet v, counting rule hits in
+// hits, which has an entry per rule.
+func (rs *Ruleset) match(v *xdp.PacketView, hits []uint64) verdict {
+	if v.IPVersion != 4 && v.IPVersion != 6 {
+		return verdictNone
+	}
+
+	var acl uint32
+	var ok bool
+	if v.IPVersion == 4 {
+		acl, ok = rs.aclSrc.Lookup4(v.SrcIP4)
+	} else {
+		acl, ok = rs.aclSrc.Lookup6(v.SrcIP6)
+	}
+	if !ok && len(rs.aclPorts) > 0 && v.Has(xdp.LayerL4) &&
+		(v.Protocol == xdp.IPProtoTCP || v.Protocol == xdp.IPProtoUDP) {
+		acl, ok = rs.aclPorts[aclPortKey(v.Protocol, v.DstPort)]
+	}
+	if ok {
+		r := aclRule(acl)
+		hits[r]++
+		if vd := rs.rules[r].verdict; vd != verdictNone {
+			return vd
+		}
+	}
+
+	if r := rs.cls.match(v, hits); r >= 0 {
+		hits[r]++
+		return rs.rules[r].verdict
+	}
+	if rs.defaultDrop {
+		return verdictDrop
+	}
+	return verdictNone
+}
+
+// dropsFlow reports whether rs drops the packets of flow t in its original
+// direction, matching t's addresses, ports and protocol, with hits counted
+// in hits. A flow tuple keeps no VLAN tag, so the flow counts as dropped if
+// its packets are dropped untagged or with a tag from any of the VLAN
+// ranges the classifier tells apart.
+func (rs *Ruleset) dropsFlow(t xdp.FlowTuple, hits []uint64) bool {
+	v := xdp.PacketView{
+		Layers:   xdp.LayerL3,
+		Protocol: t.Proto,
+		SrcPort:  t.SrcPort,
+		DstPort:  t.DstPort,
+	}
+	if src := netip.AddrFrom16(t.Src); src.Is4In6() {
+		v.IPVersion = 4
+		copy(v.SrcIP4[:], t.Src[12:])
+		copy(v.DstIP4[:], t.Dst[12:])
+	} else {
+		v.IPVersion = 6
+		v.SrcIP6, v.DstIP6 = t.Src, t.Dst
+	}
+	if t.Proto == xdp.IPProtoTCP || t.Proto == xdp.IPProtoUDP {
+		v.Layers |= xdp.LayerL4
+	}
+	if rs.match(&v, hits) == verdictDrop {
+		return true
+	}
+
+	// Each interval of the VLAN field matches one set of rules
+	v.NumVLANs = 1
+	for _, start := range rs.cls.vlan.starts {
+		if start > 0x0FFF {
+			break
+		}
+		v.VLANs[0] = uint16(start)
+		if rs.match(&v, hits) == verdictDrop {
+			return true
+		}
+	}
+	return false
+}
+
+// FilterDomain reports whether the content filters block name, and whether
+// any filter entry matched it.
+func (rs *Ruleset) FilterDomain(name string) (blocked, matched bool) {
+	if strings.ContainsAny(name, "ABCDEFGHIJKLMNOPQRSTUVWXYZ*") || strings.HasSuffix(name, ".") {
+		name = normalizeDomain(name)
+	}
+	for {
+		if e, ok := rs.domains[name]; ok {
+			return !e.allow, true
+		}
+		i := strings.IndexByte(name, '.')
+		if i < 0 {
+			return false, false
+		}
+		name = name[i+1:]
+	}
+}
+
+// CounterFunc returns the hit counter of a rule. Compile calls it once per
+// active rule.
+type CounterFunc func(key RuleKey) *atomic.Uint64
+
+// Compile compiles p into a ruleset. Rule errors name the offending rule.
+func Compile(p *Policy, counter CounterFunc) (*Ruleset, error) {
+	if counter == nil {
+		counter = func(RuleKey) *atomic.Uint64 { return new(atomic.Uint64) }
+	}
+
+	rs := &Ruleset{aclPorts: make(map[uint32]uint32), domains: make(map[string]domainEntry)}
+	switch strings.ToLower(p.DefaultAction) {
+	case "", ActionAccept:
+	case ActionDrop, ActionReject:
+		rs.defaultDrop = true
+	default:
+		return nil, fmt.Errorf("%w: default action %q", ErrInvalidRule, p.DefaultAction)
+	}
+
+	// Rules are numbered classifier first; fast-path ACL rules follow
+	var conds []conditions
+	var decisive []bool
+	var fastACL []ACLRule
+
+	acls := sortedByPriority(p.ACLRules, func(r *ACLRule) (int, bool) { return r.Priority, active(r.IsActive) })
+	for _, r := range acls {
+		if r.MatchType == MatchSrcIP || r.MatchType == MatchSrcNet || r.MatchType == MatchDstPort {
+			fastACL = append(fastACL, r)
+			continue
+		}
+		c, vd, err := compileACL(&r)
+		if err != nil {
+			return nil, err
+		}
+		conds, decisive = append(conds, c), append(decisive, vd != verdictNone)
+		rs.rules = append(rs.rules, compiledRule{key: RuleKey{KindACL, r.ID}, verdict: vd})
+	}
+
+	fws := sortedByPriority(p.FirewallRules, func(r *FirewallRule) (int, bool) { return r.Priority, active(r.IsActive) })
+	for _, r := range fws {
+		c, vd, err := compileFirewall(&r)
+		if err != nil {
+			return nil, err
+		}
+		conds, decisive = append(conds, c), append(decisive, vd != verdictNone)
+		rs.rules = append(rs.rules, compiledRule{key: RuleKey{KindFirewall, r.ID}, verdict: vd})
+	}
+	rs.cls = newClassifier(conds, decisive)
+
+	if err := rs.compileFastACL(fastACL); err != nil {
+		return nil, err
+	}
+	rs.compileDomains(p.ContentFilters)
+
+	for i := range rs.rules {
+		rs.rules[i].hits = counter(rs.rules[i].key)
+	}
+	return rs, nil
+}
+
+// sortedByPriority returns the active rules, stable-sorted by priority. An
+// unset priority sorts as the default of 100.
+func sortedByPriority[R any](rules []R, attrs func(*R) (priority int, active bool)) []R {
+	out := make([]R, 0, len(rules))
+	for i := range rules {
+		if _, ok := attrs(&rules[i]); ok {
+			out = append(out, rules[i])
+		}
+	}
+	prio := func(r *R) int {
+		if p, _ := attrs(r); p != 0 {
+			return p
+		}
+		return 100
+	}
+	slices.SortStableFunc(out, func(a, b R) int { return prio(&a) - prio(&b) })
+	return out
+}
+
+func compileFirewall(r *FirewallRule) (conditions, verdict, error) {
+	var c conditions
+	var err error
+	fail := func(format string, args ...any) (conditions, verdict, error) {
+		return c, 0, fmt.Errorf("%w: firewall rule %d (%s): %s", ErrInvalidRule, r.ID, r.Name, fmt.Sprintf(format, args...))
+	}
+
+	if c.src, err = parsePrefixes(r.SourceAddress); err != nil {
+		return fail("source_address: %v", err)
+	}
+	if c.dst, err = parsePrefixes(r.DestAddress); err != nil {
+		return fail("dest_address: %v", err)
+	}
+	if c.srcPorts, err = parseRanges(r.SourcePort, 65535); err != nil {
+		return fail("source_port: %v", err)
+	}
+	if c.dstPorts, err = parseRanges(r.DestPort, 65535); err != nil {
+		return fail("dest_port: %v", err)
+	}
+	proto, ok, err := parseProtocol(r.Protocol)
+	if err != nil {
+		return fail("%v", err)
+	}
+	if ok {
+		c.protos = []uint8{proto}
+	}
+	if (len(c.srcPorts) > 0 || len(c.dstPorts) > 0) && ok && proto != xdp.IPProtoTCP && proto != xdp.IPProtoUDP {
+		return fail("ports need protocol tcp, udp or any")
+	}
+
+	switch strings.ToLower(r.Action) {
+	case "", ActionAccept:
+		return c, verdictPass, nil
+	case ActionDrop, ActionReject:
+		return c, verdictDrop, nil
+	case ActionLog:
+		return c, verdictNone, nil
+	}
+	return fail("unknown action %q", r.Action)
+}
+
+// compileACL compiles an ACL rule the XDP program cannot run itself.
+func compileACL(r *ACLRule) (conditions, verdict, error) {
+	var c conditions
+	vd, _, err := aclVerdict(r)
+	if err != nil {
+		return c, 0, err
+	}
+
+	switch r.MatchType {
+	case MatchDstIP, MatchDstNet:
+		c.dst, err = parsePrefixes(r.MatchValue)
+		if err == nil && len(c.dst) == 0 {
+			err = fmt.Errorf("no address")
+		}
+	case MatchSrcPort:
+		c.srcPorts, err = parseRanges(r.MatchValue, 65535)
+		if err == nil && len(c.srcPorts) == 0 {
+			err = fmt.Errorf("no port")
+		}
+	case MatchProtocol:
+		var proto uint8
+		var ok bool
+		proto, ok, err = parseProtocol(r.MatchValue)
+		if ok {
+			c.protos = []uint8{proto}
+		}
+	case MatchVLAN:
+		c.vlans, err = parseRanges(r.MatchValue, 4095)
+		if err == nil && len(c.vlans) == 0 {
+			err = fmt.Errorf("no VLAN")
+		}
+	default:
+		err = fmt.Errorf("unknown match type %q", r.MatchType)
+	}
+	if err != nil {
+		return c, 0, fmt.Errorf("%w: ACL rule %d (%s): %v", ErrInvalidRule, r.ID, r.Name, err)
+	}
+	return c, vd, nil
+}
+
+// aclVerdict returns an ACL rule's userspace verdict and fast-path action.
+func aclVerdict(r *ACLRule) (verdict, xdp.ACLAction, error) {
+	switch r.Action {
+	case ACLActionPass:
+		return verdictPass, xdp.ACLAllow, nil
+	case ACLActionDrop:
+		return verdictDrop, xdp.ACLDeny, nil
+	case "", ACLActionInspectIPS, ACLActionCaptureArkime, ACLActionInspectAll:
+		return verdictNone, xdp.ACLInspect, nil
+	}
+	return 0, 0, fmt.Errorf("%w: ACL rule %d (%s): unknown action %q", ErrInvalidRule, r.ID, r.Name, r.Action)
+}
+
+// compileFastACL compiles the source-prefix and destination-port ACL rules,
+// which the XDP program runs from its LPM-trie and port maps. Where rules
+// overlap exactly, the one of highest precedence wins, as in priority order.
+func (rs *Ruleset) compileFastACL(rules []ACLRule) error {
+	b := cidrset.NewBuilder(len(rules))
+	// Added in reverse, since the builder keeps the last value of a prefix
+	for k := len(rules) - 1; k >= 0; k-- {
+		r := &rules[k]
+		vd, action, err := aclVerdict(r)
+		if err != nil {
+			return err
+		}
+		idx := len(rs.rules)
+		rs.rules = append(rs.rules, compiledRule{key: RuleKey{KindACL, r.ID}, verdict: vd})
+		value := aclValue(idx, action)
+
+		if r.MatchType == MatchDstPort {
+			ranges, err := parseRanges(r.MatchValue, 65535)
+			if err == nil && len(ranges) == 0 {
+				err = fmt.Errorf("no port")
+			}
+			if err != nil {
+				return fmt.Errorf("%w: ACL rule %d (%s): %v", ErrInvalidRule, r.ID, r.Name, err)
+			}
+			for _, pr := range ranges {
+				for port := pr.lo; port <= pr.hi; port++ {
+					for _, proto := range []uint8{xdp.IPProtoTCP, xdp.IPProtoUDP} {
+						rs.aclPorts[aclPortKey(proto, uint16(port))] = value
+					}
+				}
+			}
+			if len(rs.aclPorts) > maxACLPorts {
+				return fmt.Errorf("%w: ACL port rules need %d map entries, limit %d", ErrInvalidRule, len(rs.aclPorts), maxACLPorts)
+			}
+			continue
+		}
+
+		prefixes, err := parsePrefixes(r.MatchValue)
+		if err == nil && len(prefixes) == 0 {
+			err = fmt.Errorf("no address")
+		}
+		if err != nil {
+			return fmt.Errorf("%w: ACL rule %d (%s): %v", ErrInvalidRule, r.ID, r.Name, err)
+		}
+		if err := b.AddBatch(prefixes, value); err != nil {
+			return err
+		}
+	}
+	rs.aclSrc = b.Build()
+	return nil
+}
+
+// compileDomains merges the content filters' domain lists.
+func (rs *Ruleset) compileDomains(filters []ContentFilter) {
+	add := func(d string, e domainEntry) {
+		d = normalizeDomain(d)
+		if d == "" {
+			return
+		}
+		if old, ok := rs.domains[d]; ok && (old.priority < e.priority || (old.priority == e.priority && old.allow)) {
+			return
+		}
+		rs.domains[d] = e
+	}
+	for i := range filters {
+		f := &filters[i]
+		if !active(f.IsActive) {
+			continue
+		}
+		prio := f.Priority
+		if prio == 0 {
+			prio = 100
+		}
+		for _, d := range f.BlockedDomains {
+			add(d, domainEntry{allow: false, priority: prio})
+		}
+		for _, d := range f.AllowedDomains {
+			add(d, domainEntry{allow: true, priority: prio})
+		}
+	}
+}
+
+// canonicalPrefix stores IPv4-mapped prefixes as IPv4, as the datapath
+// decodes IPv4 packets into IPv4 addresses.
+func canonicalPrefix(p netip.Prefix) netip.Prefix {
+	if a := p.Addr(); a.Is4In6() && p.Bits() >= 96 {
+		return netip.PrefixFrom(a.Unmap(), p.Bits()-96)
+	}
+	return p
+}
@@ -0,0 +1,111 @@
+package policy
+
+import (
+	"math/bits"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// hitFlushBatches is how many batches a stage counts hits locally before
+// adding them to the shared counters.
+const hitFlushBatches = 256
+
+// Stage applies the live ruleset to every decoded frame of a batch. Each
+// batch is matched against one ruleset, loaded when the batch starts, so an
+// update never splits a batch. It must run after xdp.DecodeStage; with
+// conntrack it runs as the conntrack stage's classifier, so established flows
+// and replies to tracked flows skip it and only flows it accepts are tracked.
+type Stage struct {
+	store   *Store
+	slot    *readerSlot
+	rs      *Ruleset // Ruleset hits counts against
+	hits    []uint64
+	batches int
+	held    bool // In a section begun by EnterSection
+	// uncounted stages discard their hits rather than flush them
+	uncounted bool
+}
+
+// NewStage creates a policy stage. A stage belongs to one pipeline.
+func (s *Store) NewStage() *Stage {
+	return &Stage{store: s, slot: s.grace.register()}
+}
+
+// NewUncountedStage creates a policy stage whose hits are not added to the
+// rule counters, for frames that did not arrive on the interface (such as
+// bulk ingest), so Hits keeps reporting live traffic only.
+func (s *Store) NewUncountedStage() *Stage {
+	st := s.NewStage()
+	st.uncounted = true
+	return st
+}
+
+// Name returns the stage name.
+func (s *Stage) Name() string { return "policy" }
+
+// Process passes or drops the active frames a rule decides.
+func (s *Stage) Process(b *xdp.Batch, v *xdp.Verdicts) {
+	g := s.store.grace
+	if !s.held {
+		g.enter(s.slot)
+	}
+	rs := s.store.current.Load()
+	if rs != s.rs {
+		s.flush()
+		s.rs = rs
+		s.hits = append(s.hits[:0], make([]uint64, len(rs.rules))...)
+	}
+
+	for m := b.Active; m != 0; m &= m - 1 {
+		i := bits.TrailingZeros64(m)
+		switch rs.match(&b.Views[i], s.hits) {
+		case verdictPass:
+			v.Pass |= uint64(1) << uint(i)
+		case verdictDrop:
+			v.Drop |= uint64(1) << uint(i)
+		}
+	}
+	if !s.held {
+		g.exit(s.slot)
+	}
+
+	if s.batches++; s.batches >= hitFlushBatches {
+		s.flush()
+	}
+}
+
+// EnterSection starts a read-side section that lasts past Process, until
+// ExitSection: an update waiting out the datapath also waits for what the
+// caller does with the verdicts, such as tracking the flows accepted.
+func (s *Stage) EnterSection() {
+	s.store.grace.enter(s.slot)
+	s.held = true
+}
+
+// ExitSection ends the section begun by EnterSection.
+func (s *Stage) ExitSection() {
+	s.held = false
+	s.store.grace.exit(s.slot)
+}
+
+// flush adds the local hit counts to the ruleset's counters.
+func (s *Stage) flush() {
+	s.batches = 0
+	if s.rs == nil {
+		return
+	}
+	for i, n := range s.hits {
+		if n != 0 {
+			if !s.uncounted {
+				s.rs.rules[i].hits.Add(n)
+			}
+			s.hits[i] = 0
+		}
+	}
+}
+
+// Close flushes the stage's hit counts and detaches it from the store.
+func (s *Stage) Close() {
+	s.flush()
+	s.store.grace.unregister(s.slot)
+}
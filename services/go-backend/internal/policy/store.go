@@ -0,0 +1,288 @@
+package policy
+
+import (
+	"context"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/cidrset"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// Mirror receives the ACL rules the XDP program runs itself.
+// *xdp.XDPProgram implements it.
+type Mirror interface {
+	cidrset.ACLWriter
+	SetPortAction(proto uint8, port uint16, action xdp.ACLAction) error
+	RemovePortAction(proto uint8, port uint16) error
+}
+
+// Flows is the connection tracking table, whose established flows skip the
+// policy and are offloaded ahead of the XDP ACLs. *conntrack.Table
+// implements it.
+type Flows interface {
+	Evict(drop func(xdp.FlowTuple) bool) int
+}
+
+// StoreConfig configures a Store.
+type StoreConfig struct {
+	Path   string // Policy file, loaded at start and rewritten on update; empty keeps it in memory
+	Mirror Mirror // XDP program to mirror ACL rules into; nil disables mirroring
+	Flows  Flows  // Flows to re-check after an update; nil if conntrack is off
+}
+
+// graceTimeout bounds the wait for the datapath after an update. A batch
+// takes microseconds, so only a stuck worker reaches it.
+const graceTimeout = 5 * time.Second
+
+// UpdateResult describes an applied update.
+type UpdateResult struct {
+	Generation uint64
+	Rules      int           // Active rules
+	Compile    time.Duration // Compiling the policy
+	Swap       time.Duration // Publishing it and waiting out the grace period
+	Mirror     time.Duration // Writing the XDP maps
+	Written    int           // Map entries written
+	Removed    int           // Map entries removed
+	Evicted    int           // Tracked flows the new rules drop
+}
+
+// Store holds the live ruleset. Updates are serialized; the datapath reads
+// the current ruleset through Stage without locking.
+type Store struct {
+	config  StoreConfig
+	current atomic.Pointer[Ruleset]
+	grace   *grace
+
+	mu       sync.Mutex // Serializes updates; guards the fields below
+	policy   Policy
+	counters map[RuleKey]*atomic.Uint64
+	exported *Ruleset // Last ruleset fully mirrored, nil before the first
+}
+
+// NewStore creates a store, loading the policy file if it exists. An empty
+// store accepts everything.
+func NewStore(config StoreConfig) (*Store, error) {
+	s := &Store{
+		config:   config,
+		grace:    newGrace(),
+		counters: make(map[RuleKey]*atomic.Uint64),
+	}
+
+	var p Policy
+	if config.Path != "" {
+		data, err := os.ReadFile(config.Path)
+		switch {
+		case errors.Is(err, os.ErrNotExist):
+		case err != nil:
+			return nil, fmt.Errorf("failed to read policy: %w", err)
+		default:
+			if err := json.Unmarshal(data, &p); err != nil {
+				return nil, fmt.Errorf("failed to parse policy %s: %w", config.Path, err)
+			}
+		}
+	}
+
+	rs, err := Compile(&p, s.counter)
+	if err != nil {
+		return nil, err
+	}
+	s.policy = p
+	s.current.Store(rs)
+	if err := s.mirror(rs, nil); err != nil {
+		return nil, err
+	}
+	return s, nil
+}
+
+// counter returns the stable hit counter of a rule; s.mu must be held.
+func (s *Store) counter(key RuleKey) *atomic.Uint64 {
+	c, ok := s.counters[key]
+	if !ok {
+		c = new(atomic.Uint64)
+		s.counters[key] = c
+	}
+	return c
+}
+
+// Update compiles p and makes it the live policy. When it returns, no
+// datapath worker still matches against the previous rules, tracked flows
+// the new rules drop are evicted and the XDP maps hold the new ACL rules.
+// A policy that does not compile leaves the live one in place; once it is
+// swapped in, ctx no longer cancels the update.
+func (s *Store) Update(ctx context.Context, p Policy) (UpdateResult, error) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	var res UpdateResult
+	start := time.Now()
+	rs, err := Compile(&p, s.counter)
+	if err != nil {
+		return res, err
+	}
+	prev := s.current.Load()
+	rs.generation = prev.generation + 1
+	res.Generation, res.Rules = rs.generation, rs.Len()
+	res.Compile = time.Since(start)
+
+	start = time.Now()
+	s.current.Store(rs)
+	s.policy = p
+	s.pruneCounters(rs)
+	// The new rules are live, so the flows, maps and file must follow
+	// them even if the caller goes away
+	wctx, cancel := context.WithTimeout(context.WithoutCancel(ctx), graceTimeout)
+	waitErr := s.grace.synchronize(wctx)
+	cancel()
+	res.Swap = time.Since(start)
+
+	if s.config.Flows != nil {
+		hits := make([]uint64, len(rs.rules))
+		res.Evicted = s.config.Flows.Evict(func(t xdp.FlowTuple) bool {
+			return rs.dropsFlow(t, hits)
+		})
+	}
+
+	start = time.Now()
+	var st cidrset.ExportStats
+	if err := s.mirror(rs, &st); err != nil {
+		return res, err
+	}
+	res.Mirror = time.Since(start)
+	res.Written, res.Removed = st.Written, st.Removed
+
+	if err := s.save(&p); err != nil {
+		return res, err
+	}
+	if waitErr != nil {
+		return res, fmt.Errorf("waiting for datapath: %w", waitErr)
+	}
+	return res, nil
+}
+
+// pruneCounters drops the counters of rules rs no longer has.
+func (s *Store) pruneCounters(rs *Ruleset) {
+	live := make(map[RuleKey]struct{}, len(rs.rules))
+	for i := range rs.rules {
+		live[rs.rules[i].key] = struct{}{}
+	}
+	for k := range s.counters {
+		if _, ok := live[k]; !ok {
+			delete(s.counters, k)
+		}
+	}
+}
+
+// mirror writes the difference between the last mirrored ruleset and rs to
+// the XDP maps. On failure the maps hold a mix of both; the next update
+// diffs against the last ruleset mirrored in full.
+func (s *Store) mirror(rs *Ruleset, st *cidrset.ExportStats) error {
+	m := s.config.Mirror
+	if m == nil {
+		return nil
+	}
+
+	var prevSrc *cidrset.Set
+	var prevPorts map[uint32]uint32
+	if s.exported != nil {
+		prevSrc, prevPorts = s.exported.aclSrc, s.exported.aclPorts
+	}
+
+	exp, err := cidrset.ExportACL(m, prevSrc, rs.aclSrc, func(v uint32) (xdp.ACLAction, bool) {
+		return aclAction(v), true
+	})
+	if err != nil {
+		return fmt.Errorf("failed to mirror ACL prefixes: %w", err)
+	}
+
+	for k, v := range rs.aclPorts {
+		if old, ok := prevPorts[k]; ok && aclAction(old) == aclAction(v) {
+			continue
+		}
+		if err := m.SetPortAction(uint8(k>>16), uint16(k), aclAction(v)); err != nil {
+			return fmt.Errorf("failed to mirror ACL port: %w", err)
+		}
+		exp.Written++
+	}
+	for k := range prevPorts {
+		if _, ok := rs.aclPorts[k]; ok {
+			continue
+		}
+		if err := m.RemovePortAction(uint8(k>>16), uint16(k)); err != nil {
+			return fmt.Errorf("failed to remove ACL port: %w", err)
+		}
+		exp.Removed++
+	}
+
+	s.exported = rs
+	if st != nil {
+		*st = exp
+	}
+	return nil
+}
+
+// save writes p to the policy file through a temporary file, so a crash
+// leaves the old or the new policy.
+func (s *Store) save(p *Policy) error {
+	if s.config.Path == "" {
+		return nil
+	}
+	data, err := json.MarshalIndent(p, "", "  ")
+	if err != nil {
+		return err
+	}
+
+	f, err := os.CreateTemp(filepath.Dir(s.config.Path), ".policy-*")
+	if err != nil {
+		return fmt.Errorf("failed to save policy: %w", err)
+	}
+	defer os.Remove(f.Name())
+	if _, err := f.Write(data); err != nil {
+		f.Close()
+		return fmt.Errorf("failed to save policy: %w", err)
+	}
+	if err := f.Close(); err != nil {
+		return fmt.Errorf("failed to save policy: %w", err)
+	}
+	if err := os.Rename(f.Name(), s.config.Path); err != nil {
+		return fmt.Errorf("failed to save policy: %w", err)
+	}
+	return nil
+}
+
+// Policy returns the live policy document and its generation.
+func (s *Store) Policy() (Policy, uint64) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.policy, s.current.Load().generation
+}
+
+// Current returns the live ruleset.
+func (s *Store) Current() *Ruleset {
+	return s.current.Load()
+}
+
+// RuleHits is the hit count of one rule.
+type RuleHits struct {
+	Kind RuleKind `json:"kind"`
+	ID   int64    `json:"id"`
+	Hits uint64   `json:"hits"`
+}
+
+// Hits returns the hit counts of the live rules, in match order. Workers
+// flush their counts periodically, so the counts trail the datapath.
+func (s *Store) Hits() []RuleHits {
+	rs := s.current.Load()
+	out := make([]RuleHits, len(rs.rules))
+	for i := range rs.rules {
+		r := &rs.rules[i]
+		out[i] = RuleHits{Kind: r.key.Kind, ID: r.key.ID, Hits: r.hits.Load()}
+	}
+	return out
+}
@@ -0,0 +1,142 @@
+package server
+
+import (
+	"bufio"
+	"io"
+	"math/rand"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// Access log limits
+const (
+	accessLogQueue = 4096                   // Lines waiting for the writer
+	accessLogFlush = 100 * time.Millisecond // Longest a written line stays buffered
+)
+
+// accessLog writes request lines in gin's logger format from a background
+// goroutine, so a request only copies a few fields into a queue. One in
+// sample requests is logged, and every server error; lines are dropped,
+// and counted, while the writer is behind.
+type accessLog struct {
+	sample  uint32
+	entries chan accessEntry
+	dropped atomic.Uint64
+
+	w    *bufio.Writer
+	buf  []byte
+	stop chan struct{}
+	wg   sync.WaitGroup
+}
+
+type accessEntry struct {
+	time    time.Time
+	latency time.Duration
+	status  int
+	method  string
+	path    string
+	client  string
+}
+
+// newAccessLog starts an access log writing to w, or returns nil if sample
+// is not positive.
+func newAccessLog(w io.Writer, sample int) *accessLog {
+	if sample <= 0 {
+		return nil
+	}
+	l := &accessLog{
+		sample:  uint32(sample),
+		entries: make(chan accessEntry, accessLogQueue),
+		w:       bufio.NewWriterSize(w, 64<<10),
+		stop:    make(chan struct{}),
+	}
+	l.wg.Add(1)
+	go l.run()
+	return l
+}
+
+// sampled reports whether a request with status is logged.
+func (l *accessLog) sampled(status int) bool {
+	return status >= 500 || l.sample == 1 || rand.Uint32()%l.sample == 0
+}
+
+// log queues a line without blocking.
+func (l *accessLog) log(e accessEntry) {
+	select {
+	case l.entries <- e:
+	default:
+		l.dropped.Add(1)
+	}
+}
+
+// Close writes the queued lines and stops the writer.
+func (l *accessLog) Close() {
+	close(l.stop)
+	l.wg.Wait()
+}
+
+func (l *accessLog) run() {
+	defer l.wg.Done()
+	ticker := time.NewTicker(accessLogFlush)
+	defer ticker.Stop()
+	for {
+		select {
+		case e := <-l.entries:
+			l.write(&e)
+		case <-ticker.C:
+			l.flush()
+		case <-l.stop:
+			for {
+				select {
+				case e := <-l.entries:
+					l.write(&e)
+				default:
+					l.flush()
+					return
+				}
+			}
+		}
+	}
+}
+
+func (l *accessLog) flush() {
+	if n := l.dropped.Swap(0); n > 0 {
+		b := append(l.buf[:0], "[GIN] "...)
+		b = time.Now().AppendFormat(b, "2006/01/02 - 15:04:05")
+		b = append(b, " | dropped "...)
+		b = strconv.AppendUint(b, n, 10)
+		b = append(b, " access log lines\n"...)
+		l.buf = b
+		l.w.Write(b)
+	}
+	l.w.Flush()
+}
+
+// write formats a line as gin.LoggerWithConfig's default formatter does.
+func (l *accessLog) write(e *accessEntry) {
+	b := append(l.buf[:0], "[GIN] "...)
+	b = e.time.AppendFormat(b, "2006/01/02 - 15:04:05")
+	b = append(b, " | "...)
+	b = strconv.AppendInt(b, int64(e.status), 10)
+	b = append(b, " | "...)
+	b = appendPadded(b, e.latency.String(), 13)
+	b = append(b, " | "...)
+	b = appendPadded(b, e.client, 15)
+	b = append(b, " | "...)
+	b = append(b, e.method...)
+	b = append(b, ` "`...)
+	b = append(b, e.path...)
+	b = append(b, "\"\n"...)
+	l.buf = b
+	l.w.Write(b)
+}
+
+// appendPadded right-aligns s in width columns.
+func appendPadded(b []byte, s string, width int) []byte {
+	for i := len(s); i < width; i++ {
+		b = append(b, ' ')
+	}
+	return append(b, s...)
+}
@@ -0,0 +1,113 @@
+package server
+
+import (
+	"crypto/hmac"
+	"crypto/sha256"
+	"encoding/base64"
+	"encoding/json"
+	"net/http"
+	"strings"
+	"time"
+
+	"github.com/gin-gonic/gin"
+)
+
+// roleAdmin is the role allowed to change the datapath.
+const roleAdmin = "admin"
+
+// tokenAuth verifies the HS256 access tokens issued by the Flask backend
+// (app/auth.py create_access_token), using the JWT_SECRET_KEY both share.
+// The WebUI forwards the browser's bearer token on /api/go, so the same
+// login works here. A role is trusted for the token's lifetime.
+type tokenAuth struct {
+	secret []byte
+	now    func() time.Time
+}
+
+// accessClaims are the claims of an access token.
+type accessClaims struct {
+	Subject string `json:"sub"`
+	Role    string `json:"role"`
+	Type    string `json:"type"`
+	Expires int64  `json:"exp"`
+}
+
+func newTokenAuth(secret string) *tokenAuth {
+	return &tokenAuth{secret: []byte(secret), now: time.Now}
+}
+
+// check returns the claims of r's bearer token if it carries role. Otherwise
+// it returns the status and message to refuse r with.
+func (a *tokenAuth) check(r *http.Request, role string) (accessClaims, int, string) {
+	if len(a.secret) == 0 {
+		return accessClaims{}, http.StatusServiceUnavailable, "Authentication not configured"
+	}
+
+	token, ok := strings.CutPrefix(r.Header.Get("Authorization"), "Bearer ")
+	if !ok || token == "" {
+		return accessClaims{}, http.StatusUnauthorized, "Missing authorization token"
+	}
+
+	claims, ok := a.verify(token)
+	if !ok || claims.Expires <= a.now().Unix() {
+		return accessClaims{}, http.StatusUnauthorized, "Invalid or expired token"
+	}
+	if claims.Type != "access" {
+		return accessClaims{}, http.StatusUnauthorized, "Invalid token type"
+	}
+	if claims.Subject == "" {
+		return accessClaims{}, http.StatusUnauthorized, "Invalid token payload"
+	}
+	if claims.Role != role {
+		return accessClaims{}, http.StatusForbidden, "Insufficient permissions"
+	}
+	return claims, 0, ""
+}
+
+// verify checks token's HS256 signature and decodes its claims.
+func (a *tokenAuth) verify(token string) (accessClaims, bool) {
+	var claims accessClaims
+	parts := strings.Split(token, ".")
+	if len(parts) != 3 {
+		return claims, false
+	}
+
+	var header struct {
+		Alg string `json:"alg"`
+	}
+	if !decodeSegment(parts[0], &header) || header.Alg != "HS256" {
+		return claims, false
+	}
+
+	sig, err := base64.RawURLEncoding.DecodeString(parts[2])
+	if err != nil {
+		return claims, false
+	}
+	mac := hmac.New(sha256.New, a.secret)
+	mac.Write([]byte(parts[0]))
+	mac.Write([]byte{'.'})
+	mac.Write([]byte(parts[1]))
+	if !hmac.Equal(sig, mac.Sum(nil)) {
+		return claims, false
+	}
+
+	return claims, decodeSegment(parts[1], &claims)
+}
+
+func decodeSegment(seg string, v any) bool {
+	data, err := base64.RawURLEncoding.DecodeString(seg)
+	return err == nil && json.Unmarshal(data, v) == nil
+}
+
+// require returns middleware refusing requests without a token of role.
+func (a *tokenAuth) require(role string) gin.HandlerFunc {
+	return func(c *gin.Context) {
+		claims, status, msg := a.check(c.Request, role)
+		if status != 0 {
+			c.AbortWithStatusJSON(status, gin.H{"error": msg})
+			return
+		}
+		c.Set("principal", claims.Subject)
+		c.Next()
+	}
+}
@@ -0,0 +1,73 @@
+package server
+
+import (
+	"crypto/hmac"
+	"crypto/sha256"
+	"encoding/base64"
+	"encoding/json"
+	"net/http"
+	"net/http/httptest"
+	"testing"
+	"time"
+)
+
+func signToken(secret, alg string, claims map[string]any) string {
+	enc := func(v any) string {
+		data, _ := json.Marshal(v)
+		return base64.RawURLEncoding.EncodeToString(data)
+	}
+	signed := enc(map[string]string{"alg": alg, "typ": "JWT"}) + "." + enc(claims)
+	mac := hmac.New(sha256.New, []byte(secret))
+	mac.Write([]byte(signed))
+	return signed + "." + base64.RawURLEncoding.EncodeToString(mac.Sum(nil))
+}
+
+// TestTokenAuth checks the refusals of policy mutations: 401 without a
+// valid access token, 403 for a role other than admin.
+func TestTokenAuth(t *testing.T) {
+	now := time.Unix(1_700_000_000, 0)
+	auth := newTokenAuth("secret")
+	auth.now = func() time.Time { return now }
+
+	claims := func(role, typ string, exp time.Time) map[string]any {
+		return map[string]any{"sub": "7", "role": role, "type": typ, "exp": exp.Unix()}
+	}
+	valid := now.Add(time.Minute)
+
+	cases := []struct {
+		name   string
+		header string
+		status int
+	}{
+		{"no header", "", http.StatusUnauthorized},
+		{"not bearer", "Basic YWRtaW46YWRtaW4=", http.StatusUnauthorized},
+		{"malformed", "Bearer abc.def", http.StatusUnauthorized},
+		{"wrong secret", "Bearer " + signToken("other", "HS256", claims("admin", "access", valid)), http.StatusUnauthorized},
+		{"alg none", "Bearer " + signToken("secret", "none", claims("admin", "access", valid)), http.StatusUnauthorized},
+		{"expired", "Bearer " + signToken("secret", "HS256", claims("admin", "access", now)), http.StatusUnauthorized},
+		{"refresh token", "Bearer " + signToken("secret", "HS256", claims("admin", "refresh", valid)), http.StatusUnauthorized},
+		{"viewer", "Bearer " + signToken("secret", "HS256", claims("viewer", "access", valid)), http.StatusForbidden},
+		{"maintainer", "Bearer " + signToken("secret", "HS256", claims("maintainer", "access", valid)), http.StatusForbidden},
+		{"admin", "Bearer " + signToken("secret", "HS256", claims("admin", "access", valid)), 0},
+	}
+	for _, tc := range cases {
+		r := httptest.NewRequest(http.MethodPut, "/api/v1/policy", nil)
+		if tc.header != "" {
+			r.Header.Set("Authorization", tc.header)
+		}
+		got, status, msg := auth.check(r, roleAdmin)
+		if status != tc.status {
+			t.Errorf("%s: expected status %d, got %d (%s)", tc.name, tc.status, status, msg)
+		}
+		if status == 0 && got.Subject != "7" {
+			t.Errorf("%s: expected subject 7, got %q", tc.name, got.Subject)
+		}
+	}
+
+	// Without a secret nothing is accepted
+	r := httptest.NewRequest(http.MethodPut, "/api/v1/policy", nil)
+	r.Header.Set("Authorization", "Bearer "+signToken("", "HS256", claims("admin", "access", valid)))
+	if _, status, _ := newTokenAuth("").check(r, roleAdmin); status != http.StatusServiceUnavailable {
+		t.Errorf("expected 503 without a secret, got %d", status)
+	}
+}
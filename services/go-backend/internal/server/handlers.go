@@ -2,13 +2,23 @@
 package server
 
 import (
+	"bufio"
+	"errors"
+	"fmt"
+	"io"
 	"net/http"
 	"runtime"
+	"strconv"
+	"sync"
 	"time"
 
 	"github.com/gin-gonic/gin"
 
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/capture"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/ingest"
 	"github.com/penguintechinc/cerberus/services/go-backend/internal/memory"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/policy"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/telemetry"
 	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
 )
 
@@ -20,25 +30,25 @@ type HealthResponse struct {
 
 // StatusResponse is the response for the status endpoint.
 type StatusResponse struct {
-	Status      string            `json:"status"`
-	Service     string            `json:"service"`
-	Version     string            `json:"version"`
-	Timestamp   string            `json:"timestamp"`
-	Uptime      string            `json:"uptime"`
-	GoVersion   string            `json:"go_version"`
-	NumCPU      int               `json:"num_cpu"`
-	NumGoroutine int              `json:"num_goroutine"`
-	NUMA        *NUMAStatus       `json:"numa,omitempty"`
-	XDP         *XDPStatus        `json:"xdp,omitempty"`
-	MemoryPool  *MemoryPoolStatus `json:"memory_pool,omitempty"`
+	Status       string            `json:"status"`
+	Service      string            `json:"service"`
+	Version      string            `json:"version"`
+	Timestamp    string            `json:"timestamp"`
+	Uptime       string            `json:"uptime"`
+	GoVersion    string            `json:"go_version"`
+	NumCPU       int               `json:"num_cpu"`
+	NumGoroutine int               `json:"num_goroutine"`
+	NUMA         *NUMAStatus       `json:"numa,omitempty"`
+	XDP          *XDPStatus        `json:"xdp,omitempty"`
+	MemoryPool   *MemoryPoolStatus `json:"memory_pool,omitempty"`
 }
 
 // NUMAStatus represents NUMA topology status.
 type NUMAStatus struct {
-	Available   bool           `json:"available"`
-	NodeCount   int            `json:"node_count"`
-	CurrentNode int            `json:"current_node"`
-	MemoryMB    map[int]int64  `json:"memory_mb,omitempty"`
+	Available   bool          `json:"available"`
+	NodeCount   int           `json:"node_count"`
+	CurrentNode int           `json:"current_node"`
+	MemoryMB    map[int]int64 `json:"memory_mb,omitempty"`
 }
 
 // XDPStatus represents XDP availability status.
@@ -50,30 +60,41 @@ type XDPStatus struct {
 
 // MemoryPoolStatus represents memory pool status.
 type MemoryPoolStatus struct {
-	TotalSlots  int    `json:"total_slots"`
-	UsedSlots   int    `json:"used_slots"`
-	FreeSlots   int    `json:"free_slots"`
-	SlotSize    int    `json:"slot_size"`
-	TotalMemory int    `json:"total_memory_bytes"`
-	PeakUsage   int32  `json:"peak_usage"`
+	TotalSlots  int   `json:"total_slots"`
+	UsedSlots   int   `json:"used_slots"`
+	FreeSlots   int   `json:"free_slots"`
+	SlotSize    int   `json:"slot_size"`
+	TotalMemory int   `json:"total_memory_bytes"`
+	PeakUsage   int32 `json:"peak_usage"`
+	Nodes       []int `json:"nodes,omitempty"` // NUMA nodes with a pool
 }
 
 // Handlers holds all HTTP handlers and their dependencies.
 type Handlers struct {
-	startTime   time.Time
-	version     string
-	memoryPool  *memory.MemoryPool
-	xdpEnabled  bool
-	xdpMode     string
-	xdpIface    string
+	startTime  time.Time
+	version    string
+	pools      *memory.NodePools
+	xdpEnabled bool
+	xdpMode    string
+	xdpIface   string
+	engine     *xdp.Engine   // Set once the datapath starts
+	policy     *policy.Store // Set if the policy store loaded
+	capture    *capture.Hub  // Set once the datapath starts
+
+	ingest       ingest.PipelineFactory // Set if bulk ingest is served
+	ingestCaches chan *memory.PoolCache // One per allowed stream
+	telemetry    *telemetry.Hub         // Set once the datapath starts
+
+	numaOnce sync.Once // NUMA topology is read from sysfs once
+	numaInfo memory.NUMAInfo
 }
 
 // NewHandlers creates a new Handlers instance.
-func NewHandlers(version string, memPool *memory.MemoryPool, xdpEnabled bool, xdpMode, xdpIface string) *Handlers {
+func NewHandlers(version string, pools *memory.NodePools, xdpEnabled bool, xdpMode, xdpIface string) *Handlers {
 	return &Handlers{
 		startTime:  time.Now(),
 		version:    version,
-		memoryPool: memPool,
+		pools:      pools,
 		xdpEnabled: xdpEnabled,
 		xdpMode:    xdpMode,
 		xdpIface:   xdpIface,
@@ -98,7 +119,8 @@ func (h *Handlers) ReadinessCheck(c *gin.Context) {
 
 // Status handles GET /api/v1/status
 func (h *Handlers) Status(c *gin.Context) {
-	numaInfo := memory.GetNUMAInfo()
+	h.numaOnce.Do(func() { h.numaInfo = memory.GetNUMAInfo() })
+	numaInfo := h.numaInfo
 
 	response := StatusResponse{
 		Status:       "running",
@@ -122,8 +144,8 @@ func (h *Handlers) Status(c *gin.Context) {
 		},
 	}
 
-	if h.memoryPool != nil {
-		stats := h.memoryPool.Stats()
+	if h.pools != nil {
+		stats := h.pools.Stats()
 		response.MemoryPool = &MemoryPoolStatus{
 			TotalSlots:  stats.TotalSlots,
 			UsedSlots:   stats.UsedSlots,
@@ -131,6 +153,7 @@ func (h *Handlers) Status(c *gin.Context) {
 			SlotSize:    stats.SlotSize,
 			TotalMemory: stats.TotalMemory,
 			PeakUsage:   stats.PeakUsage,
+			Nodes:       h.pools.Nodes(),
 		}
 	}
 
@@ -147,17 +170,19 @@ func (h *Handlers) Hello(c *gin.Context) {
 }
 
 // PacketForward handles POST /api/v1/packet/forward
-// This is an example endpoint demonstrating memory pool usage.
+// This is an example endpoint demonstrating memory pool usage; injectors
+// sending traffic in bulk use PacketIngest.
 func (h *Handlers) PacketForward(c *gin.Context) {
-	if h.memoryPool == nil {
+	if h.pools == nil {
 		c.JSON(http.StatusServiceUnavailable, gin.H{
 			"error": "Memory pool not initialized",
 		})
 		return
 	}
 
-	// Acquire a buffer from the pool
-	slotIdx, buffer, err := h.memoryPool.Acquire()
+	// Acquire a buffer from the pool on this thread's NUMA node
+	pool := h.pools.Local()
+	slotIdx, buffer, err := pool.Acquire()
 	if err != nil {
 		c.JSON(http.StatusServiceUnavailable, gin.H{
 			"error": "Memory pool exhausted",
@@ -170,7 +195,7 @@ func (h *Handlers) PacketForward(c *gin.Context) {
 	_ = buffer
 
 	// Release the buffer back to the pool
-	if err := h.memoryPool.Release(slotIdx); err != nil {
+	if err := pool.Release(slotIdx); err != nil {
 		c.JSON(http.StatusInternalServerError, gin.H{
 			"error": "Failed to release buffer",
 		})
@@ -184,33 +209,447 @@ func (h *Handlers) PacketForward(c *gin.Context) {
 	})
 }
 
+// Bulk ingest limits
+const (
+	ingestMaxStreams = 8
+	ingestIdle       = 30 * time.Second // Longest wait on either direction
+)
+
+// PacketIngest handles POST /api/v1/packet/ingest
+// The body is a stream of length-prefixed frames and the response a
+// stream of one verdict byte per frame (see package ingest), exchanged
+// on one long-lived connection. The stream ends at the end of the body
+// or the first bad frame; the X-Ingest-Frames and X-Ingest-Error
+// trailers report how far it got.
+func (h *Handlers) PacketIngest(c *gin.Context) {
+	if h.pools == nil || h.ingest == nil {
+		c.JSON(http.StatusServiceUnavailable, gin.H{
+			"error": "Packet ingest not available",
+		})
+		return
+	}
+	if ct := c.ContentType(); ct != ingest.ContentType {
+		c.JSON(http.StatusUnsupportedMediaType, gin.H{
+			"error": fmt.Sprintf("Content-Type must be %s", ingest.ContentType),
+		})
+		return
+	}
+
+	var cache *memory.PoolCache
+	select {
+	case cache = <-h.ingestCaches:
+		defer func() { h.ingestCaches <- cache }()
+	default:
+		c.JSON(http.StatusTooManyRequests, gin.H{
+			"error": "Too many ingest streams",
+		})
+		return
+	}
+	pipeline, release := h.ingest()
+	defer release()
+
+	// Verdicts go out while the body is still arriving, and the stream
+	// outlives the server's timeouts as long as neither side stalls
+	rc := http.NewResponseController(c.Writer)
+	_ = rc.EnableFullDuplex()
+	_ = rc.SetWriteDeadline(time.Now().Add(ingestIdle))
+	body := &idleReader{r: c.Request.Body, rc: rc}
+
+	c.Header("Content-Type", ingest.VerdictContentType)
+	c.Header("Trailer", "X-Ingest-Frames, X-Ingest-Error")
+	c.Status(http.StatusOK)
+
+	flush := func() error {
+		if err := rc.SetWriteDeadline(time.Now().Add(ingestIdle)); err != nil {
+			return err
+		}
+		return rc.Flush()
+	}
+	st, err := ingest.Serve(body, c.Writer, flush, ingest.Config{
+		Cache:    cache,
+		SlotSize: h.pools.Local().SlotSize(),
+		Pipeline: pipeline,
+	})
+	c.Writer.Header().Set("X-Ingest-Frames", strconv.FormatUint(st.Frames, 10))
+	if err != nil {
+		c.Writer.Header().Set("X-Ingest-Error", err.Error())
+	}
+}
+
+// idleReader extends the read deadline before each read of the body.
+type idleReader struct {
+	r  io.Reader
+	rc *http.ResponseController
+}
+
+func (r *idleReader) Read(p []byte) (int, error) {
+	_ = r.rc.SetReadDeadline(time.Now().Add(ingestIdle))
+	return r.r.Read(p)
+}
+
+// TelemetryStream handles GET /api/v1/telemetry/stream
+// It streams datapath telemetry as server-sent events: a "full" event with
+// every counter, then a "delta" event per tick with what changed (see
+// package telemetry).
+func (h *Handlers) TelemetryStream(c *gin.Context) {
+	if h.telemetry == nil {
+		c.JSON(http.StatusServiceUnavailable, gin.H{
+			"error": "Telemetry not available",
+		})
+		return
+	}
+	sub, err := h.telemetry.Subscribe()
+	if err != nil {
+		c.JSON(http.StatusTooManyRequests, gin.H{
+			"error": err.Error(),
+		})
+		return
+	}
+	defer h.telemetry.Unsubscribe(sub)
+
+	c.Header("Content-Type", "text/event-stream")
+	c.Header("Cache-Control", "no-cache")
+	c.Header("X-Accel-Buffering", "no")
+	c.Status(http.StatusOK)
+
+	rc := http.NewResponseController(c.Writer)
+	_ = rc.Flush()
+	for {
+		select {
+		case <-c.Request.Context().Done():
+			return
+		case frame, ok := <-sub.C:
+			if !ok {
+				return
+			}
+			// The stream outlives the server's write timeout
+			_ = rc.SetWriteDeadline(time.Now().Add(telemetryWriteTimeout))
+			if _, err := c.Writer.Write(frame); err != nil {
+				return
+			}
+			if err := rc.Flush(); err != nil {
+				return
+			}
+		}
+	}
+}
+
+// telemetryWriteTimeout bounds one telemetry event write.
+const telemetryWriteTimeout = 10 * time.Second
+
+// Live capture limits
+const (
+	captureTick           = 10 * time.Millisecond
+	captureDefaultSeconds = 10
+	captureMaxSeconds     = 300
+	captureDefaultRate    = 1000 // Packets per second
+	captureMaxRate        = 20000
+	// captureDefaultSnaplen keeps the Ethernet, IP and transport headers
+	// but not the payload; snaplen=0 asks for whole frames
+	captureDefaultSnaplen = 128
+)
+
+// PacketCapture handles GET /api/v1/packet/capture
+// Streams datapath frames as pcapng, e.g. `curl -o x.pcapng` or piped to
+// `wireshark -k -i -`. Query: filter (pcap-filter subset), sample (1 in N),
+// snaplen (default 128, 0 for whole frames), count (stop after N
+// packets), seconds and rate (packets per second). Requires an admin
+// token, as frames carry payloads of other users' traffic. Frames over the rate wait in the capture ring and are dropped
+// once it fills; the closing statistics block counts them.
+func (h *Handlers) PacketCapture(c *gin.Context) {
+	if h.capture == nil {
+		c.JSON(http.StatusServiceUnavailable, gin.H{
+			"error": "XDP datapath not running",
+		})
+		return
+	}
+
+	cfg := capture.SessionConfig{Filter: c.Query("filter")}
+	var count, seconds, rate int
+	for _, q := range []struct {
+		name        string
+		dst         *int
+		def, lo, hi int
+	}{
+		{"sample", &cfg.Sample, 1, 1, 1 << 20},
+		{"snaplen", &cfg.Snaplen, captureDefaultSnaplen, 0, 65535},
+		{"count", &count, 0, 0, 1 << 30},
+		{"seconds", &seconds, captureDefaultSeconds, 1, captureMaxSeconds},
+		{"rate", &rate, captureDefaultRate, 1, captureMaxRate},
+	} {
+		n, err := queryInt(c, q.name, q.def, q.lo, q.hi)
+		if err != nil {
+			c.JSON(http.StatusBadRequest, gin.H{"error": err.Error()})
+			return
+		}
+		*q.dst = n
+	}
+
+	sess, err := h.capture.Subscribe(cfg)
+	switch {
+	case errors.Is(err, capture.ErrInvalidFilter):
+		c.JSON(http.StatusBadRequest, gin.H{"error": err.Error()})
+		return
+	case errors.Is(err, capture.ErrTooManySessions):
+		c.JSON(http.StatusTooManyRequests, gin.H{"error": err.Error()})
+		return
+	case err != nil:
+		c.JSON(http.StatusInternalServerError, gin.H{"error": err.Error()})
+		return
+	}
+	defer sess.Close()
+
+	// The stream outlives the server's write timeout
+	duration := time.Duration(seconds) * time.Second
+	_ = http.NewResponseController(c.Writer).SetWriteDeadline(time.Now().Add(duration + 5*time.Second))
+
+	c.Header("Content-Type", "application/x-pcapng")
+	c.Header("Content-Disposition", `attachment; filename="capture.pcapng"`)
+	c.Status(http.StatusOK)
+
+	bw := bufio.NewWriterSize(c.Writer, 64<<10)
+	pw, err := capture.NewPcapngWriter(bw, h.xdpIface, sess.Queues())
+	if err != nil {
+		return
+	}
+
+	ticker := time.NewTicker(captureTick)
+	defer ticker.Stop()
+	deadline := time.NewTimer(duration)
+	defer deadline.Stop()
+
+	// Token bucket holding up to a second of packets
+	tokens, last := float64(rate), time.Now()
+	sent := 0
+	write := func(rec *capture.Record) {
+		if err == nil {
+			err = pw.WritePacket(rec)
+		}
+	}
+loop:
+	for count == 0 || sent < count {
+		select {
+		case <-c.Request.Context().Done():
+			return
+		case <-deadline.C:
+			break loop
+		case now := <-ticker.C:
+			tokens = min(float64(rate), tokens+now.Sub(last).Seconds()*float64(rate))
+			last = now
+		}
+
+		budget := int(tokens)
+		if count > 0 {
+			budget = min(budget, count-sent)
+		}
+		if budget == 0 {
+			continue
+		}
+		n := sess.Read(budget, write)
+		if err != nil {
+			return
+		}
+		tokens -= float64(n)
+		sent += n
+		if n > 0 {
+			if bw.Flush() != nil {
+				return
+			}
+			c.Writer.Flush()
+		}
+	}
+
+	drops := sess.Drops()
+	if pw.WriteStats(time.Now().UnixNano(), uint64(sent)+drops, drops) == nil && bw.Flush() == nil {
+		c.Writer.Flush()
+	}
+}
+
+// queryInt parses an integer query parameter within [lo, hi].
+func queryInt(c *gin.Context, name string, def, lo, hi int) (int, error) {
+	s := c.Query(name)
+	if s == "" {
+		return def, nil
+	}
+	n, err := strconv.Atoi(s)
+	if err != nil || n < lo || n > hi {
+		return 0, fmt.Errorf("%s must be an integer from %d to %d", name, lo, hi)
+	}
+	return n, nil
+}
+
 // MemoryPoolStats handles GET /api/v1/memory/stats
 func (h *Handlers) MemoryPoolStats(c *gin.Context) {
-	if h.memoryPool == nil {
+	if h.pools == nil {
 		c.JSON(http.StatusServiceUnavailable, gin.H{
 			"error": "Memory pool not initialized",
 		})
 		return
 	}
 
-	stats := h.memoryPool.Stats()
+	stats := h.pools.Stats()
+
+	nodes := make(map[int]gin.H)
+	for node, ns := range h.pools.NodeStats() {
+		nodes[node] = gin.H{
+			"total_slots": ns.TotalSlots,
+			"used_slots":  ns.UsedSlots,
+			"free_slots":  ns.FreeSlots,
+			"peak_usage":  ns.PeakUsage,
+		}
+	}
+
+	c.JSON(http.StatusOK, gin.H{
+		"total_slots":  stats.TotalSlots,
+		"used_slots":   stats.UsedSlots,
+		"free_slots":   stats.FreeSlots,
+		"slot_size":    stats.SlotSize,
+		"total_memory": stats.TotalMemory,
+		"total_allocs": stats.TotalAllocs,
+		"total_frees":  stats.TotalFrees,
+		"peak_usage":   stats.PeakUsage,
+		"utilization":  float64(stats.UsedSlots) / float64(stats.TotalSlots) * 100,
+		"nodes":        nodes,
+	})
+}
+
+// StageLatencyStatus is the latency distribution of one pipeline stage.
+type StageLatencyStatus struct {
+	Stage   string  `json:"stage"`
+	Packets uint64  `json:"sampled_packets"`
+	MeanNs  float64 `json:"mean_ns"`
+	P50Ns   uint64  `json:"p50_ns"`
+	P90Ns   uint64  `json:"p90_ns"`
+	P99Ns   uint64  `json:"p99_ns"`
+	P999Ns  uint64  `json:"p999_ns"`
+	MaxNs   uint64  `json:"max_ns"`
+}
+
+// DatapathLatency handles GET /api/v1/datapath/latency
+// Stage latency is merged across workers; ?queue=N limits it to one queue.
+func (h *Handlers) DatapathLatency(c *gin.Context) {
+	if h.engine == nil {
+		c.JSON(http.StatusServiceUnavailable, gin.H{
+			"error": "XDP datapath not running",
+		})
+		return
+	}
+
+	var stages []xdp.StageLatency
+	if q := c.Query("queue"); q != "" {
+		for _, w := range h.engine.Workers() {
+			if strconv.Itoa(w.QueueID()) == q {
+				stages = w.Latency()
+			}
+		}
+		if stages == nil {
+			c.JSON(http.StatusNotFound, gin.H{"error": "Unknown queue"})
+			return
+		}
+	} else {
+		stages = h.engine.Latency()
+	}
+
+	out := make([]StageLatencyStatus, len(stages))
+	for i := range stages {
+		s := &stages[i]
+		out[i] = StageLatencyStatus{
+			Stage:   s.Name,
+			Packets: s.Count,
+			MeanNs:  s.Mean(),
+			P50Ns:   s.Quantile(0.5),
+			P90Ns:   s.Quantile(0.9),
+			P99Ns:   s.Quantile(0.99),
+			P999Ns:  s.Quantile(0.999),
+			MaxNs:   s.Max,
+		}
+	}
+
+	c.JSON(http.StatusOK, gin.H{
+		"sample_rate": h.engine.LatencySampleRate(),
+		"stages":      out,
+	})
+}
+
+// GetPolicy handles GET /api/v1/policy
+func (h *Handlers) GetPolicy(c *gin.Context) {
+	if h.policy == nil {
+		c.JSON(http.StatusServiceUnavailable, gin.H{
+			"error": "Policy store not initialized",
+		})
+		return
+	}
+
+	p, generation := h.policy.Policy()
+	c.JSON(http.StatusOK, gin.H{
+		"generation": generation,
+		"policy":     p,
+		"hits":       h.policy.Hits(),
+	})
+}
+
+// UpdatePolicy handles PUT /api/v1/policy
+// The body replaces the whole policy; it is live in the datapath and the
+// XDP maps, and tracked flows it drops are evicted, when the response is
+// sent.
+func (h *Handlers) UpdatePolicy(c *gin.Context) {
+	if h.policy == nil {
+		c.JSON(http.StatusServiceUnavailable, gin.H{
+			"error": "Policy store not initialized",
+		})
+		return
+	}
+
+	var p policy.Policy
+	if err := c.ShouldBindJSON(&p); err != nil {
+		c.JSON(http.StatusBadRequest, gin.H{"error": err.Error()})
+		return
+	}
+
+	res, err := h.policy.Update(c.Request.Context(), p)
+	if errors.Is(err, policy.ErrInvalidRule) {
+		c.JSON(http.StatusBadRequest, gin.H{"error": err.Error()})
+		return
+	}
+	if err != nil {
+		c.JSON(http.StatusInternalServerError, gin.H{
+			"error":      err.Error(),
+			"generation": res.Generation,
+		})
+		return
+	}
 
 	c.JSON(http.StatusOK, gin.H{
-		"total_slots":   stats.TotalSlots,
-		"used_slots":    stats.UsedSlots,
-		"free_slots":    stats.FreeSlots,
-		"slot_size":     stats.SlotSize,
-		"total_memory":  stats.TotalMemory,
-		"total_allocs":  stats.TotalAllocs,
-		"total_frees":   stats.TotalFrees,
-		"peak_usage":    stats.PeakUsage,
-		"utilization":   float64(stats.UsedSlots) / float64(stats.TotalSlots) * 100,
+		"generation":      res.Generation,
+		"rules":           res.Rules,
+		"compile_ns":      res.Compile.Nanoseconds(),
+		"swap_ns":         res.Swap.Nanoseconds(),
+		"mirror_ns":       res.Mirror.Nanoseconds(),
+		"entries_written": res.Written,
+		"entries_removed": res.Removed,
+		"flows_evicted":   res.Evicted,
 	})
 }
 
 // NUMAInfo handles GET /api/v1/numa/info
+// Placement samples every allocation's pages with move_pages, so it is
+// served here rather than on /status.
 func (h *Handlers) NUMAInfo(c *gin.Context) {
-	info := memory.GetNUMAInfo()
+	info := memory.GetNUMAInfoWithPlacement()
+
+	placement := make([]gin.H, 0, len(info.Placement))
+	for _, p := range info.Placement {
+		placement = append(placement, gin.H{
+			"node":          p.Node,
+			"bytes":         p.Bytes,
+			"page_size":     p.PageSize,
+			"bound":         p.Bound,
+			"sampled_pages": p.Sampled,
+			"not_present":   p.NotPresent,
+			"pages_by_node": p.PagesByNode,
+			"local_ratio":   p.LocalRatio,
+		})
+	}
 
 	c.JSON(http.StatusOK, gin.H{
 		"available":     info.Available,
@@ -218,5 +657,6 @@ func (h *Handlers) NUMAInfo(c *gin.Context) {
 		"current_node":  info.CurrentNode,
 		"cpus_per_node": info.CPUsPerNode,
 		"memory_mb":     info.MemoryMB,
+		"placement":     placement,
 	})
 }
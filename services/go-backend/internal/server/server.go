@@ -5,14 +5,20 @@ import (
 	"context"
 	"fmt"
 	"net/http"
+	"os"
 	"time"
 
 	"github.com/gin-gonic/gin"
 	"github.com/prometheus/client_golang/prometheus/promhttp"
 
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/capture"
 	"github.com/penguintechinc/cerberus/services/go-backend/internal/config"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/ingest"
 	"github.com/penguintechinc/cerberus/services/go-backend/internal/memory"
 	"github.com/penguintechinc/cerberus/services/go-backend/internal/metrics"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/policy"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/telemetry"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
 )
 
 // Server represents the HTTP server.
@@ -22,7 +28,9 @@ type Server struct {
 	httpServer *http.Server
 	handlers   *Handlers
 	metrics    *metrics.Metrics
-	memPool    *memory.MemoryPool
+	accessLog  *accessLog // Nil when access logging is off
+	pools      *memory.NodePools
+	auth       *tokenAuth
 }
 
 // NewServer creates a new HTTP server instance.
@@ -40,40 +48,51 @@ func NewServer(cfg *config.Config) (*Server, error) {
 	// Initialize metrics
 	m := metrics.NewMetrics("go_backend")
 
-	// Add logging and metrics middleware
-	router.Use(loggingMiddleware())
-	router.Use(metricsMiddleware(m))
+	// Add metrics and access logging middleware
+	accessLog := newAccessLog(os.Stdout, cfg.AccessLogSample)
+	router.Use(instrumentMiddleware(m.HTTP, accessLog))
 
-	// Initialize memory pool if enabled
-	var memPool *memory.MemoryPool
+	// Initialize memory pools if enabled: one per NUMA node with NUMA
+	// enabled, otherwise a single pool on the configured node
+	var pools *memory.NodePools
 	if cfg.MemoryPoolSlots > 0 {
 		var err error
 		poolConfig := memory.PoolConfig{
 			NumSlots:     cfg.MemoryPoolSlots,
 			SlotSize:     cfg.MemoryPoolSlotSize,
-			NUMANodeID:   cfg.NUMANodeID,
 			UseHugepages: cfg.HugepagesEnabled,
+			HugepageSize: memory.ParseHugepageSize(cfg.HugepageSize),
 			Preallocate:  cfg.MemoryPreallocate,
+			Scrub:        memory.ParseScrubPolicy(cfg.MemoryScrub),
 		}
-		memPool, err = memory.NewMemoryPool(poolConfig)
+		nodes := []int{cfg.NUMANodeID}
+		if cfg.NUMAEnabled {
+			nodes = nil
+		}
+		pools, err = memory.NewNodePools(poolConfig, nodes)
 		if err != nil {
 			return nil, fmt.Errorf("failed to create memory pool: %w", err)
 		}
 	}
 
 	// Initialize handlers
-	handlers := NewHandlers(cfg.Version, memPool, cfg.XDPEnabled, cfg.XDPMode, cfg.XDPInterface)
+	handlers := NewHandlers(cfg.Version, pools, cfg.XDPEnabled, cfg.XDPMode, cfg.XDPInterface)
 
 	server := &Server{
-		config:   cfg,
-		router:   router,
-		handlers: handlers,
-		metrics:  m,
-		memPool:  memPool,
+		config:    cfg,
+		router:    router,
+		handlers:  handlers,
+		metrics:   m,
+		accessLog: accessLog,
+		pools:     pools,
+		auth:      newTokenAuth(cfg.JWTSecretKey),
 	}
 
-	// Register routes
+	// Register routes, and their request counters
 	server.registerRoutes()
+	for _, r := range router.Routes() {
+		m.HTTP.Register(r.Method, r.Path)
+	}
 
 	return server, nil
 }
@@ -95,13 +114,68 @@ func (s *Server) registerRoutes() {
 
 		// Memory pool endpoints
 		v1.POST("/packet/forward", s.handlers.PacketForward)
+		v1.POST("/packet/ingest", s.auth.require(roleAdmin), s.handlers.PacketIngest)
 		v1.GET("/memory/stats", s.handlers.MemoryPoolStats)
 
+		// Live datapath capture (pcapng)
+		v1.GET("/packet/capture", s.auth.require(roleAdmin), s.handlers.PacketCapture)
+
 		// NUMA information
 		v1.GET("/numa/info", s.handlers.NUMAInfo)
+
+		// Datapath latency
+		v1.GET("/datapath/latency", s.handlers.DatapathLatency)
+
+		// Live telemetry (server-sent events)
+		v1.GET("/telemetry/stream", s.handlers.TelemetryStream)
+
+		// Firewall policy
+		v1.GET("/policy", s.handlers.GetPolicy)
+		v1.PUT("/policy", s.auth.require(roleAdmin), s.handlers.UpdatePolicy)
 	}
 }
 
+// SetEngine attaches the XDP datapath served by the datapath endpoints. It
+// must be called before Start.
+func (s *Server) SetEngine(engine *xdp.Engine) {
+	s.handlers.engine = engine
+}
+
+// SetCapture attaches the capture hub served by the capture endpoint. It
+// must be called before Start.
+func (s *Server) SetCapture(hub *capture.Hub) {
+	s.handlers.capture = hub
+}
+
+// SetIngest enables the bulk ingest endpoint, building a pipeline for each
+// stream with factory. It must be called before Start.
+func (s *Server) SetIngest(factory ingest.PipelineFactory) {
+	if s.pools == nil {
+		return
+	}
+	s.handlers.ingest = factory
+	s.handlers.ingestCaches = make(chan *memory.PoolCache, ingestMaxStreams)
+	for i := 0; i < ingestMaxStreams; i++ {
+		s.handlers.ingestCaches <- s.pools.Local().NewCache()
+	}
+}
+
+// SetTelemetry starts the telemetry stream over the given sources and the
+// server's memory pools. It must be called before Start.
+func (s *Server) SetTelemetry(src telemetry.Sources) {
+	src.Pools = s.pools
+	cfg := telemetry.DefaultConfig()
+	cfg.Interval = s.config.TelemetryInterval
+	cfg.TopTalkers = s.config.TelemetryTopTalkers
+	s.handlers.telemetry = telemetry.NewHub(cfg, src)
+}
+
+// SetPolicy attaches the policy store served by the policy endpoints. It
+// must be called before Start.
+func (s *Server) SetPolicy(store *policy.Store) {
+	s.handlers.policy = store
+}
+
 // Start starts the HTTP server.
 func (s *Server) Start() error {
 	addr := fmt.Sprintf("%s:%d", s.config.Host, s.config.Port)
@@ -117,41 +191,59 @@ func (s *Server) Start() error {
 	return s.httpServer.ListenAndServe()
 }
 
-// Shutdown gracefully shuts down the server.
+// Shutdown gracefully shuts down the server. Once it returns no handler
+// or telemetry tick reads the engine, conntrack table or policy any more,
+// so they may be torn down.
 func (s *Server) Shutdown(ctx context.Context) error {
-	// Close memory pool
-	if s.memPool != nil {
-		s.memPool.Close()
+	// Stop sampling and end the telemetry streams, which would otherwise
+	// hold the HTTP server open
+	if s.handlers.telemetry != nil {
+		s.handlers.telemetry.Close()
 	}
 
 	// Shutdown HTTP server
+	var err error
 	if s.httpServer != nil {
-		return s.httpServer.Shutdown(ctx)
+		err = s.httpServer.Shutdown(ctx)
 	}
 
-	return nil
-}
+	// Close memory pool, no longer used by a handler
+	if s.pools != nil {
+		s.pools.Close()
+	}
+	if s.accessLog != nil {
+		s.accessLog.Close()
+	}
 
-// loggingMiddleware provides request logging.
-func loggingMiddleware() gin.HandlerFunc {
-	return gin.LoggerWithConfig(gin.LoggerConfig{
-		SkipPaths: []string{"/healthz", "/readyz", "/metrics"},
-	})
+	return err
 }
 
-// metricsMiddleware records request metrics.
-func metricsMiddleware(m *metrics.Metrics) gin.HandlerFunc {
+// accessLogSkipPaths are not access logged.
+var accessLogSkipPaths = map[string]bool{"/healthz": true, "/readyz": true, "/metrics": true}
+
+// instrumentMiddleware records request metrics and queues access log
+// lines. Nothing is formatted or allocated for a request that is not
+// logged.
+func instrumentMiddleware(m *metrics.HTTPCollector, log *accessLog) gin.HandlerFunc {
 	return func(c *gin.Context) {
 		start := time.Now()
-
-		m.HTTPActiveRequests.Inc()
-		defer m.HTTPActiveRequests.Dec()
+		shard := m.Begin()
 
 		c.Next()
 
-		duration := time.Since(start).Seconds()
-		status := fmt.Sprintf("%d", c.Writer.Status())
-
-		m.RecordHTTPRequest(c.Request.Method, c.FullPath(), status, duration)
+		elapsed := time.Since(start)
+		status := c.Writer.Status()
+		m.End(shard, c.Request.Method, c.FullPath(), status, elapsed)
+
+		if log != nil && log.sampled(status) && !accessLogSkipPaths[c.Request.URL.Path] {
+			log.log(accessEntry{
+				time:    start,
+				latency: elapsed,
+				status:  status,
+				method:  c.Request.Method,
+				path:    c.Request.URL.Path,
+				client:  c.ClientIP(),
+			})
+		}
 	}
 }
@@ -0,0 +1,196 @@
+package telemetry
+
+import (
+	"encoding/json"
+	"errors"
+	"strconv"
+	"sync"
+	"time"
+)
+
+var (
+	// ErrTooManySubscribers is returned when MaxSubscribers streams run.
+	ErrTooManySubscribers = errors.New("too many telemetry subscribers")
+)
+
+// Config configures a Hub.
+type Config struct {
+	Interval       time.Duration // Time between samples
+	TopTalkers     int           // Flows in each top talker list
+	MaxSubscribers int
+}
+
+// DefaultConfig returns a one second tick with the top 10 talkers.
+func DefaultConfig() Config {
+	return Config{
+		Interval:       time.Second,
+		TopTalkers:     10,
+		MaxSubscribers: 64,
+	}
+}
+
+// subscriberQueue is the frames a subscriber may fall behind by before it
+// is resynchronized with a full message.
+const subscriberQueue = 4
+
+// Hub samples the sources once per tick while anyone subscribes, encodes
+// each message once as a server-sent event and hands the same bytes to
+// every subscriber. Subscribers start with a full message; one that falls
+// behind misses frames and gets a full message again.
+type Hub struct {
+	config  Config
+	sampler sampler
+
+	mu   sync.Mutex
+	subs map[*Subscriber]struct{}
+	seq  uint64
+	prev *Snapshot
+	// Full frame of prev, encoded when first needed
+	fullFrame []byte
+
+	stop chan struct{}
+	wg   sync.WaitGroup
+}
+
+// Subscriber receives encoded frames on C, which is closed when the hub
+// stops.
+type Subscriber struct {
+	C        chan []byte
+	needFull bool
+}
+
+// NewHub creates a hub and starts its ticker.
+func NewHub(config Config, src Sources) *Hub {
+	if config.Interval <= 0 {
+		config.Interval = time.Second
+	}
+	h := &Hub{
+		config:  config,
+		sampler: sampler{src: src, topTalkers: config.TopTalkers, start: time.Now()},
+		subs:    make(map[*Subscriber]struct{}),
+		stop:    make(chan struct{}),
+	}
+	h.wg.Add(1)
+	go h.run()
+	return h
+}
+
+// Subscribe starts a stream. The latest full message, if any, is queued
+// at once. Unsubscribe it when done.
+func (h *Hub) Subscribe() (*Subscriber, error) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	if len(h.subs) >= h.config.MaxSubscribers {
+		return nil, ErrTooManySubscribers
+	}
+	sub := &Subscriber{C: make(chan []byte, subscriberQueue), needFull: true}
+	if h.prev != nil {
+		sub.C <- h.full()
+		sub.needFull = false
+	}
+	h.subs[sub] = struct{}{}
+	return sub, nil
+}
+
+// Unsubscribe ends a stream.
+func (h *Hub) Unsubscribe(sub *Subscriber) {
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	delete(h.subs, sub)
+}
+
+// Close stops the ticker and closes every subscriber's channel.
+func (h *Hub) Close() {
+	close(h.stop)
+	h.wg.Wait()
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	for sub := range h.subs {
+		close(sub.C)
+		delete(h.subs, sub)
+	}
+}
+
+func (h *Hub) run() {
+	defer h.wg.Done()
+	ticker := time.NewTicker(h.config.Interval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-h.stop:
+			return
+		case now := <-ticker.C:
+			h.tick(now)
+		}
+	}
+}
+
+// tick samples and fans out one message. Nothing is sampled while no one
+// subscribes.
+func (h *Hub) tick(now time.Time) {
+	h.mu.Lock()
+	idle := len(h.subs) == 0
+	h.mu.Unlock()
+	if idle {
+		h.sampler.reset()
+		h.mu.Lock()
+		h.prev, h.fullFrame = nil, nil
+		h.mu.Unlock()
+		return
+	}
+
+	// Sampling scans the flow table, so it runs outside the lock
+	snap := h.sampler.sample(now)
+
+	h.mu.Lock()
+	defer h.mu.Unlock()
+	h.seq++
+	var deltaFrame []byte
+	if h.prev != nil {
+		deltaFrame = encode(delta(h.seq, h.prev, snap))
+	}
+	h.prev, h.fullFrame = snap, nil
+
+	for sub := range h.subs {
+		frame := deltaFrame
+		if sub.needFull || frame == nil {
+			frame = h.full()
+		}
+		select {
+		case sub.C <- frame:
+			sub.needFull = false
+		default:
+			// It missed this delta, so the next one would not apply
+			sub.needFull = true
+		}
+	}
+}
+
+// full returns the full frame of the latest snapshot. The caller holds mu.
+func (h *Hub) full() []byte {
+	if h.fullFrame == nil {
+		h.fullFrame = encode(full(h.seq, h.prev))
+	}
+	return h.fullFrame
+}
+
+// encode formats a message as a server-sent event, with the sequence as
+// its id and "full" or "delta" as its event type.
+func encode(m *Message) []byte {
+	data, err := json.Marshal(m)
+	if err != nil {
+		return nil
+	}
+	event := "delta"
+	if m.Full {
+		event = "full"
+	}
+	b := make([]byte, 0, len(data)+48)
+	b = append(b, "id: "...)
+	b = strconv.AppendUint(b, m.Seq, 10)
+	b = append(b, "\nevent: "...)
+	b = append(b, event...)
+	b = append(b, "\ndata: "...)
+	b = append(b, data...)
+	return append(b, "\n\n"...)
+}
@@ -0,0 +1,245 @@
+// Package telemetry samples datapath counters once per tick and streams
+// them to any number of subscribers as delta-encoded snapshots, so the
+// cost of live dashboards does not grow with the number watching.
+package telemetry
+
+import (
+	"net/netip"
+	"runtime"
+	"strconv"
+	"time"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/conntrack"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/memory"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/policy"
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/xdp"
+)
+
+// Sources are read once per tick. Any may be nil.
+type Sources struct {
+	Engine    *xdp.Engine
+	Pools     *memory.NodePools
+	Conntrack *conntrack.Table
+	Policy    *policy.Store
+}
+
+// QueueRates are one datapath queue's rates over the last tick.
+type QueueRates struct {
+	Queue     int    `json:"queue"`
+	RxPackets uint64 `json:"rx_pps"`
+	RxBytes   uint64 `json:"rx_bps"`
+	TxPackets uint64 `json:"tx_pps"`
+	Dropped   uint64 `json:"drop_pps"`
+}
+
+// Talker is one of the flows with the most bytes.
+type Talker struct {
+	Src     string `json:"src"`
+	Dst     string `json:"dst"`
+	Proto   uint8  `json:"proto"`
+	Packets uint64 `json:"packets"`
+	Bytes   uint64 `json:"bytes"`
+}
+
+// Snapshot is the sampled state at one tick.
+type Snapshot struct {
+	Time       int64             // Unix milliseconds
+	Counters   map[string]uint64 // Totals and gauges by name
+	Queues     []QueueRates
+	TopTalkers []Talker
+	RuleHits   map[string]uint64 // By "<kind>:<id>"
+}
+
+// Message is one streamed update. A full message carries everything; a
+// delta only what changed since the previous message, with queues by
+// queue number and the top talkers replaced as a whole when present.
+type Message struct {
+	Seq        uint64            `json:"seq"`
+	Full       bool              `json:"full"`
+	Time       int64             `json:"ts"`
+	Counters   map[string]uint64 `json:"counters,omitempty"`
+	Queues     []QueueRates      `json:"queues,omitempty"`
+	TopTalkers *[]Talker         `json:"top_talkers,omitempty"`
+	RuleHits   map[string]uint64 `json:"rule_hits,omitempty"`
+}
+
+// sampler reads the sources, keeping the previous totals for rates.
+type sampler struct {
+	src        Sources
+	topTalkers int
+	start      time.Time
+
+	last     time.Time
+	lastRx   map[int]xdp.WorkerStats
+	lastSeen bool
+}
+
+func (s *sampler) sample(now time.Time) *Snapshot {
+	snap := &Snapshot{
+		Time: now.UnixMilli(),
+		Counters: map[string]uint64{
+			"uptime_seconds": uint64(now.Sub(s.start) / time.Second),
+			"goroutines":     uint64(runtime.NumGoroutine()),
+		},
+	}
+
+	if s.src.Engine != nil {
+		workers := s.src.Engine.Stats()
+		dt := now.Sub(s.last).Seconds()
+		rates := make(map[int]xdp.WorkerStats, len(workers))
+		var rx, rxBytes, tx, txBytes, dropped, passed uint64
+		for _, w := range workers {
+			rx += w.RxPackets
+			rxBytes += w.RxBytes
+			tx += w.TxPackets
+			txBytes += w.TxBytes
+			dropped += w.Dropped
+			passed += w.Passed
+
+			q := QueueRates{Queue: w.QueueID}
+			if prev, ok := s.lastRx[w.QueueID]; ok && s.lastSeen && dt > 0 {
+				q.RxPackets = rate(w.RxPackets, prev.RxPackets, dt)
+				q.RxBytes = rate(w.RxBytes, prev.RxBytes, dt)
+				q.TxPackets = rate(w.TxPackets, prev.TxPackets, dt)
+				q.Dropped = rate(w.Dropped, prev.Dropped, dt)
+			}
+			snap.Queues = append(snap.Queues, q)
+			rates[w.QueueID] = w
+		}
+		s.lastRx = rates
+		snap.Counters["rx_packets"] = rx
+		snap.Counters["rx_bytes"] = rxBytes
+		snap.Counters["tx_packets"] = tx
+		snap.Counters["tx_bytes"] = txBytes
+		snap.Counters["dropped"] = dropped
+		snap.Counters["passed"] = passed
+	}
+	s.last, s.lastSeen = now, true
+
+	if s.src.Pools != nil {
+		st := s.src.Pools.Stats()
+		snap.Counters["pool_slots_total"] = uint64(st.TotalSlots)
+		snap.Counters["pool_slots_used"] = uint64(st.UsedSlots)
+		snap.Counters["pool_peak_usage"] = uint64(st.PeakUsage)
+	}
+
+	if s.src.Conntrack != nil {
+		st := s.src.Conntrack.Stats()
+		snap.Counters["ct_entries"] = uint64(st.Entries)
+		snap.Counters["ct_offloaded"] = uint64(st.Offloaded)
+		snap.Counters["ct_inserts"] = st.Inserts
+		snap.Counters["ct_expired"] = st.Expired
+		snap.Counters["ct_insert_failed"] = st.InsertFailed
+
+		for _, f := range s.src.Conntrack.TopFlows(s.topTalkers) {
+			snap.TopTalkers = append(snap.TopTalkers, Talker{
+				Src:     endpoint(f.Key.Src, f.Key.SrcPort),
+				Dst:     endpoint(f.Key.Dst, f.Key.DstPort),
+				Proto:   f.Key.Proto,
+				Packets: f.Packets[0] + f.Packets[1],
+				Bytes:   f.Bytes[0] + f.Bytes[1],
+			})
+		}
+	}
+
+	if s.src.Policy != nil {
+		hits := s.src.Policy.Hits()
+		snap.RuleHits = make(map[string]uint64, len(hits))
+		for _, h := range hits {
+			snap.RuleHits[string(h.Kind)+":"+strconv.FormatInt(h.ID, 10)] = h.Hits
+		}
+	}
+	return snap
+}
+
+// reset forgets the previous totals, so the next sample has no rates.
+func (s *sampler) reset() {
+	s.lastSeen = false
+}
+
+func rate(cur, prev uint64, dt float64) uint64 {
+	if cur < prev {
+		return 0
+	}
+	return uint64(float64(cur-prev)/dt + 0.5)
+}
+
+func endpoint(addr [16]byte, port uint16) string {
+	ap := netip.AddrPortFrom(netip.AddrFrom16(addr).Unmap(), port)
+	if port == 0 {
+		return ap.Addr().String()
+	}
+	return ap.String()
+}
+
+// full returns the message carrying all of snap.
+func full(seq uint64, snap *Snapshot) *Message {
+	talkers := snap.TopTalkers
+	if talkers == nil {
+		talkers = []Talker{}
+	}
+	return &Message{
+		Seq:        seq,
+		Full:       true,
+		Time:       snap.Time,
+		Counters:   snap.Counters,
+		Queues:     snap.Queues,
+		TopTalkers: &talkers,
+		RuleHits:   snap.RuleHits,
+	}
+}
+
+// delta returns the message carrying what changed from prev to snap.
+// Rule hits of rules that no longer exist are not reported; a client
+// drops them on the next full message.
+func delta(seq uint64, prev, snap *Snapshot) *Message {
+	m := &Message{Seq: seq, Time: snap.Time}
+	for k, v := range snap.Counters {
+		if old, ok := prev.Counters[k]; !ok || old != v {
+			if m.Counters == nil {
+				m.Counters = make(map[string]uint64)
+			}
+			m.Counters[k] = v
+		}
+	}
+
+	old := make(map[int]QueueRates, len(prev.Queues))
+	for _, q := range prev.Queues {
+		old[q.Queue] = q
+	}
+	for _, q := range snap.Queues {
+		if p, ok := old[q.Queue]; !ok || p != q {
+			m.Queues = append(m.Queues, q)
+		}
+	}
+
+	if !equalTalkers(prev.TopTalkers, snap.TopTalkers) {
+		talkers := snap.TopTalkers
+		if talkers == nil {
+			talkers = []Talker{}
+		}
+		m.TopTalkers = &talkers
+	}
+
+	for k, v := range snap.RuleHits {
+		if old, ok := prev.RuleHits[k]; !ok || old != v {
+			if m.RuleHits == nil {
+				m.RuleHits = make(map[string]uint64)
+			}
+			m.RuleHits[k] = v
+		}
+	}
+	return m
+}
+
+func equalTalkers(a, b []Talker) bool {
+	if len(a) != len(b) {
+		return false
+	}
+	for i := range a {
+		if a[i] != b[i] {
+			return false
+		}
+	}
+	return true
+}
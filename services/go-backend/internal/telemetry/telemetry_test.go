@@ -0,0 +1,115 @@
+package telemetry
+
+import (
+	"bytes"
+	"encoding/json"
+	"testing"
+	"time"
+)
+
+// TestDelta checks that a delta carries only what changed.
+func TestDelta(t *testing.T) {
+	prev := &Snapshot{
+		Counters:   map[string]uint64{"rx_packets": 10, "ct_entries": 3},
+		Queues:     []QueueRates{{Queue: 0, RxPackets: 5}, {Queue: 1, RxPackets: 7}},
+		TopTalkers: []Talker{{Src: "10.0.0.1:1", Dst: "10.0.0.2:2", Bytes: 100}},
+		RuleHits:   map[string]uint64{"firewall:1": 4},
+	}
+	snap := &Snapshot{
+		Counters:   map[string]uint64{"rx_packets": 20, "ct_entries": 3},
+		Queues:     []QueueRates{{Queue: 0, RxPackets: 5}, {Queue: 1, RxPackets: 9}},
+		TopTalkers: prev.TopTalkers,
+		RuleHits:   map[string]uint64{"firewall:1": 4, "acl:2": 1},
+	}
+
+	m := delta(2, prev, snap)
+	if len(m.Counters) != 1 || m.Counters["rx_packets"] != 20 {
+		t.Errorf("expected only rx_packets, got %v", m.Counters)
+	}
+	if len(m.Queues) != 1 || m.Queues[0].Queue != 1 {
+		t.Errorf("expected only queue 1, got %v", m.Queues)
+	}
+	if m.TopTalkers != nil {
+		t.Errorf("expected unchanged top talkers omitted, got %v", *m.TopTalkers)
+	}
+	if len(m.RuleHits) != 1 || m.RuleHits["acl:2"] != 1 {
+		t.Errorf("expected only acl:2, got %v", m.RuleHits)
+	}
+
+	// An emptied talker list is sent, as []
+	snap.TopTalkers = nil
+	data, _ := json.Marshal(delta(3, prev, snap))
+	if !bytes.Contains(data, []byte(`"top_talkers":[]`)) {
+		t.Errorf("expected an empty top talker list, got %s", data)
+	}
+}
+
+func event(t *testing.T, frame []byte) (string, Message) {
+	t.Helper()
+	lines := bytes.Split(bytes.TrimSpace(frame), []byte("\n"))
+	if len(lines) != 3 || !bytes.HasPrefix(lines[1], []byte("event: ")) || !bytes.HasPrefix(lines[2], []byte("data: ")) {
+		t.Fatalf("malformed event %q", frame)
+	}
+	var m Message
+	if err := json.Unmarshal(lines[2][len("data: "):], &m); err != nil {
+		t.Fatal(err)
+	}
+	return string(lines[1][len("event: "):]), m
+}
+
+// TestHub checks full and delta fan-out, joining mid-stream and the resync
+// of a subscriber that fell behind.
+func TestHub(t *testing.T) {
+	cfg := DefaultConfig()
+	cfg.Interval = time.Hour // Ticks are driven by hand
+	h := NewHub(cfg, Sources{})
+	defer h.Close()
+
+	a, err := h.Subscribe()
+	if err != nil {
+		t.Fatal(err)
+	}
+	now := time.Now()
+	h.tick(now)
+	if kind, m := event(t, <-a.C); kind != "full" || !m.Full || m.Seq != 1 {
+		t.Fatalf("expected full message 1, got %s %+v", kind, m)
+	}
+
+	// A late subscriber starts from the latest full message
+	b, _ := h.Subscribe()
+	if kind, m := event(t, <-b.C); kind != "full" || m.Seq != 1 {
+		t.Fatalf("expected full message 1 on join, got %s %+v", kind, m)
+	}
+
+	h.tick(now.Add(time.Second))
+	fa, fb := <-a.C, <-b.C
+	if kind, m := event(t, fa); kind != "delta" || m.Seq != 2 {
+		t.Fatalf("expected delta 2, got %s %+v", kind, m)
+	}
+	if &fa[0] != &fb[0] {
+		t.Error("expected subscribers to share one encoded frame")
+	}
+
+	// b stops reading: it misses a frame and is resynchronized
+	for i := 0; i < subscriberQueue+1; i++ {
+		h.tick(now.Add(time.Duration(2+i) * time.Second))
+		<-a.C
+	}
+	for len(b.C) > 0 {
+		<-b.C
+	}
+	h.tick(now.Add(10 * time.Second))
+	if kind, _ := event(t, <-b.C); kind != "full" {
+		t.Errorf("expected a full message after falling behind, got %s", kind)
+	}
+	if kind, _ := event(t, <-a.C); kind != "delta" {
+		t.Errorf("expected a delta for the subscriber keeping up, got %s", kind)
+	}
+
+	h.Unsubscribe(a)
+	h.Unsubscribe(b)
+	h.tick(now.Add(11 * time.Second))
+	if h.prev != nil {
+		t.Error("expected no sampling without subscribers")
+	}
+}
@@ -0,0 +1,141 @@
+// Package xdp provides Internet checksum routines (RFC 1071, RFC 1624).
+package xdp
+
+import (
+	"encoding/binary"
+	"math/bits"
+)
+
+// The ones' complement sum is independent of byte order (RFC 1071
+// section 2(B)), so data is summed as native 64-bit little-endian words
+// with end-around carry and the folded result is byte-swapped once at the
+// end. csumWords sums the 8-byte words of p; it is implemented in assembly
+// on amd64 and arm64.
+
+// csumWordsGeneric is the portable word loop, four words per iteration.
+func csumWordsGeneric(p []byte) uint64 {
+	var sum, carry uint64
+	for len(p) >= 32 {
+		sum, carry = bits.Add64(sum, binary.LittleEndian.Uint64(p[0:]), 0)
+		sum, carry = bits.Add64(sum, binary.LittleEndian.Uint64(p[8:]), carry)
+		sum, carry = bits.Add64(sum, binary.LittleEndian.Uint64(p[16:]), carry)
+		sum, carry = bits.Add64(sum, binary.LittleEndian.Uint64(p[24:]), carry)
+		sum, carry = bits.Add64(sum, 0, carry)
+		sum += carry // Cannot carry again
+		p = p[32:]
+	}
+	for len(p) >= 8 {
+		sum, carry = bits.Add64(sum, binary.LittleEndian.Uint64(p), 0)
+		sum += carry
+		p = p[8:]
+	}
+	return sum
+}
+
+// sum16 returns the folded, uncomplemented ones' complement sum of data in
+// network byte order. An odd trailing byte is padded with zero.
+func sum16(data []byte) uint16 {
+	sum := csumWords(data)
+	tail := data[len(data)&^7:]
+
+	var carry uint64
+	if len(tail) >= 4 {
+		sum, carry = bits.Add64(sum, uint64(binary.LittleEndian.Uint32(tail)), 0)
+		sum += carry
+		tail = tail[4:]
+	}
+	if len(tail) >= 2 {
+		sum, carry = bits.Add64(sum, uint64(binary.LittleEndian.Uint16(tail)), 0)
+		sum += carry
+		tail = tail[2:]
+	}
+	if len(tail) == 1 {
+		sum, carry = bits.Add64(sum, uint64(tail[0]), 0)
+		sum += carry
+	}
+
+	return bits.ReverseBytes16(fold64(sum))
+}
+
+// fold64 folds a 64-bit ones' complement accumulator to 16 bits.
+func fold64(sum uint64) uint16 {
+	sum = (sum & 0xFFFFFFFF) + (sum >> 32)
+	sum = (sum & 0xFFFFFFFF) + (sum >> 32)
+	return fold32(uint32(sum))
+}
+
+// fold32 folds a 32-bit ones' complement accumulator to 16 bits.
+func fold32(sum uint32) uint16 {
+	sum = (sum & 0xFFFF) + (sum >> 16)
+	sum = (sum & 0xFFFF) + (sum >> 16)
+	return uint16(sum)
+}
+
+// Checksum returns the Internet checksum of data. Over a header whose
+// checksum field is zero it is the value to store; over a header with a
+// valid checksum it is zero.
+func Checksum(data []byte) uint16 {
+	return ^sum16(data)
+}
+
+// PartialChecksum adds data to a running uncomplemented sum, for checksums
+// over several buffers. Every buffer but the last must have even length.
+// Finish the sum with FinishChecksum.
+func PartialChecksum(data []byte, initial uint32) uint32 {
+	return initial + uint32(sum16(data))
+}
+
+// FinishChecksum folds and complements a sum built with PartialChecksum
+// and the pseudo-header functions.
+func FinishChecksum(sum uint32) uint16 {
+	return ^fold32(sum)
+}
+
+// PseudoHeaderSumIPv4 returns the uncomplemented sum of the IPv4 TCP/UDP
+// pseudo-header (RFC 793, RFC 768). length is the L4 header plus payload.
+func PseudoHeaderSumIPv4(src, dst [4]byte, proto uint8, length uint16) uint32 {
+	return uint32(binary.BigEndian.Uint16(src[0:])) + uint32(binary.BigEndian.Uint16(src[2:])) +
+		uint32(binary.BigEndian.Uint16(dst[0:])) + uint32(binary.BigEndian.Uint16(dst[2:])) +
+		uint32(proto) + uint32(length)
+}
+
+// PseudoHeaderSumIPv6 returns the uncomplemented sum of the IPv6
+// upper-layer pseudo-header (RFC 8200 section 8.1).
+func PseudoHeaderSumIPv6(src, dst *[16]byte, proto uint8, length uint32) uint32 {
+	return uint32(sum16(src[:])) + uint32(sum16(dst[:])) +
+		length>>16 + length&0xFFFF + uint32(proto)
+}
+
+// L4ChecksumIPv4 returns the TCP/UDP checksum of segment, whose checksum
+// field must be zero, carried in IPv4 between src and dst. A UDP result of
+// zero must be stored as 0xFFFF.
+func L4ChecksumIPv4(src, dst [4]byte, proto uint8, segment []byte) uint16 {
+	return FinishChecksum(PartialChecksum(segment, PseudoHeaderSumIPv4(src, dst, proto, uint16(len(segment)))))
+}
+
+// L4ChecksumIPv6 returns the TCP/UDP/ICMPv6 checksum of segment, whose
+// checksum field must be zero, carried in IPv6 between src and dst.
+func L4ChecksumIPv6(src, dst *[16]byte, proto uint8, segment []byte) uint16 {
+	return FinishChecksum(PartialChecksum(segment, PseudoHeaderSumIPv6(src, dst, proto, uint32(len(segment)))))
+}
+
+// ChecksumUpdate16 returns checksum check after a 16-bit field changed
+// from old to new, using RFC 1624 equation 3: HC' = ~(~HC + ~m + m').
+func ChecksumUpdate16(check, old, new uint16) uint16 {
+	return ^fold32(uint32(^check) + uint32(^old) + uint32(new))
+}
+
+// ChecksumUpdate32 returns checksum check after a 32-bit field (such as an
+// IPv4 address) changed from old to new.
+func ChecksumUpdate32(check uint16, old, new uint32) uint16 {
+	return ^fold32(uint32(^check) +
+		uint32(^uint16(old>>16)) + uint32(^uint16(old)) +
+		uint32(uint16(new>>16)) + uint32(uint16(new)))
+}
+
+// ChecksumUpdateBytes returns checksum check after a field at an even
+// offset changed from old to new (of equal, even length), such as an IPv6
+// address.
+func ChecksumUpdateBytes(check uint16, old, new []byte) uint16 {
+	return ChecksumUpdate16(check, sum16(old), sum16(new))
+}
@@ -0,0 +1,45 @@
+#include "textflag.h"
+
+// func csumWords(p []byte) uint64
+//
+// One ADC chain over 32-byte blocks, then 8-byte words. DECQ and LEAQ
+// leave CF intact, so the carry flows through the loop and is folded in
+// at the end of each phase.
+TEXT ·csumWords(SB), NOSPLIT, $0-32
+	MOVQ p_base+0(FP), SI
+	MOVQ p_len+8(FP), CX
+	XORQ AX, AX
+
+	MOVQ CX, DX
+	SHRQ $5, DX
+	JZ   words
+	CLC         // SHRQ leaves the last bit shifted out in CF
+
+blocks:
+	ADCQ 0(SI), AX
+	ADCQ 8(SI), AX
+	ADCQ 16(SI), AX
+	ADCQ 24(SI), AX
+	LEAQ 32(SI), SI
+	DECQ DX
+	JNZ  blocks
+	ADCQ $0, AX
+	ADCQ $0, AX // The first fold can carry again when AX is all ones
+
+words:
+	ANDQ $31, CX
+	SHRQ $3, CX
+	JZ   done
+	CLC
+
+loop8:
+	ADCQ 0(SI), AX
+	LEAQ 8(SI), SI
+	DECQ CX
+	JNZ  loop8
+	ADCQ $0, AX
+	ADCQ $0, AX
+
+done:
+	MOVQ AX, ret+24(FP)
+	RET
@@ -0,0 +1,42 @@
+#include "textflag.h"
+
+// func csumWords(p []byte) uint64
+//
+// Two LDPs per 32-byte block feed an ADDS/ADCS chain; the carry is folded
+// back (twice, as the first fold can carry) at the end of every block.
+TEXT ·csumWords(SB), NOSPLIT, $0-32
+	MOVD p_base+0(FP), R0
+	MOVD p_len+8(FP), R1
+	MOVD $0, R2
+
+	LSR  $5, R1, R3
+	CBZ  R3, words
+
+blocks:
+	LDP  (R0), (R4, R5)
+	LDP  16(R0), (R6, R7)
+	ADD  $32, R0
+	ADDS R4, R2
+	ADCS R5, R2
+	ADCS R6, R2
+	ADCS R7, R2
+	ADCS ZR, R2
+	ADC  ZR, R2 // The first fold can carry again when R2 is all ones
+	SUB  $1, R3
+	CBNZ R3, blocks
+
+words:
+	AND  $31, R1, R1
+	LSR  $3, R1, R3
+	CBZ  R3, done
+
+loop8:
+	MOVD.P 8(R0), R4
+	ADDS R4, R2
+	ADC  ZR, R2
+	SUB  $1, R3
+	CBNZ R3, loop8
+
+done:
+	MOVD R2, ret+24(FP)
+	RET
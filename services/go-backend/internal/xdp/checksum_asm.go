@@ -0,0 +1,10 @@
+//go:build amd64 || arm64
+
+// Package xdp provides assembly checksum loops for amd64 and arm64.
+package xdp
+
+// csumWords returns the 64-bit ones' complement sum of the little-endian
+// 8-byte words of p, ignoring the len(p)%8 trailing bytes.
+//
+//go:noescape
+func csumWords(p []byte) uint64
@@ -0,0 +1,10 @@
+//go:build !amd64 && !arm64
+
+// Package xdp provides the portable checksum loop.
+package xdp
+
+// csumWords returns the 64-bit ones' complement sum of the little-endian
+// 8-byte words of p, ignoring the len(p)%8 trailing bytes.
+func csumWords(p []byte) uint64 {
+	return csumWordsGeneric(p)
+}
@@ -0,0 +1,455 @@
+// Package xdp provides a multi-queue AF_XDP worker engine.
+package xdp
+
+import (
+	"errors"
+	"fmt"
+	"math/bits"
+	"os"
+	"path/filepath"
+	"runtime"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+
+	"golang.org/x/sys/unix"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/memory"
+)
+
+// ErrNoQueues is returned when no RX queues can be found for an interface.
+var ErrNoQueues = errors.New("no RX queues found")
+
+// PipelineFactory builds the pipeline for one queue's worker. Each worker
+// gets its own pipeline so stage state and counters stay core-local.
+//
+// Frames with an XDPTX verdict are transmitted back out of the queue they
+// arrived on. XDPPass, XDPDrop and XDPRedirect frames are recycled to the
+// fill ring: a packet delivered to AF_XDP has already left the kernel
+// stack, and the engine has no redirect target of its own. So a pass
+// verdict does not reach the host; WorkerStats.Passed counts those frames.
+type PipelineFactory func(queueID int) *Pipeline
+
+// EngineConfig holds configuration for the multi-queue engine.
+type EngineConfig struct {
+	InterfaceName string
+	NumQueues     int // 0 uses every RX queue of the interface
+	BatchSize     int // Descriptors moved per ring operation (max MaxBatchSize)
+	PollTimeoutMs int // Idle poll timeout; bounds shutdown latency
+	PinCPUs       bool
+	LatencySample int                 // Time one pipeline batch in this many (0 or 1: every batch)
+	UseHugepages  bool                // Back the frame pool with hugepages
+	HugepageSize  memory.HugepageSize // Page size when UseHugepages is set
+	Socket        XDPSocketConfig     // Per-queue template; QueueID is overridden
+	// OnError is called from a worker with its queue when polling fails,
+	// before the worker retries or, on a fatal error, stops (may be nil)
+	OnError func(queueID int, err error)
+}
+
+// DefaultEngineConfig returns sensible defaults for the engine.
+func DefaultEngineConfig(ifaceName string) EngineConfig {
+	return EngineConfig{
+		InterfaceName: ifaceName,
+		NumQueues:     0,
+		BatchSize:     64,
+		PollTimeoutMs: 100,
+		PinCPUs:       true,
+		LatencySample: 16,
+		Socket:        DefaultSocketConfig(ifaceName),
+	}
+}
+
+// Engine runs one AF_XDP socket per NIC RX queue, each driven by its own
+// worker goroutine locked to an OS thread pinned to a NIC-local CPU.
+//
+// All sockets share one frame pool, a memory.MemoryPool on the NIC's NUMA
+// node that each socket registers as its UMEM, unless the socket template
+// names a pool of its own.
+type Engine struct {
+	config   EngineConfig
+	workers  []*Worker
+	pool     *memory.MemoryPool
+	ownsPool bool
+
+	stopping atomic.Bool
+	wg       sync.WaitGroup
+}
+
+// Worker owns a single queue's socket. All ring access for the socket
+// happens on the worker's goroutine.
+type Worker struct {
+	queueID  int
+	cpu      int // Target CPU, -1 when not pinned
+	node     int // NUMA node of the NIC, -1 when unknown
+	sock     *XDPSocket
+	pipeline *Pipeline
+
+	// Counters are owned by the worker and added to once per batch;
+	// readers sum them at collection time
+	rxPackets atomic.Uint64
+	rxBytes   atomic.Uint64
+	txPackets atomic.Uint64
+	txBytes   atomic.Uint64
+	dropped   atomic.Uint64
+	passed    atomic.Uint64
+	pollErrs  atomic.Uint64
+}
+
+// WorkerStats holds a snapshot of a worker's counters.
+type WorkerStats struct {
+	QueueID    int
+	CPU        int
+	Node       int
+	RxPackets  uint64
+	RxBytes    uint64
+	TxPackets  uint64
+	TxBytes    uint64
+	Dropped    uint64 // Dropped by the pipeline or for want of TX ring space
+	Passed     uint64 // Passed or redirected by the pipeline, so not delivered
+	PollErrors uint64 // Failed polls of the socket
+	Stages     []StageStats
+}
+
+// NewEngine opens one socket per RX queue. The engine does not process
+// packets until Start is called.
+func NewEngine(config EngineConfig, newPipeline PipelineFactory) (*Engine, error) {
+	if newPipeline == nil {
+		return nil, errors.New("engine requires a pipeline factory")
+	}
+	if config.BatchSize <= 0 || config.BatchSize > MaxBatchSize {
+		config.BatchSize = MaxBatchSize
+	}
+	if config.PollTimeoutMs <= 0 {
+		config.PollTimeoutMs = 100
+	}
+
+	numQueues := config.NumQueues
+	if numQueues <= 0 {
+		var err error
+		numQueues, err = GetRxQueueCount(config.InterfaceName)
+		if err != nil {
+			return nil, err
+		}
+	}
+
+	node := InterfaceNUMANode(config.InterfaceName)
+	cpus := localCPUs(config.InterfaceName)
+
+	e := &Engine{
+		config:  config,
+		workers: make([]*Worker, 0, numQueues),
+		pool:    config.Socket.Pool,
+	}
+
+	if e.pool == nil {
+		pool, err := newFramePool(config, numQueues, node)
+		if err != nil {
+			return nil, err
+		}
+		e.pool = pool
+		e.ownsPool = true
+	}
+
+	for q := 0; q < numQueues; q++ {
+		sockCfg := config.Socket
+		sockCfg.InterfaceName = config.InterfaceName
+		sockCfg.QueueID = q
+		sockCfg.Pool = e.pool
+
+		sock, err := NewXDPSocket(sockCfg)
+		if err != nil {
+			e.closeSockets()
+			return nil, fmt.Errorf("queue %d: %w", q, err)
+		}
+
+		cpu := -1
+		if config.PinCPUs && len(cpus) > 0 {
+			cpu = cpus[q%len(cpus)]
+		}
+
+		pipeline := newPipeline(q)
+		pipeline.SetLatencySampleRate(config.LatencySample)
+
+		e.workers = append(e.workers, &Worker{
+			queueID:  q,
+			cpu:      cpu,
+			node:     node,
+			sock:     sock,
+			pipeline: pipeline,
+		})
+	}
+
+	return e, nil
+}
+
+// newFramePool allocates the shared frame pool: every socket's frames, on
+// the node that owns the NIC's PCIe slot, where the workers are pinned.
+// Frames are overwritten by the NIC, so released slots are not scrubbed.
+func newFramePool(config EngineConfig, numQueues, node int) (*memory.MemoryPool, error) {
+	if node < 0 {
+		node = 0
+	}
+
+	pool, err := memory.NewMemoryPool(memory.PoolConfig{
+		NumSlots:     numQueues * config.Socket.NumFrames,
+		SlotSize:     config.Socket.FrameSize,
+		NUMANodeID:   node,
+		UseHugepages: config.UseHugepages,
+		HugepageSize: config.HugepageSize,
+		Preallocate:  true,
+		CacheSize:    MaxBatchSize,
+		Scrub:        memory.ScrubNone,
+	})
+	if err != nil {
+		return nil, fmt.Errorf("%w: frame pool: %v", ErrUMEMSetup, err)
+	}
+	return pool, nil
+}
+
+// Start launches one worker goroutine per queue.
+func (e *Engine) Start() {
+	for _, w := range e.workers {
+		e.wg.Add(1)
+		go e.run(w)
+	}
+}
+
+// Stop signals all workers to exit, waits for them and closes the sockets.
+func (e *Engine) Stop() {
+	e.stopping.Store(true)
+	e.wg.Wait()
+	e.closeSockets()
+}
+
+// Pool returns the frame pool registered as every socket's UMEM.
+func (e *Engine) Pool() *memory.MemoryPool {
+	return e.pool
+}
+
+// Workers returns the engine's workers.
+func (e *Engine) Workers() []*Worker {
+	return e.workers
+}
+
+// Stats returns a snapshot of every worker's counters.
+func (e *Engine) Stats() []WorkerStats {
+	stats := make([]WorkerStats, len(e.workers))
+	for i, w := range e.workers {
+		stats[i] = w.Stats()
+	}
+	return stats
+}
+
+// Latency returns the per-stage latency of every worker, merged by stage.
+func (e *Engine) Latency() []StageLatency {
+	perWorker := make([][]StageLatency, len(e.workers))
+	for i, w := range e.workers {
+		perWorker[i] = w.pipeline.Latency()
+	}
+	return mergeStageLatency(perWorker)
+}
+
+// LatencySampleRate returns how many batches each timed batch stands for.
+func (e *Engine) LatencySampleRate() int {
+	if len(e.workers) == 0 {
+		return 1
+	}
+	return e.workers[0].pipeline.LatencySampleRate()
+}
+
+// Latency returns a snapshot of the worker's per-stage latency.
+func (w *Worker) Latency() []StageLatency {
+	return w.pipeline.Latency()
+}
+
+// Stats returns a snapshot of the worker's counters.
+func (w *Worker) Stats() WorkerStats {
+	return WorkerStats{
+		QueueID:    w.queueID,
+		CPU:        w.cpu,
+		Node:       w.node,
+		RxPackets:  w.rxPackets.Load(),
+		RxBytes:    w.rxBytes.Load(),
+		TxPackets:  w.txPackets.Load(),
+		TxBytes:    w.txBytes.Load(),
+		Dropped:    w.dropped.Load(),
+		Passed:     w.passed.Load(),
+		PollErrors: w.pollErrs.Load(),
+		Stages:     w.pipeline.Stats(),
+	}
+}
+
+// Node returns the NUMA node the worker is placed on, or -1 if the NIC
+// reports none.
+func (w *Worker) Node() int {
+	return w.node
+}
+
+// QueueID returns the NIC queue served by the worker.
+func (w *Worker) QueueID() int {
+	return w.queueID
+}
+
+// Socket returns the worker's AF_XDP socket.
+func (w *Worker) Socket() *XDPSocket {
+	return w.sock
+}
+
+// run is the worker loop: receive a batch, run it through the pipeline,
+// transmit XDPTX frames in one batch and recycle the rest to the fill ring.
+func (e *Engine) run(w *Worker) {
+	defer e.wg.Done()
+
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	// Pinning is best effort: without CAP_SYS_NICE or inside a restricted
+	// cpuset the worker keeps running on the scheduler's choice of CPU.
+	if w.cpu >= 0 {
+		var cpuSet unix.CPUSet
+		cpuSet.Set(w.cpu)
+		_ = unix.SchedSetaffinity(0, &cpuSet)
+	}
+
+	batch := e.config.BatchSize
+	sock := w.sock
+	rx := make([]Desc, batch)
+	tx := make([]Desc, 0, batch)
+	recycle := make([]uint64, 0, batch)
+	frames := &Batch{}
+
+	for !e.stopping.Load() {
+		// Reclaim transmitted frames and hand them back for receive
+		sock.Complete()
+		sock.Refill(batch)
+
+		n := sock.ReceiveBatch(rx)
+		if n == 0 {
+			if _, err := sock.Poll(e.config.PollTimeoutMs); err != nil {
+				w.pollErrs.Add(1)
+				if e.config.OnError != nil {
+					e.config.OnError(w.queueID, err)
+				}
+				if !retryablePoll(err) {
+					return
+				}
+			}
+			continue
+		}
+
+		frames.Reset()
+		var rxBytes uint64
+		for i := 0; i < n; i++ {
+			frames.Add(sock.Frame(rx[i]))
+			rxBytes += uint64(rx[i].Len)
+		}
+		verdicts := w.pipeline.Run(frames)
+
+		// Frames the pipeline dropped, and below those the TX ring had no
+		// room for. Passed and redirected frames are recycled too, so they
+		// are not delivered either, but are counted apart: AF_XDP cannot
+		// hand a frame back to the kernel stack
+		dropped := bits.OnesCount64(verdicts.Drop)
+		passed := bits.OnesCount64(verdicts.Pass | verdicts.Redirect)
+
+		tx = tx[:0]
+		recycle = recycle[:0]
+		for i := 0; i < n; i++ {
+			if verdicts.TX&(uint64(1)<<uint(i)) != 0 {
+				// Stages may have shortened the frame in place
+				tx = append(tx, Desc{Addr: rx[i].Addr, Len: uint32(len(frames.Frames[i]))})
+			} else {
+				recycle = append(recycle, rx[i].Addr)
+			}
+		}
+
+		if len(tx) > 0 {
+			sent := sock.SendBatch(tx)
+			var txBytes uint64
+			for _, d := range tx[:sent] {
+				txBytes += uint64(d.Len)
+			}
+			for _, d := range tx[sent:] {
+				recycle = append(recycle, d.Addr)
+			}
+			dropped += len(tx) - sent
+			w.txPackets.Add(uint64(sent))
+			w.txBytes.Add(txBytes)
+		}
+
+		if len(recycle) > 0 {
+			filled := sock.FillBatch(recycle)
+			for _, addr := range recycle[filled:] {
+				sock.FreeFrame(addr)
+			}
+		}
+
+		w.rxPackets.Add(uint64(n))
+		w.rxBytes.Add(rxBytes)
+		w.dropped.Add(uint64(dropped))
+		w.passed.Add(uint64(passed))
+	}
+}
+
+// retryablePoll reports whether a worker may poll again after err.
+func retryablePoll(err error) bool {
+	return errors.Is(err, unix.EINTR) || errors.Is(err, unix.EAGAIN) || errors.Is(err, unix.ENOMEM)
+}
+
+// closeSockets closes every worker socket, then frees the frame pool if the
+// engine allocated it.
+func (e *Engine) closeSockets() {
+	for _, w := range e.workers {
+		w.sock.Close()
+	}
+	if e.ownsPool {
+		e.pool.Close()
+		e.ownsPool = false
+	}
+}
+
+// GetRxQueueCount returns the number of RX queues of an interface.
+func GetRxQueueCount(ifaceName string) (int, error) {
+	matches, err := filepath.Glob(filepath.Join("/sys/class/net", ifaceName, "queues", "rx-*"))
+	if err != nil {
+		return 0, err
+	}
+	if len(matches) == 0 {
+		return 0, fmt.Errorf("%w: %s", ErrNoQueues, ifaceName)
+	}
+	return len(matches), nil
+}
+
+// InterfaceNUMANode returns the NUMA node of the PCIe slot behind an
+// interface, or -1 if the kernel does not report one (e.g. virtual devices).
+func InterfaceNUMANode(ifaceName string) int {
+	data, err := os.ReadFile(filepath.Join("/sys/class/net", ifaceName, "device", "numa_node"))
+	if err != nil {
+		return -1
+	}
+
+	node, err := strconv.Atoi(strings.TrimSpace(string(data)))
+	if err != nil {
+		return -1
+	}
+	return node
+}
+
+// localCPUs returns the CPUs on the interface's NUMA node, falling back to
+// every CPU when the NIC reports no node or NUMA is unavailable.
+func localCPUs(ifaceName string) []int {
+	info := memory.GetNUMAInfo()
+	node := InterfaceNUMANode(ifaceName)
+	if info.Available && node >= 0 {
+		if cpus := info.CPUsPerNode[node]; len(cpus) > 0 {
+			return cpus
+		}
+	}
+
+	cpus := make([]int, runtime.NumCPU())
+	for i := range cpus {
+		cpus[i] = i
+	}
+	return cpus
+}
@@ -0,0 +1,140 @@
+// Package xdp provides network interface counters over rtnetlink.
+package xdp
+
+import (
+	"encoding/binary"
+	"errors"
+	"os"
+	"path/filepath"
+	"strconv"
+	"syscall"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+// XDPStats holds network interface counters.
+type XDPStats struct {
+	RxPackets uint64
+	RxBytes   uint64
+	TxPackets uint64
+	TxBytes   uint64
+	Drops     uint64
+	Errors    uint64
+}
+
+// errNoLinkStats is returned when a link reply carries no IFLA_STATS64.
+var errNoLinkStats = errors.New("no IFLA_STATS64 in link reply")
+
+// GetInterfaceStats gets network interface statistics.
+//
+// The counters come from a single RTM_GETLINK request, one round trip in
+// place of opening and parsing six sysfs files; sysfs is the fallback when
+// netlink is unavailable.
+func GetInterfaceStats(ifaceName string) (*XDPStats, error) {
+	ifaceIdx, err := GetInterfaceIndex(ifaceName)
+	if err != nil {
+		return nil, err
+	}
+
+	if stats, err := linkStats(ifaceIdx); err == nil {
+		return stats, nil
+	}
+	return sysfsStats(ifaceName), nil
+}
+
+// linkStats reads struct rtnl_link_stats64 of an interface over rtnetlink.
+func linkStats(ifaceIdx int) (*XDPStats, error) {
+	fd, err := unix.Socket(unix.AF_NETLINK, unix.SOCK_RAW|unix.SOCK_CLOEXEC, unix.NETLINK_ROUTE)
+	if err != nil {
+		return nil, err
+	}
+	defer unix.Close(fd)
+
+	// struct nlmsghdr followed by struct ifinfomsg
+	var req [unix.SizeofNlMsghdr + unix.SizeofIfInfomsg]byte
+	hdr := (*unix.NlMsghdr)(unsafe.Pointer(&req[0]))
+	hdr.Len = uint32(len(req))
+	hdr.Type = unix.RTM_GETLINK
+	hdr.Flags = unix.NLM_F_REQUEST
+	hdr.Seq = 1
+	info := (*unix.IfInfomsg)(unsafe.Pointer(&req[unix.SizeofNlMsghdr]))
+	info.Family = unix.AF_UNSPEC
+	info.Index = int32(ifaceIdx)
+
+	if err := unix.Sendto(fd, req[:], 0, &unix.SockaddrNetlink{Family: unix.AF_NETLINK}); err != nil {
+		return nil, err
+	}
+
+	buf := make([]byte, 32*1024)
+	n, _, err := unix.Recvfrom(fd, buf, 0)
+	if err != nil {
+		return nil, err
+	}
+	msgs, err := syscall.ParseNetlinkMessage(buf[:n])
+	if err != nil {
+		return nil, err
+	}
+
+	for i := range msgs {
+		switch msgs[i].Header.Type {
+		case unix.NLMSG_ERROR:
+			if len(msgs[i].Data) >= 4 {
+				if errno := int32(binary.NativeEndian.Uint32(msgs[i].Data)); errno < 0 {
+					return nil, unix.Errno(-errno)
+				}
+			}
+		case unix.RTM_NEWLINK:
+			attrs, err := syscall.ParseNetlinkRouteAttr(&msgs[i])
+			if err != nil {
+				return nil, err
+			}
+			for _, attr := range attrs {
+				if attr.Attr.Type == unix.IFLA_STATS64 && len(attr.Value) >= 64 {
+					return parseLinkStats64(attr.Value), nil
+				}
+			}
+		}
+	}
+	return nil, errNoLinkStats
+}
+
+// parseLinkStats64 decodes the leading fields of struct rtnl_link_stats64:
+// rx/tx packets, rx/tx bytes, rx/tx errors, rx/tx dropped.
+func parseLinkStats64(b []byte) *XDPStats {
+	field := func(i int) uint64 { return binary.NativeEndian.Uint64(b[i*8:]) }
+	return &XDPStats{
+		RxPackets: field(0),
+		TxPackets: field(1),
+		RxBytes:   field(2),
+		TxBytes:   field(3),
+		Errors:    field(4),
+		Drops:     field(6),
+	}
+}
+
+// sysfsStats reads /sys/class/net/<iface>/statistics. Missing files leave
+// their counter at zero.
+func sysfsStats(ifaceName string) *XDPStats {
+	basePath := filepath.Join("/sys/class/net", ifaceName, "statistics")
+	return &XDPStats{
+		RxPackets: readStatFile(basePath + "/rx_packets"),
+		RxBytes:   readStatFile(basePath + "/rx_bytes"),
+		TxPackets: readStatFile(basePath + "/tx_packets"),
+		TxBytes:   readStatFile(basePath + "/tx_bytes"),
+		Drops:     readStatFile(basePath + "/rx_dropped"),
+		Errors:    readStatFile(basePath + "/rx_errors"),
+	}
+}
+
+func readStatFile(path string) uint64 {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return 0
+	}
+	if n := len(data); n > 0 && data[n-1] == '\n' {
+		data = data[:n-1]
+	}
+	value, _ := strconv.ParseUint(string(data), 10, 64)
+	return value
+}
@@ -0,0 +1,168 @@
+// Package xdp provides log-linear latency histograms for pipeline stages.
+package xdp
+
+import (
+	"math/bits"
+	"sync/atomic"
+	"time"
+)
+
+const (
+	// latencySubBits sets the histogram precision: each power of two is
+	// split into 16 linear buckets, bounding the relative error at 1/16.
+	latencySubBits = 4
+	latencySub     = 1 << latencySubBits
+	// latencyMaxShift caps recorded values just below 2^40 ns (~18 min).
+	latencyMaxShift = 40 - latencySubBits - 1
+	// latencyBuckets covers the exact [0, 16) range and every shift.
+	latencyBuckets = (latencyMaxShift + 2) * latencySub
+)
+
+// clockBase anchors monotime; time.Since on it reads only the monotonic
+// clock, one vDSO call where time.Now reads both clocks.
+var clockBase = time.Now()
+
+// monotime returns monotonic nanoseconds since process start.
+func monotime() int64 {
+	return int64(time.Since(clockBase))
+}
+
+// latencyBucket returns the bucket index of v nanoseconds.
+func latencyBucket(v uint64) int {
+	if v < latencySub {
+		return int(v)
+	}
+	shift := bits.Len64(v) - latencySubBits - 1
+	if shift > latencyMaxShift {
+		return latencyBuckets - 1
+	}
+	return (shift+1)*latencySub + int(v>>uint(shift)) - latencySub
+}
+
+// latencyBucketHigh returns the highest value that maps to bucket idx.
+func latencyBucketHigh(idx int) uint64 {
+	if idx < latencySub {
+		return uint64(idx)
+	}
+	shift := uint(idx/latencySub - 1)
+	mantissa := uint64(latencySub + idx%latencySub)
+	return (mantissa+1)<<shift - 1
+}
+
+// LatencyHistogram is an HDR-style log-linear histogram of nanosecond
+// latencies with a single writer. Record uses plain load/store atomics,
+// which cost no more than ordinary moves on amd64 and arm64, so the owning
+// worker never issues a locked instruction; readers take lock-free
+// snapshots that may be a few records behind.
+type LatencyHistogram struct {
+	counts [latencyBuckets]atomic.Uint64
+	count  atomic.Uint64
+	sum    atomic.Uint64
+	max    atomic.Uint64
+}
+
+// Record adds n observations of v nanoseconds. Only the owning worker may
+// call it.
+func (h *LatencyHistogram) Record(v, n uint64) {
+	c := &h.counts[latencyBucket(v)]
+	c.Store(c.Load() + n)
+	h.count.Store(h.count.Load() + n)
+	h.sum.Store(h.sum.Load() + v*n)
+	if v > h.max.Load() {
+		h.max.Store(v)
+	}
+}
+
+// Snapshot copies the histogram. It is safe to call from any goroutine.
+func (h *LatencyHistogram) Snapshot() LatencySnapshot {
+	s := LatencySnapshot{
+		Counts: make([]uint64, latencyBuckets),
+		Sum:    h.sum.Load(),
+		Max:    h.max.Load(),
+	}
+	for i := range h.counts {
+		s.Counts[i] = h.counts[i].Load()
+		s.Count += s.Counts[i]
+	}
+	return s
+}
+
+// LatencySnapshot is a point-in-time copy of a LatencyHistogram. Snapshots
+// of several workers combine with Merge.
+type LatencySnapshot struct {
+	Counts []uint64
+	Count  uint64 // Sum of Counts
+	Sum    uint64 // Nanoseconds
+	Max    uint64 // Nanoseconds
+}
+
+// Merge adds another snapshot into s.
+func (s *LatencySnapshot) Merge(o LatencySnapshot) {
+	if s.Counts == nil {
+		s.Counts = make([]uint64, latencyBuckets)
+	}
+	for i, c := range o.Counts {
+		s.Counts[i] += c
+	}
+	s.Count += o.Count
+	s.Sum += o.Sum
+	if o.Max > s.Max {
+		s.Max = o.Max
+	}
+}
+
+// Quantile returns the latency at quantile q (0 < q <= 1) in nanoseconds,
+// reported as the upper bound of its bucket and capped at Max.
+func (s *LatencySnapshot) Quantile(q float64) uint64 {
+	if s.Count == 0 {
+		return 0
+	}
+	rank := uint64(q*float64(s.Count) + 0.5)
+	if rank < 1 {
+		rank = 1
+	}
+
+	var seen uint64
+	for i, c := range s.Counts {
+		seen += c
+		if seen >= rank {
+			return min(latencyBucketHigh(i), s.Max)
+		}
+	}
+	return s.Max
+}
+
+// Mean returns the mean latency in nanoseconds.
+func (s *LatencySnapshot) Mean() float64 {
+	if s.Count == 0 {
+		return 0
+	}
+	return float64(s.Sum) / float64(s.Count)
+}
+
+// StageLatency is the latency distribution of one pipeline stage. Each
+// packet of a sampled batch is counted with the time the whole batch spent
+// in the stage, since no packet leaves before its batch does.
+type StageLatency struct {
+	Name string
+	LatencySnapshot
+}
+
+// mergeStageLatency merges per-worker stage latencies by stage name,
+// keeping the order they first appear in.
+func mergeStageLatency(perWorker [][]StageLatency) []StageLatency {
+	var out []StageLatency
+	index := make(map[string]int)
+	for _, stages := range perWorker {
+		for _, st := range stages {
+			i, ok := index[st.Name]
+			if !ok {
+				i = len(out)
+				index[st.Name] = i
+				out = append(out, StageLatency{Name: st.Name})
+			}
+			out[i].Merge(st.LatencySnapshot)
+		}
+	}
+	return out
+}
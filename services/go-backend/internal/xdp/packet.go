@@ -141,7 +141,7 @@ func (h *IPv4Header) Serialize(data []byte) error {
 	copy(data[16:20], h.DstIP.To4())
 
 	// Calculate and set checksum
-	h.Checksum = calculateIPChecksum(data[:headerLen])
+	h.Checksum = Checksum(data[:headerLen])
 	binary.BigEndian.PutUint16(data[10:12], h.Checksum)
 
 	return nil
@@ -241,28 +241,6 @@ func (e packetError) Error() string {
 	return string(e)
 }
 
-// calculateIPChecksum calculates the IPv4 header checksum.
-func calculateIPChecksum(header []byte) uint16 {
-	length := len(header)
-	var sum uint32
-
-	for i := 0; i < length-1; i += 2 {
-		sum += uint32(binary.BigEndian.Uint16(header[i : i+2]))
-	}
-
-	// Handle odd length
-	if length%2 == 1 {
-		sum += uint32(header[length-1]) << 8
-	}
-
-	// Fold 32-bit sum to 16 bits
-	for sum > 0xFFFF {
-		sum = (sum & 0xFFFF) + (sum >> 16)
-	}
-
-	return ^uint16(sum)
-}
-
 // PacketProcessor provides a pipeline for processing packets.
 type PacketProcessor struct {
 	handlers []PacketHandler
@@ -296,3 +274,9 @@ func (p *PacketProcessor) Process(data []byte) ([]byte, bool) {
 	}
 	return result, true
 }
+
+// AsStage wraps the handler chain as a single pipeline Stage, so existing
+// per-packet handlers can run inside a batched Pipeline.
+func (p *PacketProcessor) AsStage(name string) Stage {
+	return HandlerStage(name, p.Process)
+}
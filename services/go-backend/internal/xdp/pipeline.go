@@ -0,0 +1,335 @@
+// Package xdp provides a batched packet processing pipeline.
+package xdp
+
+import (
+	"math/bits"
+	"sync/atomic"
+)
+
+// MaxBatchSize is the number of frames a Batch can carry, one per bit of
+// a verdict bitmap.
+const MaxBatchSize = 64
+
+// Batch is a vector of frames moving through a Pipeline together.
+//
+// Stages walk the frames still in flight with the bitmap idiom:
+//
+//	for m := b.Active; m != 0; m &= m - 1 {
+//		i := bits.TrailingZeros64(m)
+//		// b.Frames[i], b.Views[i]
+//	}
+type Batch struct {
+	Frames [MaxBatchSize][]byte
+	Views  [MaxBatchSize]PacketView // Filled by DecodeStage
+	N      int
+	Active uint64 // Frames not yet given a verdict
+}
+
+// Reset empties the batch for reuse.
+func (b *Batch) Reset() {
+	b.N = 0
+	b.Active = 0
+}
+
+// Add appends a frame. Returns false if the batch is full.
+func (b *Batch) Add(frame []byte) bool {
+	if b.N == MaxBatchSize {
+		return false
+	}
+	b.Frames[b.N] = frame
+	b.N++
+	return true
+}
+
+// Verdicts holds one bitmap per XDPAction; bit i refers to frame i of a batch.
+// XDPAborted is recorded as a drop.
+type Verdicts struct {
+	Drop     uint64
+	Pass     uint64
+	TX       uint64
+	Redirect uint64
+}
+
+// Set records action a for frame i.
+func (v *Verdicts) Set(i int, a XDPAction) {
+	bit := uint64(1) << uint(i)
+	switch a {
+	case XDPAborted, XDPDrop:
+		v.Drop |= bit
+	case XDPPass:
+		v.Pass |= bit
+	case XDPTX:
+		v.TX |= bit
+	case XDPRedirect:
+		v.Redirect |= bit
+	}
+}
+
+// SetMask records action a for every frame in mask.
+func (v *Verdicts) SetMask(mask uint64, a XDPAction) {
+	switch a {
+	case XDPAborted, XDPDrop:
+		v.Drop |= mask
+	case XDPPass:
+		v.Pass |= mask
+	case XDPTX:
+		v.TX |= mask
+	case XDPRedirect:
+		v.Redirect |= mask
+	}
+}
+
+// Decided returns the frames that have any verdict.
+func (v *Verdicts) Decided() uint64 {
+	return v.Drop | v.Pass | v.TX | v.Redirect
+}
+
+// Action returns the verdict for frame i (XDPAborted if none was recorded).
+func (v *Verdicts) Action(i int) XDPAction {
+	bit := uint64(1) << uint(i)
+	switch {
+	case v.Drop&bit != 0:
+		return XDPDrop
+	case v.Pass&bit != 0:
+		return XDPPass
+	case v.TX&bit != 0:
+		return XDPTX
+	case v.Redirect&bit != 0:
+		return XDPRedirect
+	default:
+		return XDPAborted
+	}
+}
+
+// normalize restricts the verdicts to mask and resolves frames with more
+// than one verdict, with precedence drop > pass > tx > redirect.
+func (v *Verdicts) normalize(mask uint64) {
+	v.Drop &= mask
+	v.Pass &= mask &^ v.Drop
+	v.TX &= mask &^ (v.Drop | v.Pass)
+	v.Redirect &= mask &^ (v.Drop | v.Pass | v.TX)
+}
+
+// merge adds another set of (disjoint) verdicts.
+func (v *Verdicts) merge(o Verdicts) {
+	v.Drop |= o.Drop
+	v.Pass |= o.Pass
+	v.TX |= o.TX
+	v.Redirect |= o.Redirect
+}
+
+// Stage is one step of a Pipeline. Process inspects the frames set in
+// b.Active and records final verdicts for some of them in v; frames left
+// without a verdict continue to the next stage.
+type Stage interface {
+	Name() string
+	Process(b *Batch, v *Verdicts)
+}
+
+// StageFunc adapts a function to a Stage.
+type StageFunc struct {
+	StageName string
+	Fn        func(b *Batch, v *Verdicts)
+}
+
+// Name returns the stage name.
+func (s StageFunc) Name() string { return s.StageName }
+
+// Process runs the stage function.
+func (s StageFunc) Process(b *Batch, v *Verdicts) { s.Fn(b, v) }
+
+// StageStats holds the counters of one pipeline stage.
+type StageStats struct {
+	Name        string
+	Batches     uint64
+	Packets     uint64 // Frames seen by the stage
+	Drops       uint64 // Frames the stage dropped
+	Nanoseconds uint64 // Time spent in the stage, extrapolated from sampled batches
+}
+
+// stageCounters is updated once per batch by the pipeline's owner.
+type stageCounters struct {
+	batches atomic.Uint64
+	packets atomic.Uint64
+	drops   atomic.Uint64
+	nanos   atomic.Uint64
+}
+
+// Pipeline runs batches through a sequence of stages. Frames still
+// undecided after the last stage get the pipeline's default action.
+//
+// A Pipeline is driven by a single worker; build one per worker so the
+// stage counters are never shared between cores.
+//
+// One batch in every sample rate is timed: each stage's duration feeds its
+// latency histogram and, scaled by the rate, its Nanoseconds counter.
+// Unsampled batches read no clock.
+type Pipeline struct {
+	stages        []Stage
+	counters      []stageCounters
+	defaultAction XDPAction
+
+	latency     []LatencyHistogram // Per stage
+	total       LatencyHistogram   // Whole pipeline
+	sampleShift uint               // Time one batch in 1<<sampleShift
+	seq         uint64             // Batches run
+
+	// scratch is handed to each stage; passing a local through the Stage
+	// interface would make it escape and allocate once per stage per batch.
+	scratch Verdicts
+}
+
+// NewPipeline creates a pipeline with the given default action and stages.
+func NewPipeline(defaultAction XDPAction, stages ...Stage) *Pipeline {
+	return &Pipeline{
+		stages:        stages,
+		counters:      make([]stageCounters, len(stages)),
+		defaultAction: defaultAction,
+		latency:       make([]LatencyHistogram, len(stages)),
+	}
+}
+
+// SetLatencySampleRate times one batch in every (rounded up to a power of
+// two); 1 times every batch. It must be called before the pipeline runs.
+func (p *Pipeline) SetLatencySampleRate(every int) {
+	p.sampleShift = 0
+	for 1<<p.sampleShift < every && p.sampleShift < 16 {
+		p.sampleShift++
+	}
+}
+
+// LatencySampleRate returns the number of batches per timed batch.
+func (p *Pipeline) LatencySampleRate() int {
+	return 1 << p.sampleShift
+}
+
+// Run processes a batch and returns the verdict of every frame.
+func (p *Pipeline) Run(b *Batch) Verdicts {
+	var out Verdicts
+	if b.N == 0 {
+		return out
+	}
+
+	b.Active = ^uint64(0) >> uint(MaxBatchSize-b.N)
+
+	sampled := p.seq&(1<<p.sampleShift-1) == 0
+	p.seq++
+	var start, last int64
+	if sampled {
+		start = monotime()
+		last = start
+	}
+
+	for i, stage := range p.stages {
+		active := b.Active
+		if active == 0 {
+			break
+		}
+
+		v := &p.scratch
+		*v = Verdicts{}
+		stage.Process(b, v)
+
+		v.normalize(active)
+		out.merge(*v)
+		b.Active = active &^ v.Decided()
+
+		n := uint64(bits.OnesCount64(active))
+		c := &p.counters[i]
+		c.batches.Add(1)
+		c.packets.Add(n)
+		c.drops.Add(uint64(bits.OnesCount64(v.Drop)))
+
+		if sampled {
+			now := monotime()
+			elapsed := uint64(now - last)
+			last = now
+			c.nanos.Add(elapsed << p.sampleShift)
+			p.latency[i].Record(elapsed, n)
+		}
+	}
+
+	if sampled {
+		p.total.Record(uint64(last-start), uint64(b.N))
+	}
+
+	out.SetMask(b.Active, p.defaultAction)
+	b.Active = 0
+
+	return out
+}
+
+// Stats returns a snapshot of the per-stage counters.
+func (p *Pipeline) Stats() []StageStats {
+	stats := make([]StageStats, len(p.stages))
+	for i, stage := range p.stages {
+		c := &p.counters[i]
+		stats[i] = StageStats{
+			Name:        stage.Name(),
+			Batches:     c.batches.Load(),
+			Packets:     c.packets.Load(),
+			Drops:       c.drops.Load(),
+			Nanoseconds: c.nanos.Load(),
+		}
+	}
+	return stats
+}
+
+// Latency returns a snapshot of each stage's latency histogram, followed by
+// the whole pipeline's as stage "pipeline". It is safe to call while the
+// pipeline runs.
+func (p *Pipeline) Latency() []StageLatency {
+	out := make([]StageLatency, 0, len(p.stages)+1)
+	for i, stage := range p.stages {
+		out = append(out, StageLatency{Name: stage.Name(), LatencySnapshot: p.latency[i].Snapshot()})
+	}
+	return append(out, StageLatency{Name: "pipeline", LatencySnapshot: p.total.Snapshot()})
+}
+
+// DecodeStage decodes every frame into b.Views and drops frames that fail
+// to decode.
+type DecodeStage struct{}
+
+// NewDecodeStage creates a decode stage.
+func NewDecodeStage() *DecodeStage {
+	return &DecodeStage{}
+}
+
+// Name returns the stage name.
+func (s *DecodeStage) Name() string { return "decode" }
+
+// Process decodes the active frames.
+func (s *DecodeStage) Process(b *Batch, v *Verdicts) {
+	for m := b.Active; m != 0; m &= m - 1 {
+		i := bits.TrailingZeros64(m)
+		if Decode(b.Frames[i], &b.Views[i]) != nil {
+			v.Drop |= uint64(1) << uint(i)
+		}
+	}
+}
+
+// handlerStage runs a per-packet PacketHandler over a batch.
+type handlerStage struct {
+	name    string
+	handler PacketHandler
+}
+
+// HandlerStage adapts a per-packet PacketHandler to a Stage. A handler
+// returning false drops the frame; the returned slice replaces the frame,
+// so handlers may only shorten or rewrite it in place.
+func HandlerStage(name string, h PacketHandler) Stage {
+	return &handlerStage{name: name, handler: h}
+}
+
+func (s *handlerStage) Name() string { return s.name }
+
+func (s *handlerStage) Process(b *Batch, v *Verdicts) {
+	for m := b.Active; m != 0; m &= m - 1 {
+		i := bits.TrailingZeros64(m)
+		out, cont := s.handler(b.Frames[i])
+		b.Frames[i] = out
+		if !cont {
+			v.Drop |= uint64(1) << uint(i)
+		}
+	}
+}
@@ -0,0 +1,132 @@
+package xdp
+
+import (
+	"math/bits"
+	"testing"
+)
+
+// TestPipelineVerdicts verifies stage ordering, precedence and the default action.
+func TestPipelineVerdicts(t *testing.T) {
+	dropOdd := StageFunc{StageName: "drop-odd", Fn: func(b *Batch, v *Verdicts) {
+		for m := b.Active; m != 0; m &= m - 1 {
+			if i := bits.TrailingZeros64(m); i%2 == 1 {
+				v.Set(i, XDPDrop)
+			}
+		}
+	}}
+	txFirst := StageFunc{StageName: "tx-first", Fn: func(b *Batch, v *Verdicts) {
+		// Frame 1 was already dropped, so only frame 0 may be transmitted
+		v.SetMask(0b11, XDPTX)
+	}}
+
+	p := NewPipeline(XDPPass, NewDecodeStage(), dropOdd, txFirst)
+
+	var b Batch
+	for i := 0; i < 5; i++ {
+		b.Add(buildTCPv4())
+	}
+	b.Frames[4] = b.Frames[4][:10] // Truncated, dropped by decode
+
+	v := p.Run(&b)
+
+	expected := []XDPAction{XDPTX, XDPDrop, XDPPass, XDPDrop, XDPDrop}
+	for i, want := range expected {
+		if got := v.Action(i); got != want {
+			t.Errorf("frame %d: expected %v, got %v", i, want, got)
+		}
+	}
+
+	stats := p.Stats()
+	if stats[0].Packets != 5 || stats[0].Drops != 1 {
+		t.Errorf("decode stage: expected 5 packets/1 drop, got %d/%d", stats[0].Packets, stats[0].Drops)
+	}
+	if stats[2].Packets != 2 {
+		t.Errorf("tx stage: expected 2 packets, got %d", stats[2].Packets)
+	}
+}
+
+// TestLatencyHistogram checks bucket precision, quantiles and merging.
+func TestLatencyHistogram(t *testing.T) {
+	for _, v := range []uint64{0, 1, 15, 16, 17, 1000, 123456, 1 << 30} {
+		if high := latencyBucketHigh(latencyBucket(v)); high < v || float64(high-v) > float64(v)/latencySub {
+			t.Errorf("value %d: expected bucket bound within 1/%d, got %d", v, latencySub, high)
+		}
+	}
+
+	// Two workers: a fast one and one with a slow tail
+	var fast, slow LatencyHistogram
+	for i := uint64(1); i <= 1000; i++ {
+		fast.Record(i*100, 1)
+	}
+	slow.Record(5_000_000, 1)
+
+	merged := mergeStageLatency([][]StageLatency{
+		{{Name: "inspect", LatencySnapshot: fast.Snapshot()}},
+		{{Name: "inspect", LatencySnapshot: slow.Snapshot()}},
+	})
+	if len(merged) != 1 || merged[0].Count != 1001 {
+		t.Fatalf("expected one stage with 1001 samples, got %+v", merged)
+	}
+	s := merged[0].LatencySnapshot
+	if p50 := s.Quantile(0.5); p50 < 50000 || p50 > 50000+50000/latencySub {
+		t.Errorf("expected p50 near 50000, got %d", p50)
+	}
+	if p999 := s.Quantile(0.999); p999 < 99900 || p999 > 100000+100000/latencySub {
+		t.Errorf("expected p99.9 near 100000, got %d", p999)
+	}
+	if max := s.Quantile(1); max != 5_000_000 {
+		t.Errorf("expected max 5000000, got %d", max)
+	}
+
+	// A sampled pipeline times one batch in four
+	p := NewPipeline(XDPPass, NewDecodeStage())
+	p.SetLatencySampleRate(3)
+	var b Batch
+	for i := 0; i < 8; i++ {
+		b.Reset()
+		b.Add(buildTCPv4())
+		p.Run(&b)
+	}
+	if lat := p.Latency(); lat[0].Count != 2 || lat[1].Name != "pipeline" || lat[1].Count != 2 {
+		t.Errorf("expected 2 sampled packets per stage, got %d and %d", lat[0].Count, lat[1].Count)
+	}
+}
+
+// BenchmarkPipeline measures a full 64-frame batch through decode and a
+// per-packet handler stage.
+func BenchmarkPipeline(b *testing.B) {
+	proc := NewPacketProcessor()
+	proc.AddHandler(func(data []byte) ([]byte, bool) { return data, true })
+	p := NewPipeline(XDPPass, NewDecodeStage(), proc.AsStage("handlers"))
+
+	frame := buildTCPv4()
+	var batch Batch
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		batch.Reset()
+		for batch.Add(frame) {
+		}
+		p.Run(&batch)
+	}
+	b.ReportMetric(float64(b.Elapsed().Nanoseconds())/float64(b.N*MaxBatchSize), "ns/pkt")
+}
+
+// BenchmarkPacketProcessor measures the per-packet handler chain on its own,
+// outside a batch.
+func BenchmarkPacketProcessor(b *testing.B) {
+	proc := NewPacketProcessor()
+	var v PacketView
+	proc.AddHandler(func(data []byte) ([]byte, bool) { return data, Decode(data, &v) == nil })
+	proc.AddHandler(func(data []byte) ([]byte, bool) { return data, v.DstPort == 443 })
+
+	frame := buildTCPv4()
+
+	b.ReportAllocs()
+	b.SetBytes(int64(len(frame)))
+	for i := 0; i < b.N; i++ {
+		if _, ok := proc.Process(frame); !ok {
+			b.Fatal("unexpected drop")
+		}
+	}
+}
@@ -0,0 +1,245 @@
+// Package xdp provides in-place header rewrites with incremental checksums.
+package xdp
+
+import "encoding/binary"
+
+// The rewrite methods modify the frame a PacketView was decoded from and
+// keep the IPv4 header and TCP/UDP/ICMPv6 checksums valid with RFC 1624
+// incremental updates, so NAT and TTL rewrites never re-sum the packet.
+
+// l4ChecksumOffset returns the offset of the transport checksum field, or
+// -1 if the transport header was not decoded or carries no checksum
+// covering the pseudo-header.
+func (v *PacketView) l4ChecksumOffset() int {
+	if !v.Has(LayerL4) {
+		return -1
+	}
+	off := int(v.L4Offset)
+	switch v.Protocol {
+	case IPProtoTCP:
+		off += 16
+	case IPProtoUDP:
+		off += 6
+	case IPProtoICMPv6:
+		off += 2
+	default:
+		return -1
+	}
+	if off+2 > len(v.data) {
+		return -1
+	}
+	return off
+}
+
+// updateL4Checksum applies a pseudo-header or port change to the transport
+// checksum. UDP over IPv4 with checksum zero (none) is left alone.
+func (v *PacketView) updateL4Checksum(update func(uint16) uint16) {
+	off := v.l4ChecksumOffset()
+	if off < 0 {
+		return
+	}
+	check := binary.BigEndian.Uint16(v.data[off:])
+	if v.Protocol == IPProtoUDP {
+		if check == 0 && v.IPVersion == 4 {
+			return
+		}
+		if check = update(check); check == 0 {
+			check = 0xFFFF
+		}
+	} else {
+		check = update(check)
+	}
+	binary.BigEndian.PutUint16(v.data[off:], check)
+}
+
+// DecrementTTL decrements the IPv4 TTL or IPv6 hop limit, updating the IPv4
+// header checksum. Returns false, leaving the packet unchanged, if the TTL
+// would reach zero and the packet must be dropped.
+func (v *PacketView) DecrementTTL() bool {
+	if !v.Has(LayerL3) || v.TTL <= 1 {
+		return false
+	}
+
+	l3 := v.data[v.L3Offset:]
+	switch v.IPVersion {
+	case 4:
+		// TTL shares a 16-bit word with the protocol
+		old := binary.BigEndian.Uint16(l3[8:])
+		l3[8]--
+		check := binary.BigEndian.Uint16(l3[10:])
+		binary.BigEndian.PutUint16(l3[10:], ChecksumUpdate16(check, old, old-0x0100))
+	case 6:
+		l3[7]--
+	}
+	v.TTL--
+	return true
+}
+
+// rewriteIPv4 replaces the address at l3 offset off (12 or 16).
+func (v *PacketView) rewriteIPv4(off int, cur *[4]byte, addr [4]byte) bool {
+	if !v.Has(LayerL3) || v.IPVersion != 4 {
+		return false
+	}
+
+	l3 := v.data[v.L3Offset:]
+	old := binary.BigEndian.Uint32(cur[:])
+	new := binary.BigEndian.Uint32(addr[:])
+
+	binary.BigEndian.PutUint32(l3[off:], new)
+	check := binary.BigEndian.Uint16(l3[10:])
+	binary.BigEndian.PutUint16(l3[10:], ChecksumUpdate32(check, old, new))
+
+	if v.Protocol != IPProtoICMP {
+		v.updateL4Checksum(func(c uint16) uint16 { return ChecksumUpdate32(c, old, new) })
+	}
+	*cur = addr
+	return true
+}
+
+// SetSrcIPv4 rewrites the IPv4 source address (SNAT).
+// Returns false if the packet is not IPv4.
+func (v *PacketView) SetSrcIPv4(addr [4]byte) bool {
+	return v.rewriteIPv4(12, &v.SrcIP4, addr)
+}
+
+// SetDstIPv4 rewrites the IPv4 destination address (DNAT).
+// Returns false if the packet is not IPv4.
+func (v *PacketView) SetDstIPv4(addr [4]byte) bool {
+	return v.rewriteIPv4(16, &v.DstIP4, addr)
+}
+
+// rewriteIPv6 replaces the address at l3 offset off (8 or 24).
+func (v *PacketView) rewriteIPv6(off int, cur *[16]byte, addr [16]byte) bool {
+	if !v.Has(LayerL3) || v.IPVersion != 6 {
+		return false
+	}
+
+	old := *cur
+	copy(v.data[int(v.L3Offset)+off:], addr[:])
+	v.updateL4Checksum(func(c uint16) uint16 { return ChecksumUpdateBytes(c, old[:], addr[:]) })
+	*cur = addr
+	return true
+}
+
+// SetSrcIPv6 rewrites the IPv6 source address.
+// Returns false if the packet is not IPv6.
+func (v *PacketView) SetSrcIPv6(addr [16]byte) bool {
+	return v.rewriteIPv6(8, &v.SrcIP6, addr)
+}
+
+// SetDstIPv6 rewrites the IPv6 destination address.
+// Returns false if the packet is not IPv6.
+func (v *PacketView) SetDstIPv6(addr [16]byte) bool {
+	return v.rewriteIPv6(24, &v.DstIP6, addr)
+}
+
+// rewritePort replaces the TCP/UDP port at l4 offset off (0 or 2).
+func (v *PacketView) rewritePort(off int, cur *uint16, port uint16) bool {
+	if !v.Has(LayerL4) || (v.Protocol != IPProtoTCP && v.Protocol != IPProtoUDP) {
+		return false
+	}
+
+	old := *cur
+	binary.BigEndian.PutUint16(v.data[int(v.L4Offset)+off:], port)
+	v.updateL4Checksum(func(c uint16) uint16 { return ChecksumUpdate16(c, old, port) })
+	*cur = port
+	return true
+}
+
+// SetSrcPort rewrites the TCP/UDP source port.
+// Returns false if the packet has no decoded TCP/UDP header.
+func (v *PacketView) SetSrcPort(port uint16) bool {
+	return v.rewritePort(0, &v.SrcPort, port)
+}
+
+// SetDstPort rewrites the TCP/UDP destination port.
+// Returns false if the packet has no decoded TCP/UDP header.
+func (v *PacketView) SetDstPort(port uint16) bool {
+	return v.rewritePort(2, &v.DstPort, port)
+}
+
+// l4Segment returns the transport header and payload, bounded by the IP
+// length fields so Ethernet padding is excluded.
+func (v *PacketView) l4Segment() []byte {
+	end := len(v.data)
+	l3 := int(v.L3Offset)
+	switch v.IPVersion {
+	case 4:
+		if n := l3 + int(binary.BigEndian.Uint16(v.data[l3+2:])); n < end {
+			end = n
+		}
+	case 6:
+		if n := l3 + IPv6HeaderSize + int(binary.BigEndian.Uint16(v.data[l3+4:])); n < end {
+			end = n
+		}
+	}
+	if int(v.L4Offset) > end {
+		return nil
+	}
+	return v.data[v.L4Offset:end]
+}
+
+// L4Checksum computes the transport checksum the packet should carry,
+// ignoring the value currently in the checksum field. Returns false for
+// fragments and protocols without a pseudo-header checksum.
+func (v *PacketView) L4Checksum() (uint16, bool) {
+	off := v.l4ChecksumOffset()
+	if off < 0 || v.Fragment {
+		return 0, false
+	}
+	segment := v.l4Segment()
+	if segment == nil {
+		return 0, false
+	}
+
+	// Sum the segment as is, then subtract the stored checksum
+	var sum uint32
+	if v.IPVersion == 4 {
+		sum = PseudoHeaderSumIPv4(v.SrcIP4, v.DstIP4, v.Protocol, uint16(len(segment)))
+	} else {
+		sum = PseudoHeaderSumIPv6(&v.SrcIP6, &v.DstIP6, v.Protocol, uint32(len(segment)))
+	}
+	sum = PartialChecksum(segment, sum) + uint32(^binary.BigEndian.Uint16(v.data[off:]))
+
+	check := FinishChecksum(sum)
+	if check == 0 && v.Protocol == IPProtoUDP {
+		check = 0xFFFF
+	}
+	return check, true
+}
+
+// SetL4Checksum recomputes and stores the transport checksum, for packets
+// whose payload changed.
+func (v *PacketView) SetL4Checksum() bool {
+	check, ok := v.L4Checksum()
+	if !ok {
+		return false
+	}
+	binary.BigEndian.PutUint16(v.data[v.l4ChecksumOffset():], check)
+	return true
+}
+
+// VerifyChecksums reports whether the IPv4 header checksum and the
+// transport checksum (where computable) are valid.
+func (v *PacketView) VerifyChecksums() bool {
+	if !v.Has(LayerL3) {
+		return false
+	}
+	if v.IPVersion == 4 {
+		headerLen := int(v.data[v.L3Offset]&0x0F) * 4
+		if Checksum(v.data[v.L3Offset:int(v.L3Offset)+headerLen]) != 0 {
+			return false
+		}
+	}
+
+	off := v.l4ChecksumOffset()
+	if off < 0 {
+		return true
+	}
+	stored := binary.BigEndian.Uint16(v.data[off:])
+	if stored == 0 && v.Protocol == IPProtoUDP && v.IPVersion == 4 {
+		return true // No checksum
+	}
+	check, ok := v.L4Checksum()
+	return !ok || check == stored
+}
@@ -4,10 +4,14 @@ package xdp
 import (
 	"errors"
 	"fmt"
+	"math/bits"
 	"sync"
+	"sync/atomic"
 	"unsafe"
 
 	"golang.org/x/sys/unix"
+
+	"github.com/penguintechinc/cerberus/services/go-backend/internal/memory"
 )
 
 var (
@@ -17,6 +21,17 @@ var (
 	ErrUMEMSetup = errors.New("failed to setup UMEM")
 	// ErrRingSetup is returned when ring buffer setup fails.
 	ErrRingSetup = errors.New("failed to setup ring buffers")
+	// ErrSocketClosed is returned when operating on a closed socket.
+	ErrSocketClosed = errors.New("socket closed")
+	// ErrPacketTooLarge is returned when a packet does not fit in a UMEM frame.
+	ErrPacketTooLarge = errors.New("packet too large")
+	// ErrNoFreeFrames is returned when no UMEM frame is available for TX.
+	ErrNoFreeFrames = errors.New("no free UMEM frames")
+	// ErrTxRingFull is returned when the TX ring has no room for a descriptor.
+	ErrTxRingFull = errors.New("TX ring full")
+	// ErrForeignBuffer is returned when a Buffer does not belong to the
+	// memory pool registered as the socket's UMEM.
+	ErrForeignBuffer = errors.New("buffer is not from the socket's UMEM pool")
 )
 
 // AF_XDP socket constants
@@ -25,18 +40,29 @@ const (
 	SOL_XDP = 283
 
 	// XDP socket options
-	XDP_MMAP_OFFSETS     = 1
-	XDP_RX_RING          = 2
-	XDP_TX_RING          = 3
-	XDP_UMEM_REG         = 4
-	XDP_UMEM_FILL_RING   = 5
+	XDP_MMAP_OFFSETS         = 1
+	XDP_RX_RING              = 2
+	XDP_TX_RING              = 3
+	XDP_UMEM_REG             = 4
+	XDP_UMEM_FILL_RING       = 5
 	XDP_UMEM_COMPLETION_RING = 6
-	XDP_STATISTICS       = 7
+	XDP_STATISTICS           = 7
 
 	// XDP bind flags
-	XDP_SHARED_UMEM = 1 << 0
-	XDP_COPY        = 1 << 1
-	XDP_ZEROCOPY    = 1 << 2
+	XDP_SHARED_UMEM     = 1 << 0
+	XDP_COPY            = 1 << 1
+	XDP_ZEROCOPY        = 1 << 2
+	XDP_USE_NEED_WAKEUP = 1 << 3
+
+	// XDP_RING_NEED_WAKEUP is set in a ring's flags word when the kernel
+	// must be kicked (sendto/poll) to make progress on that ring.
+	XDP_RING_NEED_WAKEUP = 1 << 0
+
+	// mmap page offsets for the four rings
+	XDP_PGOFF_RX_RING              = 0
+	XDP_PGOFF_TX_RING              = 0x80000000
+	XDP_UMEM_PGOFF_FILL_RING       = 0x100000000
+	XDP_UMEM_PGOFF_COMPLETION_RING = 0x180000000
 )
 
 // XDPSocketConfig holds configuration for an AF_XDP socket.
@@ -45,11 +71,20 @@ type XDPSocketConfig struct {
 	QueueID       int
 	NumFrames     int
 	FrameSize     int
-	RxRingSize    int
-	TxRingSize    int
-	FillRingSize  int
-	CompRingSize  int
+	FrameHeadroom int // Bytes reserved by the kernel in front of each RX packet
+	RxRingSize    int // Must be a power of two
+	TxRingSize    int // Must be a power of two
+	FillRingSize  int // Must be a power of two
+	CompRingSize  int // Must be a power of two
 	ZeroCopy      bool
+	NeedWakeup    bool // Bind with XDP_USE_NEED_WAKEUP to skip unneeded kicks
+
+	// Pool, if set, is registered as the UMEM instead of a private mapping,
+	// so its slots are the frames: NumFrames slots are taken from it for
+	// the socket and FrameSize must equal its slot size. Several sockets
+	// may share one pool; each registers the whole region and only uses
+	// the slots it holds.
+	Pool *memory.MemoryPool
 }
 
 // DefaultSocketConfig returns sensible defaults for AF_XDP socket.
@@ -59,54 +94,201 @@ func DefaultSocketConfig(ifaceName string) XDPSocketConfig {
 		QueueID:       0,
 		NumFrames:     4096,
 		FrameSize:     2048,
+		FrameHeadroom: 0,
 		RxRingSize:    2048,
 		TxRingSize:    2048,
 		FillRingSize:  2048,
 		CompRingSize:  2048,
 		ZeroCopy:      false, // Start with copy mode for compatibility
+		NeedWakeup:    true,
 	}
 }
 
+// Desc describes a packet in the UMEM. Its layout matches the kernel's
+// struct xdp_desc so RX/TX ring entries can be copied without conversion.
+type Desc struct {
+	Addr    uint64 // Byte offset of the packet data within the UMEM
+	Len     uint32
+	Options uint32
+}
+
+// xdpUmemReg mirrors the kernel's struct xdp_umem_reg.
+type xdpUmemReg struct {
+	Addr     uint64
+	Len      uint64
+	Size     uint32
+	Headroom uint32
+	Flags    uint32
+	_        uint32
+}
+
 // UMEM represents the shared memory region for AF_XDP.
 type UMEM struct {
 	data      []byte
 	numFrames int
 	frameSize int
 	headroom  int
+
+	// Set when the region belongs to a memory.MemoryPool. owned is a
+	// bitmap of the slots the socket holds (free, in a ring, or in
+	// flight); frames handed out as Buffers leave it until sent back.
+	pool  *memory.MemoryPool
+	cache *memory.PoolCache
+	owned []uint64
+}
+
+// own records that the socket holds the frame at addr.
+func (u *UMEM) own(addr uint64) {
+	i := addr / uint64(u.frameSize)
+	u.owned[i/64] |= 1 << (i % 64)
+}
+
+// disown records that the frame at addr left the socket.
+func (u *UMEM) disown(addr uint64) {
+	i := addr / uint64(u.frameSize)
+	u.owned[i/64] &^= 1 << (i % 64)
+}
+
+// acquire takes a frame from the pool. Returns false if it is exhausted.
+func (u *UMEM) acquire() (uint64, bool) {
+	idx, _, err := u.cache.Acquire()
+	if err != nil {
+		return 0, false
+	}
+	addr := u.pool.SlotAddr(idx)
+	u.own(addr)
+	return addr, true
+}
+
+// releaseAll returns every frame the socket holds to the pool. The socket
+// must be closed so the kernel no longer writes to them.
+func (u *UMEM) releaseAll() {
+	for w, b := range u.owned {
+		for b != 0 {
+			u.cache.Release(w*64 + bits.TrailingZeros64(b))
+			b &= b - 1
+		}
+		u.owned[w] = 0
+	}
+	u.cache.Flush()
 }
 
 // XDPRing represents a ring buffer for AF_XDP.
+//
+// The producer and consumer indices live in memory shared with the kernel.
+// Each ring has exactly one user-space side, so the cached copies are only
+// refreshed from shared memory when they cannot satisfy a request, which
+// keeps the shared cache lines off the per-packet path.
 type XDPRing struct {
-	producer *uint32
-	consumer *uint32
-	desc     unsafe.Pointer
-	mask     uint32
-	size     uint32
-	cached   uint32
+	producer   *uint32
+	consumer   *uint32
+	flags      *uint32
+	desc       unsafe.Pointer
+	mask       uint32
+	size       uint32
+	cachedProd uint32
+	cachedCons uint32
+	mem        []byte
+}
+
+// free returns the number of free entries in a producer ring, reloading the
+// kernel's consumer index only if the cached view has fewer than n entries.
+func (r *XDPRing) free(n uint32) uint32 {
+	free := r.cachedCons - r.cachedProd
+	if free >= n {
+		return free
+	}
+	r.cachedCons = atomic.LoadUint32(r.consumer) + r.size
+	return r.cachedCons - r.cachedProd
+}
+
+// reserve claims up to n entries in a producer ring.
+// Returns the first ring index and the number of entries reserved.
+func (r *XDPRing) reserve(n uint32) (uint32, uint32) {
+	if free := r.free(n); free < n {
+		n = free
+	}
+	idx := r.cachedProd
+	r.cachedProd += n
+	return idx, n
+}
+
+// submit publishes all reserved entries to the kernel with a single store.
+func (r *XDPRing) submit() {
+	atomic.StoreUint32(r.producer, r.cachedProd)
+}
+
+// peek claims up to n filled entries in a consumer ring, reloading the
+// kernel's producer index only if the cached view has fewer than n entries.
+// Returns the first ring index and the number of entries available.
+func (r *XDPRing) peek(n uint32) (uint32, uint32) {
+	entries := r.cachedProd - r.cachedCons
+	if entries < n {
+		r.cachedProd = atomic.LoadUint32(r.producer)
+		entries = r.cachedProd - r.cachedCons
+	}
+	if entries > n {
+		entries = n
+	}
+	idx := r.cachedCons
+	r.cachedCons += entries
+	return idx, entries
+}
+
+// release hands all peeked entries back to the kernel with a single store.
+func (r *XDPRing) release() {
+	atomic.StoreUint32(r.consumer, r.cachedCons)
+}
+
+// needsWakeup reports whether the kernel asked to be kicked for this ring.
+func (r *XDPRing) needsWakeup() bool {
+	return atomic.LoadUint32(r.flags)&XDP_RING_NEED_WAKEUP != 0
+}
+
+// descAt returns the descriptor slot for ring index i (RX/TX rings).
+func (r *XDPRing) descAt(i uint32) *Desc {
+	return (*Desc)(unsafe.Add(r.desc, uintptr(i&r.mask)*unsafe.Sizeof(Desc{})))
+}
+
+// addrAt returns the address slot for ring index i (fill/completion rings).
+func (r *XDPRing) addrAt(i uint32) *uint64 {
+	return (*uint64)(unsafe.Add(r.desc, uintptr(i&r.mask)*8))
 }
 
 // XDPSocket represents an AF_XDP socket for high-performance packet I/O.
+//
+// The ring methods (Receive, ReceiveBatch, Send, SendBatch, FillBatch,
+// ReturnFrame, Complete) are not safe for concurrent use: each socket is
+// meant to be driven by a single worker goroutine.
 type XDPSocket struct {
-	fd         int
-	ifaceIdx   int
-	queueID    int
-	umem       *UMEM
-	rxRing     *XDPRing
-	txRing     *XDPRing
-	fillRing   *XDPRing
-	compRing   *XDPRing
-	config     XDPSocketConfig
-
-	rxChan chan []byte
-	txChan chan []byte
+	fd       int
+	ifaceIdx int
+	queueID  int
+	umem     *UMEM
+	rxRing   *XDPRing
+	txRing   *XDPRing
+	fillRing *XDPRing
+	compRing *XDPRing
+	config   XDPSocketConfig
+
+	// freeFrames is a stack of UMEM frame addresses owned by user space
+	// and available for TX.
+	freeFrames []uint64
+
+	// outstandingTx counts descriptors submitted to TX and not yet completed.
+	outstandingTx uint32
 
 	mu     sync.Mutex
-	closed bool
+	closed atomic.Bool
 }
 
 // NewXDPSocket creates a new AF_XDP socket.
 // Note: This requires CAP_NET_ADMIN and CAP_SYS_ADMIN capabilities.
 func NewXDPSocket(config XDPSocketConfig) (*XDPSocket, error) {
+	if err := validateSocketConfig(config); err != nil {
+		return nil, err
+	}
+
 	ifaceIdx, err := GetInterfaceIndex(config.InterfaceName)
 	if err != nil {
 		return nil, err
@@ -123,8 +305,6 @@ func NewXDPSocket(config XDPSocketConfig) (*XDPSocket, error) {
 		ifaceIdx: ifaceIdx,
 		queueID:  config.QueueID,
 		config:   config,
-		rxChan:   make(chan []byte, config.RxRingSize),
-		txChan:   make(chan []byte, config.TxRingSize),
 	}
 
 	// Setup UMEM
@@ -145,11 +325,48 @@ func NewXDPSocket(config XDPSocketConfig) (*XDPSocket, error) {
 		return nil, err
 	}
 
+	sock.populateFillRing()
+
 	return sock, nil
 }
 
-// setupUMEM allocates and registers the UMEM region.
+// validateSocketConfig checks frame and ring geometry before touching the kernel.
+func validateSocketConfig(config XDPSocketConfig) error {
+	if config.NumFrames <= 0 || config.FrameSize <= 0 {
+		return fmt.Errorf("%w: invalid frame geometry", ErrUMEMSetup)
+	}
+	if config.FrameHeadroom < 0 || config.FrameHeadroom >= config.FrameSize {
+		return fmt.Errorf("%w: headroom must be smaller than frame size", ErrUMEMSetup)
+	}
+	if pool := config.Pool; pool != nil {
+		// Aligned-mode chunks are a power of two from 2 KiB to a page
+		size := pool.SlotSize()
+		if size != config.FrameSize {
+			return fmt.Errorf("%w: pool slot size %d does not match frame size %d", ErrUMEMSetup, size, config.FrameSize)
+		}
+		if size < 2048 || size > unix.Getpagesize() || size&(size-1) != 0 {
+			return fmt.Errorf("%w: pool slot size %d is not a power of two between 2048 and the page size", ErrUMEMSetup, size)
+		}
+		if pool.Region() == nil {
+			return fmt.Errorf("%w: pool is not preallocated", ErrUMEMSetup)
+		}
+	}
+
+	for _, size := range []int{config.RxRingSize, config.TxRingSize, config.FillRingSize, config.CompRingSize} {
+		if size <= 0 || size&(size-1) != 0 {
+			return fmt.Errorf("%w: ring size %d is not a power of two", ErrRingSetup, size)
+		}
+	}
+	return nil
+}
+
+// setupUMEM allocates and registers the UMEM region and puts every frame
+// on the free stack.
 func (s *XDPSocket) setupUMEM() error {
+	if s.config.Pool != nil {
+		return s.setupPoolUMEM()
+	}
+
 	totalSize := s.config.NumFrames * s.config.FrameSize
 
 	// Allocate page-aligned memory
@@ -160,50 +377,148 @@ func (s *XDPSocket) setupUMEM() error {
 		return fmt.Errorf("%w: mmap failed: %v", ErrUMEMSetup, err)
 	}
 
-	// Lock memory to prevent swapping
-	if err := unix.Mlock(data); err != nil {
-		// Non-fatal, continue anyway
-	}
+	// Lock memory to prevent swapping (non-fatal if it fails)
+	_ = unix.Mlock(data)
 
 	s.umem = &UMEM{
 		data:      data,
 		numFrames: s.config.NumFrames,
 		frameSize: s.config.FrameSize,
+		headroom:  s.config.FrameHeadroom,
 	}
 
 	// Register UMEM with kernel
-	// This would use the XDP_UMEM_REG socket option
-	// Omitted for brevity - requires struct definitions matching kernel
+	reg := xdpUmemReg{
+		Addr:     uint64(uintptr(unsafe.Pointer(&data[0]))),
+		Len:      uint64(totalSize),
+		Size:     uint32(s.config.FrameSize),
+		Headroom: uint32(s.config.FrameHeadroom),
+	}
+	if err := setsockopt(s.fd, XDP_UMEM_REG, unsafe.Pointer(&reg), unsafe.Sizeof(reg)); err != nil {
+		unix.Munmap(data)
+		s.umem = nil
+		return fmt.Errorf("%w: XDP_UMEM_REG: %v", ErrUMEMSetup, err)
+	}
+
+	s.freeFrames = make([]uint64, 0, s.config.NumFrames)
+	for i := s.config.NumFrames - 1; i >= 0; i-- {
+		s.freeFrames = append(s.freeFrames, uint64(i*s.config.FrameSize))
+	}
+
+	return nil
+}
+
+// setupPoolUMEM registers the memory pool's region as the UMEM and takes
+// NumFrames slots from it. The pool's allocator already placed the region
+// on its NUMA node, locked it and backed it with hugepages if configured.
+func (s *XDPSocket) setupPoolUMEM() error {
+	pool := s.config.Pool
+	data := pool.Region()
+
+	u := &UMEM{
+		data:      data,
+		numFrames: pool.NumSlots(),
+		frameSize: pool.SlotSize(),
+		headroom:  s.config.FrameHeadroom,
+		pool:      pool,
+		cache:     pool.NewCache(),
+		owned:     make([]uint64, (pool.NumSlots()+63)/64),
+	}
+
+	reg := xdpUmemReg{
+		Addr:     uint64(uintptr(unsafe.Pointer(&data[0]))),
+		Len:      uint64(len(data)),
+		Size:     uint32(u.frameSize),
+		Headroom: uint32(s.config.FrameHeadroom),
+	}
+	if err := setsockopt(s.fd, XDP_UMEM_REG, unsafe.Pointer(&reg), unsafe.Sizeof(reg)); err != nil {
+		return fmt.Errorf("%w: XDP_UMEM_REG: %v", ErrUMEMSetup, err)
+	}
+
+	s.freeFrames = make([]uint64, 0, s.config.NumFrames)
+	for len(s.freeFrames) < s.config.NumFrames {
+		addr, ok := u.acquire()
+		if !ok {
+			u.releaseAll()
+			return fmt.Errorf("%w: %v", ErrUMEMSetup, memory.ErrPoolExhausted)
+		}
+		s.freeFrames = append(s.freeFrames, addr)
+	}
+	s.umem = u
 
 	return nil
 }
 
-// setupRings configures the ring buffers.
+// setupRings sizes the four rings and maps them into user space.
 func (s *XDPSocket) setupRings() error {
-	// Ring buffer setup requires mmap of specific offsets
-	// This is a simplified skeleton - full implementation requires
-	// kernel struct definitions and mmap calls
+	sizes := []struct {
+		opt  int
+		size int
+	}{
+		{XDP_UMEM_FILL_RING, s.config.FillRingSize},
+		{XDP_UMEM_COMPLETION_RING, s.config.CompRingSize},
+		{XDP_RX_RING, s.config.RxRingSize},
+		{XDP_TX_RING, s.config.TxRingSize},
+	}
+	for _, r := range sizes {
+		if err := unix.SetsockoptInt(s.fd, SOL_XDP, r.opt, r.size); err != nil {
+			return fmt.Errorf("%w: setsockopt %d: %v", ErrRingSetup, r.opt, err)
+		}
+	}
+
+	var off unix.XDPMmapOffsets
+	if err := getsockopt(s.fd, XDP_MMAP_OFFSETS, unsafe.Pointer(&off), unsafe.Sizeof(off)); err != nil {
+		return fmt.Errorf("%w: XDP_MMAP_OFFSETS: %v", ErrRingSetup, err)
+	}
 
-	s.rxRing = &XDPRing{
-		size: uint32(s.config.RxRingSize),
-		mask: uint32(s.config.RxRingSize - 1),
+	var err error
+	descSize := uint64(unsafe.Sizeof(Desc{}))
+	if s.fillRing, err = s.mmapRing(off.Fr, s.config.FillRingSize, 8, XDP_UMEM_PGOFF_FILL_RING, true); err != nil {
+		return err
 	}
-	s.txRing = &XDPRing{
-		size: uint32(s.config.TxRingSize),
-		mask: uint32(s.config.TxRingSize - 1),
+	if s.compRing, err = s.mmapRing(off.Cr, s.config.CompRingSize, 8, XDP_UMEM_PGOFF_COMPLETION_RING, false); err != nil {
+		return err
 	}
-	s.fillRing = &XDPRing{
-		size: uint32(s.config.FillRingSize),
-		mask: uint32(s.config.FillRingSize - 1),
+	if s.rxRing, err = s.mmapRing(off.Rx, s.config.RxRingSize, descSize, XDP_PGOFF_RX_RING, false); err != nil {
+		return err
 	}
-	s.compRing = &XDPRing{
-		size: uint32(s.config.CompRingSize),
-		mask: uint32(s.config.CompRingSize - 1),
+	if s.txRing, err = s.mmapRing(off.Tx, s.config.TxRingSize, descSize, XDP_PGOFF_TX_RING, true); err != nil {
+		return err
 	}
 
 	return nil
 }
 
+// mmapRing maps a single ring at the given page offset.
+// Producer rings (fill, TX) start with the whole ring free.
+func (s *XDPSocket) mmapRing(off unix.XDPRingOffset, size int, entrySize uint64, pgoff int64, producer bool) (*XDPRing, error) {
+	length := int(off.Desc + uint64(size)*entrySize)
+	mem, err := unix.Mmap(s.fd, pgoff, length,
+		unix.PROT_READ|unix.PROT_WRITE,
+		unix.MAP_SHARED|unix.MAP_POPULATE)
+	if err != nil {
+		return nil, fmt.Errorf("%w: mmap ring at %#x: %v", ErrRingSetup, pgoff, err)
+	}
+
+	ring := &XDPRing{
+		producer: (*uint32)(unsafe.Pointer(&mem[off.Producer])),
+		consumer: (*uint32)(unsafe.Pointer(&mem[off.Consumer])),
+		flags:    (*uint32)(unsafe.Pointer(&mem[off.Flags])),
+		desc:     unsafe.Pointer(&mem[off.Desc]),
+		mask:     uint32(size - 1),
+		size:     uint32(size),
+		mem:      mem,
+	}
+
+	ring.cachedProd = atomic.LoadUint32(ring.producer)
+	ring.cachedCons = atomic.LoadUint32(ring.consumer)
+	if producer {
+		ring.cachedCons += ring.size
+	}
+
+	return ring, nil
+}
+
 // bind binds the socket to an interface and queue.
 func (s *XDPSocket) bind() error {
 	sa := &unix.SockaddrXDP{
@@ -217,85 +532,356 @@ func (s *XDPSocket) bind() error {
 	} else {
 		sa.Flags |= XDP_COPY
 	}
+	if s.config.NeedWakeup {
+		sa.Flags |= XDP_USE_NEED_WAKEUP
+	}
 
 	return unix.Bind(s.fd, sa)
 }
 
-// Receive receives a packet from the socket.
-// Returns the packet data and the frame index (for returning to fill ring).
-func (s *XDPSocket) Receive() ([]byte, int, error) {
-	s.mu.Lock()
-	defer s.mu.Unlock()
+// populateFillRing splits the UMEM between RX and TX: up to half of the
+// frames (bounded by the fill ring size) are handed to the kernel for
+// receive, the rest are kept on the free stack for Send.
+func (s *XDPSocket) populateFillRing() {
+	numFill := s.config.NumFrames / 2
+	if numFill > s.config.FillRingSize {
+		numFill = s.config.FillRingSize
+	}
+	s.Refill(numFill)
+}
 
-	if s.closed {
-		return nil, 0, errors.New("socket closed")
+// Poll waits up to timeoutMs for RX data. Returns true if the socket is readable.
+// Polling also wakes the kernel when the fill ring needs a wakeup.
+func (s *XDPSocket) Poll(timeoutMs int) (bool, error) {
+	if s.closed.Load() {
+		return false, ErrSocketClosed
 	}
 
-	// Poll for data
 	pollFds := []unix.PollFd{{
 		Fd:     int32(s.fd),
 		Events: unix.POLLIN,
 	}}
 
-	n, err := unix.Poll(pollFds, 1000) // 1 second timeout
+	n, err := unix.Poll(pollFds, timeoutMs)
 	if err != nil {
-		return nil, 0, err
+		if err == unix.EINTR {
+			return false, nil
+		}
+		return false, err
 	}
+	return n > 0, nil
+}
 
+// ReceiveBatch moves up to len(descs) received descriptors from the RX ring
+// into descs with a single consumer index update. It never blocks.
+// Returns the number of descriptors written. The frames stay owned by the
+// caller until they are given back with FillBatch/ReturnFrame or sent.
+func (s *XDPSocket) ReceiveBatch(descs []Desc) int {
+	idx, n := s.rxRing.peek(uint32(len(descs)))
 	if n == 0 {
-		return nil, 0, nil // Timeout, no data
+		return 0
 	}
 
-	// In a real implementation, we would:
-	// 1. Read from the RX ring
-	// 2. Get the frame descriptor
-	// 3. Return the data slice and frame index
+	for i := uint32(0); i < n; i++ {
+		descs[i] = *s.rxRing.descAt(idx + i)
+	}
+	s.rxRing.release()
 
-	return nil, 0, nil
+	return int(n)
 }
 
-// Send sends a packet through the socket.
-func (s *XDPSocket) Send(data []byte) error {
-	s.mu.Lock()
-	defer s.mu.Unlock()
+// Receive receives a packet from the socket.
+// Returns the packet data and the frame index (for returning to fill ring).
+// A nil slice with a nil error means the 1 second poll timed out.
+func (s *XDPSocket) Receive() ([]byte, int, error) {
+	if s.closed.Load() {
+		return nil, 0, ErrSocketClosed
+	}
 
-	if s.closed {
-		return errors.New("socket closed")
+	var desc [1]Desc
+	if s.ReceiveBatch(desc[:]) == 0 {
+		ready, err := s.Poll(1000) // 1 second timeout
+		if err != nil || !ready {
+			return nil, 0, err
+		}
+		if s.ReceiveBatch(desc[:]) == 0 {
+			return nil, 0, nil
+		}
 	}
 
-	if len(data) > s.config.FrameSize {
-		return errors.New("packet too large")
+	return s.Frame(desc[0]), s.FrameIndex(desc[0].Addr), nil
+}
+
+// Frame returns the UMEM bytes described by desc without copying.
+func (s *XDPSocket) Frame(desc Desc) []byte {
+	return s.umem.data[desc.Addr : desc.Addr+uint64(desc.Len) : desc.Addr+uint64(desc.Len)]
+}
+
+// FrameIndex converts a UMEM address (which may include headroom) to its frame index.
+func (s *XDPSocket) FrameIndex(addr uint64) int {
+	return int(addr / uint64(s.umem.frameSize))
+}
+
+// FrameAddr returns the base UMEM address of a frame index.
+func (s *XDPSocket) FrameAddr(frameIdx int) uint64 {
+	return uint64(frameIdx * s.umem.frameSize)
+}
+
+// ReceiveBuffers receives up to len(bufs) packets as Buffers of bp, which
+// must wrap the socket's memory pool. The packet bytes stay where the
+// kernel wrote them; each Buffer's headroom is the space in front of the
+// packet within its frame. The frames leave the socket: Put returns them
+// to the pool, SendBuffers transmits them. Returns the number received.
+func (s *XDPSocket) ReceiveBuffers(bp *memory.BufferPool, bufs []*memory.Buffer) (int, error) {
+	if s.umem.pool == nil || bp.Pool() != s.umem.pool {
+		return 0, ErrForeignBuffer
 	}
 
-	// In a real implementation, we would:
-	// 1. Get a frame from the completion ring
-	// 2. Copy data to the frame
-	// 3. Add to TX ring
-	// 4. Kick the kernel to send
+	var descs [MaxBatchSize]Desc
+	if len(bufs) > len(descs) {
+		bufs = bufs[:len(descs)]
+	}
+	n := s.ReceiveBatch(descs[:len(bufs)])
+	for i := 0; i < n; i++ {
+		buf, err := bp.Wrap(descs[i].Addr, int(descs[i].Len))
+		if err != nil {
+			// Cannot happen for kernel-written descriptors; keep the rest
+			for _, d := range descs[i:n] {
+				s.FreeFrame(d.Addr)
+			}
+			return i, err
+		}
+		s.umem.disown(descs[i].Addr)
+		bufs[i] = buf
+	}
+	return n, nil
+}
 
-	return nil
+// SendBuffers queues up to len(bufs) Buffers of bp, which must wrap the
+// socket's memory pool, on the TX ring without copying. Queued Buffers are
+// consumed and their frames return to the socket when the send completes;
+// the rest stay with the caller. Returns the number queued.
+func (s *XDPSocket) SendBuffers(bp *memory.BufferPool, bufs []*memory.Buffer) (int, error) {
+	if s.umem.pool == nil || bp.Pool() != s.umem.pool {
+		return 0, ErrForeignBuffer
+	}
+
+	var descs [MaxBatchSize]Desc
+	if len(bufs) > len(descs) {
+		bufs = bufs[:len(descs)]
+	}
+	for i, buf := range bufs {
+		descs[i] = Desc{Addr: buf.Addr(), Len: uint32(buf.Length())}
+	}
+	n := s.SendBatch(descs[:len(bufs)])
+	for i := 0; i < n; i++ {
+		bp.Detach(bufs[i])
+		s.umem.own(descs[i].Addr)
+		bufs[i] = nil
+	}
+	return n, nil
+}
+
+// FillBatch gives up to len(addrs) frames to the kernel for receive with a
+// single producer index update. Addresses are rounded down to their frame
+// base. Returns the number of frames queued; the rest remain with the caller.
+func (s *XDPSocket) FillBatch(addrs []uint64) int {
+	idx, n := s.fillRing.reserve(uint32(len(addrs)))
+	if n == 0 {
+		return 0
+	}
+
+	frameSize := uint64(s.umem.frameSize)
+	for i := uint32(0); i < n; i++ {
+		*s.fillRing.addrAt(idx + i) = addrs[i] - addrs[i]%frameSize
+	}
+	s.fillRing.submit()
+
+	return int(n)
 }
 
 // ReturnFrame returns a frame to the fill ring after processing.
 func (s *XDPSocket) ReturnFrame(frameIdx int) error {
-	// Add frame index to fill ring so kernel can use it for new packets
+	if frameIdx < 0 || frameIdx >= s.umem.numFrames {
+		return fmt.Errorf("invalid frame index %d", frameIdx)
+	}
+	if s.FillBatch([]uint64{s.FrameAddr(frameIdx)}) == 0 {
+		return errors.New("fill ring full")
+	}
+	return nil
+}
+
+// SendBatch queues up to len(descs) descriptors on the TX ring with a single
+// producer index update and at most one kernel kick. Descriptors may point
+// at received frames (forwarding without copy) or at frames obtained from
+// AllocFrame. Returns the number of descriptors queued.
+func (s *XDPSocket) SendBatch(descs []Desc) int {
+	idx, n := s.txRing.reserve(uint32(len(descs)))
+	if n == 0 {
+		s.kick()
+		return 0
+	}
+
+	for i := uint32(0); i < n; i++ {
+		*s.txRing.descAt(idx + i) = descs[i]
+	}
+	s.txRing.submit()
+	s.outstandingTx += n
+	s.kick()
+
+	return int(n)
+}
+
+// Send copies data into a free UMEM frame and transmits it.
+func (s *XDPSocket) Send(data []byte) error {
+	if s.closed.Load() {
+		return ErrSocketClosed
+	}
+
+	if len(data) > s.config.FrameSize {
+		return ErrPacketTooLarge
+	}
+
+	addr, ok := s.AllocFrame()
+	if !ok {
+		s.Complete()
+		if addr, ok = s.AllocFrame(); !ok {
+			return ErrNoFreeFrames
+		}
+	}
+
+	copy(s.umem.data[addr:addr+uint64(s.config.FrameSize)], data)
+	desc := [1]Desc{{Addr: addr, Len: uint32(len(data))}}
+	if s.SendBatch(desc[:]) == 0 {
+		s.freeFrames = append(s.freeFrames, addr)
+		return ErrTxRingFull
+	}
 	return nil
 }
 
-// Stats returns socket statistics.
+// AllocFrame pops a free UMEM frame for TX. With a memory pool the socket
+// takes a new slot when its own stack is empty. Returns false if none is
+// free.
+func (s *XDPSocket) AllocFrame() (uint64, bool) {
+	n := len(s.freeFrames)
+	if n == 0 {
+		if s.umem.pool != nil {
+			return s.umem.acquire()
+		}
+		return 0, false
+	}
+	addr := s.freeFrames[n-1]
+	s.freeFrames = s.freeFrames[:n-1]
+	return addr, true
+}
+
+// FreeFrame pushes a frame that will not be sent back on the free stack.
+func (s *XDPSocket) FreeFrame(addr uint64) {
+	s.freeFrames = append(s.freeFrames, addr-addr%uint64(s.umem.frameSize))
+}
+
+// Complete reaps the completion ring, moving transmitted frames back to the
+// free stack. Returns the number of frames reclaimed.
+func (s *XDPSocket) Complete() int {
+	if s.outstandingTx == 0 {
+		return 0
+	}
+
+	idx, n := s.compRing.peek(s.outstandingTx)
+	if n == 0 {
+		// Copy-mode TX only progresses on sendto, so keep kicking
+		s.kick()
+		return 0
+	}
+
+	frameSize := uint64(s.umem.frameSize)
+	for i := uint32(0); i < n; i++ {
+		addr := *s.compRing.addrAt(idx + i)
+		s.freeFrames = append(s.freeFrames, addr-addr%frameSize)
+	}
+	s.compRing.release()
+	s.outstandingTx -= n
+
+	return int(n)
+}
+
+// Refill moves up to n frames from the free stack to the fill ring so the
+// kernel can receive into them, first topping the stack up from the memory
+// pool if frames were handed out as Buffers. Returns the number of frames
+// moved.
+func (s *XDPSocket) Refill(n int) int {
+	if s.umem.pool != nil {
+		for len(s.freeFrames) < n {
+			addr, ok := s.umem.acquire()
+			if !ok {
+				break
+			}
+			s.freeFrames = append(s.freeFrames, addr)
+		}
+	}
+	if n > len(s.freeFrames) {
+		n = len(s.freeFrames)
+	}
+	if n == 0 {
+		return 0
+	}
+
+	start := len(s.freeFrames) - n
+	filled := s.FillBatch(s.freeFrames[start:])
+	// Frames the fill ring had no room for stay at the top of the stack
+	copy(s.freeFrames[start:], s.freeFrames[start+filled:])
+	s.freeFrames = s.freeFrames[:len(s.freeFrames)-filled]
+
+	return filled
+}
+
+// kick wakes the kernel TX path with a non-blocking sendto, skipping the
+// syscall when the socket uses need-wakeup and the kernel is already busy.
+func (s *XDPSocket) kick() {
+	if s.config.NeedWakeup && !s.txRing.needsWakeup() {
+		return
+	}
+
+	// EAGAIN/EBUSY/ENOBUFS/ENETDOWN are transient; the next kick retries.
+	_ = unix.Sendto(s.fd, nil, unix.MSG_DONTWAIT, nil)
+}
+
+// FillNeedsWakeup reports whether the kernel is waiting for a poll() after
+// the fill ring was replenished.
+func (s *XDPSocket) FillNeedsWakeup() bool {
+	return s.config.NeedWakeup && s.fillRing.needsWakeup()
+}
+
+// FreeFrameCount returns the number of frames on the free stack.
+func (s *XDPSocket) FreeFrameCount() int {
+	return len(s.freeFrames)
+}
+
+// XDPSocketStats mirrors the kernel's struct xdp_statistics. Kernels
+// before 5.9 only report the first three counters.
 type XDPSocketStats struct {
-	RxDropped    uint64
-	RxInvalid    uint64
-	TxInvalid    uint64
-	RxRingFull   uint64
-	FillRingFull uint64
-	TxRingFull   uint64
+	RxDropped     uint64 // Dropped for reasons other than invalid descriptors
+	RxInvalid     uint64 // Dropped due to invalid descriptors
+	TxInvalid     uint64 // Dropped due to invalid descriptors
+	RxRingFull    uint64 // Dropped because the RX ring was full
+	FillRingEmpty uint64 // Receives that found the fill ring empty
+	TxRingEmpty   uint64 // Wakeups that found the TX ring empty
 }
 
-// Stats retrieves socket statistics.
+// Stats reads the socket's XDP_STATISTICS counters. Unlike the ring
+// methods it may be called from any goroutine. FillRingEmpty growing means
+// frames are not returned to the fill ring fast enough, the usual cause of
+// RxDropped.
 func (s *XDPSocket) Stats() (*XDPSocketStats, error) {
-	// Use getsockopt with XDP_STATISTICS
-	return &XDPSocketStats{}, nil
+	if s.closed.Load() {
+		return nil, ErrSocketClosed
+	}
+
+	var stats XDPSocketStats
+	if err := getsockopt(s.fd, XDP_STATISTICS, unsafe.Pointer(&stats), unsafe.Sizeof(stats)); err != nil {
+		return nil, fmt.Errorf("XDP_STATISTICS: %w", err)
+	}
+	return &stats, nil
 }
 
 // FileDescriptor returns the socket file descriptor.
@@ -308,18 +894,49 @@ func (s *XDPSocket) Close() error {
 	s.mu.Lock()
 	defer s.mu.Unlock()
 
-	if s.closed {
+	if s.closed.Load() {
 		return nil
 	}
-	s.closed = true
+	s.closed.Store(true)
+
+	// Unmap rings
+	for _, ring := range []*XDPRing{s.rxRing, s.txRing, s.fillRing, s.compRing} {
+		if ring != nil && ring.mem != nil {
+			unix.Munmap(ring.mem)
+		}
+	}
 
-	close(s.rxChan)
-	close(s.txChan)
+	err := unix.Close(s.fd)
 
-	// Unmap UMEM
-	if s.umem != nil && s.umem.data != nil {
-		unix.Munmap(s.umem.data)
+	// Unmap UMEM, or give a pool's frames back once the kernel is done
+	if s.umem != nil {
+		if s.umem.pool != nil {
+			s.umem.releaseAll()
+		} else if s.umem.data != nil {
+			unix.Munmap(s.umem.data)
+		}
 	}
 
-	return unix.Close(s.fd)
+	return err
+}
+
+// setsockopt sets a SOL_XDP option from a raw struct.
+func setsockopt(fd, opt int, val unsafe.Pointer, size uintptr) error {
+	_, _, errno := unix.Syscall6(unix.SYS_SETSOCKOPT,
+		uintptr(fd), SOL_XDP, uintptr(opt), uintptr(val), size, 0)
+	if errno != 0 {
+		return errno
+	}
+	return nil
+}
+
+// getsockopt reads a SOL_XDP option into a raw struct.
+func getsockopt(fd, opt int, val unsafe.Pointer, size uintptr) error {
+	optlen := uint32(size)
+	_, _, errno := unix.Syscall6(unix.SYS_GETSOCKOPT,
+		uintptr(fd), SOL_XDP, uintptr(opt), uintptr(val), uintptr(unsafe.Pointer(&optlen)), 0)
+	if errno != 0 {
+		return errno
+	}
+	return nil
 }
@@ -0,0 +1,331 @@
+// Package xdp provides an allocation-free packet decoder.
+package xdp
+
+import (
+	"encoding/binary"
+	"net/netip"
+)
+
+// Additional EtherType constants for stacked VLAN tags
+const (
+	EtherTypeQinQ    = 0x88A8 // IEEE 802.1ad service tag
+	EtherTypeQinQOld = 0x9100 // Pre-standard QinQ tag
+	VLANTagSize      = 4
+	MaxVLANTags      = 2
+)
+
+// IPv6 extension header and ICMPv6 protocol numbers
+const (
+	IPProtoHopByHop = 0
+	IPProtoRouting  = 43
+	IPProtoFragment = 44
+	IPProtoESP      = 50
+	IPProtoAH       = 51
+	IPProtoICMPv6   = 58
+	IPProtoNoNext   = 59
+	IPProtoDstOpts  = 60
+
+	// maxIPv6ExtHeaders bounds the extension header walk
+	maxIPv6ExtHeaders = 8
+)
+
+// ICMPHeaderSize is the fixed ICMP/ICMPv6 header size.
+const ICMPHeaderSize = 8
+
+// Layer flags record which layers a PacketView decoded.
+const (
+	LayerL3 uint8 = 1 << iota
+	LayerL4
+	LayerPayload
+)
+
+// PacketView is a decoded view of a packet. It holds offsets into the
+// caller's buffer plus the fixed-size header fields the datapath matches
+// on, so decoding into a reused (or stack-allocated) view never allocates.
+//
+// A view is only valid while the buffer it was decoded from is unchanged.
+type PacketView struct {
+	data []byte
+
+	// Offsets from the start of the frame
+	L2Offset      uint16
+	L3Offset      uint16
+	L4Offset      uint16
+	PayloadOffset uint16
+
+	// Layers decoded (LayerL3, LayerL4, LayerPayload)
+	Layers uint8
+
+	// L2
+	EtherType uint16 // Innermost EtherType, after any VLAN tags
+	NumVLANs  uint8
+	VLANs     [MaxVLANTags]uint16 // TCI of each tag, outermost first
+
+	// L3
+	IPVersion uint8
+	Protocol  uint8 // L4 protocol, after any IPv6 extension headers
+	TTL       uint8 // IPv4 TTL or IPv6 hop limit
+	Fragment  bool  // Part of a fragmented datagram
+	SrcIP4    [4]byte
+	DstIP4    [4]byte
+	SrcIP6    [16]byte
+	DstIP6    [16]byte
+
+	// L4
+	SrcPort  uint16
+	DstPort  uint16
+	TCPFlags uint8
+}
+
+// Decode decodes a frame into v in a single pass, stopping at the deepest
+// layer it understands: non-IP frames decode L2 only, and non-first
+// fragments and unknown L4 protocols decode through L3.
+// Returns ErrPacketTooShort if a header is truncated and ErrInvalidPacket
+// if a header is malformed.
+func Decode(data []byte, v *PacketView) error {
+	*v = PacketView{data: data}
+
+	if len(data) < EthernetHeaderSize {
+		return ErrPacketTooShort
+	}
+
+	off := 12
+	etherType := binary.BigEndian.Uint16(data[off:])
+	off += 2
+
+	for etherType == EtherTypeVLAN || etherType == EtherTypeQinQ || etherType == EtherTypeQinQOld {
+		if v.NumVLANs == MaxVLANTags {
+			return ErrUnsupportedType
+		}
+		if len(data) < off+VLANTagSize {
+			return ErrPacketTooShort
+		}
+		v.VLANs[v.NumVLANs] = binary.BigEndian.Uint16(data[off:])
+		v.NumVLANs++
+		etherType = binary.BigEndian.Uint16(data[off+2:])
+		off += VLANTagSize
+	}
+
+	v.EtherType = etherType
+	v.L3Offset = uint16(off)
+
+	switch etherType {
+	case EtherTypeIPv4:
+		return v.decodeIPv4(off)
+	case EtherTypeIPv6:
+		return v.decodeIPv6(off)
+	default:
+		return nil
+	}
+}
+
+// decodeIPv4 decodes the IPv4 header at off and continues to L4.
+func (v *PacketView) decodeIPv4(off int) error {
+	data := v.data
+	if len(data) < off+IPv4MinHeaderSize {
+		return ErrPacketTooShort
+	}
+
+	hdr := data[off:]
+	if hdr[0]>>4 != 4 {
+		return ErrInvalidPacket
+	}
+	headerLen := int(hdr[0]&0x0F) * 4
+	if headerLen < IPv4MinHeaderSize {
+		return ErrInvalidPacket
+	}
+	if len(hdr) < headerLen {
+		return ErrPacketTooShort
+	}
+
+	v.Layers |= LayerL3
+	v.IPVersion = 4
+	v.TTL = hdr[8]
+	v.Protocol = hdr[9]
+	copy(v.SrcIP4[:], hdr[12:16])
+	copy(v.DstIP4[:], hdr[16:20])
+
+	flagsFrag := binary.BigEndian.Uint16(hdr[6:8])
+	fragOffset := flagsFrag & 0x1FFF
+	moreFragments := flagsFrag&0x2000 != 0
+	v.Fragment = moreFragments || fragOffset != 0
+	if fragOffset != 0 {
+		return nil // L4 header is in the first fragment only
+	}
+
+	return v.decodeL4(off + headerLen)
+}
+
+// decodeIPv6 decodes the IPv6 header and extension headers at off and
+// continues to L4.
+func (v *PacketView) decodeIPv6(off int) error {
+	data := v.data
+	if len(data) < off+IPv6HeaderSize {
+		return ErrPacketTooShort
+	}
+
+	hdr := data[off:]
+	if hdr[0]>>4 != 6 {
+		return ErrInvalidPacket
+	}
+
+	v.Layers |= LayerL3
+	v.IPVersion = 6
+	v.TTL = hdr[7]
+	copy(v.SrcIP6[:], hdr[8:24])
+	copy(v.DstIP6[:], hdr[24:40])
+
+	next := hdr[6]
+	off += IPv6HeaderSize
+
+	for i := 0; i < maxIPv6ExtHeaders; i++ {
+		switch next {
+		case IPProtoHopByHop, IPProtoRouting, IPProtoDstOpts:
+			if len(data) < off+8 {
+				return ErrPacketTooShort
+			}
+			next = data[off]
+			off += (int(data[off+1]) + 1) * 8
+
+		case IPProtoAH:
+			if len(data) < off+8 {
+				return ErrPacketTooShort
+			}
+			next = data[off]
+			off += (int(data[off+1]) + 2) * 4
+
+		case IPProtoFragment:
+			if len(data) < off+8 {
+				return ErrPacketTooShort
+			}
+			v.Fragment = true
+			fragOffset := binary.BigEndian.Uint16(data[off+2:]) >> 3
+			next = data[off]
+			off += 8
+			if fragOffset != 0 {
+				v.Protocol = next
+				return nil
+			}
+
+		default:
+			v.Protocol = next
+			if next == IPProtoESP || next == IPProtoNoNext {
+				return nil // Nothing decodable follows
+			}
+			return v.decodeL4(off)
+		}
+	}
+
+	return ErrUnsupportedType
+}
+
+// decodeL4 decodes the transport header at off.
+func (v *PacketView) decodeL4(off int) error {
+	data := v.data
+	if off > len(data) {
+		return ErrPacketTooShort
+	}
+
+	var headerLen int
+	switch v.Protocol {
+	case IPProtoTCP:
+		if len(data) < off+TCPMinHeaderSize {
+			return ErrPacketTooShort
+		}
+		headerLen = int(data[off+12]>>4) * 4
+		if headerLen < TCPMinHeaderSize {
+			return ErrInvalidPacket
+		}
+		v.TCPFlags = data[off+13]
+
+	case IPProtoUDP:
+		headerLen = UDPHeaderSize
+
+	case IPProtoICMP, IPProtoICMPv6:
+		if len(data) < off+ICMPHeaderSize {
+			return ErrPacketTooShort
+		}
+		v.L4Offset = uint16(off)
+		v.PayloadOffset = uint16(off + ICMPHeaderSize)
+		v.Layers |= LayerL4 | LayerPayload
+		return nil
+
+	default:
+		return nil
+	}
+
+	if len(data) < off+headerLen {
+		return ErrPacketTooShort
+	}
+
+	v.SrcPort = binary.BigEndian.Uint16(data[off:])
+	v.DstPort = binary.BigEndian.Uint16(data[off+2:])
+	v.L4Offset = uint16(off)
+	v.PayloadOffset = uint16(off + headerLen)
+	v.Layers |= LayerL4 | LayerPayload
+
+	return nil
+}
+
+// Data returns the frame the view was decoded from.
+func (v *PacketView) Data() []byte {
+	return v.data
+}
+
+// Has reports whether all of the given layers were decoded.
+func (v *PacketView) Has(layers uint8) bool {
+	return v.Layers&layers == layers
+}
+
+// L2 returns the frame starting at the Ethernet header.
+func (v *PacketView) L2() []byte {
+	return v.data[v.L2Offset:]
+}
+
+// L3 returns the frame starting at the network header, or nil.
+func (v *PacketView) L3() []byte {
+	if !v.Has(LayerL3) {
+		return nil
+	}
+	return v.data[v.L3Offset:]
+}
+
+// L4 returns the frame starting at the transport header, or nil.
+func (v *PacketView) L4() []byte {
+	if !v.Has(LayerL4) {
+		return nil
+	}
+	return v.data[v.L4Offset:]
+}
+
+// Payload returns the transport payload, or nil.
+func (v *PacketView) Payload() []byte {
+	if !v.Has(LayerPayload) {
+		return nil
+	}
+	return v.data[v.PayloadOffset:]
+}
+
+// SrcAddr returns the source address as a netip.Addr (no allocation).
+func (v *PacketView) SrcAddr() netip.Addr {
+	switch v.IPVersion {
+	case 4:
+		return netip.AddrFrom4(v.SrcIP4)
+	case 6:
+		return netip.AddrFrom16(v.SrcIP6)
+	default:
+		return netip.Addr{}
+	}
+}
+
+// DstAddr returns the destination address as a netip.Addr (no allocation).
+func (v *PacketView) DstAddr() netip.Addr {
+	switch v.IPVersion {
+	case 4:
+		return netip.AddrFrom4(v.DstIP4)
+	case 6:
+		return netip.AddrFrom16(v.DstIP6)
+	default:
+		return netip.Addr{}
+	}
+}
@@ -0,0 +1,155 @@
+package xdp
+
+import (
+	"encoding/binary"
+	"testing"
+)
+
+// buildTCPv4 builds an Ethernet/IPv4/TCP frame with optional VLAN tags.
+func buildTCPv4(vlans ...uint16) []byte {
+	frame := make([]byte, 0, 128)
+	frame = append(frame, 0x02, 0, 0, 0, 0, 0x01, 0x02, 0, 0, 0, 0, 0x02)
+	for _, tci := range vlans {
+		frame = binary.BigEndian.AppendUint16(frame, EtherTypeVLAN)
+		frame = binary.BigEndian.AppendUint16(frame, tci)
+	}
+	frame = binary.BigEndian.AppendUint16(frame, EtherTypeIPv4)
+
+	ip := []byte{
+		0x45, 0, 0, 44, 0, 1, 0x40, 0, 64, IPProtoTCP, 0, 0,
+		10, 0, 0, 1, 192, 168, 1, 10,
+	}
+	binary.BigEndian.PutUint16(ip[10:], Checksum(ip))
+	frame = append(frame, ip...)
+
+	tcp := make([]byte, TCPMinHeaderSize)
+	binary.BigEndian.PutUint16(tcp[0:], 40000)
+	binary.BigEndian.PutUint16(tcp[2:], 443)
+	tcp[12] = 5 << 4
+	tcp[13] = TCPFlagSYN
+	frame = append(frame, tcp...)
+
+	return append(frame, 'p', 'i', 'n', 'g')
+}
+
+// buildUDPv6 builds an Ethernet/IPv6/UDP frame behind a hop-by-hop and a
+// first-fragment extension header.
+func buildUDPv6() []byte {
+	frame := make([]byte, 0, 128)
+	frame = append(frame, 0x02, 0, 0, 0, 0, 0x01, 0x02, 0, 0, 0, 0, 0x02)
+	frame = binary.BigEndian.AppendUint16(frame, EtherTypeIPv6)
+
+	ip := make([]byte, IPv6HeaderSize)
+	ip[0] = 6 << 4
+	ip[6] = IPProtoHopByHop
+	ip[7] = 32
+	ip[8], ip[9], ip[23] = 0x20, 0x01, 0x01
+	ip[24], ip[25], ip[39] = 0x20, 0x01, 0x02
+	frame = append(frame, ip...)
+
+	frame = append(frame, IPProtoFragment, 0, 1, 4, 0, 0, 0, 0) // Hop-by-hop, 8 bytes
+	frame = append(frame, IPProtoUDP, 0, 0, 1, 0, 0, 0, 7)      // Fragment offset 0, M=1
+
+	udp := make([]byte, UDPHeaderSize)
+	binary.BigEndian.PutUint16(udp[0:], 5353)
+	binary.BigEndian.PutUint16(udp[2:], 53)
+	frame = append(frame, udp...)
+
+	return append(frame, 'd', 'n', 's')
+}
+
+// TestDecodeTCPv4QinQ verifies offsets and fields through two VLAN tags.
+func TestDecodeTCPv4QinQ(t *testing.T) {
+	frame := buildTCPv4(100, 200)
+
+	var v PacketView
+	if err := Decode(frame, &v); err != nil {
+		t.Fatalf("decode failed: %v", err)
+	}
+
+	if v.NumVLANs != 2 || v.VLANs[0] != 100 || v.VLANs[1] != 200 {
+		t.Errorf("expected VLANs [100 200], got %v (%d)", v.VLANs, v.NumVLANs)
+	}
+	if v.L3Offset != 22 || v.L4Offset != 42 || v.PayloadOffset != 62 {
+		t.Errorf("unexpected offsets L3=%d L4=%d payload=%d", v.L3Offset, v.L4Offset, v.PayloadOffset)
+	}
+	if v.SrcIP4 != [4]byte{10, 0, 0, 1} || v.DstAddr().String() != "192.168.1.10" {
+		t.Errorf("unexpected addresses %v -> %v", v.SrcAddr(), v.DstAddr())
+	}
+	if v.Protocol != IPProtoTCP || v.SrcPort != 40000 || v.DstPort != 443 || v.TCPFlags != TCPFlagSYN {
+		t.Errorf("unexpected L4 fields proto=%d %d->%d flags=%#x", v.Protocol, v.SrcPort, v.DstPort, v.TCPFlags)
+	}
+	if string(v.Payload()) != "ping" {
+		t.Errorf("expected payload 'ping', got '%s'", v.Payload())
+	}
+}
+
+// TestDecodeIPv6ExtensionHeaders verifies the extension header walk.
+func TestDecodeIPv6ExtensionHeaders(t *testing.T) {
+	frame := buildUDPv6()
+
+	var v PacketView
+	if err := Decode(frame, &v); err != nil {
+		t.Fatalf("decode failed: %v", err)
+	}
+
+	if v.IPVersion != 6 || v.Protocol != IPProtoUDP || !v.Fragment {
+		t.Errorf("expected fragmented IPv6/UDP, got v%d proto=%d fragment=%v", v.IPVersion, v.Protocol, v.Fragment)
+	}
+	if v.SrcAddr().String() != "2001::1" || v.DstAddr().String() != "2001::2" {
+		t.Errorf("unexpected addresses %v -> %v", v.SrcAddr(), v.DstAddr())
+	}
+	if v.SrcPort != 5353 || v.DstPort != 53 || string(v.Payload()) != "dns" {
+		t.Errorf("unexpected L4 %d->%d payload '%s'", v.SrcPort, v.DstPort, v.Payload())
+	}
+}
+
+// TestDecodeTruncated verifies truncated frames are rejected at every layer.
+func TestDecodeTruncated(t *testing.T) {
+	frame := buildTCPv4()
+
+	var v PacketView
+	for _, n := range []int{10, 20, 40} {
+		if err := Decode(frame[:n], &v); err != ErrPacketTooShort {
+			t.Errorf("expected ErrPacketTooShort for %d bytes, got %v", n, err)
+		}
+	}
+}
+
+// BenchmarkDecode measures the single-pass decoder; it must report 0 allocs/op.
+func BenchmarkDecode(b *testing.B) {
+	frames := map[string][]byte{
+		"TCPv4":     buildTCPv4(),
+		"TCPv4QinQ": buildTCPv4(100, 200),
+		"UDPv6Ext":  buildUDPv6(),
+	}
+
+	for name, frame := range frames {
+		b.Run(name, func(b *testing.B) {
+			var v PacketView
+			b.ReportAllocs()
+			b.SetBytes(int64(len(frame)))
+			for i := 0; i < b.N; i++ {
+				if err := Decode(frame, &v); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+// BenchmarkParseHeaders measures the allocating per-header parsers for comparison.
+func BenchmarkParseHeaders(b *testing.B) {
+	frame := buildTCPv4()
+
+	b.ReportAllocs()
+	b.SetBytes(int64(len(frame)))
+	for i := 0; i < b.N; i++ {
+		eth, _ := ParseEthernetHeader(frame)
+		ip, _ := ParseIPv4Header(frame[EthernetHeaderSize:])
+		tcp, _ := ParseTCPHeader(frame[EthernetHeaderSize+ip.HeaderLength():])
+		if eth.EtherType != EtherTypeIPv4 || tcp.DstPort != 443 {
+			b.Fatal("unexpected parse result")
+		}
+	}
+}
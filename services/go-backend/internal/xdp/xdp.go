@@ -5,7 +5,9 @@ import (
 	"errors"
 	"fmt"
 	"net"
+	"net/netip"
 	"os"
+	"sync/atomic"
 
 	"github.com/cilium/ebpf"
 	"github.com/cilium/ebpf/link"
@@ -31,8 +33,124 @@ var (
 	ErrXDPNotSupported = errors.New("XDP not supported on this system")
 	// ErrInterfaceNotFound is returned when the network interface doesn't exist.
 	ErrInterfaceNotFound = errors.New("network interface not found")
+	// ErrProgramLoad is returned when the eBPF object cannot be loaded.
+	ErrProgramLoad = errors.New("failed to load XDP program")
+	// ErrInvalidACLAction is returned for an action outside ACLAllow..ACLInspect.
+	ErrInvalidACLAction = errors.New("invalid ACL action")
 )
 
+// ACLAction is the verdict of a fast-path ACL rule, as stored in the BPF maps.
+// The values must match the ACL_* constants in bpf/xdp_filter.c.
+type ACLAction uint32
+
+const (
+	// ACLNone means no rule; lookups fall through to the next table.
+	ACLNone ACLAction = iota
+	// ACLAllow passes the packet to the kernel stack (XDP_PASS).
+	ACLAllow
+	// ACLDeny drops the packet in the driver (XDP_DROP).
+	ACLDeny
+	// ACLInspect redirects the packet to the queue's AF_XDP socket.
+	ACLInspect
+)
+
+// String returns the string representation of an ACLAction.
+func (a ACLAction) String() string {
+	switch a {
+	case ACLNone:
+		return "none"
+	case ACLAllow:
+		return "allow"
+	case ACLDeny:
+		return "deny"
+	case ACLInspect:
+		return "inspect"
+	default:
+		return "unknown"
+	}
+}
+
+// ParseACLAction parses a string action to ACLAction.
+func ParseACLAction(action string) (ACLAction, error) {
+	switch action {
+	case "allow", "pass":
+		return ACLAllow, nil
+	case "deny", "drop":
+		return ACLDeny, nil
+	case "inspect":
+		return ACLInspect, nil
+	default:
+		return ACLNone, fmt.Errorf("%w: %s", ErrInvalidACLAction, action)
+	}
+}
+
+// BPF map key layouts, mirroring the structs in bpf/xdp_filter.c
+type lpmKeyV4 struct {
+	Prefixlen uint32
+	Addr      [4]byte
+}
+
+type lpmKeyV6 struct {
+	Prefixlen uint32
+	Addr      [16]byte
+}
+
+type portKey struct {
+	Proto uint8
+	_     uint8
+	Port  uint16 // Host byte order
+}
+
+// FlowTuple is one direction of a connection, the key of the ct_flows map.
+// Addresses are IPv6 or IPv4-mapped IPv6; ports are in host byte order.
+type FlowTuple struct {
+	Src     [16]byte
+	Dst     [16]byte
+	SrcPort uint16
+	DstPort uint16
+	Proto   uint8
+	_       [3]uint8
+}
+
+// flowValue mirrors struct ct_value.
+type flowValue struct {
+	LastSeen uint64 // bpf_ktime_get_ns() of the last fast-path hit
+	Packets  uint64
+	Bytes    uint64
+}
+
+// ActionStat is one per-CPU slot of the action_stats map.
+type ActionStat struct {
+	Packets uint64
+	Bytes   uint64
+}
+
+// cfg_map slots
+const cfgDefaultAction uint32 = 0
+
+// xdpObjects receives the program and maps of bpf/xdp_filter.o.
+type xdpObjects struct {
+	Program     *ebpf.Program `ebpf:"xdp_cerberus"`
+	ACLSrcV4    *ebpf.Map     `ebpf:"acl_src_v4"`
+	ACLSrcV6    *ebpf.Map     `ebpf:"acl_src_v6"`
+	ACLPorts    *ebpf.Map     `ebpf:"acl_ports"`
+	CTFlows     *ebpf.Map     `ebpf:"ct_flows"`
+	XSKs        *ebpf.Map     `ebpf:"xsks_map"`
+	Cfg         *ebpf.Map     `ebpf:"cfg_map"`
+	ActionStats *ebpf.Map     `ebpf:"action_stats"`
+}
+
+// Close releases the program and maps.
+func (o *xdpObjects) Close() {
+	for _, c := range []interface{ Close() error }{
+		o.Program, o.ACLSrcV4, o.ACLSrcV6, o.ACLPorts, o.CTFlows, o.XSKs, o.Cfg, o.ActionStats,
+	} {
+		if c != nil {
+			c.Close()
+		}
+	}
+}
+
 // XDPProgram represents a loaded XDP program.
 type XDPProgram struct {
 	ifaceName string
@@ -40,6 +158,9 @@ type XDPProgram struct {
 	mode      XDPMode
 	link      link.Link
 	prog      *ebpf.Program
+	objs      xdpObjects
+	// Set once the kernel refuses batch updates of the LPM tries
+	lpmNoBatch atomic.Bool
 }
 
 // XDPConfig holds configuration for XDP program loading.
@@ -47,8 +168,12 @@ type XDPConfig struct {
 	InterfaceName string
 	Mode          XDPMode
 	ProgramPath   string // Path to compiled eBPF object file
+	FlowEntries   uint32 // Size of the conntrack fast-path map; 0 keeps the object's default
 }
 
+// DefaultProgramPath is where the container image installs bpf/xdp_filter.o.
+const DefaultProgramPath = "/app/bpf/xdp_filter.o"
+
 // ParseXDPMode parses a string mode to XDPMode.
 func ParseXDPMode(mode string) XDPMode {
 	switch mode {
@@ -84,9 +209,12 @@ func GetInterfaceIndex(name string) (int, error) {
 	return iface.Index, nil
 }
 
-// LoadXDPProgram loads an XDP program from an eBPF object file.
-// Note: This is a skeleton implementation. In production, you would
-// compile actual eBPF C code and load it here.
+// LoadXDPProgram loads the filter program from an eBPF object file
+// (bpf/xdp_filter.c) and attaches it to the interface.
+//
+// The program passes everything until rules are installed with the ACL
+// methods; frames only reach AF_XDP sockets once they are registered with
+// RegisterSocket and a rule (or the default action) selects ACLInspect.
 func LoadXDPProgram(config XDPConfig) (*XDPProgram, error) {
 	if !IsXDPSupported() {
 		return nil, ErrXDPNotSupported
@@ -97,32 +225,69 @@ func LoadXDPProgram(config XDPConfig) (*XDPProgram, error) {
 		return nil, err
 	}
 
+	path := config.ProgramPath
+	if path == "" {
+		path = DefaultProgramPath
+	}
+
+	spec, err := ebpf.LoadCollectionSpec(path)
+	if err != nil {
+		return nil, fmt.Errorf("%w: %s: %v", ErrProgramLoad, path, err)
+	}
+
+	if m, ok := spec.Maps["ct_flows"]; ok && config.FlowEntries > 0 {
+		m.MaxEntries = config.FlowEntries
+	}
+
 	xdp := &XDPProgram{
 		ifaceName: config.InterfaceName,
 		ifaceIdx:  ifaceIdx,
 		mode:      config.Mode,
 	}
 
-	// In a real implementation, you would:
-	// 1. Load the eBPF object file
-	// 2. Get the XDP program from the collection
-	// 3. Attach it to the interface
-	//
-	// Example with a real program:
-	// spec, err := ebpf.LoadCollectionSpec(config.ProgramPath)
-	// coll, err := ebpf.NewCollection(spec)
-	// xdp.prog = coll.Programs["xdp_prog"]
-	// xdp.link, err = link.AttachXDP(link.XDPOptions{...})
+	if err := spec.LoadAndAssign(&xdp.objs, nil); err != nil {
+		return nil, fmt.Errorf("%w: %v", ErrProgramLoad, err)
+	}
+	xdp.prog = xdp.objs.Program
+
+	xdp.link, err = link.AttachXDP(link.XDPOptions{
+		Program:   xdp.prog,
+		Interface: ifaceIdx,
+		Flags:     attachFlags(config.Mode),
+	})
+	if err != nil {
+		xdp.objs.Close()
+		return nil, fmt.Errorf("attach XDP to %s: %w", config.InterfaceName, err)
+	}
 
 	return xdp, nil
 }
 
-// Detach removes the XDP program from the interface.
+// attachFlags maps an XDPMode to the netlink attach flags.
+func attachFlags(mode XDPMode) link.XDPAttachFlags {
+	switch mode {
+	case XDPModeSKB:
+		return link.XDPGenericMode
+	case XDPModeNative:
+		return link.XDPDriverMode
+	case XDPModeOffload:
+		return link.XDPOffloadMode
+	default:
+		return 0
+	}
+}
+
+// Detach removes the XDP program from the interface and releases its maps.
 func (x *XDPProgram) Detach() error {
+	var err error
 	if x.link != nil {
-		return x.link.Close()
+		err = x.link.Close()
+		x.link = nil
 	}
-	return nil
+	x.objs.Close()
+	x.objs = xdpObjects{}
+	x.prog = nil
+	return err
 }
 
 // InterfaceName returns the interface name.
@@ -140,6 +305,241 @@ func (x *XDPProgram) Mode() XDPMode {
 	return x.mode
 }
 
+// SetCIDRAction installs a source-prefix rule. The longest matching prefix
+// wins; a matching prefix takes precedence over port rules.
+func (x *XDPProgram) SetCIDRAction(prefix netip.Prefix, action ACLAction) error {
+	if action < ACLAllow || action > ACLInspect {
+		return fmt.Errorf("%w: %d", ErrInvalidACLAction, action)
+	}
+
+	prefix = prefix.Masked()
+	addr := prefix.Addr()
+	value := uint32(action)
+
+	if addr.Is4() {
+		return x.objs.ACLSrcV4.Put(lpmKeyV4{Prefixlen: uint32(prefix.Bits()), Addr: addr.As4()}, value)
+	}
+	return x.objs.ACLSrcV6.Put(lpmKeyV6{Prefixlen: uint32(prefix.Bits()), Addr: addr.As16()}, value)
+}
+
+// RemoveCIDR deletes a source-prefix rule.
+func (x *XDPProgram) RemoveCIDR(prefix netip.Prefix) error {
+	prefix = prefix.Masked()
+	addr := prefix.Addr()
+
+	if addr.Is4() {
+		return x.objs.ACLSrcV4.Delete(lpmKeyV4{Prefixlen: uint32(prefix.Bits()), Addr: addr.As4()})
+	}
+	return x.objs.ACLSrcV6.Delete(lpmKeyV6{Prefixlen: uint32(prefix.Bits()), Addr: addr.As16()})
+}
+
+// SetCIDRActions installs source-prefix rules in bulk. Unlike SetCIDRAction
+// it accepts ACLNone, which shadows shorter prefixes and defers to port
+// rules. Batched map updates are used where the kernel supports them.
+func (x *XDPProgram) SetCIDRActions(prefixes []netip.Prefix, actions []ACLAction) error {
+	if len(prefixes) != len(actions) {
+		return fmt.Errorf("%d prefixes for %d actions", len(prefixes), len(actions))
+	}
+
+	var keys4 []lpmKeyV4
+	var keys6 []lpmKeyV6
+	var values4, values6 []uint32
+	for i, prefix := range prefixes {
+		if actions[i] > ACLInspect {
+			return fmt.Errorf("%w: %d", ErrInvalidACLAction, actions[i])
+		}
+		prefix = prefix.Masked()
+		addr := prefix.Addr()
+		if addr.Is4() {
+			keys4 = append(keys4, lpmKeyV4{Prefixlen: uint32(prefix.Bits()), Addr: addr.As4()})
+			values4 = append(values4, uint32(actions[i]))
+		} else {
+			keys6 = append(keys6, lpmKeyV6{Prefixlen: uint32(prefix.Bits()), Addr: addr.As16()})
+			values6 = append(values6, uint32(actions[i]))
+		}
+	}
+
+	if err := putLPM(x.objs.ACLSrcV4, &x.lpmNoBatch, keys4, values4); err != nil {
+		return err
+	}
+	return putLPM(x.objs.ACLSrcV6, &x.lpmNoBatch, keys6, values6)
+}
+
+// RemoveCIDRs deletes source-prefix rules in bulk. Prefixes without a rule
+// are ignored.
+func (x *XDPProgram) RemoveCIDRs(prefixes []netip.Prefix) error {
+	var keys4 []lpmKeyV4
+	var keys6 []lpmKeyV6
+	for _, prefix := range prefixes {
+		prefix = prefix.Masked()
+		addr := prefix.Addr()
+		if addr.Is4() {
+			keys4 = append(keys4, lpmKeyV4{Prefixlen: uint32(prefix.Bits()), Addr: addr.As4()})
+		} else {
+			keys6 = append(keys6, lpmKeyV6{Prefixlen: uint32(prefix.Bits()), Addr: addr.As16()})
+		}
+	}
+
+	if err := deleteLPM(x.objs.ACLSrcV4, &x.lpmNoBatch, keys4); err != nil {
+		return err
+	}
+	return deleteLPM(x.objs.ACLSrcV6, &x.lpmNoBatch, keys6)
+}
+
+// putLPM writes keys to an LPM trie in one batch, falling back to one update
+// per key on kernels without batch support for the map type.
+func putLPM[K any](m *ebpf.Map, noBatch *atomic.Bool, keys []K, values []uint32) error {
+	if len(keys) == 0 {
+		return nil
+	}
+	if !noBatch.Load() {
+		_, err := m.BatchUpdate(keys, values, nil)
+		if !errors.Is(err, ebpf.ErrNotSupported) {
+			return err
+		}
+		noBatch.Store(true)
+	}
+	for i := range keys {
+		if err := m.Put(keys[i], values[i]); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// deleteLPM removes keys from an LPM trie, as putLPM. A batch stops at the
+// first missing key, so the rest are then deleted one at a time.
+func deleteLPM[K any](m *ebpf.Map, noBatch *atomic.Bool, keys []K) error {
+	if len(keys) == 0 {
+		return nil
+	}
+	if !noBatch.Load() {
+		n, err := m.BatchDelete(keys, nil)
+		switch {
+		case err == nil:
+			return nil
+		case errors.Is(err, ebpf.ErrKeyNotExist):
+			keys = keys[n:]
+		case errors.Is(err, ebpf.ErrNotSupported):
+			noBatch.Store(true)
+		default:
+			return err
+		}
+	}
+	for i := range keys {
+		if err := m.Delete(keys[i]); err != nil && !errors.Is(err, ebpf.ErrKeyNotExist) {
+			return err
+		}
+	}
+	return nil
+}
+
+// AllowCIDR passes traffic from prefix to the kernel stack.
+func (x *XDPProgram) AllowCIDR(prefix netip.Prefix) error {
+	return x.SetCIDRAction(prefix, ACLAllow)
+}
+
+// DenyCIDR drops traffic from prefix in the driver.
+func (x *XDPProgram) DenyCIDR(prefix netip.Prefix) error {
+	return x.SetCIDRAction(prefix, ACLDeny)
+}
+
+// InspectCIDR sends traffic from prefix to the AF_XDP datapath.
+func (x *XDPProgram) InspectCIDR(prefix netip.Prefix) error {
+	return x.SetCIDRAction(prefix, ACLInspect)
+}
+
+// SetPortAction installs a rule for a transport protocol and destination
+// port (e.g. IPProtoTCP, 22). Port rules apply when no prefix rule matched.
+func (x *XDPProgram) SetPortAction(proto uint8, port uint16, action ACLAction) error {
+	if action < ACLAllow || action > ACLInspect {
+		return fmt.Errorf("%w: %d", ErrInvalidACLAction, action)
+	}
+	return x.objs.ACLPorts.Put(portKey{Proto: proto, Port: port}, uint32(action))
+}
+
+// RemovePortAction deletes a protocol/port rule.
+func (x *XDPProgram) RemovePortAction(proto uint8, port uint16) error {
+	return x.objs.ACLPorts.Delete(portKey{Proto: proto, Port: port})
+}
+
+// SetDefaultAction sets the action for packets no rule matched.
+func (x *XDPProgram) SetDefaultAction(action ACLAction) error {
+	if action < ACLAllow || action > ACLInspect {
+		return fmt.Errorf("%w: %d", ErrInvalidACLAction, action)
+	}
+	return x.objs.Cfg.Put(cfgDefaultAction, uint32(action))
+}
+
+// RegisterSocket binds an AF_XDP socket to its RX queue in the XSKMAP so
+// ACLInspect traffic on that queue is redirected to it.
+func (x *XDPProgram) RegisterSocket(queueID int, sock *XDPSocket) error {
+	return x.objs.XSKs.Put(uint32(queueID), uint32(sock.FileDescriptor()))
+}
+
+// UnregisterSocket removes the socket of an RX queue from the XSKMAP;
+// ACLInspect traffic on that queue then falls back to XDP_PASS.
+func (x *XDPProgram) UnregisterSocket(queueID int) error {
+	return x.objs.XSKs.Delete(uint32(queueID))
+}
+
+// OffloadFlow adds one direction of an established flow to the fast path;
+// its packets then skip the ACLs and the AF_XDP datapath.
+func (x *XDPProgram) OffloadFlow(t FlowTuple) error {
+	return x.objs.CTFlows.Put(t, flowValue{})
+}
+
+// RemoveFlow takes one direction of a flow off the fast path.
+func (x *XDPProgram) RemoveFlow(t FlowTuple) error {
+	err := x.objs.CTFlows.Delete(t)
+	if errors.Is(err, ebpf.ErrKeyNotExist) {
+		return nil
+	}
+	return err
+}
+
+// FlowLastSeen returns the CLOCK_MONOTONIC time in nanoseconds of the last
+// fast-path packet of a flow direction, or 0 if it has seen none.
+func (x *XDPProgram) FlowLastSeen(t FlowTuple) (int64, error) {
+	var v flowValue
+	if err := x.objs.CTFlows.Lookup(t, &v); err != nil {
+		return 0, err
+	}
+	return int64(v.LastSeen), nil
+}
+
+// FlowCounters returns the packets and bytes a flow direction has had on
+// the fast path since it was offloaded.
+func (x *XDPProgram) FlowCounters(t FlowTuple) (packets, bytes uint64, err error) {
+	var v flowValue
+	if err := x.objs.CTFlows.Lookup(t, &v); err != nil {
+		return 0, 0, err
+	}
+	return v.Packets, v.Bytes, nil
+}
+
+// ActionStatsMap returns the per-CPU action_stats map, indexed by XDPAction.
+func (x *XDPProgram) ActionStatsMap() *ebpf.Map {
+	return x.objs.ActionStats
+}
+
+// ActionStats sums the per-CPU action_stats counters of the program,
+// indexed by XDPAction.
+func (x *XDPProgram) ActionStats() ([XDPRedirect + 1]ActionStat, error) {
+	var totals [XDPRedirect + 1]ActionStat
+	var perCPU []ActionStat
+	for action := range totals {
+		if err := x.objs.ActionStats.Lookup(uint32(action), &perCPU); err != nil {
+			return totals, fmt.Errorf("action_stats[%d]: %w", action, err)
+		}
+		for _, cpu := range perCPU {
+			totals[action].Packets += cpu.Packets
+			totals[action].Bytes += cpu.Bytes
+		}
+	}
+	return totals, nil
+}
+
 // XDPAction represents an XDP program action.
 type XDPAction int
 
@@ -174,61 +574,6 @@ func (a XDPAction) String() string {
 	}
 }
 
-// GetXDPStats retrieves XDP statistics from the kernel.
-type XDPStats struct {
-	RxPackets  uint64
-	RxBytes    uint64
-	TxPackets  uint64
-	TxBytes    uint64
-	Drops      uint64
-	Errors     uint64
-}
-
-// GetInterfaceStats gets network interface statistics.
-func GetInterfaceStats(ifaceName string) (*XDPStats, error) {
-	iface, err := net.InterfaceByName(ifaceName)
-	if err != nil {
-		return nil, err
-	}
-
-	// Read stats from /sys/class/net/<iface>/statistics/
-	basePath := fmt.Sprintf("/sys/class/net/%s/statistics", iface.Name)
-
-	stats := &XDPStats{}
-
-	if rx, err := readStatFile(basePath + "/rx_packets"); err == nil {
-		stats.RxPackets = rx
-	}
-	if rx, err := readStatFile(basePath + "/rx_bytes"); err == nil {
-		stats.RxBytes = rx
-	}
-	if tx, err := readStatFile(basePath + "/tx_packets"); err == nil {
-		stats.TxPackets = tx
-	}
-	if tx, err := readStatFile(basePath + "/tx_bytes"); err == nil {
-		stats.TxBytes = tx
-	}
-	if drops, err := readStatFile(basePath + "/rx_dropped"); err == nil {
-		stats.Drops = drops
-	}
-	if errs, err := readStatFile(basePath + "/rx_errors"); err == nil {
-		stats.Errors = errs
-	}
-
-	return stats, nil
-}
-
-func readStatFile(path string) (uint64, error) {
-	data, err := os.ReadFile(path)
-	if err != nil {
-		return 0, err
-	}
-
-	var value uint64
-	_, err = fmt.Sscanf(string(data), "%d", &value)
-	return value, err
-}
-
 // SetRLimitMemlock sets the memlock rlimit to allow BPF map creation.
 func SetRLimitMemlock() error {
 	return unix.Setrlimit(unix.RLIMIT_MEMLOCK, &unix.Rlimit{
@@ -1,6 +1,14 @@
 import { useState, useCallback } from 'react';
 import api from '../lib/api';
-import type { User, CreateUserData, UpdateUserData, PaginatedResponse } from '../types';
+import type {
+  User,
+  CreateUserData,
+  UpdateUserData,
+  CursorPage,
+  FirewallPolicy,
+  PolicyState,
+  PolicyUpdateResult,
+} from '../types';
 
 // Generic API hook for loading states
 export function useApiCall<T>() {
@@ -29,9 +37,9 @@ export function useApiCall<T>() {
 
 // Users API
 export const usersApi = {
-  list: async (page = 1, perPage = 20): Promise<PaginatedResponse<User>> => {
-    const response = await api.get('/users', { params: { page, per_page: perPage } });
-    return response.data;
+  list: async (cursor = '', perPage = 20): Promise<CursorPage<User>> => {
+    const response = await api.get('/users', { params: { cursor, per_page: perPage } });
+    return { items: response.data.users, ...response.data.pagination };
   },
 
   get: async (id: number): Promise<User> => {
@@ -84,3 +92,16 @@ export const goApi = {
     return response.data;
   },
 };
+
+// Firewall policy API (Go backend); an update is live when it resolves
+export const policyApi = {
+  get: async (): Promise<PolicyState> => {
+    const response = await api.get('/go/policy');
+    return response.data;
+  },
+
+  update: async (policy: FirewallPolicy): Promise<PolicyUpdateResult> => {
+    const response = await api.put('/go/policy', policy);
+    return response.data;
+  },
+};
@@ -0,0 +1,62 @@
+import { useEffect, useState } from 'react';
+import type { TelemetryMessage, TelemetryState } from '../types';
+
+const STREAM_URL = '/api/go/telemetry/stream';
+
+// applyMessage merges a telemetry event into the current state. Deltas
+// only carry what changed; queues are merged by queue number.
+export function applyMessage(
+  state: TelemetryState | null,
+  msg: TelemetryMessage
+): TelemetryState | null {
+  if (msg.full) {
+    return {
+      seq: msg.seq,
+      ts: msg.ts,
+      counters: msg.counters ?? {},
+      queues: msg.queues ?? [],
+      top_talkers: msg.top_talkers ?? [],
+      rule_hits: msg.rule_hits ?? {},
+    };
+  }
+  // A delta only applies on top of the message before it
+  if (!state || msg.seq !== state.seq + 1) return state;
+
+  let queues = state.queues;
+  if (msg.queues) {
+    const byQueue = new Map(queues.map((q) => [q.queue, q]));
+    for (const q of msg.queues) byQueue.set(q.queue, q);
+    queues = [...byQueue.values()].sort((a, b) => a.queue - b.queue);
+  }
+  return {
+    seq: msg.seq,
+    ts: msg.ts,
+    counters: msg.counters ? { ...state.counters, ...msg.counters } : state.counters,
+    queues,
+    top_talkers: msg.top_talkers ?? state.top_talkers,
+    rule_hits: msg.rule_hits ? { ...state.rule_hits, ...msg.rule_hits } : state.rule_hits,
+  };
+}
+
+// useTelemetry subscribes to the Go backend's telemetry stream for as long
+// as the component is mounted. The browser reconnects on its own, and the
+// server starts every connection with a full event.
+export function useTelemetry() {
+  const [state, setState] = useState<TelemetryState | null>(null);
+  const [connected, setConnected] = useState(false);
+
+  useEffect(() => {
+    const source = new EventSource(STREAM_URL);
+    const onMessage = (e: MessageEvent<string>) => {
+      const msg = JSON.parse(e.data) as TelemetryMessage;
+      setState((prev) => applyMessage(prev, msg));
+    };
+    source.addEventListener('full', onMessage);
+    source.addEventListener('delta', onMessage);
+    source.onopen = () => setConnected(true);
+    source.onerror = () => setConnected(false);
+    return () => source.close();
+  }, []);
+
+  return { telemetry: state, connected };
+}
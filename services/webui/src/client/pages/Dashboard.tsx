@@ -1,6 +1,7 @@
 import { useState, useEffect } from 'react';
 import { useAuth } from '../hooks/useAuth';
 import { helloApi, goApi } from '../hooks/useApi';
+import { useTelemetry } from '../hooks/useTelemetry';
 import Card from '../components/Card';
 import TabNavigation from '../components/TabNavigation';
 
@@ -10,6 +11,8 @@ export default function Dashboard() {
   const [helloMessage, setHelloMessage] = useState<string | null>(null);
   const [goStatus, setGoStatus] = useState<Record<string, unknown> | null>(null);
   const [isLoading, setIsLoading] = useState(true);
+  const { telemetry, connected } = useTelemetry();
+  const counter = (name: string) => (telemetry?.counters[name] ?? 0).toLocaleString();
 
   const tabs = [
     { id: 'overview', label: 'Overview' },
@@ -25,7 +28,7 @@ export default function Dashboard() {
         const hello = await helloApi.getProtected();
         setHelloMessage(hello.message);
 
-        // Try to fetch Go backend status
+        // Go backend version info; live counters come from the telemetry stream
         try {
           const status = await goApi.status();
           setGoStatus(status);
@@ -86,17 +89,29 @@ export default function Dashboard() {
             </Card>
 
             {/* Quick Stats Card */}
-            <Card title="Quick Stats">
-              <div className="grid grid-cols-2 gap-4">
-                <div>
-                  <div className="text-2xl font-bold text-gold-400">3</div>
-                  <div className="text-sm text-dark-400">Services</div>
-                </div>
-                <div>
-                  <div className="text-2xl font-bold text-green-400">Active</div>
-                  <div className="text-sm text-dark-400">Status</div>
+            <Card title="Datapath">
+              {telemetry ? (
+                <div className="grid grid-cols-2 gap-4">
+                  <div>
+                    <div className="text-2xl font-bold text-gold-400">{counter('rx_packets')}</div>
+                    <div className="text-sm text-dark-400">Packets received</div>
+                  </div>
+                  <div>
+                    <div className="text-2xl font-bold text-red-400">{counter('dropped')}</div>
+                    <div className="text-sm text-dark-400">Dropped</div>
+                  </div>
+                  <div>
+                    <div className="text-2xl font-bold text-gold-400">{counter('ct_entries')}</div>
+                    <div className="text-sm text-dark-400">Tracked flows</div>
+                  </div>
+                  <div>
+                    <div className="text-2xl font-bold text-gold-400">{counter('pool_slots_used')}</div>
+                    <div className="text-sm text-dark-400">Pool slots in use</div>
+                  </div>
                 </div>
-              </div>
+              ) : (
+                <p className="text-dark-400">Waiting for telemetry…</p>
+              )}
             </Card>
           </div>
         )}
@@ -137,6 +152,14 @@ export default function Dashboard() {
                     <span className="text-dark-400">Go Version</span>
                     <span className="text-dark-300">{(goStatus as Record<string, string>).go_version || 'N/A'}</span>
                   </div>
+                  <div className="flex items-center justify-between">
+                    <span className="text-dark-400">Telemetry</span>
+                    {connected ? (
+                      <span className="text-green-400">● Live</span>
+                    ) : (
+                      <span className="text-yellow-400">● Reconnecting</span>
+                    )}
+                  </div>
                 </div>
               ) : (
                 <div className="text-dark-400">
@@ -149,16 +172,65 @@ export default function Dashboard() {
         )}
 
         {activeTab === 'metrics' && (
-          <Card title="System Metrics">
-            <p className="text-dark-400">
-              Metrics visualization will be available when Prometheus/Grafana are configured.
-            </p>
-            <div className="mt-4 p-4 bg-dark-900 rounded-lg">
-              <pre className="text-sm text-dark-300 font-mono">
-                {goStatus ? JSON.stringify(goStatus, null, 2) : 'No metrics available'}
-              </pre>
-            </div>
-          </Card>
+          <div className="grid grid-cols-1 lg:grid-cols-2 gap-6">
+            <Card title="Queues">
+              {telemetry && telemetry.queues.length > 0 ? (
+                <table className="w-full text-sm">
+                  <thead>
+                    <tr className="text-dark-400 text-left">
+                      <th>Queue</th>
+                      <th>RX pps</th>
+                      <th>RX bytes/s</th>
+                      <th>TX pps</th>
+                      <th>Drops/s</th>
+                    </tr>
+                  </thead>
+                  <tbody>
+                    {telemetry.queues.map((q) => (
+                      <tr key={q.queue} className="text-dark-300">
+                        <td className="text-gold-400">{q.queue}</td>
+                        <td>{q.rx_pps.toLocaleString()}</td>
+                        <td>{q.rx_bps.toLocaleString()}</td>
+                        <td>{q.tx_pps.toLocaleString()}</td>
+                        <td className={q.drop_pps > 0 ? 'text-red-400' : ''}>{q.drop_pps.toLocaleString()}</td>
+                      </tr>
+                    ))}
+                  </tbody>
+                </table>
+              ) : (
+                <p className="text-dark-400">No datapath queues are running.</p>
+              )}
+            </Card>
+
+            <Card title="Top Talkers">
+              {telemetry && telemetry.top_talkers.length > 0 ? (
+                <table className="w-full text-sm">
+                  <thead>
+                    <tr className="text-dark-400 text-left">
+                      <th>Source</th>
+                      <th>Destination</th>
+                      <th>Proto</th>
+                      <th>Packets</th>
+                      <th>Bytes</th>
+                    </tr>
+                  </thead>
+                  <tbody>
+                    {telemetry.top_talkers.map((t) => (
+                      <tr key={`${t.src}-${t.dst}-${t.proto}`} className="text-dark-300">
+                        <td className="font-mono">{t.src}</td>
+                        <td className="font-mono">{t.dst}</td>
+                        <td>{t.proto}</td>
+                        <td>{t.packets.toLocaleString()}</td>
+                        <td>{t.bytes.toLocaleString()}</td>
+                      </tr>
+                    ))}
+                  </tbody>
+                </table>
+              ) : (
+                <p className="text-dark-400">No tracked flows.</p>
+              )}
+            </Card>
+          </div>
         )}
       </div>
     </div>
@@ -1,19 +1,364 @@
+import { useState, useEffect } from 'react';
+import { policyApi } from '../hooks/useApi';
+import { useTelemetry } from '../hooks/useTelemetry';
 import Card from '../components/Card';
+import Button from '../components/Button';
+import type {
+  FirewallPolicy,
+  FirewallRule,
+  FirewallAction,
+  FirewallProtocol,
+  PolicyUpdateResult,
+} from '../types';
+
+const PROTOCOLS: FirewallProtocol[] = ['any', 'tcp', 'udp', 'icmp', 'icmpv6', 'esp', 'ah', 'gre'];
+const ACTIONS: FirewallAction[] = ['accept', 'drop', 'reject', 'log'];
+
+const emptyRule = {
+  name: '',
+  priority: 100,
+  source_address: '',
+  dest_address: '',
+  source_port: '',
+  dest_port: '',
+  protocol: 'any' as FirewallProtocol,
+  action: 'accept' as FirewallAction,
+};
+
+const actionClass: Record<FirewallAction, string> = {
+  accept: 'text-green-400',
+  drop: 'text-red-400',
+  reject: 'text-red-400',
+  log: 'text-gold-400',
+};
 
 export default function Firewall() {
+  const [policy, setPolicy] = useState<FirewallPolicy | null>(null);
+  const [generation, setGeneration] = useState(0);
+  const [hits, setHits] = useState<Record<number, number>>({});
+  const [isLoading, setIsLoading] = useState(true);
+  const [error, setError] = useState<string | null>(null);
+  const [dirty, setDirty] = useState(false);
+  const [applyLoading, setApplyLoading] = useState(false);
+  const [lastApply, setLastApply] = useState<PolicyUpdateResult | null>(null);
+  const [showCreateModal, setShowCreateModal] = useState(false);
+  const [newRule, setNewRule] = useState(emptyRule);
+  const { telemetry } = useTelemetry();
+
+  const fetchPolicy = async () => {
+    setIsLoading(true);
+    try {
+      const state = await policyApi.get();
+      setPolicy(state.policy);
+      setGeneration(state.generation);
+      const byId: Record<number, number> = {};
+      for (const h of state.hits) {
+        if (h.kind === 'firewall') byId[h.id] = h.hits;
+      }
+      setHits(byId);
+      setDirty(false);
+      setError(null);
+    } catch (err) {
+      setError('Failed to load firewall policy');
+    } finally {
+      setIsLoading(false);
+    }
+  };
+
+  useEffect(() => {
+    fetchPolicy();
+  }, []);
+
+  // Hit counts stay live from the telemetry stream
+  const ruleHits = (id: number) => telemetry?.rule_hits[`firewall:${id}`] ?? hits[id] ?? 0;
+
+  const rules = [...(policy?.firewall_rules ?? [])].sort(
+    (a, b) => (a.priority || 100) - (b.priority || 100)
+  );
+
+  const updateRules = (fn: (rules: FirewallRule[]) => FirewallRule[]) => {
+    if (!policy) return;
+    setPolicy({ ...policy, firewall_rules: fn(policy.firewall_rules ?? []) });
+    setDirty(true);
+  };
+
+  const handleCreateRule = (e: React.FormEvent) => {
+    e.preventDefault();
+    const nextId = Math.max(0, ...rules.map((r) => r.id)) + 1;
+    updateRules((rs) => [...rs, { ...newRule, id: nextId, is_active: true }]);
+    setShowCreateModal(false);
+    setNewRule(emptyRule);
+  };
+
+  const handleToggleRule = (id: number) => {
+    updateRules((rs) =>
+      rs.map((r) => (r.id === id ? { ...r, is_active: r.is_active === false } : r))
+    );
+  };
+
+  const handleDeleteRule = (id: number) => {
+    if (!confirm('Are you sure you want to delete this rule?')) return;
+    updateRules((rs) => rs.filter((r) => r.id !== id));
+  };
+
+  const handleApply = async () => {
+    if (!policy) return;
+    setApplyLoading(true);
+    try {
+      const result = await policyApi.update(policy);
+      setLastApply(result);
+      await fetchPolicy();
+    } catch (err) {
+      const message = (err as { response?: { data?: { error?: string } } }).response?.data?.error;
+      setError(message ? `Policy rejected: ${message}` : 'Failed to apply firewall policy');
+    } finally {
+      setApplyLoading(false);
+    }
+  };
+
+  const applyMs = (r: PolicyUpdateResult) =>
+    ((r.compile_ns + r.swap_ns + r.mirror_ns) / 1e6).toFixed(2);
+
   return (
     <div>
-      <div className="mb-6">
-        <h1 className="text-2xl font-bold text-gold-400">Firewall</h1>
-        <p className="text-dark-400 mt-1">Manage firewall rules and policies</p>
+      {/* Header */}
+      <div className="flex items-center justify-between mb-6">
+        <div>
+          <h1 className="text-2xl font-bold text-gold-400">Firewall</h1>
+          <p className="text-dark-400 mt-1">
+            Manage firewall rules; applied rules reach the datapath without a restart
+          </p>
+        </div>
+        <div className="flex items-center gap-3">
+          <Button variant="secondary" onClick={() => setShowCreateModal(true)} disabled={!policy}>
+            + Add Rule
+          </Button>
+          <Button onClick={handleApply} isLoading={applyLoading} disabled={!dirty}>
+            Apply
+          </Button>
+        </div>
       </div>
 
+      {/* Error Message */}
+      {error && (
+        <div className="mb-4 p-3 bg-red-900/30 border border-red-700 rounded-lg text-red-400">
+          {error}
+        </div>
+      )}
+
+      {/* Policy Summary */}
+      {policy && (
+        <div className="mb-4 flex items-center gap-6 text-sm text-dark-400">
+          <span>
+            Generation <span className="text-gold-400">{generation}</span>
+          </span>
+          {lastApply && (
+            <span>
+              Last apply: {lastApply.rules} rules live in {applyMs(lastApply)} ms,{' '}
+              {lastApply.entries_written} map entries written, {lastApply.entries_removed} removed,{' '}
+              {lastApply.flows_evicted} flows evicted
+            </span>
+          )}
+          <label className="flex items-center gap-2 ml-auto">
+            Default action
+            <select
+              value={policy.default_action || 'accept'}
+              onChange={(e) => {
+                setPolicy({ ...policy, default_action: e.target.value as 'accept' | 'drop' });
+                setDirty(true);
+              }}
+              className="input"
+            >
+              <option value="accept">Accept</option>
+              <option value="drop">Drop</option>
+            </select>
+          </label>
+          {dirty && <span className="text-gold-400">Unapplied changes</span>}
+        </div>
+      )}
+
+      {/* Rules Table */}
       <Card title="Firewall Rules">
-        <p className="text-dark-400">
-          Firewall management coming soon. This page will allow you to configure
-          inbound and outbound traffic rules, port forwarding, and zone-based policies.
-        </p>
+        {isLoading ? (
+          <div className="animate-pulse space-y-4">
+            {[1, 2, 3].map((i) => (
+              <div key={i} className="h-12 bg-dark-700 rounded"></div>
+            ))}
+          </div>
+        ) : rules.length === 0 ? (
+          <p className="text-dark-400">No firewall rules. Traffic gets the default action.</p>
+        ) : (
+          <table className="table">
+            <thead>
+              <tr>
+                <th>Priority</th>
+                <th>Name</th>
+                <th>Source</th>
+                <th>Destination</th>
+                <th>Protocol</th>
+                <th>Action</th>
+                <th>Hits</th>
+                <th>Status</th>
+                <th>Actions</th>
+              </tr>
+            </thead>
+            <tbody>
+              {rules.map((rule) => (
+                <tr key={rule.id}>
+                  <td className="text-dark-300">{rule.priority || 100}</td>
+                  <td className="text-gold-400">{rule.name}</td>
+                  <td className="text-dark-300">
+                    {rule.source_address || 'any'}
+                    {rule.source_port && `:${rule.source_port}`}
+                  </td>
+                  <td className="text-dark-300">
+                    {rule.dest_address || 'any'}
+                    {rule.dest_port && `:${rule.dest_port}`}
+                  </td>
+                  <td className="text-dark-300">{rule.protocol || 'any'}</td>
+                  <td>
+                    <span className={actionClass[rule.action] ?? 'text-dark-300'}>{rule.action}</span>
+                  </td>
+                  <td className="text-dark-300">{ruleHits(rule.id).toLocaleString()}</td>
+                  <td>
+                    <span className={rule.is_active !== false ? 'text-green-400' : 'text-red-400'}>
+                      {rule.is_active !== false ? '● Active' : '○ Inactive'}
+                    </span>
+                  </td>
+                  <td>
+                    <div className="flex items-center gap-2">
+                      <button
+                        onClick={() => handleToggleRule(rule.id)}
+                        className="text-gold-400 hover:text-gold-300"
+                      >
+                        {rule.is_active !== false ? 'Disable' : 'Enable'}
+                      </button>
+                      <button
+                        onClick={() => handleDeleteRule(rule.id)}
+                        className="text-red-400 hover:text-red-300"
+                      >
+                        Delete
+                      </button>
+                    </div>
+                  </td>
+                </tr>
+              ))}
+            </tbody>
+          </table>
+        )}
       </Card>
+
+      {/* Create Rule Modal */}
+      {showCreateModal && (
+        <div className="fixed inset-0 bg-black/50 flex items-center justify-center z-50">
+          <div className="card w-full max-w-md">
+            <h2 className="text-xl font-bold text-gold-400 mb-4">Add Firewall Rule</h2>
+            <form onSubmit={handleCreateRule} className="space-y-4">
+              <div>
+                <label className="block text-sm text-dark-400 mb-1">Name</label>
+                <input
+                  type="text"
+                  value={newRule.name}
+                  onChange={(e) => setNewRule({ ...newRule, name: e.target.value })}
+                  className="input"
+                  required
+                />
+              </div>
+              <div>
+                <label className="block text-sm text-dark-400 mb-1">Priority (lowest first)</label>
+                <input
+                  type="number"
+                  min={1}
+                  value={newRule.priority}
+                  onChange={(e) => setNewRule({ ...newRule, priority: Number(e.target.value) })}
+                  className="input"
+                />
+              </div>
+              <div className="grid grid-cols-2 gap-3">
+                <div>
+                  <label className="block text-sm text-dark-400 mb-1">Source</label>
+                  <input
+                    type="text"
+                    placeholder="10.0.0.0/8, 2001:db8::1"
+                    value={newRule.source_address}
+                    onChange={(e) => setNewRule({ ...newRule, source_address: e.target.value })}
+                    className="input"
+                  />
+                </div>
+                <div>
+                  <label className="block text-sm text-dark-400 mb-1">Source Port</label>
+                  <input
+                    type="text"
+                    placeholder="1024-65535"
+                    value={newRule.source_port}
+                    onChange={(e) => setNewRule({ ...newRule, source_port: e.target.value })}
+                    className="input"
+                  />
+                </div>
+                <div>
+                  <label className="block text-sm text-dark-400 mb-1">Destination</label>
+                  <input
+                    type="text"
+                    value={newRule.dest_address}
+                    onChange={(e) => setNewRule({ ...newRule, dest_address: e.target.value })}
+                    className="input"
+                  />
+                </div>
+                <div>
+                  <label className="block text-sm text-dark-400 mb-1">Destination Port</label>
+                  <input
+                    type="text"
+                    placeholder="80,443"
+                    value={newRule.dest_port}
+                    onChange={(e) => setNewRule({ ...newRule, dest_port: e.target.value })}
+                    className="input"
+                  />
+                </div>
+              </div>
+              <div className="grid grid-cols-2 gap-3">
+                <div>
+                  <label className="block text-sm text-dark-400 mb-1">Protocol</label>
+                  <select
+                    value={newRule.protocol}
+                    onChange={(e) => setNewRule({ ...newRule, protocol: e.target.value as FirewallProtocol })}
+                    className="input"
+                  >
+                    {PROTOCOLS.map((p) => (
+                      <option key={p} value={p}>
+                        {p}
+                      </option>
+                    ))}
+                  </select>
+                </div>
+                <div>
+                  <label className="block text-sm text-dark-400 mb-1">Action</label>
+                  <select
+                    value={newRule.action}
+                    onChange={(e) => setNewRule({ ...newRule, action: e.target.value as FirewallAction })}
+                    className="input"
+                  >
+                    {ACTIONS.map((a) => (
+                      <option key={a} value={a}>
+                        {a}
+                      </option>
+                    ))}
+                  </select>
+                </div>
+              </div>
+              <div className="flex justify-end gap-3 mt-6">
+                <Button
+                  type="button"
+                  variant="secondary"
+                  onClick={() => setShowCreateModal(false)}
+                >
+                  Cancel
+                </Button>
+                <Button type="submit">Add Rule</Button>
+              </div>
+            </form>
+          </div>
+        </div>
+      )}
     </div>
   );
 }
@@ -7,6 +7,9 @@ import type { User } from '../types';
 
 export default function Users() {
   const [users, setUsers] = useState<User[]>([]);
+  const [total, setTotal] = useState(0);
+  const [nextCursor, setNextCursor] = useState<string | null>(null);
+  const [moreLoading, setMoreLoading] = useState(false);
   const [isLoading, setIsLoading] = useState(true);
   const [error, setError] = useState<string | null>(null);
   const [showCreateModal, setShowCreateModal] = useState(false);
@@ -25,6 +28,8 @@ export default function Users() {
     try {
       const response = await usersApi.list();
       setUsers(response.items);
+      setTotal(response.total);
+      setNextCursor(response.next_cursor);
       setError(null);
     } catch (err) {
       setError('Failed to load users');
@@ -33,6 +38,22 @@ export default function Users() {
     }
   };
 
+  const fetchMoreUsers = async () => {
+    if (!nextCursor) return;
+    setMoreLoading(true);
+    try {
+      const response = await usersApi.list(nextCursor);
+      setUsers((prev) => [...prev, ...response.items]);
+      setTotal(response.total);
+      setNextCursor(response.next_cursor);
+      setError(null);
+    } catch (err) {
+      setError('Failed to load users');
+    } finally {
+      setMoreLoading(false);
+    }
+  };
+
   useEffect(() => {
     fetchUsers();
   }, []);
@@ -133,6 +154,18 @@ export default function Users() {
             </tbody>
           </table>
         )}
+        {!isLoading && (
+          <div className="flex items-center justify-between mt-4 text-sm text-dark-400">
+            <span>
+              Showing {users.length} of {Math.max(total, users.length)} users
+            </span>
+            {nextCursor && (
+              <Button variant="secondary" onClick={fetchMoreUsers} isLoading={moreLoading}>
+                Load more
+              </Button>
+            )}
+          </div>
+        )}
       </Card>
 
       {/* Create User Modal */}
@@ -53,12 +53,78 @@ export interface ApiResponse<T> {
   message?: string;
 }
 
-export interface PaginatedResponse<T> {
+// Keyset page: pass next_cursor back for the next page, null on the last
+export interface CursorPage<T> {
   items: T[];
   total: number;
-  page: number;
   per_page: number;
-  pages: number;
+  next_cursor: string | null;
+}
+
+// Firewall policy types (Go backend /policy)
+export type FirewallAction = 'accept' | 'drop' | 'reject' | 'log';
+export type FirewallProtocol = 'any' | 'tcp' | 'udp' | 'icmp' | 'icmpv6' | 'esp' | 'ah' | 'gre';
+
+export interface FirewallRule {
+  id: number;
+  name: string;
+  priority: number;
+  source_address: string;
+  dest_address: string;
+  source_port: string;
+  dest_port: string;
+  protocol: FirewallProtocol;
+  action: FirewallAction;
+  is_active?: boolean;
+}
+
+export interface ACLRule {
+  id: number;
+  name: string;
+  priority: number;
+  match_type: string;
+  match_value: string;
+  action: string;
+  is_active?: boolean;
+}
+
+export interface ContentFilterRule {
+  id: number;
+  name: string;
+  priority: number;
+  allowed_domains: string[];
+  blocked_domains: string[];
+  is_active?: boolean;
+}
+
+export interface FirewallPolicy {
+  default_action: 'accept' | 'drop';
+  firewall_rules: FirewallRule[] | null;
+  acl_rules: ACLRule[] | null;
+  content_filters: ContentFilterRule[] | null;
+}
+
+export interface RuleHits {
+  kind: 'firewall' | 'acl';
+  id: number;
+  hits: number;
+}
+
+export interface PolicyState {
+  generation: number;
+  policy: FirewallPolicy;
+  hits: RuleHits[];
+}
+
+export interface PolicyUpdateResult {
+  generation: number;
+  rules: number;
+  compile_ns: number;
+  swap_ns: number;
+  mirror_ns: number;
+  entries_written: number;
+  entries_removed: number;
+  flows_evicted: number;
 }
 
 // Navigation types
@@ -81,3 +147,39 @@ export interface Tab {
   label: string;
   content?: React.ReactNode;
 }
+
+// Live datapath telemetry (GET /api/go/telemetry/stream)
+export interface QueueRates {
+  queue: number;
+  rx_pps: number;
+  rx_bps: number;
+  tx_pps: number;
+  drop_pps: number;
+}
+
+export interface Talker {
+  src: string;
+  dst: string;
+  proto: number;
+  packets: number;
+  bytes: number;
+}
+
+export interface TelemetryMessage {
+  seq: number;
+  full: boolean;
+  ts: number;
+  counters?: Record<string, number>;
+  queues?: QueueRates[];
+  top_talkers?: Talker[];
+  rule_hits?: Record<string, number>;
+}
+
+export interface TelemetryState {
+  seq: number;
+  ts: number;
+  counters: Record<string, number>;
+  queues: QueueRates[];
+  top_talkers: Talker[];
+  rule_hits: Record<string, number>;
+}
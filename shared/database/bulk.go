@@ -0,0 +1,119 @@
+package database
+
+import (
+	"context"
+	"encoding/json"
+	"fmt"
+
+	"github.com/redis/go-redis/v9"
+)
+
+// Bulk read defaults. A 512-key MGET keeps each reply small enough not to
+// hold up the server's event loop; eight of them share a round trip.
+const (
+	DefaultBulkChunkSize = 512
+	DefaultBulkPipeline  = 8
+)
+
+// BulkGetOptions sizes bulk reads.
+type BulkGetOptions struct {
+	ChunkSize int // Keys per MGET (default: DefaultBulkChunkSize)
+	Pipeline  int // MGETs sent per round trip (default: DefaultBulkPipeline)
+}
+
+// BulkGetFunc receives the value of keys[i]. err is redis.Nil for a missing
+// key and the MGET's error for keys of a chunk that failed; the read
+// continues past both. Returning an error stops the read.
+type BulkGetFunc func(i int, value string, err error) error
+
+// GetMultipleFunc reads keys in chunked, pipelined MGETs and streams each
+// value to fn in key order as its chunk arrives, so at most one round
+// trip's replies are held in memory however many keys are read.
+func (r *RedisClient) GetMultipleFunc(ctx context.Context, keys []string, opts BulkGetOptions, fn BulkGetFunc) error {
+	chunkSize := opts.ChunkSize
+	if chunkSize <= 0 {
+		chunkSize = DefaultBulkChunkSize
+	}
+	depth := opts.Pipeline
+	if depth <= 0 {
+		depth = DefaultBulkPipeline
+	}
+
+	cmds := make([]*redis.SliceCmd, 0, depth)
+	sizes := make([]int, 0, depth)
+	for start := 0; start < len(keys); {
+		// Exec's error is that of the first failed command; each chunk is
+		// checked on its own below
+		pipe := r.Pipeline()
+		cmds, sizes = cmds[:0], sizes[:0]
+		groupStart := start
+		for len(cmds) < depth && start < len(keys) {
+			end := min(start+chunkSize, len(keys))
+			cmds = append(cmds, pipe.MGet(ctx, keys[start:end]...))
+			sizes = append(sizes, end-start)
+			start = end
+		}
+		_, _ = pipe.Exec(ctx)
+
+		i := groupStart
+		for c, cmd := range cmds {
+			vals, err := cmd.Result()
+			if err == nil && len(vals) != sizes[c] {
+				err = fmt.Errorf("MGET returned %d values for %d keys", len(vals), sizes[c])
+			}
+			for j := 0; j < sizes[c]; j, i = j+1, i+1 {
+				var value string
+				keyErr := err
+				if err == nil {
+					switch v := vals[j].(type) {
+					case string:
+						value = v
+					case nil:
+						keyErr = redis.Nil
+					default:
+						keyErr = fmt.Errorf("unexpected MGET reply %T", v)
+					}
+				}
+				if ferr := fn(i, value, keyErr); ferr != nil {
+					return ferr
+				}
+			}
+		}
+
+		if err := ctx.Err(); err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// GetMultipleInto decodes the value of each keys[i] into dst[i], which
+// must be as long as keys. It returns nil errs if every key decoded;
+// otherwise errs[i] holds keys[i]'s error (redis.Nil if missing), and
+// dst[i] is left as it was. err is set only when the read itself stopped.
+func GetMultipleInto[T any](ctx context.Context, r *RedisClient, keys []string, dst []T, opts BulkGetOptions,
+	decode func(value string, dst *T) error) (errs []error, err error) {
+	if len(dst) != len(keys) {
+		return nil, fmt.Errorf("GetMultipleInto: %d destinations for %d keys", len(dst), len(keys))
+	}
+
+	err = r.GetMultipleFunc(ctx, keys, opts, func(i int, value string, keyErr error) error {
+		if keyErr == nil {
+			keyErr = decode(value, &dst[i])
+		}
+		if keyErr != nil {
+			if errs == nil {
+				errs = make([]error, len(keys))
+			}
+			errs[i] = keyErr
+		}
+		return nil
+	})
+	return errs, err
+}
+
+// DecodeJSON is a GetMultipleInto decoder for JSON values.
+func DecodeJSON[T any](value string, dst *T) error {
+	return json.Unmarshal([]byte(value), dst)
+}
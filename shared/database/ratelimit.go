@@ -0,0 +1,237 @@
+package database
+
+import (
+	"context"
+	"fmt"
+	"hash/maphash"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/redis/go-redis/v9"
+)
+
+// gcraScript implements the generic cell rate algorithm in one round trip.
+// The key holds the theoretical arrival time (TAT) in microseconds of Redis
+// server time, so limits hold across processes with skewed clocks.
+//
+// KEYS[1]: limit key
+// ARGV[1]: emission interval (window / limit) in microseconds
+// ARGV[2]: limit, the burst a caller may use at once
+// ARGV[3]: tokens requested
+// Returns {granted, remaining, retry_after_us}; fewer tokens than requested
+// are granted when that is all the limit allows.
+var gcraScript = redis.NewScript(`
+redis.replicate_commands()
+local t = redis.call('TIME')
+local now = tonumber(t[1]) * 1000000 + tonumber(t[2])
+local interval = tonumber(ARGV[1])
+local limit = tonumber(ARGV[2])
+local want = tonumber(ARGV[3])
+
+local tat = tonumber(redis.call('GET', KEYS[1]) or now)
+if tat < now then
+  tat = now
+end
+
+local avail = math.floor((now + limit * interval - tat) / interval)
+local granted = math.min(want, avail)
+if granted <= 0 then
+  return {0, 0, math.ceil(tat - (limit - 1) * interval - now)}
+end
+
+tat = tat + granted * interval
+redis.call('SET', KEYS[1], string.format('%d', tat), 'PX', string.format('%d', math.ceil((tat - now) / 1000)))
+return {granted, avail - granted, 0}
+`)
+
+// RateLimitResult is the outcome of a rate limit check.
+type RateLimitResult struct {
+	Allowed    int           // Tokens granted; 0 when limited
+	Remaining  int           // Tokens still available in the window
+	RetryAfter time.Duration // When limited, time until a token frees up
+}
+
+// RateLimitN takes up to n tokens from identifier's limit of limit requests
+// per window. Requests are spread by GCRA: a caller may burst up to limit at
+// once, then gets one token every window/limit.
+func (r *RedisClient) RateLimitN(ctx context.Context, identifier string, limit int, window time.Duration, n int) (RateLimitResult, error) {
+	if limit <= 0 || window <= 0 || n <= 0 {
+		return RateLimitResult{}, fmt.Errorf("invalid rate limit: limit %d, window %v, n %d", limit, window, n)
+	}
+
+	key := CacheKey{Prefix: "ratelimit", ID: identifier}
+	interval := float64(window) / float64(time.Microsecond) / float64(limit)
+
+	res, err := gcraScript.Run(ctx, r.Client, []string{key.String()},
+		strconv.FormatFloat(interval, 'f', 3, 64), limit, n).Int64Slice()
+	if err != nil {
+		return RateLimitResult{}, err
+	}
+	if len(res) != 3 {
+		return RateLimitResult{}, fmt.Errorf("unexpected rate limit reply: %v", res)
+	}
+
+	return RateLimitResult{
+		Allowed:    int(res[0]),
+		Remaining:  int(res[1]),
+		RetryAfter: time.Duration(res[2]) * time.Microsecond,
+	}, nil
+}
+
+// rateLimiterShards is the number of independently locked lease shards.
+const rateLimiterShards = 32
+
+// RateLimiterConfig holds configuration for a leasing rate limiter.
+type RateLimiterConfig struct {
+	Limit  int           // Requests per Window, shared by every process
+	Window time.Duration // Window the limit applies to
+	// LeaseSize is how many tokens a process takes from Redis at once and
+	// then hands out locally. 0 or 1 checks Redis on every request.
+	LeaseSize int
+	// LeaseTTL bounds how long unused leased tokens are kept (default: Window)
+	LeaseTTL time.Duration
+}
+
+// DefaultRateLimiterConfig returns a limiter that leases a tenth of the
+// limit, cutting Redis calls about tenfold for busy identifiers.
+func DefaultRateLimiterConfig(limit int, window time.Duration) RateLimiterConfig {
+	return RateLimiterConfig{
+		Limit:     limit,
+		Window:    window,
+		LeaseSize: max(1, limit/10),
+		LeaseTTL:  window,
+	}
+}
+
+// RateLimiter enforces a Redis-backed limit per identifier, leasing tokens
+// in batches so most requests are decided in process.
+//
+// Leased tokens are already counted against the shared limit, so a fleet
+// never admits more than Limit per Window; at worst each process strands up
+// to LeaseSize-1 tokens per identifier, which briefly under-admits. A
+// limited identifier is refused locally until its retry time instead of
+// asking Redis again on every request.
+type RateLimiter struct {
+	client *RedisClient
+	config RateLimiterConfig
+	seed   maphash.Seed
+	shards [rateLimiterShards]leaseShard
+
+	localHits  atomic.Uint64
+	redisCalls atomic.Uint64
+}
+
+// leaseShard holds the leases of the identifiers hashing to it. The padding
+// keeps neighbouring shard locks on separate cache lines.
+type leaseShard struct {
+	mu      sync.Mutex
+	leases  map[string]*tokenLease
+	sweepAt int // Sweep expired leases when the map reaches this size
+	_       [64]byte
+}
+
+// tokenLease is one identifier's local tokens, in Unix nanoseconds.
+type tokenLease struct {
+	tokens       int
+	expires      int64
+	blockedUntil int64
+}
+
+// RateLimiterStats holds a rate limiter's decision counters.
+type RateLimiterStats struct {
+	LocalHits  uint64 // Requests decided from a lease or a cached denial
+	RedisCalls uint64 // Requests that went to Redis
+}
+
+// NewRateLimiter creates a leasing rate limiter backed by this client.
+func (r *RedisClient) NewRateLimiter(config RateLimiterConfig) *RateLimiter {
+	if config.LeaseSize <= 0 {
+		config.LeaseSize = 1
+	}
+	config.LeaseSize = min(config.LeaseSize, config.Limit)
+	if config.LeaseTTL <= 0 {
+		config.LeaseTTL = config.Window
+	}
+
+	rl := &RateLimiter{
+		client: r,
+		config: config,
+		seed:   maphash.MakeSeed(),
+	}
+	for i := range rl.shards {
+		rl.shards[i].leases = make(map[string]*tokenLease)
+		rl.shards[i].sweepAt = 64
+	}
+	return rl
+}
+
+// Allow reports whether identifier may make a request now.
+func (rl *RateLimiter) Allow(ctx context.Context, identifier string) (bool, error) {
+	now := time.Now().UnixNano()
+	s := &rl.shards[maphash.String(rl.seed, identifier)%rateLimiterShards]
+
+	s.mu.Lock()
+	if l := s.leases[identifier]; l != nil {
+		if now < l.blockedUntil {
+			s.mu.Unlock()
+			rl.localHits.Add(1)
+			return false, nil
+		}
+		if l.tokens > 0 && now < l.expires {
+			l.tokens--
+			s.mu.Unlock()
+			rl.localHits.Add(1)
+			return true, nil
+		}
+	}
+	s.mu.Unlock()
+
+	// Concurrent callers may each lease; the tokens are pooled below
+	rl.redisCalls.Add(1)
+	res, err := rl.client.RateLimitN(ctx, identifier, rl.config.Limit, rl.config.Window, rl.config.LeaseSize)
+	if err != nil {
+		return false, err
+	}
+
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	l := s.leases[identifier]
+	if l == nil {
+		if len(s.leases) >= s.sweepAt {
+			s.sweep(now)
+		}
+		l = &tokenLease{}
+		s.leases[identifier] = l
+	} else if now >= l.expires {
+		l.tokens = 0
+	}
+
+	if res.Allowed == 0 {
+		l.blockedUntil = now + int64(res.RetryAfter)
+		return false, nil
+	}
+	l.tokens += res.Allowed - 1
+	l.expires = now + int64(rl.config.LeaseTTL)
+	return true, nil
+}
+
+// sweep drops leases that have neither tokens nor a denial in force, and
+// grows the threshold so sweeps stay amortised O(1) per insert.
+func (s *leaseShard) sweep(now int64) {
+	for id, l := range s.leases {
+		if now >= l.expires && now >= l.blockedUntil {
+			delete(s.leases, id)
+		}
+	}
+	s.sweepAt = max(64, 2*len(s.leases))
+}
+
+// Stats returns the limiter's decision counters.
+func (rl *RateLimiter) Stats() RateLimiterStats {
+	return RateLimiterStats{
+		LocalHits:  rl.localHits.Load(),
+		RedisCalls: rl.redisCalls.Load(),
+	}
+}
@@ -71,8 +71,8 @@ func NewRedisFromURL(url string) (*RedisClient, error) {
 	config := DefaultRedisConfig()
 	opts.PoolSize = config.PoolSize
 	opts.MinIdleConns = config.MinIdleConns
-	opts.MaxIdleTime = config.MaxIdleTime
-	opts.MaxConnAge = config.MaxConnAge
+	opts.ConnMaxIdleTime = config.MaxIdleTime
+	opts.ConnMaxLifetime = config.MaxConnAge
 	opts.DialTimeout = config.DialTimeout
 	opts.ReadTimeout = config.ReadTimeout
 	opts.WriteTimeout = config.WriteTimeout
@@ -104,10 +104,10 @@ func NewRedis(config *RedisConfig) (*RedisClient, error) {
 		Password: config.Password,
 		DB:       config.DB,
 
-		PoolSize:     config.PoolSize,
-		MinIdleConns: config.MinIdleConns,
-		MaxIdleTime:  config.MaxIdleTime,
-		MaxConnAge:   config.MaxConnAge,
+		PoolSize:        config.PoolSize,
+		MinIdleConns:    config.MinIdleConns,
+		ConnMaxIdleTime: config.MaxIdleTime,
+		ConnMaxLifetime: config.MaxConnAge,
 
 		DialTimeout:  config.DialTimeout,
 		ReadTimeout:  config.ReadTimeout,
@@ -176,14 +176,62 @@ func (r *RedisClient) GetCachedFeature(ctx context.Context, licenseKey, feature
 }
 
 // Session management operations
+
+// Session keys share the {session} hash tag, so in Redis Cluster every
+// session and the index live in one slot: reapSessionsScript derives the
+// keys it unlinks from the index rather than receiving them in KEYS, which
+// Cluster only allows within the script's slot, and DeleteSession's
+// MULTI needs both keys on one node. The price is that sessions are not
+// spread across the cluster.
+const sessionPrefix = "{session}"
+
+// sessionIndexKey is a sorted set of session IDs scored by expiry time in
+// Unix milliseconds of Redis server time, so expired sessions can be found
+// without a SCAN.
+const sessionIndexKey = sessionPrefix + ":expiry"
+
+func sessionKey(sessionID string) string {
+	return CacheKey{Prefix: sessionPrefix, ID: sessionID}.String()
+}
+
+// legacySessionKey is where sessions were stored before the {session} hash
+// tag. GetSession and DeleteSession still honour it so existing sessions
+// survive the upgrade; it can go once one session TTL has passed since.
+func legacySessionKey(sessionID string) string {
+	return CacheKey{Prefix: "session", ID: sessionID}.String()
+}
+
+// storeSessionScript sets a session and indexes its expiry, both measured
+// on the Redis clock like the reaper's, so a skewed client clock neither
+// reaps live sessions nor keeps expired ones.
+//
+// KEYS[1]: session key
+// KEYS[2]: session index
+// ARGV[1]: user ID
+// ARGV[2]: TTL in milliseconds
+// ARGV[3]: session ID
+var storeSessionScript = redis.NewScript(`
+redis.replicate_commands()
+local t = redis.call('TIME')
+local now = tonumber(t[1]) * 1000 + math.floor(tonumber(t[2]) / 1000)
+redis.call('SET', KEYS[1], ARGV[1], 'PX', ARGV[2])
+redis.call('ZADD', KEYS[2], now + tonumber(ARGV[2]), ARGV[3])
+return 1
+`)
+
+// StoreSession stores a session and records its expiry in the session
+// index, in one round trip.
 func (r *RedisClient) StoreSession(ctx context.Context, sessionID string, userID uint, ttl time.Duration) error {
-	key := CacheKey{Prefix: "session", ID: sessionID}
-	return r.SetEx(ctx, key.String(), userID, ttl).Err()
+	ttlMillis := max(ttl.Milliseconds(), 1)
+	return storeSessionScript.Run(ctx, r.Client, []string{sessionKey(sessionID), sessionIndexKey},
+		userID, ttlMillis, sessionID).Err()
 }
 
 func (r *RedisClient) GetSession(ctx context.Context, sessionID string) (uint, error) {
-	key := CacheKey{Prefix: "session", ID: sessionID}
-	result := r.Get(ctx, key.String())
+	result := r.Get(ctx, sessionKey(sessionID))
+	if result.Err() == redis.Nil {
+		result = r.Get(ctx, legacySessionKey(sessionID))
+	}
 	if result.Err() != nil {
 		return 0, result.Err()
 	}
@@ -192,29 +240,30 @@ func (r *RedisClient) GetSession(ctx context.Context, sessionID string) (uint, e
 }
 
 func (r *RedisClient) DeleteSession(ctx context.Context, sessionID string) error {
-	key := CacheKey{Prefix: "session", ID: sessionID}
-	return r.Del(ctx, key.String()).Err()
+	_, err := r.TxPipelined(ctx, func(pipe redis.Pipeliner) error {
+		pipe.Unlink(ctx, sessionKey(sessionID))
+		pipe.ZRem(ctx, sessionIndexKey, sessionID)
+		return nil
+	})
+	if err != nil {
+		return err
+	}
+	// Outside the MULTI: in Redis Cluster the legacy key may be in another
+	// slot
+	return r.Unlink(ctx, legacySessionKey(sessionID)).Err()
 }
 
 // Rate limiting operations
-func (r *RedisClient) RateLimit(ctx context.Context, identifier string, limit int, window time.Duration) (bool, error) {
-	key := CacheKey{Prefix: "ratelimit", ID: identifier}
-
-	pipe := r.Pipeline()
-	incr := pipe.Incr(ctx, key.String())
-	pipe.Expire(ctx, key.String(), window)
-
-	_, err := pipe.Exec(ctx)
-	if err != nil {
-		return false, err
-	}
 
-	current, err := incr.Result()
+// RateLimit reports whether identifier may make one more request under a
+// limit of limit requests per window. The check is a single GCRA script
+// call (see RateLimitN); use NewRateLimiter to decide most requests locally.
+func (r *RedisClient) RateLimit(ctx context.Context, identifier string, limit int, window time.Duration) (bool, error) {
+	res, err := r.RateLimitN(ctx, identifier, limit, window, 1)
 	if err != nil {
 		return false, err
 	}
-
-	return current <= int64(limit), nil
+	return res.Allowed > 0, nil
 }
 
 // Feature usage tracking
@@ -262,59 +311,115 @@ func (r *RedisClient) GetConnectionStats() *redis.PoolStats {
 }
 
 // Cleanup operations
-func (r *RedisClient) CleanupExpiredSessions(ctx context.Context) error {
-	// This would be implemented as a periodic cleanup job
-	pattern := "session:*"
-	iter := r.Scan(ctx, 0, pattern, 100).Iterator()
 
-	var keysToCheck []string
-	for iter.Next(ctx) {
-		keysToCheck = append(keysToCheck, iter.Val())
+// reapSessionsScript removes one batch of sessions expired by the Redis
+// clock: their keys and their index entries. Running as a script keeps a
+// session refreshed by StoreSession meanwhile from being deleted. The
+// session keys are not in KEYS; they share the index's hash slot (see
+// sessionPrefix).
+//
+// KEYS[1]: session index
+// ARGV[1]: batch size
+// ARGV[2]: session key prefix
+var reapSessionsScript = redis.NewScript(`
+redis.replicate_commands()
+local t = redis.call('TIME')
+local now = tonumber(t[1]) * 1000 + math.floor(tonumber(t[2]) / 1000)
+local ids = redis.call('ZRANGEBYSCORE', KEYS[1], '-inf', now, 'LIMIT', 0, ARGV[1])
+if #ids == 0 then
+  return 0
+end
+local keys = {}
+for i, id in ipairs(ids) do
+  keys[i] = ARGV[2] .. id
+end
+redis.call('UNLINK', unpack(keys))
+redis.call('ZREM', KEYS[1], unpack(ids))
+return #ids
+`)
+
+// SessionCleanupConfig bounds the work of a session cleanup pass.
+type SessionCleanupConfig struct {
+	BatchSize  int           // Sessions removed per round trip
+	Pause      time.Duration // Wait between batches, capping the load on Redis
+	MaxBatches int           // Batches per pass; 0 runs until none are expired
+}
+
+// DefaultSessionCleanupConfig returns 500-session batches at most 20 times
+// a second.
+func DefaultSessionCleanupConfig() SessionCleanupConfig {
+	return SessionCleanupConfig{
+		BatchSize: 500,
+		Pause:     50 * time.Millisecond,
 	}
+}
 
-	if err := iter.Err(); err != nil {
-		return err
+// CleanupExpiredSessions removes sessions whose expiry has passed, using
+// the default cleanup bounds. Sessions stored under the keys used before
+// the expiry index existed are not indexed; Redis expires them through
+// their TTL.
+func (r *RedisClient) CleanupExpiredSessions(ctx context.Context) error {
+	_, err := r.ReapExpiredSessions(ctx, DefaultSessionCleanupConfig())
+	return err
+}
+
+// ReapExpiredSessions removes expired sessions from the session index in
+// batches and returns how many were removed. Memory use is one batch
+// regardless of how many sessions exist.
+func (r *RedisClient) ReapExpiredSessions(ctx context.Context, config SessionCleanupConfig) (int, error) {
+	if config.BatchSize <= 0 {
+		config.BatchSize = DefaultSessionCleanupConfig().BatchSize
 	}
+	prefix := sessionKey("")
+
+	total := 0
+	for batch := 0; config.MaxBatches <= 0 || batch < config.MaxBatches; batch++ {
+		if batch > 0 && config.Pause > 0 {
+			select {
+			case <-ctx.Done():
+				return total, ctx.Err()
+			case <-time.After(config.Pause):
+			}
+		}
 
-	// Check TTL for each key and remove expired ones
-	for _, key := range keysToCheck {
-		ttl := r.TTL(ctx, key)
-		if ttl.Val() < 0 {
-			r.Del(ctx, key)
+		n, err := reapSessionsScript.Run(ctx, r.Client, []string{sessionIndexKey},
+			config.BatchSize, prefix).Int()
+		if err != nil {
+			return total, err
+		}
+		total += n
+		if n < config.BatchSize {
+			break
 		}
 	}
 
-	return nil
+	return total, nil
 }
 
 // Bulk operations
+
+// GetMultiple returns the values of keys, nil for missing ones, failing on
+// the first other error. It reads in chunks like GetMultipleFunc; prefer
+// that or GetMultipleInto for large reads, which do not box each value or
+// fail the whole read for one key.
 func (r *RedisClient) GetMultiple(ctx context.Context, keys []string) ([]interface{}, error) {
 	if len(keys) == 0 {
 		return nil, nil
 	}
 
-	pipe := r.Pipeline()
-	cmds := make([]*redis.StringCmd, len(keys))
-
-	for i, key := range keys {
-		cmds[i] = pipe.Get(ctx, key)
-	}
-
-	_, err := pipe.Exec(ctx)
-	if err != nil && err != redis.Nil {
-		return nil, err
-	}
-
 	results := make([]interface{}, len(keys))
-	for i, cmd := range cmds {
-		val, err := cmd.Result()
+	err := r.GetMultipleFunc(ctx, keys, BulkGetOptions{}, func(i int, value string, err error) error {
 		if err == redis.Nil {
-			results[i] = nil
-		} else if err != nil {
-			return nil, err
-		} else {
-			results[i] = val
+			return nil
 		}
+		if err != nil {
+			return err
+		}
+		results[i] = value
+		return nil
+	})
+	if err != nil {
+		return nil, err
 	}
 
 	return results, nil
@@ -328,4 +433,4 @@ func getEnvInt(key string, defaultValue int) int {
 		}
 	}
 	return defaultValue
-}
\ No newline at end of file
+}
@@ -0,0 +1,54 @@
+package grpc
+
+import (
+	"math"
+	"sync/atomic"
+)
+
+// retryBudget limits retries to a share of successful calls, as gRPC
+// retry throttling does: the bucket holds up to max tokens, a retry takes
+// one, a success returns ratio of one. Retries stop while the bucket is
+// at or below half, so a failing backend sees few retries on top of its
+// load rather than MaxRetries times it.
+type retryBudget struct {
+	tokens atomic.Int64 // In thousandths of a token
+	max    int64
+	ratio  int64
+}
+
+const budgetScale = 1000
+
+func newRetryBudget(ratio, tokens float64) *retryBudget {
+	b := &retryBudget{
+		max:   int64(math.Max(tokens, 1) * budgetScale),
+		ratio: int64(math.Max(ratio, 0) * budgetScale),
+	}
+	b.tokens.Store(b.max)
+	return b
+}
+
+// withdraw takes a token for a retry, reporting false if none may be spent.
+func (b *retryBudget) withdraw() bool {
+	for {
+		cur := b.tokens.Load()
+		if cur <= b.max/2 {
+			return false
+		}
+		if b.tokens.CompareAndSwap(cur, cur-budgetScale) {
+			return true
+		}
+	}
+}
+
+// success returns ratio of a token.
+func (b *retryBudget) success() {
+	for {
+		cur := b.tokens.Load()
+		if cur >= b.max {
+			return
+		}
+		if b.tokens.CompareAndSwap(cur, min(cur+b.ratio, b.max)) {
+			return
+		}
+	}
+}
@@ -0,0 +1,90 @@
+package grpc
+
+import (
+	"sync"
+	"testing"
+)
+
+// TestRetryBudget checks that retries stop at half the bucket and resume
+// as successes refill it, never past its size.
+func TestRetryBudget(t *testing.T) {
+	b := newRetryBudget(0.1, 10)
+	n := 0
+	for b.withdraw() {
+		n++
+	}
+	if n != 5 {
+		t.Fatalf("expected 5 retries from a full bucket of 10, got %d", n)
+	}
+
+	// Any refill above half allows a retry, which then takes the bucket
+	// below half until ten successes at 0.1 have paid it back
+	b.success()
+	if !b.withdraw() || b.withdraw() {
+		t.Fatal("expected exactly one retry after a success")
+	}
+	for i := 0; i < 9; i++ {
+		b.success()
+	}
+	if b.withdraw() {
+		t.Fatal("expected no retry until the bucket is back above half")
+	}
+	b.success()
+	if !b.withdraw() {
+		t.Fatal("expected a retry once the bucket is back above half")
+	}
+
+	// Successes do not fill the bucket past its size
+	for i := 0; i < 1000; i++ {
+		b.success()
+	}
+	if got := b.tokens.Load(); got != b.max {
+		t.Errorf("expected a full bucket of %d, got %d", b.max, got)
+	}
+}
+
+// TestRetryBudgetBounds checks the clamped configurations: a zero ratio
+// never refills and a bucket smaller than one token holds one.
+func TestRetryBudgetBounds(t *testing.T) {
+	b := newRetryBudget(0, 2)
+	if !b.withdraw() || b.withdraw() {
+		t.Fatal("expected one retry from a bucket of 2")
+	}
+	for i := 0; i < 100; i++ {
+		b.success()
+	}
+	if b.withdraw() {
+		t.Error("expected a zero ratio never to refill")
+	}
+
+	small := newRetryBudget(0.1, 0)
+	if !small.withdraw() || small.withdraw() {
+		t.Error("expected one retry from a bucket clamped to one token")
+	}
+}
+
+// TestRetryBudgetConcurrent checks that concurrent retries never take more
+// than the bucket allows.
+func TestRetryBudgetConcurrent(t *testing.T) {
+	b := newRetryBudget(0.1, 100)
+	var wg sync.WaitGroup
+	var mu sync.Mutex
+	granted := 0
+	for g := 0; g < 8; g++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := 0; i < 100; i++ {
+				if b.withdraw() {
+					mu.Lock()
+					granted++
+					mu.Unlock()
+				}
+			}
+		}()
+	}
+	wg.Wait()
+	if granted != 50 {
+		t.Errorf("expected 50 retries granted, got %d", granted)
+	}
+}
@@ -13,12 +13,24 @@ import (
 	"google.golang.org/grpc/codes"
 	"google.golang.org/grpc/credentials"
 	"google.golang.org/grpc/credentials/insecure"
+	"google.golang.org/grpc/keepalive"
 	"google.golang.org/grpc/status"
 )
 
+// Load balancing policies, applied across the addresses a target resolves to.
+const (
+	// BalancerPickFirst sends every RPC of a connection to one backend.
+	BalancerPickFirst = "pick_first"
+	// BalancerRoundRobin spreads RPCs over every healthy backend in turn.
+	BalancerRoundRobin = "round_robin"
+	// BalancerLeastRequest sends each RPC to the less loaded of two
+	// backends, by outstanding RPCs.
+	BalancerLeastRequest = "least_request_experimental"
+)
+
 // ClientOptions configures gRPC client behavior.
 type ClientOptions struct {
-	MaxRetries        int
+	MaxRetries        int // Maximum attempts per call, retries also need budget
 	InitialBackoff    time.Duration
 	MaxBackoff        time.Duration
 	BackoffMultiplier float64
@@ -29,6 +41,12 @@ type ClientOptions struct {
 	ClientKeyPath     string
 	KeepaliveTime     time.Duration
 	KeepaliveTimeout  time.Duration
+	PoolSize          int     // Connections (subchannels) opened to each backend
+	Balancer          string  // One of the Balancer* policies
+	HealthCheck       bool    // Skip backends failing the gRPC health check
+	HealthService     string  // Service name sent in health checks
+	RetryBudgetRatio  float64 // Retries allowed per successful call
+	RetryBudgetTokens float64 // Budget size, half of which a burst may spend
 }
 
 // DefaultClientOptions returns sensible defaults for client configuration.
@@ -42,6 +60,11 @@ func DefaultClientOptions() *ClientOptions {
 		EnableTLS:         false,
 		KeepaliveTime:     1 * time.Minute,
 		KeepaliveTimeout:  20 * time.Second,
+		PoolSize:          4,
+		Balancer:          BalancerRoundRobin,
+		HealthCheck:       true,
+		RetryBudgetRatio:  0.1,
+		RetryBudgetTokens: 10,
 	}
 }
 
@@ -72,21 +95,62 @@ func WithRetries(maxRetries int) ClientOption {
 	}
 }
 
-// Client wraps a gRPC connection with retry logic.
+// WithPoolSize sets the connections opened to each backend. A server
+// caps the concurrent streams on one connection (100 for NewServer), so
+// busy clients need several.
+func WithPoolSize(size int) ClientOption {
+	return func(opts *ClientOptions) {
+		opts.PoolSize = size
+	}
+}
+
+// WithBalancer sets the load balancing policy, one of the Balancer* names.
+func WithBalancer(balancer string) ClientOption {
+	return func(opts *ClientOptions) {
+		opts.Balancer = balancer
+	}
+}
+
+// WithHealthCheck enables or disables per-subchannel health checks
+// against the named health service ("" for the whole server).
+func WithHealthCheck(enable bool, service string) ClientOption {
+	return func(opts *ClientOptions) {
+		opts.HealthCheck = enable
+		opts.HealthService = service
+	}
+}
+
+// WithRetryBudget sets the retry budget: each successful call earns ratio
+// of a retry, and a burst of failures may spend up to half of tokens.
+func WithRetryBudget(ratio, tokens float64) ClientOption {
+	return func(opts *ClientOptions) {
+		opts.RetryBudgetRatio = ratio
+		opts.RetryBudgetTokens = tokens
+	}
+}
+
+// Client is a pool of gRPC connections to one target with retry logic.
+//
+// Each of the PoolSize connections resolves the target and balances over
+// its backends with the configured policy, so every backend gets PoolSize
+// subchannels. Conn picks a connection per call.
 type Client struct {
-	conn   *grpc.ClientConn
+	pool   *connPool
+	budget *retryBudget
 	opts   *ClientOptions
 	target string
 }
 
 // NewClient creates a new gRPC client with the given target and options.
+// The target is resolved by DNS unless it names another scheme; use
+// HeadlessServiceTarget to balance over the pods of a Kubernetes service.
 //
 // Example:
 //
 //	client, err := NewClient(
-//	    "localhost:50051",
+//	    HeadlessServiceTarget("my-service-headless", "default", 50051),
 //	    WithTimeout(10*time.Second),
-//	    WithRetries(5),
+//	    WithBalancer(BalancerLeastRequest),
 //	)
 //	if err != nil {
 //	    log.Fatal(err)
@@ -101,6 +165,7 @@ func NewClient(target string, options ...ClientOption) (*Client, error) {
 	// Create dial options
 	dialOpts := []grpc.DialOption{
 		grpc.WithKeepaliveParams(keepaliveClientParams(opts)),
+		grpc.WithDefaultServiceConfig(serviceConfig(opts)),
 	}
 
 	// Configure credentials
@@ -115,25 +180,27 @@ func NewClient(target string, options ...ClientOption) (*Client, error) {
 		dialOpts = append(dialOpts, grpc.WithTransportCredentials(insecure.NewCredentials()))
 	}
 
-	// Create connection
-	conn, err := grpc.Dial(target, dialOpts...)
+	// Create connections; they connect on first use
+	pool, err := newConnPool(target, max(opts.PoolSize, 1), opts.Balancer == BalancerLeastRequest, dialOpts)
 	if err != nil {
-		log.Printf("Failed to connect to %s: %v", target, err)
+		log.Printf("Failed to create gRPC client for %s: %v", target, err)
 		return nil, err
 	}
 
-	log.Printf("gRPC client connected to %s", target)
+	log.Printf("gRPC client created for %s (pool=%d, balancer=%s)", target, len(pool.conns), opts.Balancer)
 
 	return &Client{
-		conn:   conn,
+		pool:   pool,
+		budget: newRetryBudget(opts.RetryBudgetRatio, opts.RetryBudgetTokens),
 		opts:   opts,
 		target: target,
 	}, nil
 }
 
-// Conn returns the underlying gRPC connection.
+// Conn returns a connection of the pool to make one call on. Get a new one
+// per call rather than keeping it, so calls spread over the pool.
 func (c *Client) Conn() *grpc.ClientConn {
-	return c.conn
+	return c.pool.pick()
 }
 
 // CallWithRetry executes the given function with exponential backoff retry.
@@ -163,6 +230,7 @@ func (c *Client) CallWithRetry(
 		cancel()
 
 		if err == nil {
+			c.budget.success()
 			return nil
 		}
 
@@ -174,12 +242,25 @@ func (c *Client) CallWithRetry(
 			return err
 		}
 
-		// Retry with exponential backoff
+		// Retry with exponential backoff, while the budget allows. An
+		// outage then costs a few retries per call rather than MaxRetries.
 		if attempt < c.opts.MaxRetries-1 {
+			if !c.budget.withdraw() {
+				log.Printf("RPC failed (attempt %d/%d), retry budget exhausted: %v",
+					attempt+1, c.opts.MaxRetries, err)
+				return err
+			}
+
 			log.Printf("RPC failed (attempt %d/%d), retrying in %v: %v",
 				attempt+1, c.opts.MaxRetries, backoff, err)
 
-			time.Sleep(backoff)
+			timer := time.NewTimer(backoff)
+			select {
+			case <-timer.C:
+			case <-ctx.Done():
+				timer.Stop()
+				return lastErr
+			}
 
 			// Increase backoff
 			backoff = time.Duration(float64(backoff) * c.opts.BackoffMultiplier)
@@ -193,13 +274,10 @@ func (c *Client) CallWithRetry(
 	return lastErr
 }
 
-// Close closes the gRPC connection.
+// Close closes every connection of the pool.
 func (c *Client) Close() error {
-	if c.conn != nil {
-		log.Printf("Closing gRPC connection to %s", c.target)
-		return c.conn.Close()
-	}
-	return nil
+	log.Printf("Closing gRPC connections to %s", c.target)
+	return c.pool.close()
 }
 
 // isRetryable determines if a gRPC error should be retried.
@@ -256,8 +334,8 @@ func loadTLSCredentials(opts *ClientOptions) (credentials.TransportCredentials,
 }
 
 // keepaliveClientParams returns keepalive parameters for the client.
-func keepaliveClientParams(opts *ClientOptions) grpc.KeepaliveParams {
-	return grpc.KeepaliveParams{
+func keepaliveClientParams(opts *ClientOptions) keepalive.ClientParameters {
+	return keepalive.ClientParameters{
 		Time:                opts.KeepaliveTime,
 		Timeout:             opts.KeepaliveTimeout,
 		PermitWithoutStream: true,
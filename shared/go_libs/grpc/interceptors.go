@@ -5,9 +5,10 @@ import (
 	"context"
 	"fmt"
 	"log"
+	"net"
+	"net/netip"
 	"runtime/debug"
 	"strings"
-	"sync"
 	"time"
 
 	"github.com/golang-jwt/jwt/v5"
@@ -15,6 +16,7 @@ import (
 	"google.golang.org/grpc"
 	"google.golang.org/grpc/codes"
 	"google.golang.org/grpc/metadata"
+	"google.golang.org/grpc/peer"
 	"google.golang.org/grpc/status"
 )
 
@@ -90,8 +92,9 @@ func (a *AuthInterceptor) Unary() grpc.UnaryServerInterceptor {
 			return nil, status.Error(codes.Unauthenticated, "invalid token")
 		}
 
-		// Extract user info from claims
+		// Hand the verified claims to later interceptors and the handler
 		if claims, ok := token.Claims.(jwt.MapClaims); ok {
+			ctx = context.WithValue(ctx, claimsKey{}, claims)
 			if sub, ok := claims["sub"].(string); ok {
 				log.Printf("Authenticated request to %s from user %s", info.FullMethod, sub)
 			}
@@ -101,37 +104,188 @@ func (a *AuthInterceptor) Unary() grpc.UnaryServerInterceptor {
 	}
 }
 
+// claimsKey is the context key of the claims AuthInterceptor verified.
+type claimsKey struct{}
+
+// ClaimsFromContext returns the JWT claims AuthInterceptor verified for the
+// current RPC.
+func ClaimsFromContext(ctx context.Context) (jwt.MapClaims, bool) {
+	claims, ok := ctx.Value(claimsKey{}).(jwt.MapClaims)
+	return claims, ok
+}
+
+// SubjectFromContext returns the verified "sub" claim of the current RPC.
+func SubjectFromContext(ctx context.Context) (string, bool) {
+	claims, ok := ClaimsFromContext(ctx)
+	if !ok {
+		return "", false
+	}
+	sub, ok := claims["sub"].(string)
+	return sub, ok && sub != ""
+}
+
 // RateLimitInterceptor provides rate limiting for gRPC servers.
+//
+// Each client gets a token bucket that refills at requestsPerMinute and
+// holds up to a minute's worth of requests. Buckets live in a sharded
+// table, so concurrent RPCs only serialize on the same shard, and the table
+// is bounded: idle clients expire and the least recently seen client is
+// evicted when it is full.
 type RateLimitInterceptor struct {
-	requestsPerMinute int
-	perUser           bool
-	mu                sync.Mutex
-	limits            map[string]*rateLimitEntry
+	perUser bool
+	trusted []netip.Prefix
+	buckets *bucketTable
+}
+
+// RateLimitOptions configures the rate limiter's bucket table.
+type RateLimitOptions struct {
+	Burst      int           // Bucket capacity (default: requestsPerMinute)
+	MaxClients int           // Clients tracked at once (default: 100000)
+	IdleTTL    time.Duration // Idle time before a client expires (default: time to refill Burst)
+	// TrustedProxies are the peers whose x-forwarded-for is believed
+	// (default: none, clients key on their own address)
+	TrustedProxies []netip.Prefix
+}
+
+// RateLimitOption is a functional option for configuring the rate limiter.
+type RateLimitOption func(*RateLimitOptions)
+
+// WithRateLimitBurst sets how many requests a client may make at once.
+func WithRateLimitBurst(burst int) RateLimitOption {
+	return func(opts *RateLimitOptions) {
+		opts.Burst = burst
+	}
+}
+
+// WithRateLimitMaxClients bounds the number of clients tracked.
+func WithRateLimitMaxClients(max int) RateLimitOption {
+	return func(opts *RateLimitOptions) {
+		opts.MaxClients = max
+	}
+}
+
+// WithRateLimitIdleTTL sets how long an idle client's bucket is kept.
+func WithRateLimitIdleTTL(ttl time.Duration) RateLimitOption {
+	return func(opts *RateLimitOptions) {
+		opts.IdleTTL = ttl
+	}
 }
 
-type rateLimitEntry struct {
-	count       int
-	windowStart time.Time
+// WithRateLimitTrustedProxies sets the proxies, such as the ingress, whose
+// x-forwarded-for names the client. Anyone else could set the header to a
+// fresh value per RPC and never be limited.
+func WithRateLimitTrustedProxies(proxies ...netip.Prefix) RateLimitOption {
+	return func(opts *RateLimitOptions) {
+		opts.TrustedProxies = append(opts.TrustedProxies, proxies...)
+	}
 }
 
 // NewRateLimitInterceptor creates a new rate limiting interceptor.
 //
+// With perUser, clients are identified by the JWT subject AuthInterceptor
+// verified, so it must run first in the chain; unauthenticated RPCs and
+// non-per-user limiters key on the client address: the peer's, or the
+// one a trusted proxy forwarded.
+//
 // Example:
 //
 //	rateLimiter := NewRateLimitInterceptor(100, true)
 //	server := NewServer(
 //	    []grpc.ServerOption{
-//	        grpc.UnaryInterceptor(rateLimiter.Unary()),
+//	        grpc.ChainUnaryInterceptor(auth.Unary(), rateLimiter.Unary()),
 //	    },
 //	)
-func NewRateLimitInterceptor(requestsPerMinute int, perUser bool) *RateLimitInterceptor {
+func NewRateLimitInterceptor(requestsPerMinute int, perUser bool, opts ...RateLimitOption) *RateLimitInterceptor {
+	options := RateLimitOptions{
+		Burst:      requestsPerMinute,
+		MaxClients: 100000,
+	}
+	for _, opt := range opts {
+		opt(&options)
+	}
+
+	perSecond := float64(requestsPerMinute) / 60
+	if options.IdleTTL <= 0 {
+		options.IdleTTL = time.Minute
+		if perSecond > 0 {
+			options.IdleTTL = max(time.Second, time.Duration(float64(options.Burst)/perSecond*float64(time.Second)))
+		}
+	}
+
 	return &RateLimitInterceptor{
-		requestsPerMinute: requestsPerMinute,
-		perUser:           perUser,
-		limits:            make(map[string]*rateLimitEntry),
+		perUser: perUser,
+		trusted: options.TrustedProxies,
+		buckets: newBucketTable(perSecond, float64(options.Burst), options.MaxClients, options.IdleTTL),
 	}
 }
 
+// Clients returns the number of clients currently tracked.
+func (r *RateLimitInterceptor) Clients() int {
+	return r.buckets.len()
+}
+
+// clientID identifies the caller of an RPC.
+func (r *RateLimitInterceptor) clientID(ctx context.Context) string {
+	if r.perUser {
+		if sub, ok := SubjectFromContext(ctx); ok {
+			return sub
+		}
+	}
+
+	p, ok := peer.FromContext(ctx)
+	if !ok || p.Addr == nil {
+		return "anonymous"
+	}
+	addr := p.Addr.String()
+	host, _, err := net.SplitHostPort(addr)
+	if err != nil {
+		return addr
+	}
+	remote, err := netip.ParseAddr(host)
+	if err != nil || !r.isTrusted(remote) {
+		return host
+	}
+
+	var forwarded []string
+	if md, ok := metadata.FromIncomingContext(ctx); ok {
+		forwarded = md.Get("x-forwarded-for")
+	}
+	return forwardedClient(remote, forwarded, r.isTrusted).String()
+}
+
+func (r *RateLimitInterceptor) isTrusted(addr netip.Addr) bool {
+	addr = addr.Unmap()
+	for _, p := range r.trusted {
+		if p.Contains(addr) {
+			return true
+		}
+	}
+	return false
+}
+
+// forwardedClient returns the client address of a request a trusted proxy
+// at remote passed on: the x-forwarded-for hop nearest the proxy that is
+// not itself trusted. Each proxy appends the address it saw, so further
+// left only the client's own claims remain. An unparsable hop ends the
+// walk at the last address known good.
+func forwardedClient(remote netip.Addr, forwarded []string, trusted func(netip.Addr) bool) netip.Addr {
+	client := remote
+	for i := len(forwarded) - 1; i >= 0; i-- {
+		hops := strings.Split(forwarded[i], ",")
+		for j := len(hops) - 1; j >= 0; j-- {
+			hop, err := netip.ParseAddr(strings.TrimSpace(hops[j]))
+			if err != nil {
+				return client
+			}
+			client = hop.Unmap()
+			if !trusted(client) {
+				return client
+			}
+		}
+	}
+	return client
+}
+
 // Unary returns a unary server interceptor for rate limiting.
 func (r *RateLimitInterceptor) Unary() grpc.UnaryServerInterceptor {
 	return func(
@@ -140,59 +294,13 @@ func (r *RateLimitInterceptor) Unary() grpc.UnaryServerInterceptor {
 		info *grpc.UnaryServerInfo,
 		handler grpc.UnaryHandler,
 	) (interface{}, error) {
-		// Determine client identifier
-		clientID := "anonymous"
-
-		md, ok := metadata.FromIncomingContext(ctx)
-		if ok {
-			if r.perUser {
-				// Extract user from token
-				authHeaders := md.Get("authorization")
-				if len(authHeaders) > 0 {
-					tokenString := strings.TrimPrefix(authHeaders[0], "Bearer ")
-					token, _ := jwt.Parse(tokenString, nil)
-					if token != nil {
-						if claims, ok := token.Claims.(jwt.MapClaims); ok {
-							if sub, ok := claims["sub"].(string); ok {
-								clientID = sub
-							}
-						}
-					}
-				}
-			} else {
-				// Use peer address
-				if forwarded := md.Get("x-forwarded-for"); len(forwarded) > 0 {
-					clientID = forwarded[0]
-				}
-			}
-		}
-
-		// Check rate limit
-		r.mu.Lock()
-		entry, exists := r.limits[clientID]
-		if !exists {
-			entry = &rateLimitEntry{
-				count:       0,
-				windowStart: time.Now(),
-			}
-			r.limits[clientID] = entry
-		}
+		clientID := r.clientID(ctx)
 
-		now := time.Now()
-		if now.Sub(entry.windowStart) >= time.Minute {
-			entry.count = 0
-			entry.windowStart = now
-		}
-
-		if entry.count >= r.requestsPerMinute {
-			r.mu.Unlock()
+		if !r.buckets.allow(clientID, time.Now().UnixNano()) {
 			log.Printf("Rate limit exceeded for %s", clientID)
 			return nil, status.Error(codes.ResourceExhausted, "rate limit exceeded")
 		}
 
-		entry.count++
-		r.mu.Unlock()
-
 		return handler(ctx, req)
 	}
 }
@@ -0,0 +1,118 @@
+package grpc
+
+import (
+	"context"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"math/rand"
+	"sync/atomic"
+
+	"google.golang.org/grpc"
+	// Registers the least_request_experimental balancer
+	_ "google.golang.org/grpc/balancer/leastrequest"
+	// Registers client-side health checking
+	_ "google.golang.org/grpc/health"
+)
+
+// HeadlessServiceTarget returns the target of a Kubernetes headless
+// service. DNS then resolves to every ready pod rather than one virtual
+// IP, so the balancer sees, and health checks, each backend. The list is
+// re-resolved when a connection fails or a server ends it (as NewServer's
+// MaxConnectionAge does), which picks up pods that were added.
+func HeadlessServiceTarget(service, namespace string, port int) string {
+	return fmt.Sprintf("dns:///%s.%s.svc.cluster.local:%d", service, namespace, port)
+}
+
+// serviceConfig returns the default service config for opts: the load
+// balancing policy and, if enabled, per-subchannel health checking.
+func serviceConfig(opts *ClientOptions) string {
+	balancer := opts.Balancer
+	if balancer == "" {
+		balancer = BalancerRoundRobin
+	}
+	policy := map[string]any{}
+	if balancer == BalancerLeastRequest {
+		policy["choiceCount"] = 2
+	}
+	config := map[string]any{
+		"loadBalancingConfig": []map[string]any{{balancer: policy}},
+	}
+	if opts.HealthCheck {
+		config["healthCheckConfig"] = map[string]any{"serviceName": opts.HealthService}
+	}
+	data, _ := json.Marshal(config)
+	return string(data)
+}
+
+// pooledConn is a connection of the pool with its outstanding unary RPCs.
+type pooledConn struct {
+	conn        *grpc.ClientConn
+	outstanding atomic.Int64
+}
+
+// connPool holds the connections of a Client.
+type connPool struct {
+	conns []*pooledConn
+	next  atomic.Uint32
+	// leastRequest picks the less loaded of two connections rather than
+	// taking them in turn
+	leastRequest bool
+}
+
+func newConnPool(target string, size int, leastRequest bool, dialOpts []grpc.DialOption) (*connPool, error) {
+	p := &connPool{conns: make([]*pooledConn, size), leastRequest: leastRequest}
+	for i := range p.conns {
+		pc := &pooledConn{}
+		opts := append(dialOpts[:len(dialOpts):len(dialOpts)],
+			grpc.WithChainUnaryInterceptor(pc.track))
+		conn, err := grpc.NewClient(target, opts...)
+		if err != nil {
+			p.close()
+			return nil, err
+		}
+		pc.conn = conn
+		p.conns[i] = pc
+	}
+	return p, nil
+}
+
+// track counts the connection's outstanding unary RPCs.
+func (pc *pooledConn) track(
+	ctx context.Context,
+	method string,
+	req, reply any,
+	cc *grpc.ClientConn,
+	invoker grpc.UnaryInvoker,
+	opts ...grpc.CallOption,
+) error {
+	pc.outstanding.Add(1)
+	defer pc.outstanding.Add(-1)
+	return invoker(ctx, method, req, reply, cc, opts...)
+}
+
+// pick returns the connection for the next call.
+func (p *connPool) pick() *grpc.ClientConn {
+	n := len(p.conns)
+	if n == 1 {
+		return p.conns[0].conn
+	}
+	if !p.leastRequest {
+		return p.conns[int(p.next.Add(1)-1)%n].conn
+	}
+	a, b := p.conns[rand.Intn(n)], p.conns[rand.Intn(n)]
+	if b.outstanding.Load() < a.outstanding.Load() {
+		a = b
+	}
+	return a.conn
+}
+
+func (p *connPool) close() error {
+	var errs []error
+	for _, pc := range p.conns {
+		if pc != nil && pc.conn != nil {
+			errs = append(errs, pc.conn.Close())
+		}
+	}
+	return errors.Join(errs...)
+}
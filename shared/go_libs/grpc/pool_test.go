@@ -0,0 +1,76 @@
+package grpc
+
+import (
+	"context"
+	"testing"
+
+	"google.golang.org/grpc"
+)
+
+func testPool(n int, leastRequest bool) *connPool {
+	p := &connPool{conns: make([]*pooledConn, n), leastRequest: leastRequest}
+	for i := range p.conns {
+		p.conns[i] = &pooledConn{conn: new(grpc.ClientConn)}
+	}
+	return p
+}
+
+func (p *connPool) index(conn *grpc.ClientConn) int {
+	for i, pc := range p.conns {
+		if pc.conn == conn {
+			return i
+		}
+	}
+	return -1
+}
+
+// TestConnPoolRoundRobin checks that connections are taken in turn.
+func TestConnPoolRoundRobin(t *testing.T) {
+	p := testPool(3, false)
+	for i := 0; i < 7; i++ {
+		if got := p.index(p.pick()); got != i%3 {
+			t.Fatalf("pick %d: expected connection %d, got %d", i, i%3, got)
+		}
+	}
+
+	single := testPool(1, true)
+	if single.pick() != single.conns[0].conn {
+		t.Error("expected the only connection")
+	}
+}
+
+// TestConnPoolLeastRequest checks that the less loaded of two random
+// connections is picked, so an idle connection takes most calls.
+func TestConnPoolLeastRequest(t *testing.T) {
+	p := testPool(3, true)
+	p.conns[1].outstanding.Store(5)
+	p.conns[2].outstanding.Store(5)
+
+	idle := 0
+	for i := 0; i < 1000; i++ {
+		if p.index(p.pick()) == 0 {
+			idle++
+		}
+	}
+	// Missed only when both choices are loaded: 4/9 of picks
+	if idle < 450 || idle > 650 {
+		t.Errorf("expected the idle connection in about 5/9 of 1000 picks, got %d", idle)
+	}
+}
+
+// TestConnPoolTrack checks that outstanding counts a call while it runs.
+func TestConnPoolTrack(t *testing.T) {
+	pc := &pooledConn{}
+	invoker := func(ctx context.Context, method string, req, reply any, cc *grpc.ClientConn, opts ...grpc.CallOption) error {
+		if n := pc.outstanding.Load(); n != 1 {
+			t.Errorf("expected 1 outstanding call during the RPC, got %d", n)
+		}
+		return nil
+	}
+	if err := pc.track(context.Background(), "/svc/Method", nil, nil, nil, invoker); err != nil {
+		t.Fatal(err)
+	}
+	if n := pc.outstanding.Load(); n != 0 {
+		t.Errorf("expected none outstanding after the RPC, got %d", n)
+	}
+}
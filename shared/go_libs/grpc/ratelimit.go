@@ -0,0 +1,140 @@
+// Package grpc provides a sharded token-bucket table for rate limiting.
+package grpc
+
+import (
+	"hash/maphash"
+	"sync"
+	"time"
+)
+
+// rateLimitShards is the number of independently locked bucket shards. RPCs
+// from different clients contend only when their keys hash to one shard.
+const rateLimitShards = 64
+
+// tokenBucket is one client's bucket, linked into its shard's LRU list.
+type tokenBucket struct {
+	key        string
+	tokens     float64
+	last       int64 // Unix nanoseconds of the last refill
+	prev, next *tokenBucket
+}
+
+// bucketShard is a map of buckets with an intrusive LRU list, most recently
+// used first. The padding keeps neighbouring shard locks on separate cache
+// lines.
+type bucketShard struct {
+	mu      sync.Mutex
+	buckets map[string]*tokenBucket
+	lru     tokenBucket // Sentinel: lru.next is newest, lru.prev is oldest
+	_       [64]byte
+}
+
+// bucketTable holds token buckets for up to maxPerShard*rateLimitShards
+// clients. Buckets idle for idleTTL are dropped as shards are touched; the
+// least recently used bucket of a full shard is reused for a new client.
+type bucketTable struct {
+	seed        maphash.Seed
+	rate        float64 // Tokens per nanosecond
+	burst       float64
+	idleTTL     int64 // Nanoseconds
+	maxPerShard int
+	shards      [rateLimitShards]bucketShard
+}
+
+func newBucketTable(perSecond, burst float64, maxClients int, idleTTL time.Duration) *bucketTable {
+	t := &bucketTable{
+		seed:        maphash.MakeSeed(),
+		rate:        perSecond / float64(time.Second),
+		burst:       burst,
+		idleTTL:     int64(idleTTL),
+		maxPerShard: max(1, (maxClients+rateLimitShards-1)/rateLimitShards),
+	}
+	for i := range t.shards {
+		s := &t.shards[i]
+		s.buckets = make(map[string]*tokenBucket)
+		s.lru.next = &s.lru
+		s.lru.prev = &s.lru
+	}
+	return t
+}
+
+// allow takes a token from key's bucket at now and reports whether one was
+// available.
+func (t *bucketTable) allow(key string, now int64) bool {
+	s := &t.shards[maphash.String(t.seed, key)&(rateLimitShards-1)]
+
+	s.mu.Lock()
+	b := s.buckets[key]
+	if b == nil {
+		b = t.insert(s, key)
+		b.tokens = t.burst
+	} else {
+		s.unlink(b)
+		b.tokens = min(t.burst, b.tokens+float64(now-b.last)*t.rate)
+	}
+	b.last = now
+	s.pushFront(b)
+	t.expire(s, now)
+
+	ok := b.tokens >= 1
+	if ok {
+		b.tokens--
+	}
+	s.mu.Unlock()
+	return ok
+}
+
+// insert adds a bucket for key, reusing the oldest bucket if the shard is
+// full. The bucket is not yet linked into the LRU list.
+func (t *bucketTable) insert(s *bucketShard, key string) *tokenBucket {
+	var b *tokenBucket
+	if len(s.buckets) >= t.maxPerShard {
+		b = s.lru.prev
+		s.unlink(b)
+		delete(s.buckets, b.key)
+		b.key = key
+	} else {
+		b = &tokenBucket{key: key}
+	}
+	s.buckets[key] = b
+	return b
+}
+
+// expire drops up to two buckets idle for idleTTL from the tail, which is
+// enough to keep pace with one insert per call. A bucket idle that long has
+// refilled completely, so dropping it does not change any client's limit.
+func (t *bucketTable) expire(s *bucketShard, now int64) {
+	for n := 0; n < 2; n++ {
+		b := s.lru.prev
+		if b == &s.lru || now-b.last < t.idleTTL {
+			return
+		}
+		s.unlink(b)
+		delete(s.buckets, b.key)
+	}
+}
+
+// len returns the number of tracked clients.
+func (t *bucketTable) len() int {
+	n := 0
+	for i := range t.shards {
+		s := &t.shards[i]
+		s.mu.Lock()
+		n += len(s.buckets)
+		s.mu.Unlock()
+	}
+	return n
+}
+
+func (s *bucketShard) unlink(b *tokenBucket) {
+	b.prev.next = b.next
+	b.next.prev = b.prev
+	b.prev, b.next = nil, nil
+}
+
+func (s *bucketShard) pushFront(b *tokenBucket) {
+	b.prev = &s.lru
+	b.next = s.lru.next
+	s.lru.next.prev = b
+	s.lru.next = b
+}
@@ -13,36 +13,39 @@ import (
 	"google.golang.org/grpc"
 	"google.golang.org/grpc/health"
 	"google.golang.org/grpc/health/grpc_health_v1"
+	"google.golang.org/grpc/keepalive"
 	"google.golang.org/grpc/reflection"
 )
 
 // ServerOptions configures gRPC server behavior.
 type ServerOptions struct {
-	MaxWorkers          int
-	MaxConcurrentRPCs   int
-	EnableReflection    bool
-	EnableHealthCheck   bool
-	Port                string
-	MaxConnectionIdle   time.Duration
-	MaxConnectionAge    time.Duration
-	KeepaliveTime       time.Duration
-	KeepaliveTimeout    time.Duration
-	GracefulStopTimeout time.Duration
+	MaxWorkers            int
+	MaxConcurrentRPCs     int
+	EnableReflection      bool
+	EnableHealthCheck     bool
+	Port                  string
+	MaxConnectionIdle     time.Duration
+	MaxConnectionAge      time.Duration
+	MaxConnectionAgeGrace time.Duration // In-flight RPCs may finish this long after MaxConnectionAge
+	KeepaliveTime         time.Duration
+	KeepaliveTimeout      time.Duration
+	GracefulStopTimeout   time.Duration
 }
 
 // DefaultServerOptions returns sensible defaults for server configuration.
 func DefaultServerOptions() *ServerOptions {
 	return &ServerOptions{
-		MaxWorkers:          10,
-		MaxConcurrentRPCs:   100,
-		EnableReflection:    true,
-		EnableHealthCheck:   true,
-		Port:                "50051",
-		MaxConnectionIdle:   5 * time.Minute,
-		MaxConnectionAge:    10 * time.Minute,
-		KeepaliveTime:       1 * time.Minute,
-		KeepaliveTimeout:    20 * time.Second,
-		GracefulStopTimeout: 30 * time.Second,
+		MaxWorkers:            10,
+		MaxConcurrentRPCs:     100,
+		EnableReflection:      true,
+		EnableHealthCheck:     true,
+		Port:                  "50051",
+		MaxConnectionIdle:     5 * time.Minute,
+		MaxConnectionAge:      10 * time.Minute,
+		MaxConnectionAgeGrace: 30 * time.Second,
+		KeepaliveTime:         1 * time.Minute,
+		KeepaliveTimeout:      20 * time.Second,
+		GracefulStopTimeout:   30 * time.Second,
 	}
 }
 
@@ -176,9 +179,14 @@ func StartServerWithGracefulShutdown(server *grpc.Server, opts *ServerOptions) e
 }
 
 // keepaliveServerParams returns keepalive parameters for the server.
-func keepaliveServerParams(opts *ServerOptions) grpc.KeepaliveParams {
-	return grpc.KeepaliveParams{
-		Time:    opts.KeepaliveTime,
-		Timeout: opts.KeepaliveTimeout,
+// Connections are closed once idle or old, so clients re-resolve the
+// target and spread over backends added since they connected.
+func keepaliveServerParams(opts *ServerOptions) keepalive.ServerParameters {
+	return keepalive.ServerParameters{
+		MaxConnectionIdle:     opts.MaxConnectionIdle,
+		MaxConnectionAge:      opts.MaxConnectionAge,
+		MaxConnectionAgeGrace: opts.MaxConnectionAgeGrace,
+		Time:                  opts.KeepaliveTime,
+		Timeout:               opts.KeepaliveTimeout,
 	}
 }
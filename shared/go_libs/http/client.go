@@ -7,7 +7,10 @@ import (
 	"log"
 	"math"
 	"math/rand"
+	"net"
 	"net/http"
+	"net/url"
+	"sync"
 	"time"
 )
 
@@ -24,8 +27,8 @@ type RetryConfig struct {
 func DefaultRetryConfig() RetryConfig {
 	return RetryConfig{
 		MaxRetries:      3,
-		BaseDelay:       1 * time.Second,
-		MaxDelay:        30 * time.Second,
+		BaseDelay:       100 * time.Millisecond,
+		MaxDelay:        5 * time.Second,
 		ExponentialBase: 2.0,
 		Jitter:          true,
 	}
@@ -61,6 +64,73 @@ func DefaultCircuitBreakerConfig() CircuitBreakerConfig {
 	}
 }
 
+// TransportConfig tunes the connection pool. The transport keeps a
+// separate pool of connections per host; the limits below apply to each.
+type TransportConfig struct {
+	MaxIdleConns          int           // Idle connections across all hosts
+	MaxIdleConnsPerHost   int           // Idle connections kept per host
+	MaxConnsPerHost       int           // Connections per host, 0 for no limit
+	IdleConnTimeout       time.Duration // How long an idle connection is kept
+	DialTimeout           time.Duration // TCP connect timeout
+	KeepAlive             time.Duration // TCP keep-alive period
+	TLSHandshakeTimeout   time.Duration
+	ResponseHeaderTimeout time.Duration // Time to wait for response headers, 0 for none
+	DisableHTTP2          bool          // Use HTTP/1.1 only
+}
+
+// DefaultTransportConfig returns a pool sized for service-to-service calls.
+// net/http keeps only 2 idle connections per host by default, so bursts
+// to one dependency would otherwise keep reconnecting.
+func DefaultTransportConfig() TransportConfig {
+	return TransportConfig{
+		MaxIdleConns:        256,
+		MaxIdleConnsPerHost: 64,
+		IdleConnTimeout:     90 * time.Second,
+		DialTimeout:         5 * time.Second,
+		KeepAlive:           30 * time.Second,
+		TLSHandshakeTimeout: 5 * time.Second,
+	}
+}
+
+// newTransport builds a transport from config.
+func newTransport(config TransportConfig) *http.Transport {
+	dialer := &net.Dialer{
+		Timeout:   config.DialTimeout,
+		KeepAlive: config.KeepAlive,
+	}
+	return &http.Transport{
+		Proxy:                 http.ProxyFromEnvironment,
+		DialContext:           dialer.DialContext,
+		ForceAttemptHTTP2:     !config.DisableHTTP2,
+		MaxIdleConns:          config.MaxIdleConns,
+		MaxIdleConnsPerHost:   config.MaxIdleConnsPerHost,
+		MaxConnsPerHost:       config.MaxConnsPerHost,
+		IdleConnTimeout:       config.IdleConnTimeout,
+		TLSHandshakeTimeout:   config.TLSHandshakeTimeout,
+		ResponseHeaderTimeout: config.ResponseHeaderTimeout,
+		ExpectContinueTimeout: 1 * time.Second,
+	}
+}
+
+// DefaultMaxErrorBody is the most of an error response body kept in a
+// StatusError.
+const DefaultMaxErrorBody = 4 << 10
+
+// drainLimit is the most of a response body read to reuse its connection;
+// a longer body is dropped with the connection.
+const drainLimit = 64 << 10
+
+// StatusError is returned for an error status. Body holds at most the
+// client's maximum error body.
+type StatusError struct {
+	StatusCode int
+	Body       []byte
+}
+
+func (e *StatusError) Error() string {
+	return fmt.Sprintf("HTTP %d: %s", e.StatusCode, e.Body)
+}
+
 // circuitBreakerState tracks the internal state of a circuit breaker.
 type circuitBreakerState struct {
 	state           CircuitState
@@ -93,6 +163,27 @@ func WithCircuitBreaker(config CircuitBreakerConfig) ClientOption {
 	}
 }
 
+// WithHedging enables and configures request hedging.
+func WithHedging(config HedgeConfig) ClientOption {
+	return func(c *Client) {
+		c.hedgeConfig = config
+	}
+}
+
+// WithTransport replaces the connection pool with one built from config.
+func WithTransport(config TransportConfig) ClientOption {
+	return func(c *Client) {
+		c.client.Transport = newTransport(config)
+	}
+}
+
+// WithMaxErrorBody sets how much of an error response body is kept.
+func WithMaxErrorBody(n int64) ClientOption {
+	return func(c *Client) {
+		c.maxErrorBody = n
+	}
+}
+
 // WithHeaders sets default headers for all requests.
 func WithHeaders(headers map[string]string) ClientOption {
 	return func(c *Client) {
@@ -100,7 +191,7 @@ func WithHeaders(headers map[string]string) ClientOption {
 	}
 }
 
-// WithLogger sets a custom logger function.
+// WithLogger sets a custom logger function. A nil logger disables logging.
 func WithLogger(logger func(format string, args ...interface{})) ClientOption {
 	return func(c *Client) {
 		c.logger = logger
@@ -109,12 +200,17 @@ func WithLogger(logger func(format string, args ...interface{})) ClientOption {
 
 // Client is a production-ready HTTP client with retries and circuit breaker.
 type Client struct {
-	client          *http.Client
-	retryConfig     RetryConfig
-	circuitConfig   CircuitBreakerConfig
-	circuitState    circuitBreakerState
-	defaultHeaders  map[string]string
-	logger          func(format string, args ...interface{})
+	client         *http.Client
+	retryConfig    RetryConfig
+	circuitConfig  CircuitBreakerConfig
+	hedgeConfig    HedgeConfig
+	latency        latencyTracker
+	maxErrorBody   int64
+	defaultHeaders map[string]string
+	logger         func(format string, args ...interface{})
+
+	mu           sync.Mutex // Guards circuitState
+	circuitState circuitBreakerState
 }
 
 // NewClient creates a new HTTP client with the provided options.
@@ -125,6 +221,7 @@ type Client struct {
 //	    WithTimeout(30 * time.Second),
 //	    WithRetryConfig(RetryConfig{MaxRetries: 3, BaseDelay: 1 * time.Second}),
 //	    WithCircuitBreaker(CircuitBreakerConfig{Enabled: true, FailureThreshold: 5}),
+//	    WithHedging(DefaultHedgeConfig()),
 //	)
 //	defer client.Close()
 //
@@ -136,10 +233,13 @@ type Client struct {
 func NewClient(opts ...ClientOption) *Client {
 	c := &Client{
 		client: &http.Client{
-			Timeout: 30 * time.Second,
+			Timeout:   30 * time.Second,
+			Transport: newTransport(DefaultTransportConfig()),
 		},
 		retryConfig:   DefaultRetryConfig(),
 		circuitConfig: DefaultCircuitBreakerConfig(),
+		hedgeConfig:   DefaultHedgeConfig(),
+		maxErrorBody:  DefaultMaxErrorBody,
 		circuitState: circuitBreakerState{
 			state: CircuitClosed,
 		},
@@ -178,18 +278,44 @@ func (c *Client) calculateDelay(attempt int) time.Duration {
 	return delay
 }
 
+// sleep waits for d, returning early with ctx's error if it is done first.
+func sleep(ctx context.Context, d time.Duration) error {
+	timer := time.NewTimer(d)
+	defer timer.Stop()
+	select {
+	case <-timer.C:
+		return nil
+	case <-ctx.Done():
+		return ctx.Err()
+	}
+}
+
+// logf logs through the configured logger, if any.
+func (c *Client) logf(format string, args ...interface{}) {
+	if c.logger != nil {
+		c.logger(format, args...)
+	}
+}
+
+// redactedURL formats a URL without its password, only when logged.
+type redactedURL struct{ u *url.URL }
+
+func (r redactedURL) String() string { return r.u.Redacted() }
+
 // checkCircuitBreaker checks if the circuit breaker allows the request.
 func (c *Client) checkCircuitBreaker() error {
 	if !c.circuitConfig.Enabled {
 		return nil
 	}
 
+	c.mu.Lock()
+	defer c.mu.Unlock()
 	now := time.Now()
 
 	if c.circuitState.state == CircuitOpen {
 		elapsed := now.Sub(c.circuitState.lastFailureTime)
 		if elapsed >= c.circuitConfig.Timeout {
-			c.logger("Circuit breaker entering HALF_OPEN state")
+			c.logf("Circuit breaker entering HALF_OPEN state")
 			c.circuitState.state = CircuitHalfOpen
 			c.circuitState.successCount = 0
 		} else {
@@ -206,10 +332,12 @@ func (c *Client) recordSuccess() {
 		return
 	}
 
+	c.mu.Lock()
+	defer c.mu.Unlock()
 	if c.circuitState.state == CircuitHalfOpen {
 		c.circuitState.successCount++
 		if c.circuitState.successCount >= c.circuitConfig.SuccessThreshold {
-			c.logger("Circuit breaker closing after successful requests")
+			c.logf("Circuit breaker closing after successful requests")
 			c.circuitState.state = CircuitClosed
 			c.circuitState.failureCount = 0
 		}
@@ -224,16 +352,18 @@ func (c *Client) recordFailure() {
 		return
 	}
 
+	c.mu.Lock()
+	defer c.mu.Unlock()
 	c.circuitState.lastFailureTime = time.Now()
 
 	if c.circuitState.state == CircuitHalfOpen {
-		c.logger("Circuit breaker opening after failure in HALF_OPEN state")
+		c.logf("Circuit breaker opening after failure in HALF_OPEN state")
 		c.circuitState.state = CircuitOpen
 		c.circuitState.failureCount = 0
 	} else if c.circuitState.state == CircuitClosed {
 		c.circuitState.failureCount++
 		if c.circuitState.failureCount >= c.circuitConfig.FailureThreshold {
-			c.logger("Circuit breaker opening after %d failures", c.circuitState.failureCount)
+			c.logf("Circuit breaker opening after %d failures", c.circuitState.failureCount)
 			c.circuitState.state = CircuitOpen
 		}
 	}
@@ -274,71 +404,87 @@ func shouldRetry(statusCode int) bool {
 	return statusCode >= 500 || statusCode == 429
 }
 
+// replayable reports whether req can be sent more than once.
+func replayable(req *http.Request) bool {
+	return req.Body == nil || req.Body == http.NoBody || req.GetBody != nil
+}
+
+// newAttempt returns a copy of req for one attempt, with a fresh body.
+func newAttempt(ctx context.Context, req *http.Request) (*http.Request, error) {
+	r := req.Clone(ctx)
+	if req.GetBody != nil && req.Body != nil && req.Body != http.NoBody {
+		body, err := req.GetBody()
+		if err != nil {
+			return nil, err
+		}
+		r.Body = body
+	}
+	return r, nil
+}
+
+// statusError reads at most maxErrorBody of resp's body into an error and
+// drains a little more so the connection can be reused.
+func (c *Client) statusError(resp *http.Response) *StatusError {
+	body, _ := io.ReadAll(io.LimitReader(resp.Body, c.maxErrorBody))
+	io.CopyN(io.Discard, resp.Body, drainLimit)
+	resp.Body.Close()
+	return &StatusError{StatusCode: resp.StatusCode, Body: body}
+}
+
 // Do executes an HTTP request with retry logic and circuit breaker.
+//
+// Requests with a body are retried only if req.GetBody is set, as it is
+// by http.NewRequest for in-memory bodies. Backoff ends early when ctx is
+// done. Idempotent requests are hedged when hedging is enabled.
 func (c *Client) Do(ctx context.Context, req *http.Request) (*http.Response, error) {
 	// Check circuit breaker
 	if err := c.checkCircuitBreaker(); err != nil {
 		return nil, err
 	}
 
-	var lastErr error
+	target := redactedURL{req.URL}
+	maxRetries := c.retryConfig.MaxRetries
+	if !replayable(req) {
+		maxRetries = 0
+	}
 
-	for attempt := 0; attempt <= c.retryConfig.MaxRetries; attempt++ {
-		c.logger("HTTP %s %s (attempt %d/%d)", req.Method, req.URL.String(), attempt+1, c.retryConfig.MaxRetries+1)
+	var lastErr error
 
-		// Clone request for retry (body might be consumed)
-		reqClone := req.Clone(ctx)
+	for attempt := 0; attempt <= maxRetries; attempt++ {
+		if attempt > 0 {
+			delay := c.calculateDelay(attempt - 1)
+			c.logf("HTTP %s %s: retrying in %.2fs (attempt %d/%d)", req.Method, target, delay.Seconds(), attempt+1, maxRetries+1)
+			if err := sleep(ctx, delay); err != nil {
+				return nil, fmt.Errorf("%w (last error: %v)", err, lastErr)
+			}
+		}
 
-		// Execute request
-		resp, err := c.client.Do(reqClone)
+		resp, err := c.send(ctx, req)
 		if err != nil {
 			lastErr = err
-			c.logger("HTTP %s %s failed (attempt %d): %v", req.Method, req.URL.String(), attempt+1, err)
+			c.logf("HTTP %s %s failed (attempt %d): %v", req.Method, target, attempt+1, err)
 			c.recordFailure()
-
-			// If this was the last attempt, return error
-			if attempt >= c.retryConfig.MaxRetries {
-				return nil, lastErr
+			if ctx.Err() != nil {
+				return nil, err
 			}
-
-			// Calculate and apply delay
-			delay := c.calculateDelay(attempt)
-			c.logger("Retrying in %.2fs...", delay.Seconds())
-			time.Sleep(delay)
 			continue
 		}
 
 		// Check if response indicates failure
 		if resp.StatusCode >= 400 {
-			// Read and close body for error responses
-			body, _ := io.ReadAll(resp.Body)
-			resp.Body.Close()
-
-			lastErr = fmt.Errorf("HTTP %d: %s", resp.StatusCode, string(body))
-			c.logger("HTTP %s %s -> %d", req.Method, req.URL.String(), resp.StatusCode)
+			lastErr = c.statusError(resp)
+			c.logf("HTTP %s %s -> %d", req.Method, target, resp.StatusCode)
+			c.recordFailure()
 
 			// Don't retry client errors (except 429)
 			if !shouldRetry(resp.StatusCode) {
-				c.recordFailure()
 				return nil, lastErr
 			}
-
-			c.recordFailure()
-
-			// If this was the last attempt, return error
-			if attempt >= c.retryConfig.MaxRetries {
-				return nil, lastErr
-			}
-
-			// Calculate and apply delay
-			delay := c.calculateDelay(attempt)
-			c.logger("Retrying in %.2fs...", delay.Seconds())
-			time.Sleep(delay)
 			continue
 		}
 
 		// Success
-		c.logger("HTTP %s %s -> %d", req.Method, req.URL.String(), resp.StatusCode)
+		c.logf("HTTP %s %s -> %d", req.Method, target, resp.StatusCode)
 		c.recordSuccess()
 		return resp, nil
 	}
@@ -0,0 +1,131 @@
+package http
+
+import (
+	"context"
+	"errors"
+	"io"
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"sync/atomic"
+	"testing"
+	"time"
+)
+
+// retryClient returns a client retrying up to retries times at once.
+func retryClient(retries int, opts ...ClientOption) *Client {
+	opts = append([]ClientOption{
+		WithLogger(nil),
+		WithRetryConfig(RetryConfig{
+			MaxRetries:      retries,
+			BaseDelay:       time.Millisecond,
+			MaxDelay:        time.Millisecond,
+			ExponentialBase: 2,
+		}),
+	}, opts...)
+	return NewClient(opts...)
+}
+
+// failFirst returns a server answering 503 to the first n requests. Every
+// request must carry body.
+func failFirst(t *testing.T, n int32, body string, calls *atomic.Int32) *httptest.Server {
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		got, _ := io.ReadAll(r.Body)
+		if string(got) != body {
+			t.Errorf("attempt %d: expected body %q, got %q", calls.Load()+1, body, got)
+		}
+		if calls.Add(1) <= n {
+			w.WriteHeader(http.StatusServiceUnavailable)
+			return
+		}
+		io.WriteString(w, "done")
+	}))
+	t.Cleanup(srv.Close)
+	return srv
+}
+
+// TestRetryReplaysBody checks that every attempt sends the whole body.
+func TestRetryReplaysBody(t *testing.T) {
+	var calls atomic.Int32
+	srv := failFirst(t, 2, "payload", &calls)
+
+	resp, err := retryClient(2).Post(context.Background(), srv.URL, strings.NewReader("payload"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	body, _ := io.ReadAll(resp.Body)
+	resp.Body.Close()
+	if string(body) != "done" || calls.Load() != 3 {
+		t.Errorf("expected success on the third attempt, got %q after %d", body, calls.Load())
+	}
+}
+
+// TestNoReplayWithoutGetBody checks that a body that cannot be rewound is
+// sent once.
+func TestNoReplayWithoutGetBody(t *testing.T) {
+	var calls atomic.Int32
+	srv := failFirst(t, 1, "payload", &calls)
+
+	body := io.MultiReader(strings.NewReader("payload"))
+	_, err := retryClient(3).Post(context.Background(), srv.URL, body)
+	var se *StatusError
+	if !errors.As(err, &se) || se.StatusCode != http.StatusServiceUnavailable {
+		t.Fatalf("expected a 503 StatusError, got %v", err)
+	}
+	if n := calls.Load(); n != 1 {
+		t.Errorf("expected 1 attempt, got %d", n)
+	}
+}
+
+// TestStatusErrorTruncated checks that StatusError keeps at most the
+// maximum error body.
+func TestStatusErrorTruncated(t *testing.T) {
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		w.WriteHeader(http.StatusBadRequest)
+		io.WriteString(w, strings.Repeat("x", 100000))
+	}))
+	defer srv.Close()
+
+	tests := []struct {
+		name string
+		c    *Client
+		want int
+	}{
+		{"default", retryClient(0), DefaultMaxErrorBody},
+		{"WithMaxErrorBody", retryClient(0, WithMaxErrorBody(10)), 10},
+	}
+	for _, tt := range tests {
+		_, err := tt.c.Get(context.Background(), srv.URL)
+		var se *StatusError
+		if !errors.As(err, &se) || se.StatusCode != http.StatusBadRequest {
+			t.Fatalf("%s: expected a 400 StatusError, got %v", tt.name, err)
+		}
+		if len(se.Body) != tt.want || strings.Trim(string(se.Body), "x") != "" {
+			t.Errorf("%s: expected %d bytes of body, got %d", tt.name, tt.want, len(se.Body))
+		}
+	}
+}
+
+// TestRetryStopsWithContext checks that backoff ends when ctx is done.
+func TestRetryStopsWithContext(t *testing.T) {
+	var calls atomic.Int32
+	srv := failFirst(t, 100, "", &calls)
+
+	c := NewClient(WithLogger(nil), WithRetryConfig(RetryConfig{
+		MaxRetries:      5,
+		BaseDelay:       time.Hour,
+		MaxDelay:        time.Hour,
+		ExponentialBase: 2,
+	}))
+	ctx, cancel := context.WithTimeout(context.Background(), 50*time.Millisecond)
+	defer cancel()
+
+	begin := time.Now()
+	_, err := c.Get(ctx, srv.URL)
+	if !errors.Is(err, context.DeadlineExceeded) {
+		t.Errorf("expected the deadline, got %v", err)
+	}
+	if d := time.Since(begin); d > time.Second {
+		t.Errorf("expected backoff cut short, took %v", d)
+	}
+}
@@ -0,0 +1,225 @@
+package http
+
+import (
+	"context"
+	"io"
+	"net/http"
+	"slices"
+	"sync"
+	"time"
+)
+
+// HedgeConfig configures request hedging. A hedged request is sent again
+// if no response arrives within the hedge delay; the first good response
+// wins and the other attempt is cancelled. This bounds tail latency at
+// the cost of a few extra requests, so only idempotent requests (GET,
+// HEAD, OPTIONS, PUT, DELETE, or any with an Idempotency-Key header) are
+// hedged.
+type HedgeConfig struct {
+	Enabled    bool          // Whether hedging is enabled
+	Delay      time.Duration // Fixed hedge delay, 0 to follow observed latency
+	Percentile float64       // Latency percentile used as the delay, e.g. 0.95
+	MinDelay   time.Duration // Lower bound on the hedge delay
+	MaxDelay   time.Duration // Upper bound, also used until latency is known
+}
+
+// DefaultHedgeConfig returns default hedging configuration (disabled),
+// hedging at the p95 latency when enabled.
+func DefaultHedgeConfig() HedgeConfig {
+	return HedgeConfig{
+		Enabled:    false,
+		Percentile: 0.95,
+		MinDelay:   10 * time.Millisecond,
+		MaxDelay:   1 * time.Second,
+	}
+}
+
+const (
+	// latencySamples is the window of recent latencies the percentile is
+	// taken over.
+	latencySamples = 256
+	// latencyRefresh is how many new samples are taken before the
+	// percentile is recomputed.
+	latencyRefresh = 32
+)
+
+// latencyTracker keeps a window of recent response latencies.
+type latencyTracker struct {
+	mu      sync.Mutex
+	samples [latencySamples]time.Duration
+	n       int // Samples held, up to latencySamples
+	next    int // Slot of the next sample
+	fresh   int // Samples since the percentile was computed
+	q       float64
+	value   time.Duration
+	sorted  []time.Duration
+}
+
+func (t *latencyTracker) observe(d time.Duration) {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	t.samples[t.next] = d
+	t.next = (t.next + 1) % latencySamples
+	if t.n < latencySamples {
+		t.n++
+	}
+	t.fresh++
+}
+
+// percentile returns the q percentile of the window, or false before
+// latencyRefresh samples have been seen.
+func (t *latencyTracker) percentile(q float64) (time.Duration, bool) {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if t.n < latencyRefresh {
+		return 0, false
+	}
+	if t.fresh >= latencyRefresh || t.q != q || t.value == 0 {
+		t.sorted = append(t.sorted[:0], t.samples[:t.n]...)
+		slices.Sort(t.sorted)
+		i := int(q * float64(t.n))
+		t.value = t.sorted[min(max(i, 0), t.n-1)]
+		t.q, t.fresh = q, 0
+	}
+	return t.value, true
+}
+
+// hedgeDelay returns how long to wait before hedging.
+func (c *Client) hedgeDelay() time.Duration {
+	cfg := c.hedgeConfig
+	if cfg.Delay > 0 {
+		return cfg.Delay
+	}
+	d, ok := c.latency.percentile(cfg.Percentile)
+	if !ok {
+		return cfg.MaxDelay
+	}
+	return min(max(d, cfg.MinDelay), cfg.MaxDelay)
+}
+
+// hedgeable reports whether req may be sent twice at once.
+func hedgeable(req *http.Request) bool {
+	if !replayable(req) {
+		return false
+	}
+	switch req.Method {
+	case http.MethodGet, http.MethodHead, http.MethodOptions, http.MethodPut, http.MethodDelete:
+		return true
+	}
+	return req.Header.Get("Idempotency-Key") != ""
+}
+
+// attemptResult is the outcome of one in-flight attempt.
+type attemptResult struct {
+	id   int
+	resp *http.Response
+	err  error
+}
+
+// ok reports whether the attempt got a response worth returning at once.
+func (r attemptResult) ok() bool {
+	return r.err == nil && !shouldRetry(r.resp.StatusCode)
+}
+
+// cancelBody cancels the winning attempt's context once its body is closed.
+type cancelBody struct {
+	io.ReadCloser
+	cancel context.CancelFunc
+}
+
+func (b *cancelBody) Close() error {
+	err := b.ReadCloser.Close()
+	b.cancel()
+	return err
+}
+
+// send makes one attempt at req, hedged when enabled and req allows it.
+// While the other attempt of a hedged pair is in flight, a failed attempt
+// is held back in case the other succeeds.
+//
+// The latency observed is taken from the start of the call, whichever
+// attempt wins: a winning hedge means the primary took at least that
+// long, while its own time would leave out the hedge delay and pull the
+// percentile, and so the delay, down.
+func (c *Client) send(ctx context.Context, req *http.Request) (*http.Response, error) {
+	begin := time.Now()
+	results := make(chan attemptResult, 2)
+	var cancels [2]context.CancelFunc
+	started := 0
+	start := func() error {
+		actx, cancel := context.WithCancel(ctx)
+		r, err := newAttempt(actx, req)
+		if err != nil {
+			cancel()
+			return err
+		}
+		id := started
+		cancels[id] = cancel
+		started++
+		go func() {
+			resp, err := c.client.Do(r)
+			results <- attemptResult{id: id, resp: resp, err: err}
+		}()
+		return nil
+	}
+
+	if err := start(); err != nil {
+		return nil, err
+	}
+
+	var hedge <-chan time.Time
+	if c.hedgeConfig.Enabled && hedgeable(req) {
+		timer := time.NewTimer(c.hedgeDelay())
+		defer timer.Stop()
+		hedge = timer.C
+	}
+
+	inflight := 1
+	var held *attemptResult
+	for {
+		var r attemptResult
+		select {
+		case <-hedge:
+			hedge = nil
+			if start() == nil {
+				inflight++
+			}
+			continue
+		case r = <-results:
+			inflight--
+		}
+
+		if !r.ok() && inflight > 0 {
+			held = &r
+			continue
+		}
+
+		// r settles it: cancel the attempt still in flight, and release
+		// the one held back
+		for id := 0; id < started; id++ {
+			if id != r.id {
+				cancels[id]()
+			}
+		}
+		if inflight > 0 {
+			go func() {
+				if l := <-results; l.resp != nil {
+					l.resp.Body.Close()
+				}
+			}()
+		}
+		if held != nil && held.resp != nil {
+			held.resp.Body.Close()
+		}
+
+		if r.err != nil {
+			cancels[r.id]()
+			return nil, r.err
+		}
+		if r.ok() {
+			c.latency.observe(time.Since(begin))
+		}
+		r.resp.Body = &cancelBody{ReadCloser: r.resp.Body, cancel: cancels[r.id]}
+		return r.resp, nil
+	}
+}
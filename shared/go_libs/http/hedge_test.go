@@ -0,0 +1,163 @@
+package http
+
+import (
+	"context"
+	"io"
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"sync/atomic"
+	"testing"
+	"time"
+)
+
+// hedgeClient returns a client hedging after delay, without retries.
+func hedgeClient(delay time.Duration) *Client {
+	return NewClient(
+		WithLogger(nil),
+		WithRetryConfig(RetryConfig{MaxRetries: 0}),
+		WithHedging(HedgeConfig{Enabled: true, Delay: delay}),
+	)
+}
+
+// TestHedgeWins checks that a slow primary is hedged, the hedge's response
+// returned and the primary cancelled.
+func TestHedgeWins(t *testing.T) {
+	var calls, cancelled atomic.Int32
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		if calls.Add(1) == 1 {
+			select {
+			case <-r.Context().Done():
+				cancelled.Add(1)
+				return
+			case <-time.After(2 * time.Second):
+			}
+		}
+		io.WriteString(w, "ok")
+	}))
+	defer srv.Close()
+
+	c := hedgeClient(20 * time.Millisecond)
+	begin := time.Now()
+	resp, err := c.Get(context.Background(), srv.URL)
+	if err != nil {
+		t.Fatal(err)
+	}
+	body, _ := io.ReadAll(resp.Body)
+	resp.Body.Close()
+	if string(body) != "ok" {
+		t.Errorf("expected the hedge's body, got %q", body)
+	}
+	if d := time.Since(begin); d > time.Second {
+		t.Errorf("expected the hedge to answer, took %v", d)
+	}
+
+	deadline := time.Now().Add(time.Second)
+	for cancelled.Load() == 0 && time.Now().Before(deadline) {
+		time.Sleep(5 * time.Millisecond)
+	}
+	if cancelled.Load() != 1 {
+		t.Error("expected the primary cancelled")
+	}
+}
+
+// TestHedgeLatencyFromCallStart checks that a winning hedge is observed
+// with the time since the call began, not its own shorter one.
+func TestHedgeLatencyFromCallStart(t *testing.T) {
+	var calls atomic.Int32
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		if calls.Add(1) == 1 {
+			<-r.Context().Done()
+			return
+		}
+		io.WriteString(w, "ok")
+	}))
+	defer srv.Close()
+
+	delay := 50 * time.Millisecond
+	c := hedgeClient(delay)
+	resp, err := c.Get(context.Background(), srv.URL)
+	if err != nil {
+		t.Fatal(err)
+	}
+	resp.Body.Close()
+
+	c.latency.mu.Lock()
+	n, observed := c.latency.n, c.latency.samples[0]
+	c.latency.mu.Unlock()
+	if n != 1 || observed < delay {
+		t.Errorf("expected one sample of at least %v, got %d of %v", delay, n, observed)
+	}
+}
+
+// TestHedgeHoldsFailure checks that a failed attempt is held back while
+// the other is in flight, and the other's success returned.
+func TestHedgeHoldsFailure(t *testing.T) {
+	var calls atomic.Int32
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		if calls.Add(1) == 1 {
+			time.Sleep(60 * time.Millisecond)
+			w.WriteHeader(http.StatusServiceUnavailable)
+			return
+		}
+		time.Sleep(100 * time.Millisecond)
+		io.WriteString(w, "ok")
+	}))
+	defer srv.Close()
+
+	resp, err := hedgeClient(20*time.Millisecond).Get(context.Background(), srv.URL)
+	if err != nil {
+		t.Fatalf("expected the hedge's success, got %v", err)
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode != http.StatusOK {
+		t.Errorf("expected 200, got %d", resp.StatusCode)
+	}
+}
+
+// TestHedgeable checks which requests may be sent twice at once.
+func TestHedgeable(t *testing.T) {
+	newRequest := func(method string, body io.Reader) *http.Request {
+		req, err := http.NewRequest(method, "http://example.com/", body)
+		if err != nil {
+			t.Fatal(err)
+		}
+		return req
+	}
+
+	keyed := newRequest(http.MethodPost, strings.NewReader("x"))
+	keyed.Header.Set("Idempotency-Key", "k")
+	// A body http.NewRequest cannot rewind
+	unreplayable := newRequest(http.MethodPut, io.MultiReader(strings.NewReader("x")))
+
+	tests := []struct {
+		name string
+		req  *http.Request
+		want bool
+	}{
+		{"GET", newRequest(http.MethodGet, nil), true},
+		{"PUT", newRequest(http.MethodPut, strings.NewReader("x")), true},
+		{"POST", newRequest(http.MethodPost, strings.NewReader("x")), false},
+		{"POST with Idempotency-Key", keyed, true},
+		{"PUT without GetBody", unreplayable, false},
+	}
+	for _, tt := range tests {
+		if got := hedgeable(tt.req); got != tt.want {
+			t.Errorf("%s: expected hedgeable %v, got %v", tt.name, tt.want, got)
+		}
+	}
+}
+
+// TestLatencyPercentile checks the percentile of the latency window.
+func TestLatencyPercentile(t *testing.T) {
+	var tr latencyTracker
+	if _, ok := tr.percentile(0.95); ok {
+		t.Error("expected no percentile before latencyRefresh samples")
+	}
+	for i := 1; i <= 100; i++ {
+		tr.observe(time.Duration(i) * time.Millisecond)
+	}
+	if d, ok := tr.percentile(0.95); !ok || d != 96*time.Millisecond {
+		t.Errorf("expected a p95 of 96ms, got %v", d)
+	}
+}
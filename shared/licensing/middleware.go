@@ -1,34 +1,63 @@
 package licensing
 
 import (
+	"context"
 	"errors"
 	"log"
 	"net/http"
-	"sync"
+	"sync/atomic"
 	"time"
 
 	"github.com/gin-gonic/gin"
+	"github.com/redis/go-redis/v9"
+	"golang.org/x/sync/singleflight"
 )
 
+// refreshKey is the singleflight key of full license refreshes. Feature
+// names cannot collide with it.
+const refreshKey = "\x00validate"
+
 // FeatureGate manages feature access based on license
+//
+// Lookups read an immutable snapshot through an atomic pointer, so gating a
+// request costs a pointer load and a map lookup. A timer revalidates the
+// license in the background every cacheTTL while the old snapshot keeps
+// being served, and failed refreshes are retried sooner without dropping
+// it. Features missing from the snapshot are checked with the license
+// server once, however many requests ask at the same time.
 type FeatureGate struct {
-	client       *Client
-	features     map[string]bool
-	lastUpdate   time.Time
-	cacheTTL     time.Duration
-	mutex        sync.RWMutex
+	client   *Client
+	cacheTTL time.Duration
+	snapshot atomic.Pointer[featureSnapshot]
+	group    singleflight.Group
+	timer    *time.Timer
+	closed   atomic.Bool
+	done     chan struct{} // Closed by Close to stop license update watches
+	// invalidations counts Invalidate calls, so a refresh begun before one
+	// is not taken as reflecting it
+	invalidations atomic.Uint64
+}
+
+// featureSnapshot is never modified once published.
+type featureSnapshot struct {
+	features   map[string]bool
+	lastUpdate time.Time // Zero until the license has been validated
 }
 
 // NewFeatureGate creates a new feature gate
+// The license is validated once before it returns and in the background
+// from then on; call Close to stop refreshing.
 func NewFeatureGate(client *Client) *FeatureGate {
 	fg := &FeatureGate{
 		client:   client,
-		features: make(map[string]bool),
 		cacheTTL: 5 * time.Minute,
+		done:     make(chan struct{}),
 	}
+	fg.snapshot.Store(&featureSnapshot{features: map[string]bool{}})
 
 	// Initialize features cache
-	fg.refreshFeatures()
+	next := fg.refreshFeatures()
+	fg.timer = time.AfterFunc(next, fg.scheduledRefresh)
 
 	return fg
 }
@@ -51,78 +80,171 @@ func (fg *FeatureGate) RequireFeature(featureName string) gin.HandlerFunc {
 
 // HasFeature checks if a feature is available
 func (fg *FeatureGate) HasFeature(featureName string) bool {
-	fg.mutex.RLock()
-
-	// Check if cache is stale
-	if time.Since(fg.lastUpdate) > fg.cacheTTL {
-		fg.mutex.RUnlock()
-		fg.refreshFeatures()
-		fg.mutex.RLock()
+	if enabled, exists := fg.snapshot.Load().features[featureName]; exists {
+		return enabled
 	}
 
-	enabled, exists := fg.features[featureName]
-	fg.mutex.RUnlock()
-
-	if !exists {
-		// Feature not in cache, check directly
+	// Feature not in cache, check directly; concurrent misses share a call
+	v, err, _ := fg.group.Do(featureName, func() (interface{}, error) {
+		if enabled, exists := fg.snapshot.Load().features[featureName]; exists {
+			return enabled, nil
+		}
 		enabled, err := fg.client.CheckFeature(featureName)
 		if err != nil {
-			log.Printf("Failed to check feature %s: %v", featureName, err)
-			return false
+			return false, err
 		}
+		fg.storeFeature(featureName, enabled)
+		return enabled, nil
+	})
+	if err != nil {
+		log.Printf("Failed to check feature %s: %v", featureName, err)
+		return false
+	}
+	return v.(bool)
+}
 
-		// Update cache
-		fg.mutex.Lock()
-		fg.features[featureName] = enabled
-		fg.mutex.Unlock()
+// storeFeature publishes a copy of the snapshot with one more feature.
+func (fg *FeatureGate) storeFeature(featureName string, enabled bool) {
+	for {
+		old := fg.snapshot.Load()
+		features := make(map[string]bool, len(old.features)+1)
+		for k, v := range old.features {
+			features[k] = v
+		}
+		features[featureName] = enabled
 
-		return enabled
+		if fg.snapshot.CompareAndSwap(old, &featureSnapshot{features: features, lastUpdate: old.lastUpdate}) {
+			return
+		}
 	}
-
-	return enabled
 }
 
-// refreshFeatures refreshes the features cache
-func (fg *FeatureGate) refreshFeatures() {
-	validation, err := fg.client.Validate()
-	if err != nil {
-		log.Printf("Failed to refresh license features: %v", err)
+// Invalidate revalidates the license in the background, e.g. when the
+// license server announces a change. Lookups keep using the current
+// features until the refresh completes.
+func (fg *FeatureGate) Invalidate() {
+	if fg.closed.Load() {
 		return
 	}
+	fg.invalidations.Add(1)
+	go fg.refreshFeatures()
+}
+
+// LicenseUpdateSubscriber is implemented by database.RedisClient.
+type LicenseUpdateSubscriber interface {
+	SubscribeLicenseUpdates(ctx context.Context, licenseKey string) *redis.PubSub
+}
 
-	if !validation.Valid {
-		log.Printf("License validation failed: %s", validation.Message)
+// WatchLicenseUpdates invalidates the gate on every message published for
+// its license key until ctx is done or the gate is closed.
+func (fg *FeatureGate) WatchLicenseUpdates(ctx context.Context, sub LicenseUpdateSubscriber) {
+	pubsub := sub.SubscribeLicenseUpdates(ctx, fg.client.LicenseKey)
+	go func() {
+		defer pubsub.Close()
+		updates := pubsub.Channel()
+		for {
+			select {
+			case <-ctx.Done():
+				return
+			case <-fg.done:
+				return
+			case _, ok := <-updates:
+				if !ok {
+					return
+				}
+				fg.Invalidate()
+			}
+		}
+	}()
+}
+
+// Close stops background refreshes and license update watches.
+func (fg *FeatureGate) Close() {
+	if !fg.closed.CompareAndSwap(false, true) {
 		return
 	}
+	fg.timer.Stop()
+	close(fg.done)
+}
 
-	fg.mutex.Lock()
-	defer fg.mutex.Unlock()
-
-	// Clear existing features
-	fg.features = make(map[string]bool)
+// scheduledRefresh runs on the refresh timer.
+func (fg *FeatureGate) scheduledRefresh() {
+	next := fg.refreshFeatures()
+	if !fg.closed.Load() {
+		fg.timer.Reset(next)
+	}
+}
 
-	// Update with current features
-	for _, feature := range validation.Features {
-		fg.features[feature.Name] = feature.Entitled
+// refreshFeatures refreshes the features cache and returns when to refresh
+// next: cacheTTL after a success, sooner after a failure. Concurrent
+// refreshes share one license server call.
+func (fg *FeatureGate) refreshFeatures() time.Duration {
+	retry := min(fg.cacheTTL, 30*time.Second)
+
+	// A refresh already in flight may have validated before the latest
+	// Invalidate; joining it is not enough, so refresh again until one
+	// began after it
+	want := fg.invalidations.Load()
+	for {
+		begun, err := fg.validateOnce()
+		if err != nil {
+			return retry
+		}
+		if begun >= want {
+			return fg.cacheTTL
+		}
 	}
+}
 
-	fg.lastUpdate = time.Now()
+// validateOnce validates the license and replaces the features, sharing a
+// validation already in flight. It returns the Invalidate count as of when
+// that validation began.
+func (fg *FeatureGate) validateOnce() (uint64, error) {
+	v, err, _ := fg.group.Do(refreshKey, func() (interface{}, error) {
+		begun := fg.invalidations.Load()
+		validation, err := fg.client.Validate()
+		if err != nil {
+			log.Printf("Failed to refresh license features: %v", err)
+			return nil, err
+		}
+
+		if !validation.Valid {
+			log.Printf("License validation failed: %s", validation.Message)
+			return nil, errors.New(validation.Message)
+		}
+
+		// Replace the features with the current ones
+		features := make(map[string]bool, len(validation.Features))
+		for _, feature := range validation.Features {
+			features[feature.Name] = feature.Entitled
+		}
+		fg.snapshot.Store(&featureSnapshot{features: features, lastUpdate: time.Now()})
+		return begun, nil
+	})
+	if err != nil {
+		return 0, err
+	}
+	return v.(uint64), nil
 }
 
 // GetAllFeatures returns all available features
 func (fg *FeatureGate) GetAllFeatures() map[string]bool {
-	fg.mutex.RLock()
-	defer fg.mutex.RUnlock()
+	snap := fg.snapshot.Load()
 
 	// Return a copy to prevent external modification
-	features := make(map[string]bool)
-	for k, v := range fg.features {
+	features := make(map[string]bool, len(snap.features))
+	for k, v := range snap.features {
 		features[k] = v
 	}
 
 	return features
 }
 
+// LastUpdate returns when the license was last validated successfully.
+func (fg *FeatureGate) LastUpdate() time.Time {
+	return fg.snapshot.Load().lastUpdate
+}
+
 // FeatureNotAvailableError represents a feature not available error
 type FeatureNotAvailableError struct {
 	Feature string
@@ -143,13 +265,16 @@ func RequireFeatureFunc(fg *FeatureGate, featureName string) func() error {
 }
 
 // LicenseMiddleware provides license validation middleware
+// One feature gate is shared by every request, so requests never wait on
+// the license server.
 func LicenseMiddleware(client *Client) gin.HandlerFunc {
+	fg := NewFeatureGate(client)
+
 	return func(c *gin.Context) {
 		// Add license client to context
 		c.Set("license_client", client)
 
 		// Add feature gate to context
-		fg := NewFeatureGate(client)
 		c.Set("feature_gate", fg)
 
 		c.Next()
@@ -184,4 +309,4 @@ func GetLicenseClient(c *gin.Context) (*Client, error) {
 	}
 
 	return licenseClient, nil
-}
\ No newline at end of file
+}
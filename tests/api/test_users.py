@@ -1,5 +1,6 @@
 """API tests for user management endpoints."""
 
+import pytest
 from conftest import auth_header
 
 
@@ -30,6 +31,31 @@ class TestListUsers:
         data = response.get_json()
         assert data["pagination"]["per_page"] == 5
 
+    def test_list_users_cursor(self, client, admin_token):
+        response = client.get(
+            "/api/v1/users?cursor=&per_page=1",
+            headers=auth_header(admin_token),
+        )
+        assert response.status_code == 200
+        data = response.get_json()
+        assert len(data["users"]) == 1
+        assert "next_cursor" in data["pagination"]
+
+    @pytest.mark.parametrize("cursor", [
+        "!!!!",  # Not base64
+        "bm90IGpzb24",  # not json
+        "WyJ5ZXN0ZXJkYXkiLDFd",  # ["yesterday",1]
+        "WzFd",  # [1]
+        "WzEsMl0",  # [1,2]
+    ])
+    def test_list_users_malformed_cursor(self, client, admin_token, cursor):
+        response = client.get(
+            f"/api/v1/users?cursor={cursor}",
+            headers=auth_header(admin_token),
+        )
+        assert response.status_code == 400
+        assert response.get_json()["error"] == "Invalid cursor"
+
 
 class TestCreateUser:
     """Tests for POST /api/v1/users."""
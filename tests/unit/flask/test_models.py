@@ -2,6 +2,7 @@
 
 import os
 import sys
+from datetime import datetime
 
 import pytest
 
@@ -13,9 +14,11 @@ from app.config import TestingConfig
 from app.models import (
     create_user,
     delete_user,
+    get_db,
     get_user_by_email,
     get_user_by_id,
     list_users,
+    list_users_after,
     update_user,
 )
 
@@ -125,3 +128,56 @@ class TestUserCRUD:
         users, total = list_users(page=1, per_page=10)
         assert total >= 3
         assert len(users) >= 3
+
+
+class TestKeysetPagination:
+    """Tests for list_users_after."""
+
+    @pytest.fixture
+    def users(self, ctx):
+        """Four users, the middle two created at the same instant."""
+        db = get_db()
+        created = [
+            datetime(2000, 1, 1),
+            datetime(2000, 1, 2),
+            datetime(2000, 1, 2),
+            datetime(2000, 1, 3),
+        ]
+        users = []
+        for i, created_at in enumerate(created):
+            user = create_user(
+                email=f"keyset{i}@example.com",
+                password_hash=hash_password("password123"),
+                full_name=f"Keyset User {i}",
+                role="viewer",
+            )
+            db(db.users.id == user["id"]).update(created_at=created_at)
+            users.append(user["id"])
+        db.commit()
+        return users
+
+    def test_first_page(self, users):
+        page, next_cursor = list_users_after(limit=2)
+        assert [u["id"] for u in page] == users[:2]
+        assert next_cursor == (datetime(2000, 1, 2), users[1])
+
+    def test_tie_broken_by_id(self, users):
+        page, _ = list_users_after(cursor=(datetime(2000, 1, 2), users[1]), limit=1)
+        assert [u["id"] for u in page] == [users[2]]
+
+    def test_last_page(self, users):
+        seen = []
+        cursor = None
+        while True:
+            page, cursor = list_users_after(cursor=cursor, limit=3)
+            seen.extend(u["id"] for u in page)
+            if cursor is None:
+                break
+            assert len(page) == 3
+        assert seen[:4] == users
+        assert len(seen) == len(set(seen))
+
+        # A last page that is exactly full has no cursor either
+        page, cursor = list_users_after(limit=len(seen))
+        assert len(page) == len(seen)
+        assert cursor is None
@@ -0,0 +1,140 @@
+"""Unit tests for the principal cache without Redis."""
+
+import os
+import sys
+
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "../../../services/flask-backend"))
+
+from app import create_app, principal
+from app.auth import hash_password
+from app.config import TestingConfig
+from app.models import (
+    create_user,
+    delete_user,
+    get_db,
+    get_user_by_id,
+    revoke_all_user_tokens,
+    update_user,
+)
+from app.principal import load_principal
+
+
+@pytest.fixture
+def app():
+    app = create_app(TestingConfig)
+    app.config.update(
+        REDIS_URL="",
+        PRINCIPAL_CACHE_TTL=5,
+        PRINCIPAL_CACHE_LOCAL_TTL=2,
+    )
+    yield app
+
+
+@pytest.fixture
+def ctx(app, monkeypatch):
+    monkeypatch.setattr(principal, "_local", principal._LocalCache())
+    with app.app_context():
+        yield
+
+
+@pytest.fixture
+def clock(monkeypatch):
+    """Monotonic time the local cache sees, advanced by the test."""
+    now = [1000.0]
+    monkeypatch.setattr(principal.time, "monotonic", lambda: now[0])
+    return now
+
+
+@pytest.fixture
+def user(ctx):
+    return create_user(
+        email="principal@example.com",
+        password_hash=hash_password("password123"),
+        full_name="Cached User",
+        role="viewer",
+    )
+
+
+class CountingLoader:
+    """Loader that counts its calls."""
+
+    def __init__(self, user=None):
+        self.user = user
+        self.calls = 0
+
+    def __call__(self, user_id):
+        self.calls += 1
+        return self.user
+
+
+class TestLocalCache:
+    """Tests for the in-process layer."""
+
+    def test_hit(self, ctx):
+        loader = CountingLoader(
+            {"id": 7, "email": "a@example.com", "role": "viewer", "is_active": True}
+        )
+        first = load_principal(7, loader)
+        second = load_principal(7, loader)
+        assert loader.calls == 1
+        assert first == second
+        assert first["role"] == "viewer"
+        assert "password_hash" not in first
+
+    def test_hit_is_a_copy(self, ctx):
+        loader = CountingLoader({"id": 7, "role": "viewer"})
+        load_principal(7, loader)["role"] = "admin"
+        assert load_principal(7, loader)["role"] == "viewer"
+
+    def test_expiry(self, ctx, clock):
+        loader = CountingLoader({"id": 7, "role": "viewer"})
+        load_principal(7, loader)
+        clock[0] += 1.9
+        load_principal(7, loader)
+        assert loader.calls == 1
+        clock[0] += 0.2
+        load_principal(7, loader)
+        assert loader.calls == 2
+
+    def test_missing_user_not_cached(self, ctx):
+        loader = CountingLoader()
+        assert load_principal(7, loader) is None
+        loader.user = {"id": 7, "role": "viewer"}
+        assert load_principal(7, loader)["role"] == "viewer"
+        assert loader.calls == 2
+
+    def test_disabled(self, ctx, app):
+        app.config["PRINCIPAL_CACHE_TTL"] = 0
+        loader = CountingLoader({"id": 7, "role": "viewer"})
+        load_principal(7, loader)
+        load_principal(7, loader)
+        assert loader.calls == 2
+
+
+class TestInvalidation:
+    """Tests that user changes drop the cached principal."""
+
+    def test_update_user(self, user):
+        assert load_principal(user["id"], get_user_by_id)["role"] == "viewer"
+        update_user(user["id"], role="admin")
+        assert load_principal(user["id"], get_user_by_id)["role"] == "admin"
+
+    def test_delete_user(self, user):
+        assert load_principal(user["id"], get_user_by_id) is not None
+        delete_user(user["id"])
+        assert load_principal(user["id"], get_user_by_id) is None
+
+    def test_revoke_all_user_tokens(self, user):
+        assert load_principal(user["id"], get_user_by_id)["is_active"]
+
+        # Changed behind the cache's back: the stale copy is served until
+        # the user's sessions are ended
+        db = get_db()
+        db(db.users.id == user["id"]).update(is_active=False)
+        db.commit()
+        assert load_principal(user["id"], get_user_by_id)["is_active"]
+
+        revoke_all_user_tokens(user["id"])
+        assert not load_principal(user["id"], get_user_by_id)["is_active"]